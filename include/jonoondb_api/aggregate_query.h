@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "constraint.h"
+
+namespace jonoondb_api {
+// AggregateQuery recognizes the aggregate queries over a single collection
+// that can be evaluated in parallel, i.e. queries of the form
+//   SELECT <group keys and aggregates> FROM <collection>
+//   [WHERE <condition>] [GROUP BY <keys>]
+// where the aggregates are COUNT, SUM, TOTAL, MIN, MAX and AVG. The query is
+// rewritten into a partial query that is evaluated on disjoint rowid ranges
+// and a merge query that combines the partial rows. Queries using anything
+// else (joins, subqueries, DISTINCT, HAVING, ORDER BY, LIMIT etc.) are not
+// recognized and should be executed as is.
+// SELECT DISTINCT <keys> is treated as a GROUP BY on the keys. Queries that
+// only aggregate plain columns, grouped on at most one column, under a WHERE
+// clause made of column comparisons with literals are also described in a
+// structured form, so they can be answered from the indexes directly.
+class AggregateQuery final {
+ public:
+  enum class AggregateType { NONE, COUNT, SUM, TOTAL, MIN, MAX, AVG };
+
+  // An aggregate over a single column, columnName is empty for COUNT(*).
+  // Items of type NONE are the group by column.
+  struct ColumnAggregateItem {
+    AggregateType type;
+    std::string columnName;
+  };
+
+  // A "column op literal" term of the WHERE clause, the operand is not set
+  // for IS NULL and IS NOT NULL
+  struct Condition {
+    std::string columnName;
+    IndexConstraintOperator op;
+    OperandType operandType = OperandType::INTEGER;
+    std::int64_t intVal = 0;
+    double doubleVal = 0;
+    std::string strVal;
+  };
+
+  static bool TryParse(const std::string& selectStatement,
+                       AggregateQuery& query);
+
+  const std::string& GetCollectionName() const;
+  // The partial query has two parameters, ?1 is the first rowid of the
+  // range and ?2 is one past the last rowid of the range.
+  const std::string& GetPartialStatement() const;
+  std::size_t GetPartialColumnCount() const;
+  // The merge query reads the partial rows from tableName, its columns are
+  // named c0, c1 ... in the order of the partial query columns.
+  std::string GetMergeStatement(const std::string& tableName) const;
+
+  // True if every item is an aggregate over a single column, COUNT(*) or
+  // the group by column, the query is grouped on at most one column and the
+  // WHERE clause is a conjunction of conditions. Only then the functions
+  // below describe the query.
+  bool IsColumnAggregate() const;
+  const std::vector<ColumnAggregateItem>& GetColumnAggregateItems() const;
+  const std::vector<Condition>& GetConditions() const;
+  // Empty if the query has no GROUP BY
+  const std::string& GetGroupByColumn() const;
+  // Returns a statement producing the result of the query from the rows in
+  // tableName, one per group with the value of each item. The columns are
+  // named c0, c1 ... in the order of the items.
+  std::string GetResultStatement(const std::string& tableName) const;
+
+ private:
+  struct SelectItem {
+    AggregateType type;
+    // Position of the first partial column that belongs to this item
+    std::size_t partialColumn;
+    // Column name of the item in the result of the original query, quoted
+    std::string name;
+  };
+
+  std::string m_collectionName;
+  std::string m_partialStatement;
+  std::size_t m_partialColumnCount = 0;
+  std::size_t m_groupByCount = 0;
+  std::vector<SelectItem> m_selectItems;
+  bool m_isColumnAggregate = false;
+  std::string m_groupByColumn;
+  std::vector<ColumnAggregateItem> m_columnAggregateItems;
+  std::vector<Condition> m_conditions;
+};
+}  // namespace jonoondb_api
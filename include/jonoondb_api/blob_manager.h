@@ -1,6 +1,8 @@
 #pragma once
 
 #include <gsl/span.h>
+#include <atomic>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -16,46 +18,160 @@ namespace jonoondb_api {
 struct BlobMetadata;
 class FileNameManager;
 
-// This class is responsible for reading/writing blobs into the data files
+// This class is responsible for reading/writing blobs into the data files.
+// Writers append to one of the write lanes, every lane has its own active
+// data file and compression buffer so batches on different lanes are
+// compressed, copied and flushed in parallel.
 class BlobManager final {
+  struct WriteLane;
+
  public:
+  // Blobs framed and, if asked for, compressed the way they are stored in
+  // the data files. Encoding is most of the work of a put and needs no lock,
+  // so the blobs of a batch can be encoded by many threads.
+  class EncodedBlobs final {
+   public:
+    std::size_t GetCount() const;
+
+   private:
+    friend class BlobManager;
+    std::vector<char> m_data;
+    // Blob i ends at m_ends[i] in m_data
+    std::vector<std::size_t> m_ends;
+    BufferImpl m_compBuffer;
+  };
+
+  // A batch that was appended but is not committed yet. It keeps its
+  // write lane locked until it is committed or destroyed, so the batches of
+  // a lane are committed in the order they are in the lane's files. The
+  // written blobs are discarded if the batch is destroyed uncommitted.
+  // The blobs of a batch with deferSync are not flushed and the length of
+  // its files is not persisted until SyncDeferred is called.
+  class PendingBatch final {
+   public:
+    explicit PendingBatch(bool deferSync = false) : m_deferSync(deferSync) {}
+    PendingBatch(const PendingBatch&) = delete;
+    PendingBatch& operator=(const PendingBatch&) = delete;
+    ~PendingBatch();
+
+   private:
+    friend class BlobManager;
+    // The part of the batch that went into one data file
+    struct FileRun {
+      std::int32_t fileKey;
+      std::shared_ptr<MemoryMappedFile> file;
+      std::size_t startOffset;
+      std::size_t endOffset;
+      // Index of the first blob of the run in the batch
+      std::size_t firstBlob;
+      bool hasBatchMarker;
+    };
+
+    std::unique_lock<std::mutex> m_laneLock;
+    WriteLane* m_lane = nullptr;
+    std::vector<FileRun> m_runs;
+    std::size_t m_blobCount = 0;
+    bool m_committed = false;
+    bool m_deferSync;
+  };
+
   BlobManager(std::unique_ptr<FileNameManager> fileNameManager,
-              size_t maxDataFileSize, bool synchronous);
+              size_t maxDataFileSize, bool synchronous,
+              std::size_t writeLanes);
   BlobManager(const BlobManager&) = delete;
   BlobManager(BlobManager&&) = delete;
   BlobManager& operator=(const BlobManager&) = delete;
   BlobManager& operator=(BlobManager&&) = delete;
+  // Put and this overload of MultiPut write and commit the blobs right away.
+  // They can't be used once batch markers are enabled.
   void Put(const BufferImpl& blob, BlobMetadata& blobMetadata, bool compress);
   void MultiPut(gsl::span<const BufferImpl*> blobs,
                 std::vector<BlobMetadata>& blobMetadataVec, bool compress);
+  // Encodes the blobs and appends them to the batch
+  void MultiPut(gsl::span<const BufferImpl*> blobs,
+                std::vector<BlobMetadata>& blobMetadataVec, bool compress,
+                PendingBatch& batch);
+  // Adds blob to encodedBlobs, it can be called from any thread
+  static void Encode(const BufferImpl& blob, bool compress,
+                     EncodedBlobs& encodedBlobs);
+  // Copies the encoded blobs to the data file of the batch's write lane and
+  // flushes them, blobMetadata[i] receives the location of blob i. The
+  // first append to a batch locks a free write lane. The blobs become part
+  // of the data files once the batch is committed.
+  void Append(const EncodedBlobs& encodedBlobs,
+              gsl::span<BlobMetadata> blobMetadata, PendingBatch& batch);
+  // Persists the length of the files the batch was written to and releases
+  // its write lane. When batch markers are enabled firstDocumentID is
+  // recorded in the files so BlobIterator can tell the ids of the blobs.
+  // Batches have to be committed in document id order. Committing a batch
+  // that is not deferred syncs the deferred batches first, so the persisted
+  // lengths never cover blobs that may not be on disk.
+  void Commit(PendingBatch& batch, std::uint64_t firstDocumentID);
+  // Flushes the blobs of the committed batches with deferSync and persists
+  // the length of their files
+  void SyncDeferred();
+  // Data files of a collection that was written with more than one write
+  // lane don't have the documents in id order. From then on every batch
+  // starts with a marker that has the id of its first document.
+  void EnableBatchMarkers();
   void Get(const BlobMetadata& blobMetadata, BufferImpl& blob);
+  // Reads a batch of blobs, blobs[i] receives the blob for
+  // blobMetadataVec[i]. The reads are done in file and offset order and the
+  // pages are prefetched, so this is cheaper than calling Get for each blob.
+  void MultiGet(const std::vector<BlobMetadata>& blobMetadataVec,
+                std::vector<BufferImpl>& blobs);
   void UnmapLRUDataFiles();
 
  private:
-  inline void Flush(size_t offset, size_t numBytes);
-  void SwitchToNewDataFile();
-  size_t PutInternal(const BufferImpl& blob, BlobMetadata& blobMetadata,
-                     bool compress);
+  // Blobs of a MultiGet that lie within this many bytes of each other are
+  // prefetched with a single hint
+  static const std::int64_t MaxPrefetchSpan = 4 * 1024 * 1024;
+
+  struct WriteLane {
+    std::mutex mutex;
+    FileInfo fileInfo;
+    // Null until the lane writes its first batch
+    std::shared_ptr<MemoryMappedFile> file;
+  };
+
+  std::shared_ptr<MemoryMappedFile> GetReaderFile(std::int32_t fileKey);
+  void ReadBlob(MemoryMappedFile& memMapFile, std::int64_t offset,
+                BufferImpl& blob);
+  WriteLane& LockWriteLane(std::unique_lock<std::mutex>& lock);
+  void SwitchToNewDataFile(WriteLane& lane);
+  void StartFileRun(WriteLane& lane, std::size_t firstBlob,
+                    PendingBatch& batch);
 
-  FileInfo m_currentBlobFileInfo;
-  std::shared_ptr<MemoryMappedFile> m_currentBlobFile;
   std::unique_ptr<FileNameManager> m_fileNameManager;
   size_t m_maxDataFileSize;
   ConcurrentLRUCache<int32_t, MemoryMappedFile> m_readerFiles;
-  std::mutex m_writeMutex;
+  std::vector<std::unique_ptr<WriteLane>> m_writeLanes;
+  std::atomic<std::size_t> m_nextWriteLane{0};
   bool m_synchronous;
-  BufferImpl m_compBuffer;
+  bool m_writeBatchMarkers;
+  // File runs of the committed batches with deferSync, in commit order
+  std::mutex m_deferredRunsMutex;
+  std::vector<PendingBatch::FileRun> m_deferredRuns;
 };
 
+// Iterates over the blobs of a data file in the order they were written.
+// Blobs get consecutive document ids starting at firstDocumentID, until a
+// batch marker sets the id of the blobs that follow it.
 class BlobIterator {
  public:
-  BlobIterator(FileInfo fileInfo);
+  BlobIterator(FileInfo fileInfo, std::uint64_t firstDocumentID);
   std::size_t GetNextBatch(std::vector<BufferImpl>& blobs,
-                           std::vector<BlobMetadata>& metadataVec);
+                           std::vector<BlobMetadata>& metadataVec,
+                           std::vector<std::uint64_t>& documentIDs);
+  // The id the next blob in the file would get
+  std::uint64_t GetNextDocumentID() const;
+  bool HasBatchMarkers() const;
 
  private:
   FileInfo m_fileInfo;
   MemoryMappedFile m_memMapFile;
   char* m_currentOffsetAddress;
+  std::uint64_t m_nextDocumentID;
+  bool m_hasBatchMarkers;
 };
 }  // namespace jonoondb_api
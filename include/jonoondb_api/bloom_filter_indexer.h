@@ -0,0 +1,285 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "chunked_vector.h"
+#include "constraint.h"
+#include "document.h"
+#include "enums.h"
+#include "exception_utils.h"
+#include "field_accessor.h"
+#include "index_info_impl.h"
+#include "index_stat.h"
+#include "indexer.h"
+#include "jonoondb_exceptions.h"
+#include "mama_jennies_bitmap.h"
+#include "null_helpers.h"
+
+namespace jonoondb_api {
+// BloomFilterIndexer keeps one Bloom filter per block of consecutive document
+// IDs. It can only answer equality constraints and the answer is a superset:
+// all the documents of the blocks that may contain the value. Documents are
+// stored in the data files in ID order, so a block maps to a contiguous
+// region of a data file and the blocks that are skipped are never read.
+// Because of the false positives the constraint has to be rechecked by the
+// caller i.e. SQLite.
+class BloomFilterIndexer final : public Indexer {
+ public:
+  // Number of documents covered by one filter and the number of bits we
+  // spend per document. 10 bits with 7 probes gives ~1% false positives.
+  static const std::uint64_t BLOCK_SIZE = 8192;
+  static const std::uint64_t BITS_PER_DOCUMENT = 10;
+  static const int NUM_PROBES = 7;
+
+  static void Construct(const IndexInfoImpl& indexInfo,
+                        const FieldType& fieldType,
+                        std::unique_ptr<FieldAccessor> fieldAccessor,
+                        BloomFilterIndexer*& obj) {
+    std::string errorMsg;
+    if (indexInfo.GetIndexName().size() == 0) {
+      errorMsg = "Argument indexInfo has empty name.";
+    } else if (indexInfo.GetColumnName().size() == 0) {
+      errorMsg = "Argument indexInfo has empty column name.";
+    } else if (indexInfo.GetType() != IndexType::BLOOM_FILTER) {
+      errorMsg =
+          "Argument indexInfo can only have IndexType BLOOM_FILTER for "
+          "BloomFilterIndexer.";
+    } else if (!IsValidFieldType(fieldType)) {
+      std::ostringstream ss;
+      ss << "Argument fieldType " << GetFieldString(fieldType)
+         << " is not valid for BloomFilterIndexer.";
+      errorMsg = ss.str();
+    }
+
+    if (errorMsg.length() > 0) {
+      throw InvalidArgumentException(errorMsg, __FILE__, __func__, __LINE__);
+    }
+
+    IndexStat indexStat(indexInfo, fieldType);
+    obj = new BloomFilterIndexer(indexStat, std::move(fieldAccessor));
+  }
+
+  static bool IsValidFieldType(FieldType fieldType) {
+    return (fieldType == FieldType::INT8 || fieldType == FieldType::INT16 ||
+            fieldType == FieldType::INT32 || fieldType == FieldType::INT64 ||
+            fieldType == FieldType::FLOAT || fieldType == FieldType::DOUBLE ||
+            fieldType == FieldType::STRING || fieldType == FieldType::BLOB);
+  }
+
+  void Insert(std::uint64_t documentID, const Document& document) override {
+    auto block = documentID / BLOCK_SIZE;
+    while (m_blocks.size() <= block) {
+      // Value initialization zeroes the words
+      m_blocks.emplace_back(new Block());
+    }
+    m_documentCount.store(
+        std::max(m_documentCount.load(std::memory_order_relaxed),
+                 documentID + 1),
+        std::memory_order_release);
+
+    // Nulls are never equal to anything so they are not added to the filter
+    std::uint64_t hash;
+    switch (m_indexStat.GetFieldType()) {
+      case FieldType::FLOAT:
+      case FieldType::DOUBLE: {
+        auto val = m_fieldAccessor->GetFloatValue(document);
+        if (NullHelpers::IsNull(val) && m_fieldAccessor->IsNull(document)) {
+          return;
+        }
+        hash = HashDouble(val);
+        break;
+      }
+      case FieldType::STRING: {
+        std::size_t size;
+        auto val = m_fieldAccessor->GetStringValue(document, size);
+        if (val == nullptr) {
+          return;
+        }
+        hash = HashBytes(val, size);
+        break;
+      }
+      case FieldType::BLOB: {
+        std::size_t size;
+        auto val = m_fieldAccessor->GetBlobValue(document, size);
+        if (val == nullptr) {
+          return;
+        }
+        hash = HashBytes(val, size);
+        break;
+      }
+      default: {
+        auto val = m_fieldAccessor->GetIntegerValue(document);
+        if (NullHelpers::IsNull(val) && m_fieldAccessor->IsNull(document)) {
+          return;
+        }
+        hash = HashInteger(val);
+      }
+    }
+
+    SetBits(*m_blocks[block], hash);
+  }
+
+  const IndexStat& GetIndexStats() override {
+    return m_indexStat;
+  }
+
+  std::shared_ptr<MamaJenniesBitmap> Filter(
+      const Constraint& constraint) override {
+    if (constraint.op != IndexConstraintOperator::EQUAL) {
+      std::ostringstream ss;
+      ss << "IndexConstraintOperator type "
+         << static_cast<std::int32_t>(constraint.op)
+         << " is not valid for BloomFilterIndexer.";
+      throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
+    }
+
+    auto bitmap = std::make_shared<MamaJenniesBitmap>();
+    std::uint64_t hash;
+    if (!TryGetOperandHash(constraint, hash)) {
+      // The operand cannot be equal to any value of this field
+      return bitmap;
+    }
+
+    // Documents can be inserted while we read the filters
+    auto documentCount = m_documentCount.load(std::memory_order_acquire);
+    auto blockCount = m_blocks.size();
+    for (std::size_t block = 0; block < blockCount; block++) {
+      if (MayContain(*m_blocks[block], hash)) {
+        auto end = std::min((block + 1) * BLOCK_SIZE, documentCount);
+        for (auto id = block * BLOCK_SIZE; id < end; id++) {
+          bitmap->Add(id);
+        }
+      }
+    }
+
+    return bitmap;
+  }
+
+  std::shared_ptr<MamaJenniesBitmap> FilterRange(
+      const Constraint& lowerConstraint,
+      const Constraint& upperConstraint) override {
+    throw JonoonDBException(
+        "Range constraints are not supported by BloomFilterIndexer.",
+        __FILE__, __func__, __LINE__);
+  }
+
+ private:
+  static const std::size_t WORDS_PER_BLOCK =
+      BLOCK_SIZE * BITS_PER_DOCUMENT / 64;
+  // Queries test bits while inserts set them
+  typedef std::array<std::atomic<std::uint64_t>, WORDS_PER_BLOCK> Block;
+
+  BloomFilterIndexer(const IndexStat& indexStat,
+                     std::unique_ptr<FieldAccessor> fieldAccessor)
+      : m_indexStat(indexStat), m_fieldAccessor(std::move(fieldAccessor)) {}
+
+  bool TryGetOperandHash(const Constraint& constraint, std::uint64_t& hash) {
+    // Follow the same rules as the other indexers, an operand of a different
+    // kind never matches.
+    switch (m_indexStat.GetFieldType()) {
+      case FieldType::FLOAT:
+      case FieldType::DOUBLE:
+        if (constraint.operandType == OperandType::DOUBLE) {
+          hash = HashDouble(constraint.operand.doubleVal);
+        } else if (constraint.operandType == OperandType::INTEGER) {
+          hash = HashDouble(static_cast<double>(constraint.operand.int64Val));
+        } else {
+          return false;
+        }
+        return true;
+      case FieldType::STRING:
+        if (constraint.operandType != OperandType::STRING) {
+          return false;
+        }
+        hash = HashBytes(constraint.strVal.data(), constraint.strVal.size());
+        return true;
+      case FieldType::BLOB:
+        if (constraint.operandType != OperandType::BLOB) {
+          return false;
+        }
+        hash = HashBytes(constraint.blobVal.GetData(),
+                         constraint.blobVal.GetLength());
+        return true;
+      default:
+        if (constraint.operandType == OperandType::INTEGER) {
+          hash = HashInteger(constraint.operand.int64Val);
+        } else if (constraint.operandType == OperandType::DOUBLE) {
+          // Check if double has no fractional part
+          std::int64_t intVal =
+              static_cast<std::int64_t>(constraint.operand.doubleVal);
+          if (constraint.operand.doubleVal != intVal) {
+            return false;
+          }
+          hash = HashInteger(intVal);
+        } else {
+          return false;
+        }
+        return true;
+    }
+  }
+
+  // splitmix64 finalizer, good enough to spread sequential integers
+  static std::uint64_t HashInteger(std::int64_t val) {
+    std::uint64_t x = static_cast<std::uint64_t>(val);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  static std::uint64_t HashDouble(double val) {
+    if (val == 0) {
+      // -0.0 and 0.0 are equal but have different bits
+      val = 0;
+    }
+    std::int64_t bits;
+    std::memcpy(&bits, &val, sizeof(bits));
+    return HashInteger(bits);
+  }
+
+  // FNV-1a followed by the integer finalizer
+  static std::uint64_t HashBytes(const char* data, std::size_t size) {
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (std::size_t i = 0; i < size; i++) {
+      hash ^= static_cast<std::uint8_t>(data[i]);
+      hash *= 0x100000001b3ULL;
+    }
+    return HashInteger(static_cast<std::int64_t>(hash));
+  }
+
+  // Kirsch-Mitzenmacher double hashing to derive the probes from one hash
+  static void SetBits(Block& block, std::uint64_t hash) {
+    const std::uint64_t numBits = WORDS_PER_BLOCK * 64;
+    std::uint64_t h1 = hash, h2 = (hash >> 32) | 1;
+    for (int i = 0; i < NUM_PROBES; i++) {
+      auto bit = (h1 + i * h2) % numBits;
+      block[bit / 64].fetch_or(1ULL << (bit % 64), std::memory_order_relaxed);
+    }
+  }
+
+  static bool MayContain(const Block& block, std::uint64_t hash) {
+    const std::uint64_t numBits = WORDS_PER_BLOCK * 64;
+    std::uint64_t h1 = hash, h2 = (hash >> 32) | 1;
+    for (int i = 0; i < NUM_PROBES; i++) {
+      auto bit = (h1 + i * h2) % numBits;
+      auto word = block[bit / 64].load(std::memory_order_relaxed);
+      if ((word & (1ULL << (bit % 64))) == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  IndexStat m_indexStat;
+  std::unique_ptr<FieldAccessor> m_fieldAccessor;
+  ChunkedVector<std::unique_ptr<Block>> m_blocks;
+  std::atomic<std::uint64_t> m_documentCount{0};
+};
+}  // namespace jonoondb_api
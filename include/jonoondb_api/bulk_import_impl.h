@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "write_options_impl.h"
+
+namespace jonoondb_api {
+struct BulkImportOptionsImpl {
+  static const std::size_t DefaultBatchSize = 100000;
+
+  BulkImportOptionsImpl()
+      : bigEndianSizes(false),
+        syncEachBatch(false),
+        batchSize(DefaultBatchSize) {}
+  WriteOptionsImpl wo;
+  // The 4 byte size in front of every document is big endian
+  bool bigEndianSizes;
+  // Flush the data files after every batch instead of once at the end
+  bool syncEachBatch;
+  // Maximum number of documents that are inserted together
+  std::size_t batchSize;
+};
+
+struct BulkImportResultImpl {
+  BulkImportResultImpl()
+      : documentCount(0), byteCount(0), elapsedNanoseconds(0) {}
+  std::uint64_t documentCount;
+  // Size of the imported file
+  std::uint64_t byteCount;
+  std::uint64_t elapsedNanoseconds;
+};
+}  // namespace jonoondb_api
@@ -26,7 +26,8 @@ typedef enum jonoondb_status_codes {
   status_indexoutofbounderrorcode = 11,
   status_sqlerrorcode = 12,
   status_fileioerrorcode = 13,
-  status_apimisusecode = 14
+  status_apimisusecode = 14,
+  status_insertqueuefullcode = 15
 } jonoondb_status_codes;
 
 typedef struct status* status_ptr;
@@ -63,6 +64,30 @@ jonoondb_options_getmemorycleanupthreshold(options_ptr opt);
 JONOONDB_API_EXPORT void jonoondb_options_setmemorycleanupthreshold(
     options_ptr opt, uint64_t valueInBytes);
 
+JONOONDB_API_EXPORT uint64_t
+jonoondb_options_getmaxquerythreads(options_ptr opt);
+JONOONDB_API_EXPORT void jonoondb_options_setmaxquerythreads(options_ptr opt,
+                                                             uint64_t value);
+
+JONOONDB_API_EXPORT uint64_t
+jonoondb_options_getmaxinsertthreads(options_ptr opt);
+JONOONDB_API_EXPORT void jonoondb_options_setmaxinsertthreads(options_ptr opt,
+                                                              uint64_t value);
+
+JONOONDB_API_EXPORT uint64_t jonoondb_options_getwritelanes(options_ptr opt);
+JONOONDB_API_EXPORT void jonoondb_options_setwritelanes(options_ptr opt,
+                                                        uint64_t value);
+
+JONOONDB_API_EXPORT uint64_t
+jonoondb_options_getinsertqueuecapacity(options_ptr opt);
+JONOONDB_API_EXPORT void jonoondb_options_setinsertqueuecapacity(
+    options_ptr opt, uint64_t value);
+
+JONOONDB_API_EXPORT bool jonoondb_options_getblockwheninsertqueuefull(
+    options_ptr opt);
+JONOONDB_API_EXPORT void jonoondb_options_setblockwheninsertqueuefull(
+    options_ptr opt, bool value);
+
 //
 // WriteOptions Functions
 //
@@ -184,6 +209,65 @@ JONOONDB_API_EXPORT const char* jonoondb_resultset_getcolumnlabel(
 JONOONDB_API_EXPORT int32_t jonoondb_resultset_isnull(resultset_ptr rs,
                                                       int32_t columnIndex,
                                                       status_ptr* sts);
+// Caller owned buffers for one column of a batch, laid out like Arrow
+// arrays. The values of column columnIndex are converted to type, one of
+// the SqlType values INTEGER, DOUBLE, STRING or BLOB. Bit i of validity (least
+// significant bit first) is set if row i is not null, it needs
+// (maxRows + 7) / 8 bytes. INTEGER and DOUBLE columns fill int64Values or
+// doubleValues, STRING and BLOB columns store the value of row i in
+// data[offsets[i], offsets[i + 1]), so offsets needs maxRows + 1 entries.
+typedef struct jonoondb_column_vector {
+  int32_t columnIndex;
+  int32_t type;
+  uint8_t* validity;
+  int64_t* int64Values;
+  double* doubleValues;
+  int64_t* offsets;
+  char* data;
+  uint64_t dataCapacity;
+} jonoondb_column_vector;
+// Reads up to maxRows rows into the column vectors and returns the number of
+// rows read, 0 once the resultset is consumed. A row that doesn't fit in the
+// data capacity ends the batch and is returned by the next call.
+JONOONDB_API_EXPORT uint64_t jonoondb_resultset_fetchbatch(
+    resultset_ptr rs, jonoondb_column_vector* columns, uint64_t columnCount,
+    uint64_t maxRows, status_ptr* sts);
+// Returns the execution profile of a resultset returned by
+// jonoondb_database_executeselectprofiled as a human readable report. The
+// string stays valid until the next call or until the resultset is destroyed.
+JONOONDB_API_EXPORT const char* jonoondb_resultset_getprofile(
+    resultset_ptr rs, uint64_t** retValSize, status_ptr* sts);
+
+//
+// PreparedStatement Functions
+//
+// Parameters are numbered from 1 and keep their value until they are bound
+// again or cleared. The values are copied, so the arguments can be freed
+// once the bind function returns.
+typedef struct preparedstatement* preparedstatement_ptr;
+JONOONDB_API_EXPORT void jonoondb_preparedstatement_destruct(
+    preparedstatement_ptr ps);
+JONOONDB_API_EXPORT int32_t
+jonoondb_preparedstatement_getparametercount(preparedstatement_ptr ps);
+JONOONDB_API_EXPORT void jonoondb_preparedstatement_bindinteger(
+    preparedstatement_ptr ps, int32_t paramIndex, int64_t val,
+    status_ptr* sts);
+JONOONDB_API_EXPORT void jonoondb_preparedstatement_binddouble(
+    preparedstatement_ptr ps, int32_t paramIndex, double val, status_ptr* sts);
+JONOONDB_API_EXPORT void jonoondb_preparedstatement_bindstring(
+    preparedstatement_ptr ps, int32_t paramIndex, const char* val,
+    uint64_t valLength, status_ptr* sts);
+JONOONDB_API_EXPORT void jonoondb_preparedstatement_bindblob(
+    preparedstatement_ptr ps, int32_t paramIndex, const char* val,
+    uint64_t valLength, status_ptr* sts);
+JONOONDB_API_EXPORT void jonoondb_preparedstatement_bindnull(
+    preparedstatement_ptr ps, int32_t paramIndex, status_ptr* sts);
+JONOONDB_API_EXPORT void jonoondb_preparedstatement_clearbindings(
+    preparedstatement_ptr ps);
+JONOONDB_API_EXPORT resultset_ptr jonoondb_preparedstatement_executeselect(
+    preparedstatement_ptr ps, status_ptr* sts);
+JONOONDB_API_EXPORT int64_t jonoondb_preparedstatement_executedelete(
+    preparedstatement_ptr ps, status_ptr* sts);
 
 //
 // Database Functions
@@ -197,6 +281,9 @@ JONOONDB_API_EXPORT void jonoondb_database_createcollection(
     database_ptr db, const char* name, int32_t schemaType, const char* schema,
     uint64_t schemaSize, indexinfo_ptr* indexes, uint64_t indexesLength,
     status_ptr* sts);
+JONOONDB_API_EXPORT void jonoondb_database_createindex(
+    database_ptr db, const char* collectionName, const indexinfo_ptr indexInfo,
+    status_ptr* sts);
 JONOONDB_API_EXPORT void jonoondb_database_insert(
     database_ptr db, const char* collectionName,
     const jonoondb_buffer_ptr documentData, const write_options_ptr wo,
@@ -205,13 +292,84 @@ JONOONDB_API_EXPORT void jonoondb_database_multi_insert(
     database_ptr db, const char* collectionName, uint64_t collectionNameLength,
     const jonoondb_buffer_ptr* documentArr, uint64_t documentArrLength,
     const write_options_ptr wo, status_ptr* sts);
+// Completion callback of the async inserts, sts is null if the documents were
+// inserted. They get consecutive ids starting with firstDocumentID. Otherwise
+// sts has the error and it is destroyed after the callback returns. The
+// callbacks of a collection are called one at a time on its writer thread.
+typedef void (*jonoondb_insert_callback)(void* context,
+                                         uint64_t firstDocumentID,
+                                         status_ptr sts);
+// The async inserts copy the documents into the insert queue of the
+// collection and return, callback is called with context once they are
+// inserted. If sts is set the documents were not queued and callback is not
+// called.
+JONOONDB_API_EXPORT void jonoondb_database_insert_async(
+    database_ptr db, const char* collectionName,
+    const jonoondb_buffer_ptr documentData, const write_options_ptr wo,
+    jonoondb_insert_callback callback, void* context, status_ptr* sts);
+JONOONDB_API_EXPORT void jonoondb_database_multi_insert_async(
+    database_ptr db, const char* collectionName, uint64_t collectionNameLength,
+    const jonoondb_buffer_ptr* documentArr, uint64_t documentArrLength,
+    const write_options_ptr wo, jonoondb_insert_callback callback,
+    void* context, status_ptr* sts);
+// Options of jonoondb_database_bulkimport. compress and verifyDocuments are
+// the write options of the documents. bigEndianSizes tells the byte order of
+// the 4 byte size in front of every document. Unless syncEachBatch is set
+// the data files are synced once at the end of the import instead of after
+// every batch of batchSize documents, a batchSize of 0 uses the default.
+typedef struct jonoondb_bulkimport_options {
+  bool compress;
+  bool verifyDocuments;
+  bool bigEndianSizes;
+  bool syncEachBatch;
+  uint64_t batchSize;
+} jonoondb_bulkimport_options;
+typedef struct jonoondb_bulkimport_result {
+  uint64_t documentCount;
+  uint64_t byteCount;
+  uint64_t elapsedNanoseconds;
+} jonoondb_bulkimport_result;
+// Inserts the documents of the file at filePath, the result has the number
+// of documents and bytes that were imported and how long it took. If sts is
+// set the documents of the batches before the failed one are inserted.
+JONOONDB_API_EXPORT void jonoondb_database_bulkimport(
+    database_ptr db, const char* collectionName, const char* filePath,
+    const jonoondb_bulkimport_options* opt, jonoondb_bulkimport_result* result,
+    status_ptr* sts);
 JONOONDB_API_EXPORT resultset_ptr
 jonoondb_database_executeselect(database_ptr db, const char* selectStmt,
                                 uint64_t selectStmtLength, status_ptr* sts);
+// Like jonoondb_database_executeselect but also records the plan, the time
+// and rows of every stage and the storage counters of the query
+JONOONDB_API_EXPORT resultset_ptr jonoondb_database_executeselectprofiled(
+    database_ptr db, const char* selectStmt, uint64_t selectStmtLength,
+    status_ptr* sts);
 JONOONDB_API_EXPORT int64_t jonoondb_database_delete(database_ptr db,
                                                      const char* deleteStmt,
                                                      uint64_t deleteStmtLength,
                                                      status_ptr* sts);
+JONOONDB_API_EXPORT preparedstatement_ptr
+jonoondb_database_prepare(database_ptr db, const char* stmt,
+                          uint64_t stmtLength, status_ptr* sts);
+// A counter or latency histogram of the engine, the same rows are returned
+// by SELECT * FROM jonoondb_stats. For counters count is the value and the
+// time fields are 0. For latencies count is the number of samples and the
+// percentiles are the upper bound of the power of 2 bucket they fall in.
+// The stats are shared by all the databases of the process.
+typedef struct jonoondb_engine_stat {
+  const char* name;
+  int32_t isLatency;
+  uint64_t count;
+  uint64_t totalNanoseconds;
+  uint64_t p50Nanoseconds;
+  uint64_t p99Nanoseconds;
+  uint64_t maxNanoseconds;
+} jonoondb_engine_stat;
+// Copies up to statsCapacity stats into stats and returns the number of
+// stats there are, which can be more than statsCapacity
+JONOONDB_API_EXPORT uint64_t jonoondb_database_getenginestats(
+    database_ptr db, jonoondb_engine_stat* stats, uint64_t statsCapacity,
+    status_ptr* sts);
 
 #ifdef __cplusplus
 }  // extern "C"
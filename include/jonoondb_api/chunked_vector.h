@@ -0,0 +1,202 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace jonoondb_api {
+// ChunkedVector is an append-only vector that one writer grows while any
+// number of readers index into it without taking locks. Elements live in
+// chunks that double in size and are never moved, so references to them
+// stay valid for the lifetime of the vector. The writer constructs new
+// elements first and then publishes the new size with a release store. A
+// reader that loads the size with acquire sees every element below it fully
+// constructed and never looks at the ones above it.
+template <typename T>
+class ChunkedVector final {
+ public:
+  class const_iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef const T& reference;
+
+    const_iterator(const ChunkedVector* vector, std::size_t index)
+        : m_vector(vector), m_index(index), m_chunk(0) {
+      m_current = vector->m_chunks[0].load(std::memory_order_relaxed);
+      m_chunkEnd = m_current + FirstChunkSize;
+    }
+
+    const T& operator*() const {
+      return *m_current;
+    }
+
+    const T* operator->() const {
+      return m_current;
+    }
+
+    const_iterator& operator++() {
+      m_index++;
+      if (++m_current == m_chunkEnd) {
+        // The next chunk is only null once we have reached the end
+        m_chunk++;
+        m_current =
+            m_vector->m_chunks[m_chunk].load(std::memory_order_relaxed);
+        m_chunkEnd =
+            m_current == nullptr ? nullptr : m_current + GetChunkSize(m_chunk);
+      }
+      return *this;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return m_index == other.m_index;
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return m_index != other.m_index;
+    }
+
+   private:
+    const ChunkedVector* m_vector;
+    std::size_t m_index;
+    std::size_t m_chunk;
+    const T* m_current;
+    const T* m_chunkEnd;
+  };
+
+  ChunkedVector() {
+    for (auto& chunk : m_chunks) {
+      chunk.store(nullptr, std::memory_order_relaxed);
+    }
+    // The first chunk always exists so iterators never start on a null chunk
+    m_chunks[0].store(std::allocator<T>().allocate(FirstChunkSize),
+                      std::memory_order_relaxed);
+  }
+
+  ~ChunkedVector() {
+    auto count = m_size.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < count; i++) {
+      (*this)[i].~T();
+    }
+
+    for (std::size_t i = 0; i < ChunkCount; i++) {
+      auto chunk = m_chunks[i].load(std::memory_order_relaxed);
+      if (chunk != nullptr) {
+        std::allocator<T>().deallocate(chunk, GetChunkSize(i));
+      }
+    }
+  }
+
+  ChunkedVector(const ChunkedVector&) = delete;
+  ChunkedVector& operator=(const ChunkedVector&) = delete;
+
+  // The number of published elements
+  std::size_t size() const {
+    return m_size.load(std::memory_order_acquire);
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  // index has to be less than a size() loaded by the caller
+  const T& operator[](std::size_t index) const {
+    std::size_t chunk, offset;
+    Locate(index, chunk, offset);
+    return m_chunks[chunk].load(std::memory_order_relaxed)[offset];
+  }
+
+  T& operator[](std::size_t index) {
+    std::size_t chunk, offset;
+    Locate(index, chunk, offset);
+    return m_chunks[chunk].load(std::memory_order_relaxed)[offset];
+  }
+
+  // end() loads the size once, so a range based for loop visits a consistent
+  // prefix of the vector even if elements are appended while it runs
+  const_iterator begin() const {
+    return const_iterator(this, 0);
+  }
+
+  const_iterator end() const {
+    return const_iterator(this, size());
+  }
+
+  // Only the writer may call the functions below
+  template <typename... Args>
+  void emplace_back(Args&&... args) {
+    auto count = m_size.load(std::memory_order_relaxed);
+    new (GetSlot(count)) T(std::forward<Args>(args)...);
+    m_size.store(count + 1, std::memory_order_release);
+  }
+
+  void push_back(const T& val) {
+    emplace_back(val);
+  }
+
+  // Appends [first, last) and publishes all the elements with one store
+  template <typename Iter>
+  void append(Iter first, Iter last) {
+    auto count = m_size.load(std::memory_order_relaxed);
+    for (; first != last; ++first, ++count) {
+      new (GetSlot(count)) T(*first);
+    }
+    m_size.store(count, std::memory_order_release);
+  }
+
+ private:
+  // Chunk i holds FirstChunkSize * 2^i elements, 56 chunks cover every
+  // index that fits in 64 bits
+  static const std::size_t FirstChunkBits = 8;
+  static const std::size_t FirstChunkSize = std::size_t(1) << FirstChunkBits;
+  static const std::size_t ChunkCount = 64 - FirstChunkBits;
+
+  static std::size_t GetChunkSize(std::size_t chunk) {
+    return FirstChunkSize << chunk;
+  }
+
+  static std::size_t FloorLog2(std::uint64_t val) {
+#if defined(_MSC_VER)
+    unsigned long bit;
+    _BitScanReverse64(&bit, val);
+    return bit;
+#else
+    return 63 - __builtin_clzll(val);
+#endif
+  }
+
+  static void Locate(std::size_t index, std::size_t& chunk,
+                     std::size_t& offset) {
+    auto pos = static_cast<std::uint64_t>(index) + FirstChunkSize;
+    auto bit = FloorLog2(pos);
+    chunk = bit - FirstChunkBits;
+    offset = static_cast<std::size_t>(pos - (std::uint64_t(1) << bit));
+  }
+
+  T* GetSlot(std::size_t index) {
+    std::size_t chunk, offset;
+    Locate(index, chunk, offset);
+    auto data = m_chunks[chunk].load(std::memory_order_relaxed);
+    if (data == nullptr) {
+      // Readers never look at this chunk before the size that covers it is
+      // published, the release store of the size orders it for them
+      data = std::allocator<T>().allocate(GetChunkSize(chunk));
+      m_chunks[chunk].store(data, std::memory_order_relaxed);
+    }
+    return data + offset;
+  }
+
+  std::array<std::atomic<T*>, ChunkCount> m_chunks;
+  std::atomic<std::size_t> m_size{0};
+};
+}  // namespace jonoondb_api
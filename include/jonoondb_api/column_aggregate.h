@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace jonoondb_api {
+// ColumnAggregate accumulates the non null values of a column the same way
+// the SQLite aggregate functions do, so COUNT, SUM, TOTAL, AVG, MIN and MAX
+// can be answered from it directly. Values have to be added in documentID
+// order for the double sums to match the ones SQLite computes.
+struct ColumnAggregate {
+  void Add(std::int64_t val) {
+    // SQLite keeps the exact integer sum for SUM and a double sum for TOTAL
+    // and AVG, integer overflow makes SUM fail
+    doubleSum += val;
+    if (!intSumOverflow) {
+      const auto maxVal = std::numeric_limits<std::int64_t>::max();
+      const auto minVal = std::numeric_limits<std::int64_t>::min();
+      if ((val > 0 && intSum > maxVal - val) ||
+          (val < 0 && intSum < minVal - val)) {
+        intSumOverflow = true;
+      } else {
+        intSum += val;
+      }
+    }
+
+    if (count == 0 || val < intMin) {
+      intMin = val;
+    }
+    if (count == 0 || val > intMax) {
+      intMax = val;
+    }
+    count++;
+  }
+
+  void Add(double val) {
+    doubleSum += val;
+    if (count == 0 || val < doubleMin) {
+      doubleMin = val;
+    }
+    if (count == 0 || val > doubleMax) {
+      doubleMax = val;
+    }
+    count++;
+  }
+
+  // Number of non null values
+  std::uint64_t count = 0;
+  // True if the values are integers, only the int members are valid for
+  // MIN, MAX and SUM in that case
+  bool isInteger = false;
+  bool intSumOverflow = false;
+  std::int64_t intSum = 0;
+  std::int64_t intMin = 0;
+  std::int64_t intMax = 0;
+  double doubleSum = 0;
+  double doubleMin = 0;
+  double doubleMax = 0;
+};
+}  // namespace jonoondb_api
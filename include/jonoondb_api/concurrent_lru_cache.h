@@ -74,7 +74,8 @@ class ConcurrentLRUCache {
     }
   }
 
-  void PerformEviction() {
+  // Returns the number of evicted entries
+  size_t PerformEviction() {
     std::list<EvictionEntry<T1, T2>> keysToEvict;
 
     {
@@ -130,6 +131,8 @@ class ConcurrentLRUCache {
         m_map.erase(item.Key);
       }
     }
+
+    return keysToEvict.size();
   }
 
  private:
@@ -14,7 +14,9 @@ enum class IndexConstraintOperator : std::int8_t {
   MATCH,
   LIKE,
   GLOB,
-  REGEX
+  REGEX,
+  IS_NULL,
+  IS_NOT_NULL
 };
 
 // Forward declarations
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <assert.h>
+#include <algorithm>
+#include <future>
+#include <memory>
 #include <string>
 #include <vector>
 #include "cdatabase.h"
@@ -57,90 +60,92 @@ class ThrowOnError {
  public:
   ~ThrowOnError() noexcept(false) {
     if (m_status.opaque) {
-      switch (jonoondb_status_code(m_status.opaque)) {
-        case status_genericerrorcode:
-          throw JonoonDBException(jonoondb_status_message(m_status.opaque),
-                                  jonoondb_status_file(m_status.opaque),
-                                  jonoondb_status_function(m_status.opaque),
-                                  jonoondb_status_line(m_status.opaque));
-        case status_invalidargumentcode:
-          throw InvalidArgumentException(
-              jonoondb_status_message(m_status.opaque),
-              jonoondb_status_file(m_status.opaque),
-              jonoondb_status_function(m_status.opaque),
-              jonoondb_status_line(m_status.opaque));
-        case status_missingdatabasefilecode:
-          throw MissingDatabaseFileException(
-              jonoondb_status_message(m_status.opaque),
-              jonoondb_status_file(m_status.opaque),
-              jonoondb_status_function(m_status.opaque),
-              jonoondb_status_line(m_status.opaque));
-        case status_missingdatabasefoldercode:
-          throw MissingDatabaseFolderException(
-              jonoondb_status_message(m_status.opaque),
-              jonoondb_status_file(m_status.opaque),
-              jonoondb_status_function(m_status.opaque),
-              jonoondb_status_line(m_status.opaque));
-        case status_outofmemoryerrorcode:
-          throw OutOfMemoryException(jonoondb_status_message(m_status.opaque),
-                                     jonoondb_status_file(m_status.opaque),
-                                     jonoondb_status_function(m_status.opaque),
-                                     jonoondb_status_line(m_status.opaque));
-        case status_duplicatekeyerrorcode:
-          throw DuplicateKeyException(jonoondb_status_message(m_status.opaque),
-                                      jonoondb_status_file(m_status.opaque),
-                                      jonoondb_status_function(m_status.opaque),
-                                      jonoondb_status_line(m_status.opaque));
-        case status_collectionalreadyexistcode:
-          throw CollectionAlreadyExistException(
-              jonoondb_status_message(m_status.opaque),
-              jonoondb_status_file(m_status.opaque),
-              jonoondb_status_function(m_status.opaque),
-              jonoondb_status_line(m_status.opaque));
-        case status_indexalreadyexistcode:
-          throw IndexAlreadyExistException(
-              jonoondb_status_message(m_status.opaque),
-              jonoondb_status_file(m_status.opaque),
-              jonoondb_status_function(m_status.opaque),
-              jonoondb_status_line(m_status.opaque));
-        case status_collectionnotfoundcode:
-          throw CollectionNotFoundException(
-              jonoondb_status_message(m_status.opaque),
-              jonoondb_status_file(m_status.opaque),
-              jonoondb_status_function(m_status.opaque),
-              jonoondb_status_line(m_status.opaque));
-        case status_invalidschemaerrorcode:
-          throw InvalidSchemaException(
-              jonoondb_status_message(m_status.opaque),
-              jonoondb_status_file(m_status.opaque),
-              jonoondb_status_function(m_status.opaque),
-              jonoondb_status_line(m_status.opaque));
-        case status_indexoutofbounderrorcode:
-          throw IndexOutOfBoundException(
-              jonoondb_status_message(m_status.opaque),
-              jonoondb_status_file(m_status.opaque),
-              jonoondb_status_function(m_status.opaque),
-              jonoondb_status_line(m_status.opaque));
-        case status_sqlerrorcode:
-          throw SQLException(jonoondb_status_message(m_status.opaque),
-                             jonoondb_status_file(m_status.opaque),
-                             jonoondb_status_function(m_status.opaque),
-                             jonoondb_status_line(m_status.opaque));
-        case status_fileioerrorcode:
-          throw FileIOException(jonoondb_status_message(m_status.opaque),
-                                jonoondb_status_file(m_status.opaque),
-                                jonoondb_status_function(m_status.opaque),
-                                jonoondb_status_line(m_status.opaque));
-        case status_apimisusecode:
-          throw ApiMisuseException(jonoondb_status_message(m_status.opaque),
-                                   jonoondb_status_file(m_status.opaque),
-                                   jonoondb_status_function(m_status.opaque),
-                                   jonoondb_status_line(m_status.opaque));
-        default:
-          // this should not happen
-          assert(false);
-          throw std::runtime_error(jonoondb_status_message(m_status.opaque));
-      }
+      Throw(m_status.opaque);
+    }
+  }
+
+  // Throws the exception that matches the code of sts, sts is not destroyed
+  static void Throw(status_ptr sts) {
+    switch (jonoondb_status_code(sts)) {
+      case status_genericerrorcode:
+        throw JonoonDBException(jonoondb_status_message(sts),
+                                jonoondb_status_file(sts),
+                                jonoondb_status_function(sts),
+                                jonoondb_status_line(sts));
+      case status_invalidargumentcode:
+        throw InvalidArgumentException(jonoondb_status_message(sts),
+                                       jonoondb_status_file(sts),
+                                       jonoondb_status_function(sts),
+                                       jonoondb_status_line(sts));
+      case status_missingdatabasefilecode:
+        throw MissingDatabaseFileException(jonoondb_status_message(sts),
+                                           jonoondb_status_file(sts),
+                                           jonoondb_status_function(sts),
+                                           jonoondb_status_line(sts));
+      case status_missingdatabasefoldercode:
+        throw MissingDatabaseFolderException(jonoondb_status_message(sts),
+                                             jonoondb_status_file(sts),
+                                             jonoondb_status_function(sts),
+                                             jonoondb_status_line(sts));
+      case status_outofmemoryerrorcode:
+        throw OutOfMemoryException(jonoondb_status_message(sts),
+                                   jonoondb_status_file(sts),
+                                   jonoondb_status_function(sts),
+                                   jonoondb_status_line(sts));
+      case status_duplicatekeyerrorcode:
+        throw DuplicateKeyException(jonoondb_status_message(sts),
+                                    jonoondb_status_file(sts),
+                                    jonoondb_status_function(sts),
+                                    jonoondb_status_line(sts));
+      case status_collectionalreadyexistcode:
+        throw CollectionAlreadyExistException(jonoondb_status_message(sts),
+                                              jonoondb_status_file(sts),
+                                              jonoondb_status_function(sts),
+                                              jonoondb_status_line(sts));
+      case status_indexalreadyexistcode:
+        throw IndexAlreadyExistException(jonoondb_status_message(sts),
+                                         jonoondb_status_file(sts),
+                                         jonoondb_status_function(sts),
+                                         jonoondb_status_line(sts));
+      case status_collectionnotfoundcode:
+        throw CollectionNotFoundException(jonoondb_status_message(sts),
+                                          jonoondb_status_file(sts),
+                                          jonoondb_status_function(sts),
+                                          jonoondb_status_line(sts));
+      case status_invalidschemaerrorcode:
+        throw InvalidSchemaException(jonoondb_status_message(sts),
+                                     jonoondb_status_file(sts),
+                                     jonoondb_status_function(sts),
+                                     jonoondb_status_line(sts));
+      case status_indexoutofbounderrorcode:
+        throw IndexOutOfBoundException(jonoondb_status_message(sts),
+                                       jonoondb_status_file(sts),
+                                       jonoondb_status_function(sts),
+                                       jonoondb_status_line(sts));
+      case status_sqlerrorcode:
+        throw SQLException(jonoondb_status_message(sts),
+                           jonoondb_status_file(sts),
+                           jonoondb_status_function(sts),
+                           jonoondb_status_line(sts));
+      case status_fileioerrorcode:
+        throw FileIOException(jonoondb_status_message(sts),
+                              jonoondb_status_file(sts),
+                              jonoondb_status_function(sts),
+                              jonoondb_status_line(sts));
+      case status_apimisusecode:
+        throw ApiMisuseException(jonoondb_status_message(sts),
+                                 jonoondb_status_file(sts),
+                                 jonoondb_status_function(sts),
+                                 jonoondb_status_line(sts));
+      case status_insertqueuefullcode:
+        throw InsertQueueFullException(jonoondb_status_message(sts),
+                                       jonoondb_status_file(sts),
+                                       jonoondb_status_function(sts),
+                                       jonoondb_status_line(sts));
+      default:
+        // this should not happen
+        assert(false);
+        throw std::runtime_error(jonoondb_status_message(sts));
     }
   }
 
@@ -218,6 +223,57 @@ class Options {
     return jonoondb_options_getmemorycleanupthreshold(m_opaque);
   }
 
+  // Aggregate queries over large collections are split across up to this
+  // many threads. Defaults to the number of cores, 1 disables it.
+  void SetMaxQueryThreads(std::size_t value) {
+    jonoondb_options_setmaxquerythreads(m_opaque, value);
+  }
+
+  std::size_t GetMaxQueryThreads() const {
+    return jonoondb_options_getmaxquerythreads(m_opaque);
+  }
+
+  // Large inserts verify and compress their documents on up to this many
+  // threads. Defaults to the number of cores, 1 disables it.
+  void SetMaxInsertThreads(std::size_t value) {
+    jonoondb_options_setmaxinsertthreads(m_opaque, value);
+  }
+
+  std::size_t GetMaxInsertThreads() const {
+    return jonoondb_options_getmaxinsertthreads(m_opaque);
+  }
+
+  // Inserts into a collection from up to this many threads write their
+  // documents to separate data files in parallel. Defaults to 1.
+  void SetWriteLanes(std::size_t value) {
+    jonoondb_options_setwritelanes(m_opaque, value);
+  }
+
+  std::size_t GetWriteLanes() const {
+    return jonoondb_options_getwritelanes(m_opaque);
+  }
+
+  // Maximum number of documents waiting to be inserted by the async inserts
+  // into a collection. Defaults to 100000.
+  void SetInsertQueueCapacity(std::size_t value) {
+    jonoondb_options_setinsertqueuecapacity(m_opaque, value);
+  }
+
+  std::size_t GetInsertQueueCapacity() const {
+    return jonoondb_options_getinsertqueuecapacity(m_opaque);
+  }
+
+  // When the insert queue is full the async inserts wait for space if this
+  // is true, which is the default, otherwise they throw
+  // InsertQueueFullException
+  void SetBlockWhenInsertQueueFull(bool value) {
+    jonoondb_options_setblockwheninsertqueuefull(m_opaque, value);
+  }
+
+  bool GetBlockWhenInsertQueueFull() const {
+    return jonoondb_options_getblockwheninsertqueuefull(m_opaque);
+  }
+
   const options_ptr GetOpaquePtr() const {
     return m_opaque;
   }
@@ -291,6 +347,47 @@ class WriteOptions {
   write_options_ptr m_opaque;
 };
 
+//
+// BulkImportOptions
+//
+// By default the documents are verified and not compressed, the sizes in
+// front of them are little endian and the data files are synced once at the
+// end of the import
+struct BulkImportOptions : jonoondb_bulkimport_options {
+  BulkImportOptions() {
+    compress = false;
+    verifyDocuments = true;
+    bigEndianSizes = false;
+    syncEachBatch = false;
+    batchSize = 0;
+  }
+};
+
+//
+// BulkImportResult
+//
+struct BulkImportResult : jonoondb_bulkimport_result {
+  BulkImportResult() {
+    documentCount = 0;
+    byteCount = 0;
+    elapsedNanoseconds = 0;
+  }
+
+  double GetDocumentsPerSecond() const {
+    if (elapsedNanoseconds == 0) {
+      return 0;
+    }
+    return documentCount * 1e9 / elapsedNanoseconds;
+  }
+
+  double GetMegabytesPerSecond() const {
+    if (elapsedNanoseconds == 0) {
+      return 0;
+    }
+    return byteCount * 1e9 / (1024 * 1024) / elapsedNanoseconds;
+  }
+};
+
 //
 // IndexInfo
 //
@@ -495,6 +592,102 @@ class Buffer {
   jonoondb_buffer_ptr m_opaque;
 };
 
+// A column of a batch read by ResultSet::FetchBatch. It holds up to capacity
+// values of column columnIndex converted to type, one of INTEGER, DOUBLE,
+// STRING or BLOB. The STRING and BLOB values of a batch share dataCapacity
+// bytes. The buffers are laid out like Arrow arrays.
+class ColumnVector {
+ public:
+  ColumnVector(std::int32_t columnIndex, SqlType type, std::size_t capacity,
+               std::size_t dataCapacity = 0)
+      : m_columnIndex(columnIndex),
+        m_type(type),
+        m_capacity(capacity),
+        m_validity((capacity + 7) / 8) {
+    if (type == SqlType::INTEGER) {
+      m_int64Values.resize(capacity);
+    } else if (type == SqlType::DOUBLE) {
+      m_doubleValues.resize(capacity);
+    } else {
+      m_offsets.resize(capacity + 1);
+      m_data.resize(dataCapacity);
+    }
+  }
+
+  std::int32_t GetColumnIndex() const {
+    return m_columnIndex;
+  }
+
+  SqlType GetType() const {
+    return m_type;
+  }
+
+  std::size_t GetCapacity() const {
+    return m_capacity;
+  }
+
+  bool IsNull(std::size_t row) const {
+    return (m_validity[row / 8] & (1 << (row % 8))) == 0;
+  }
+
+  std::int64_t GetInteger(std::size_t row) const {
+    return m_int64Values[row];
+  }
+
+  double GetDouble(std::size_t row) const {
+    return m_doubleValues[row];
+  }
+
+  // Returns the value of a STRING or BLOB column
+  StringView GetString(std::size_t row) const {
+    return StringView(m_data.data() + m_offsets[row],
+                      m_offsets[row + 1] - m_offsets[row]);
+  }
+
+  const std::uint8_t* GetValidity() const {
+    return m_validity.data();
+  }
+
+  const std::int64_t* GetInt64Values() const {
+    return m_int64Values.data();
+  }
+
+  const double* GetDoubleValues() const {
+    return m_doubleValues.data();
+  }
+
+  const std::int64_t* GetOffsets() const {
+    return m_offsets.data();
+  }
+
+  const char* GetData() const {
+    return m_data.data();
+  }
+
+ private:
+  friend class ResultSet;
+
+  jonoondb_column_vector GetColumnVector() {
+    return jonoondb_column_vector{m_columnIndex,
+                                  static_cast<int32_t>(m_type),
+                                  m_validity.data(),
+                                  m_int64Values.data(),
+                                  m_doubleValues.data(),
+                                  m_offsets.data(),
+                                  m_data.data(),
+                                  m_data.size()};
+  }
+
+  std::int32_t m_columnIndex;
+  SqlType m_type;
+  std::size_t m_capacity;
+  std::vector<std::uint8_t> m_validity;
+  std::vector<std::int64_t> m_int64Values;
+  std::vector<double> m_doubleValues;
+  std::vector<std::int64_t> m_offsets;
+  std::vector<char> m_data;
+};
+
 class ResultSet {
  public:
   ResultSet(resultset_ptr opaque) : m_opaque(opaque) {}
@@ -578,6 +771,16 @@ class ResultSet {
         m_opaque, columnIndex, ThrowOnError{}));
   }
 
+  // Returns the execution profile of a resultset returned by
+  // Database::ExecuteSelectProfiled
+  StringView GetProfile() {
+    std::uint64_t size;
+    std::uint64_t* sizePtr = &size;
+    const char* str =
+        jonoondb_resultset_getprofile(m_opaque, &sizePtr, ThrowOnError{});
+    return StringView(str, size);
+  }
+
   StringView GetColumnLabel(std::int32_t columnIndex) {
     std::uint64_t size;
     std::uint64_t* sizePtr = &size;
@@ -594,11 +797,111 @@ class ResultSet {
     return true;
   }
 
+  // Reads the next rows into the columns, as many as the column with the
+  // smallest capacity holds. Returns the number of rows read, 0 once the
+  // resultset is consumed.
+  std::size_t FetchBatch(std::vector<ColumnVector>& columns) {
+    if (columns.empty()) {
+      return 0;
+    }
+
+    std::size_t maxRows = columns[0].GetCapacity();
+    std::vector<jonoondb_column_vector> vectors;
+    for (auto& column : columns) {
+      maxRows = std::min(maxRows, column.GetCapacity());
+      vectors.push_back(column.GetColumnVector());
+    }
+
+    return jonoondb_resultset_fetchbatch(m_opaque, vectors.data(),
+                                         vectors.size(), maxRows,
+                                         ThrowOnError{});
+  }
+
  private:
   resultset_ptr m_opaque;
   Buffer m_tmpStorage;
 };
 
+// A select or delete statement with ? parameters that can be executed
+// repeatedly. Parameters are numbered from 1 and keep their value until they
+// are bound again or cleared.
+class PreparedStatement {
+ public:
+  PreparedStatement(preparedstatement_ptr opaque) : m_opaque(opaque) {}
+
+  PreparedStatement(const PreparedStatement& other) = delete;
+  PreparedStatement(PreparedStatement&& other) {
+    if (this != &other) {
+      this->m_opaque = other.m_opaque;
+      other.m_opaque = nullptr;
+    }
+  }
+
+  ~PreparedStatement() {
+    if (m_opaque != nullptr) {
+      jonoondb_preparedstatement_destruct(m_opaque);
+    }
+  }
+
+  PreparedStatement& operator=(const PreparedStatement& other) = delete;
+  PreparedStatement& operator=(PreparedStatement&& other) {
+    if (this != &other) {
+      if (m_opaque != nullptr) {
+        jonoondb_preparedstatement_destruct(m_opaque);
+      }
+      this->m_opaque = other.m_opaque;
+      other.m_opaque = nullptr;
+    }
+
+    return *this;
+  }
+
+  std::int32_t GetParameterCount() const {
+    return jonoondb_preparedstatement_getparametercount(m_opaque);
+  }
+
+  void BindInteger(std::int32_t paramIndex, std::int64_t val) {
+    jonoondb_preparedstatement_bindinteger(m_opaque, paramIndex, val,
+                                           ThrowOnError{});
+  }
+
+  void BindDouble(std::int32_t paramIndex, double val) {
+    jonoondb_preparedstatement_binddouble(m_opaque, paramIndex, val,
+                                          ThrowOnError{});
+  }
+
+  void BindString(std::int32_t paramIndex, const std::string& val) {
+    jonoondb_preparedstatement_bindstring(m_opaque, paramIndex, val.c_str(),
+                                          val.size(), ThrowOnError{});
+  }
+
+  void BindBlob(std::int32_t paramIndex, const Buffer& val) {
+    jonoondb_preparedstatement_bindblob(m_opaque, paramIndex, val.GetData(),
+                                        val.GetLength(), ThrowOnError{});
+  }
+
+  void BindNull(std::int32_t paramIndex) {
+    jonoondb_preparedstatement_bindnull(m_opaque, paramIndex, ThrowOnError{});
+  }
+
+  void ClearBindings() {
+    jonoondb_preparedstatement_clearbindings(m_opaque);
+  }
+
+  ResultSet ExecuteSelect() {
+    auto rs =
+        jonoondb_preparedstatement_executeselect(m_opaque, ThrowOnError{});
+    return ResultSet(rs);
+  }
+
+  int64_t ExecuteDelete() {
+    return jonoondb_preparedstatement_executedelete(m_opaque, ThrowOnError{});
+  }
+
+ private:
+  preparedstatement_ptr m_opaque;
+};
+
 class Database {
  public:
   // This is a delegating ctor that uses default db options
@@ -628,6 +931,12 @@ class Database {
         schema.c_str(), schema.size(), vec.data(), vec.size(), ThrowOnError{});
   }
 
+  void CreateIndex(const std::string& collectionName,
+                   const IndexInfo& indexInfo) {
+    jonoondb_database_createindex(m_opaque, collectionName.c_str(),
+                                  indexInfo.GetOpaqueType(), ThrowOnError{});
+  }
+
   void Insert(const std::string& collectionName, const Buffer& documentData,
               const WriteOptions& wo = WriteOptions()) {
     jonoondb_database_insert(m_opaque, collectionName.c_str(),
@@ -647,6 +956,56 @@ class Database {
         documents.size(), wo.GetOpaquePtr(), ThrowOnError{});
   }
 
+  // Copies the document into the insert queue of the collection and returns
+  // without waiting for the insert. The future returns the id of the
+  // document or throws the error of the insert.
+  std::future<std::uint64_t> InsertAsync(
+      const std::string& collectionName, const Buffer& documentData,
+      const WriteOptions& wo = WriteOptions()) {
+    auto promise = std::make_unique<std::promise<std::uint64_t>>();
+    auto future = promise->get_future();
+    jonoondb_database_insert_async(
+        m_opaque, collectionName.c_str(), documentData.GetOpaqueType(),
+        wo.GetOpaquePtr(), &Database::OnInsertCompleted, promise.get(),
+        ThrowOnError{});
+    // The callback owns the promise now
+    promise.release();
+    return future;
+  }
+
+  // Like InsertAsync, the documents get consecutive ids and the future
+  // returns the id of the first one
+  std::future<std::uint64_t> MultiInsertAsync(
+      const std::string& collectionName, const std::vector<Buffer>& documents,
+      const WriteOptions& wo = WriteOptions()) {
+    static_assert(sizeof(Buffer) == sizeof(jonoondb_buffer_ptr),
+                  "Critical Error. Size assumptions not correct for Buffer & "
+                  "jonoondb_buffer_ptr.");
+    auto promise = std::make_unique<std::promise<std::uint64_t>>();
+    auto future = promise->get_future();
+    jonoondb_database_multi_insert_async(
+        m_opaque, collectionName.data(), collectionName.size(),
+        reinterpret_cast<const jonoondb_buffer_ptr*>(documents.data()),
+        documents.size(), wo.GetOpaquePtr(), &Database::OnInsertCompleted,
+        promise.get(), ThrowOnError{});
+    promise.release();
+    return future;
+  }
+
+  // Inserts the documents of a file that has the size of every document in
+  // 4 bytes in front of it, like the files written by dbgen_converter. The
+  // file is read through a memory map in batches and the next batch is
+  // verified and compressed while the current one is indexed.
+  BulkImportResult BulkImport(
+      const std::string& collectionName, const std::string& filePath,
+      const BulkImportOptions& options = BulkImportOptions()) {
+    BulkImportResult result;
+    jonoondb_database_bulkimport(m_opaque, collectionName.c_str(),
+                                 filePath.c_str(), &options, &result,
+                                 ThrowOnError{});
+    return result;
+  }
+
   ResultSet ExecuteSelect(const std::string& selectStatement) {
     auto rs =
         jonoondb_database_executeselect(m_opaque, selectStatement.c_str(),
@@ -654,6 +1013,15 @@ class Database {
     return ResultSet(rs);
   }
 
+  // Executes the select statement and records a profile of its execution
+  // that can be read with ResultSet::GetProfile
+  ResultSet ExecuteSelectProfiled(const std::string& selectStatement) {
+    auto rs = jonoondb_database_executeselectprofiled(
+        m_opaque, selectStatement.c_str(), selectStatement.size(),
+        ThrowOnError{});
+    return ResultSet(rs);
+  }
+
   int64_t Delete(const std::string& deleteStatement) {
     auto deletedCnt =
         jonoondb_database_delete(m_opaque, deleteStatement.c_str(),
@@ -661,7 +1029,43 @@ class Database {
     return deletedCnt;
   }
 
+  PreparedStatement Prepare(const std::string& statement) {
+    auto ps = jonoondb_database_prepare(m_opaque, statement.c_str(),
+                                        statement.size(), ThrowOnError{});
+    return PreparedStatement(ps);
+  }
+
+  // Returns the engine counters and latency histograms, they are shared by
+  // all the databases of the process
+  std::vector<jonoondb_engine_stat> GetEngineStats() {
+    std::vector<jonoondb_engine_stat> stats(32);
+    auto count = jonoondb_database_getenginestats(m_opaque, stats.data(),
+                                                  stats.size(), ThrowOnError{});
+    if (count > stats.size()) {
+      stats.resize(count);
+      count = jonoondb_database_getenginestats(m_opaque, stats.data(),
+                                               stats.size(), ThrowOnError{});
+    }
+    stats.resize(count);
+    return stats;
+  }
+
  private:
+  static void OnInsertCompleted(void* context, uint64_t firstDocumentID,
+                                status_ptr sts) {
+    std::unique_ptr<std::promise<std::uint64_t>> promise(
+        static_cast<std::promise<std::uint64_t>*>(context));
+    if (sts) {
+      try {
+        ThrowOnError::Throw(sts);
+      } catch (...) {
+        promise->set_exception(std::current_exception());
+      }
+    } else {
+      promise->set_value(firstDocumentID);
+    }
+  }
+
   database_ptr m_opaque;
 };
 
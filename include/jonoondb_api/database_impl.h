@@ -9,13 +9,18 @@
 #include "database_metadata_manager.h"
 #include "document_collection.h"
 #include "gsl/span.h"
+#include "insert_queue.h"
 #include "options_impl.h"
 #include "query_processor.h"
+#include "thread_pool.h"
 
 namespace jonoondb_api {
 // Forward Declarations
 class BufferImpl;
+struct BulkImportOptionsImpl;
+struct BulkImportResultImpl;
 class IndexInfoImpl;
+class PreparedStatementImpl;
 class ResultSetImpl;
 struct WriteOptionsImpl;
 enum class SchemaType : std::int32_t;
@@ -32,13 +37,29 @@ class DatabaseImpl final {
   void CreateCollection(const std::string& name, SchemaType schemaType,
                         const std::string& schema,
                         const std::vector<IndexInfoImpl*>& indexes);
+  void CreateIndex(const std::string& collectionName,
+                   const IndexInfoImpl& indexInfo);
   void Insert(const char* collectionName, const BufferImpl& documentData,
               const WriteOptionsImpl& wo);
   void MultiInsert(const boost::string_ref& collectionName,
                    gsl::span<const BufferImpl*>& documents,
                    const WriteOptionsImpl& wo);
-  ResultSetImpl ExecuteSelect(const std::string& selectStatement);
+  // Queues the documents in the insert queue of the collection, callback is
+  // called once they are inserted
+  void MultiInsertAsync(const boost::string_ref& collectionName,
+                        gsl::span<const BufferImpl*>& documents,
+                        const WriteOptionsImpl& wo,
+                        InsertQueue::Callback callback);
+  void BulkImport(const std::string& collectionName,
+                  const std::string& filePath,
+                  const BulkImportOptionsImpl& options,
+                  BulkImportResultImpl& result);
+  // Returns the schema text the collection was created with
+  const std::string& GetCollectionSchema(const std::string& collectionName);
+  ResultSetImpl ExecuteSelect(const std::string& selectStatement,
+                              bool collectProfile = false);
   std::int64_t Delete(const std::string& deleteStatement);
+  PreparedStatementImpl Prepare(const std::string& statement);
 
  private:
   std::shared_ptr<DocumentCollection> CreateCollectionInternal(
@@ -47,6 +68,8 @@ class DatabaseImpl final {
       const std::vector<FileInfo>& dataFilesToLoad);
   std::unique_ptr<DatabaseMetadataManager> m_dbMetadataMgrImpl;
   void MemoryWatcherFunc();
+  // Shared by the collections to verify and compress large inserts
+  std::shared_ptr<ThreadPool> m_insertThreadPool;
   // m_collectionNameStore stores the collection name as string,
   // m_collectionContainer just uses string_ref as the key.
   // m_collectionNameStore should be declared before m_collectionContainer. This
@@ -61,6 +84,10 @@ class DatabaseImpl final {
   bool m_shutdownMemWatcher = false;
   std::mutex m_memWatcherMutex;
   std::condition_variable m_memWatcherCV;
+  // The insert queues are created on the first async insert into their
+  // collection
+  std::mutex m_insertQueuesMutex;
+  std::map<boost::string_ref, std::unique_ptr<InsertQueue>> m_insertQueues;
 };
 
 }  // namespace jonoondb_api
@@ -34,6 +34,10 @@ class DatabaseMetadataManager final {
   void AddCollection(const std::string& name, SchemaType schemaType,
                      const std::string& schema,
                      const std::vector<IndexInfoImpl*>& indexes);
+  void AddIndex(const std::string& collectionName,
+                const IndexInfoImpl& indexInfo);
+  void RemoveIndex(const std::string& collectionName,
+                   const std::string& indexName);
   const std::string& GetDBPath() const;
   const std::string& GetDBName() const;
   void GetExistingCollections(std::vector<CollectionMetadata>& collections);
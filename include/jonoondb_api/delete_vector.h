@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <vector>
 #include "jonoondb_api/buffer_impl.h"
 #include "jonoondb_api/guard_funcs.h"
 #include "jonoondb_api/mama_jennies_bitmap.h"
@@ -13,6 +17,11 @@ struct sqlite3_stmt;
 namespace jonoondb_api {
 class DocumentCollection;
 
+// DeleteVector tracks the deleted documents of a collection. Deletes are
+// persisted as rows in an append-only log table, a batch of deletes is written
+// to the log in a single SQLite transaction. Once the log grows as big as the
+// last snapshot it is compacted into a new bitmap snapshot, so the cost of
+// persisting a delete stays amortized constant.
 class DeleteVector final {
  public:
   DeleteVector(const std::string& dbPath, const std::string& dbName,
@@ -24,29 +33,60 @@ class DeleteVector final {
   DeleteVector& operator=(DeleteVector&&) = delete;
 
   void OnDocumentDeleted(std::uint64_t docId);
-  const MamaJenniesBitmap& GetDeleteVectorBitmap();
+  // Persists the ids in one SQLite transaction and only then marks them as
+  // deleted, if it throws nothing is deleted. Ids that are already deleted
+  // are skipped. A transaction collects its ids on its own and passes them
+  // here on commit, so concurrent transactions share no pending state.
+  void OnDocumentsDeleted(const std::vector<std::uint64_t>& docIds);
+  // Returns a snapshot bitmap with the ids of all the live documents, later
+  // inserts and deletes don't change it
+  std::shared_ptr<const MamaJenniesBitmap> GetDeleteVectorBitmap();
+  bool HasDeletes() const;
   void OnDocumentsInserted(std::uint64_t nextDocId);
 
  private:
-  void MaybeReconstructBitmap();
+  void BuildBitmap();
+  void PatchBitmap(std::vector<std::uint64_t> docIds);
+  MamaJenniesBitmap& GetWritableBitmap();
   void InsertEmptyDeleteVector();
+  void WriteToLog(const std::vector<std::uint64_t>& docIds);
+  void MaybeCompactLog();
   void StoreBitmap();
   void LoadBitmap();
+  void LoadLog();
   void InitializeTableAndStatements();
   std::int64_t GetRowCount();
 
   // keep m_dbConnection as first member so it gets destructed in the end, stmts
   // should be destructed first
   std::unique_ptr<sqlite3, void (*)(sqlite3*)> m_dbConnection;
+  // Serializes the writers of the log, m_deletedDocIds and the counts below
+  std::mutex m_deleteMutex;
   std::set<std::uint64_t> m_deletedDocIds;
-  MamaJenniesBitmap m_deleteVecBitmap;
+  // Queries call HasDeletes without m_deleteMutex, so they read this instead
+  // of m_deletedDocIds. It is set once the deletes are in the bitmap.
+  std::atomic<bool> m_hasDeletes{false};
+  // m_deleteVecBitmap has a bit set for every live document. Inserts extend
+  // it right away, deletes are collected here and XORed into it in one go
+  // the next time it is read.
+  std::vector<std::uint64_t> m_unpatchedDocIds;
+  // Guards m_unpatchedDocIds and m_deleteVecBitmap. Queries hold on to the
+  // bitmap while inserts extend it, so it is copied before it is changed if
+  // a query still has it.
+  std::mutex m_patchMutex;
+  std::shared_ptr<MamaJenniesBitmap> m_deleteVecBitmap;
   MamaJenniesBitmap m_deleteVecSerializationBitmap;
-  bool m_isDirty;
+  // Number of ids in the stored snapshot and in the log respectively
+  std::uint64_t m_snapshotDocCount;
+  std::uint64_t m_logDocCount;
   // m_nextDocumentId is equal to next id that will be assigned to a new
   // document inserted into collection
   std::uint64_t m_nextDocumentId;
   std::unique_ptr<sqlite3_stmt, void (*)(sqlite3_stmt*)> m_updateStmt;
   std::unique_ptr<sqlite3_stmt, void (*)(sqlite3_stmt*)> m_selectStmt;
+  std::unique_ptr<sqlite3_stmt, void (*)(sqlite3_stmt*)> m_insertLogStmt;
+  std::unique_ptr<sqlite3_stmt, void (*)(sqlite3_stmt*)> m_selectLogStmt;
+  std::unique_ptr<sqlite3_stmt, void (*)(sqlite3_stmt*)> m_clearLogStmt;
   std::string m_collectionName;
   BufferImpl m_bitmapBuffer;
 };
@@ -1,10 +1,15 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
+#include "blob_manager.h"
 #include "blob_metadata.h"
+#include "chunked_vector.h"
 #include "document_id_generator.h"
 #include "gsl/span.h"
 #include "index_manager.h"
@@ -21,10 +26,17 @@ class IndexStat;
 enum class FieldType : std::int8_t;
 enum class SchemaType : std::int32_t;
 struct Constraint;
-class BlobManager;
 struct FileInfo;
 struct WriteOptionsImpl;
+struct BulkImportOptionsImpl;
+struct BulkImportResultImpl;
 class DeleteVector;
+class FieldAccessor;
+class IDSequence;
+class ValueBatch;
+struct ColumnAggregate;
+struct ValueBitmap;
+class ThreadPool;
 
 class DocumentCollection final {
  public:
@@ -33,26 +45,61 @@ class DocumentCollection final {
                      const std::string& schema,
                      const std::vector<IndexInfoImpl*>& indexes,
                      std::unique_ptr<BlobManager> blobManager,
-                     const std::vector<FileInfo>& dataFilesToLoad);
+                     const std::vector<FileInfo>& dataFilesToLoad,
+                     std::shared_ptr<ThreadPool> insertThreadPool);
 
-  void Insert(const BufferImpl& documentData, const WriteOptionsImpl& wo);
-  void MultiInsert(gsl::span<const BufferImpl*>& documents,
-                   const WriteOptionsImpl& wo);
+  // Insert and MultiInsert return the id of the first inserted document, the
+  // documents of a batch get consecutive ids
+  std::uint64_t Insert(const BufferImpl& documentData,
+                       const WriteOptionsImpl& wo);
+  std::uint64_t MultiInsert(gsl::span<const BufferImpl*>& documents,
+                            const WriteOptionsImpl& wo);
+  // Inserts the documents of a file that has the size of every document in
+  // 4 bytes in front of it. The file is memory mapped and inserted in
+  // batches, the next batch is verified and compressed while the current one
+  // is indexed. If the import fails the batches before the failed one stay
+  // inserted.
+  void BulkImport(const std::string& filePath,
+                  const BulkImportOptionsImpl& options,
+                  BulkImportResultImpl& result);
+  // Builds a new index over the documents already in the collection without
+  // blocking inserts for the duration of the build. The index becomes visible
+  // to queries only after it has caught up with all the inserted documents.
+  void CreateIndex(const IndexInfoImpl& indexInfo);
   const std::string& GetName();
+  // Returns the number of committed documents, deleted ones included. It is
+  // the watermark of the collection: a document is only counted once it is
+  // stored, indexed and in the delete vector, so a query that clips to a
+  // count it loaded once reads a consistent snapshot without blocking
+  // inserts.
+  std::uint64_t GetDocumentCount() const;
   const std::shared_ptr<DocumentSchema>& GetDocumentSchema();
   bool TryGetBestIndex(const std::string& columnName,
                        IndexConstraintOperator op, IndexStat& indexStat);
-  std::shared_ptr<MamaJenniesBitmap> Filter(
-      const std::vector<Constraint>& constraints);
+  // Filter and Scan only return ids below documentCount, which has to be a
+  // value returned by GetDocumentCount
+  std::shared_ptr<const MamaJenniesBitmap> Filter(
+      const std::vector<Constraint>& constraints, std::uint64_t documentCount);
+  // Returns a sequence over the ids of all the live documents that is
+  // generated lazily as it is consumed
+  std::unique_ptr<IDSequence> Scan(int vecSize, std::uint64_t documentCount);
 
   // Document Access Functions
   void GetDocumentAndBuffer(std::uint64_t docID,
                             std::unique_ptr<Document>& document,
                             BufferImpl& buffer) const;
+  // Fetches all the documents in docIDs with a single batched read,
+  // documents[i] is backed by buffers[i] so buffers have to outlive them.
+  void GetDocumentsAndBuffers(
+      const gsl::span<std::uint64_t>& docIDs,
+      std::vector<std::unique_ptr<Document>>& documents,
+      std::vector<BufferImpl>& buffers) const;
 
+  // The string and blob values point into the storage of the indexer, see
+  // Indexer::TryGetStringValue
   bool TryGetBlobFieldFromIndexer(std::uint64_t docID,
                                   const std::string& columnName,
-                                  BufferImpl& val) const;
+                                  const char*& val, std::size_t& size) const;
   bool TryGetIntegerFieldFromIndexer(std::uint64_t docID,
                                      const std::string& columnName,
                                      std::int64_t& val) const;
@@ -61,30 +108,67 @@ class DocumentCollection final {
                                    double& val) const;
   bool TryGetStringFieldFromIndexer(std::uint64_t docID,
                                     const std::string& columnName,
-                                    std::string& val) const;
+                                    const char*& val, std::size_t& size) const;
   void GetDocumentFieldsAsIntegerVector(
-      const gsl::span<std::uint64_t>& docIDs, const std::string& columnName,
-      const std::vector<std::string>& tokens,
+      const gsl::span<std::uint64_t>& docIDs,
+      const FieldAccessor& fieldAccessor,
       std::vector<std::int64_t>& values) const;
   void GetDocumentFieldsAsDoubleVector(const gsl::span<std::uint64_t>& docIDs,
-                                       const std::string& columnName,
-                                       const std::vector<std::string>& tokens,
+                                       const FieldAccessor& fieldAccessor,
                                        std::vector<double>& values) const;
+  // Gathers the values of a batch of documents from a VECTOR index, null
+  // values are added as nulls. Returns false if there is no such index on
+  // the column.
+  bool TryGetStringVectorFromIndexer(const gsl::span<std::uint64_t>& docIDs,
+                                     const std::string& columnName,
+                                     ValueBatch& values) const;
+  bool TryGetBlobVectorFromIndexer(const gsl::span<std::uint64_t>& docIDs,
+                                   const std::string& columnName,
+                                   ValueBatch& values) const;
+  // Aggregates the non null values of columnName over docIDs from a VECTOR
+  // index without reading the documents. Returns false if there is no such
+  // index on the column.
+  bool TryAggregateFromIndexer(const MamaJenniesBitmap& docIDs,
+                               const std::string& columnName,
+                               ColumnAggregate& aggregate) const;
+  // Returns the distinct non null values of columnName in ascending order
+  // with the documents that have them, deleted documents included. Returns
+  // false if there is no inverted index on the column.
+  bool TryGetValueBitmapsFromIndexer(
+      const std::string& columnName,
+      std::vector<ValueBitmap>& valueBitmaps) const;
   void UnmapLRUDataFiles();
-  void AddToDeleteVector(std::uint64_t id);
+  // The ids are persisted together, they become visible once this returns
+  void AddToDeleteVector(const std::vector<std::uint64_t>& ids);
 
  private:
-  void PopulateColumnTypes(
-      const std::vector<IndexInfoImpl*>& indexes,
-      const DocumentSchema& documentSchema,
-      std::unordered_map<std::string, FieldType>& columnTypes);
+  // Indexes the written documents, commits batch and makes the documents
+  // visible. Returns the id of the first document.
+  std::uint64_t CommitDocuments(std::vector<std::unique_ptr<Document>>& docs,
+                                std::vector<BlobMetadata>& blobMetadataVec,
+                                BlobManager::PendingBatch& batch);
+  void IndexExistingDocuments(Indexer& indexer, std::uint64_t startID,
+                              const std::vector<BlobMetadata>& blobs);
+  // Loads the documents at the start of pending that have the next ids
+  void IndexPendingDocuments(std::map<std::uint64_t, BlobMetadata>& pending);
   std::unique_ptr<sqlite3, void (*)(sqlite3*)> m_dbConnection;
   std::unique_ptr<IndexManager> m_indexManager;
   std::shared_ptr<DocumentSchema> m_documentSchema;
   DocumentIDGenerator m_documentIDGenerator;
-  std::vector<BlobMetadata> m_documentIDMap;
+  // Queries read it without locks. A document is indexed before its metadata
+  // is appended here, so its size is the number of documents that queries
+  // can see.
+  ChunkedVector<BlobMetadata> m_documentIDMap;
   std::string m_name;
   std::unique_ptr<BlobManager> m_blobManager;
   std::unique_ptr<DeleteVector> m_deleteVector;
+  // Verifies and compresses the documents of large inserts, it is shared by
+  // all the collections of the database
+  std::shared_ptr<ThreadPool> m_insertThreadPool;
+  // Serializes the writers of m_documentIDMap, so it decides the order in
+  // which concurrent inserts get their ids. Online index creation takes it
+  // to copy the metadata of the documents it has to index and finally to
+  // publish the new index.
+  std::mutex m_insertMutex;
 };
 }  // namespace jonoondb_api
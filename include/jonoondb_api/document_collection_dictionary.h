@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <vector>
 #include "jonoondb_api/field.h"
+#include "jonoondb_api/field_accessor.h"
 
 namespace jonoondb_api {
 // Forward Declarations
@@ -13,13 +14,13 @@ class DocumentCollection;
 
 struct ColumnInfo {
   ColumnInfo(const std::string& colName, FieldType colType,
-             const std::vector<std::string>& colNameTokens)
+             const std::shared_ptr<FieldAccessor>& colFieldAccessor)
       : columnName(colName),
         columnType(colType),
-        columnNameTokens(colNameTokens) {}
+        fieldAccessor(colFieldAccessor) {}
   std::string columnName;
   FieldType columnType;
-  std::vector<std::string> columnNameTokens;
+  std::shared_ptr<FieldAccessor> fieldAccessor;
 };
 
 struct DocumentCollectionInfo {
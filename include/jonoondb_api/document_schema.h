@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
 
 namespace jonoondb_api {
@@ -8,6 +9,7 @@ namespace jonoondb_api {
 enum class FieldType : std::int8_t;
 enum class SchemaType : std::int32_t;
 class Field;
+class FieldAccessor;
 
 class DocumentSchema {
  public:
@@ -18,5 +20,7 @@ class DocumentSchema {
   virtual std::size_t GetRootFieldCount() const = 0;
   virtual void GetRootField(size_t index, Field*& field) const = 0;
   virtual Field* AllocateField() const = 0;
+  virtual std::unique_ptr<FieldAccessor> CreateFieldAccessor(
+      const std::string& fieldName) const = 0;
 };
 }  // namespace jonoondb_api
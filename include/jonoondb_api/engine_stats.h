@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace jonoondb_api {
+enum class EngineCounter : std::int32_t {
+  DOCUMENTS_INSERTED,
+  DOCUMENTS_FETCHED,
+  BYTES_DECOMPRESSED,
+  DATA_FILE_SWITCHES,
+  DATA_FILE_CACHE_HITS,
+  DATA_FILE_CACHE_MISSES,
+  // Data files unmapped by the memory watcher
+  MEMORY_WATCHER_EVICTIONS,
+  DELETE_VECTOR_REBUILDS,
+  DELETE_VECTOR_PATCHES,
+  DELETE_LOG_COMPACTIONS,
+  // Takes from the query connection pool that had to open a connection
+  CONNECTION_POOL_MISSES,
+  COUNT
+};
+
+enum class EngineLatency : std::int32_t {
+  INSERT_BATCH,
+  MSYNC,
+  DECOMPRESSION,
+  CONNECTION_POOL_WAIT,
+  COUNT
+};
+
+// A snapshot of a counter or a latency histogram. For counters count is the
+// value of the counter and the time fields are 0. Percentiles are the upper
+// bound of the power of 2 bucket they fall in.
+struct EngineStat {
+  const char* name;
+  bool isLatency;
+  std::uint64_t count;
+  std::uint64_t totalNanoseconds;
+  std::uint64_t p50Nanoseconds;
+  std::uint64_t p99Nanoseconds;
+  std::uint64_t maxNanoseconds;
+};
+
+// EngineStats keeps process wide counters and latency histograms of the hot
+// paths of the storage and query engine. They are cheap enough to always be
+// on: every thread updates one of a fixed number of cache line aligned
+// shards with relaxed atomic adds, the shards are only summed up when the
+// stats are read.
+class EngineStats final {
+ public:
+  EngineStats() = delete;
+  static void Add(EngineCounter counter, std::uint64_t value = 1);
+  static void Record(EngineLatency latency, std::chrono::nanoseconds duration);
+  // Returns the counters followed by the latencies
+  static std::vector<EngineStat> GetStats();
+};
+
+// Records the time from its construction to its destruction as a sample of
+// latency
+class LatencyTimer final {
+ public:
+  explicit LatencyTimer(EngineLatency latency)
+      : m_latency(latency), m_start(std::chrono::steady_clock::now()) {}
+
+  ~LatencyTimer() {
+    EngineStats::Record(m_latency, std::chrono::steady_clock::now() - m_start);
+  }
+
+  LatencyTimer(const LatencyTimer&) = delete;
+  LatencyTimer& operator=(const LatencyTimer&) = delete;
+
+ private:
+  EngineLatency m_latency;
+  std::chrono::steady_clock::time_point m_start;
+};
+}  // namespace jonoondb_api
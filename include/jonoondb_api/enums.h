@@ -10,6 +10,7 @@ extern SchemaType ToSchemaType(std::int32_t type);
 enum class IndexType : std::int32_t {
   INVERTED_COMPRESSED_BITMAP = 1,
   VECTOR = 2,
+  BLOOM_FILTER = 3,
 };
 JONOONDB_API_EXPORT extern IndexType ToIndexType(std::int32_t type);
 
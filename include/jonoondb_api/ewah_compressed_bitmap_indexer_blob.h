@@ -10,15 +10,16 @@
 #include "jonoondb_api/buffer_impl.h"
 #include "jonoondb_api/constraint.h"
 #include "jonoondb_api/document.h"
-#include "jonoondb_api/document_id_generator.h"
 #include "jonoondb_api/enums.h"
 #include "jonoondb_api/exception_utils.h"
+#include "jonoondb_api/field_accessor.h"
 #include "jonoondb_api/index_info_impl.h"
 #include "jonoondb_api/index_stat.h"
 #include "jonoondb_api/indexer.h"
 #include "jonoondb_api/jonoondb_exceptions.h"
 #include "jonoondb_api/mama_jennies_bitmap.h"
-#include "jonoondb_api/null_helpers.h"
+#include "jonoondb_api/null_bitmap.h"
+#include "jonoondb_api/segmented_bitmap_map.h"
 #include "jonoondb_api/standard_deleters.h"
 #include "jonoondb_api/status_impl.h"
 #include "jonoondb_api/string_utils.h"
@@ -29,6 +30,7 @@ class EWAHCompressedBitmapIndexerBlob final : public Indexer {
  public:
   static void Construct(const IndexInfoImpl& indexInfo,
                         const FieldType& fieldType,
+                        std::unique_ptr<FieldAccessor> fieldAccessor,
                         EWAHCompressedBitmapIndexerBlob*& obj) {
     std::string errorMsg;
     if (indexInfo.GetIndexName().size() == 0) {
@@ -50,10 +52,9 @@ class EWAHCompressedBitmapIndexerBlob final : public Indexer {
       throw InvalidArgumentException(errorMsg, __FILE__, __func__, __LINE__);
     }
 
-    std::vector<std::string> tokens =
-        StringUtils::Split(indexInfo.GetColumnName(), ".");
     IndexStat indexStat(indexInfo, fieldType);
-    obj = new EWAHCompressedBitmapIndexerBlob(indexStat, tokens);
+    obj = new EWAHCompressedBitmapIndexerBlob(indexStat,
+                                              std::move(fieldAccessor));
   }
 
   ~EWAHCompressedBitmapIndexerBlob() override {}
@@ -64,23 +65,21 @@ class EWAHCompressedBitmapIndexerBlob final : public Indexer {
 
   void Insert(std::uint64_t documentID, const Document& document) override {
     std::size_t size = 0;
-    auto val = DocumentUtils::GetBlobValue(document, m_subDoc,
-                                           m_fieldNameTokens, size);
-
-    BufferImpl buffer(const_cast<char*>(val), size, size, nullptr);
-    auto compressedBitmap = m_compressedBitmaps.find(buffer);
-    if (compressedBitmap == m_compressedBitmaps.end()) {
-      auto bm = shared_ptr<MamaJenniesBitmap>(new MamaJenniesBitmap());
-      bm->Add(documentID);
-      m_compressedBitmaps[buffer] = bm;
-    } else {
-      compressedBitmap->second->Add(documentID);
+    auto val = m_fieldAccessor->GetBlobValue(document, size);
+    m_nullBitmap.Add(documentID, val == nullptr);
+    if (val != nullptr) {
+      BufferImpl buffer(const_cast<char*>(val), size, size, nullptr);
+      m_compressedBitmaps.Add(buffer, documentID);
     }
 
     assert(documentID == m_lastInsertedDocId + 1);
     m_lastInsertedDocId = documentID;
   }
 
+  void PublishInserts() override {
+    m_compressedBitmaps.Publish();
+  }
+
   const IndexStat& GetIndexStats() override {
     return m_indexStat;
   }
@@ -98,6 +97,9 @@ class EWAHCompressedBitmapIndexerBlob final : public Indexer {
         return GetBitmapGT(constraint, false);
       case jonoondb_api::IndexConstraintOperator::GREATER_THAN_EQUAL:
         return GetBitmapGT(constraint, true);
+      case jonoondb_api::IndexConstraintOperator::IS_NULL:
+      case jonoondb_api::IndexConstraintOperator::IS_NOT_NULL:
+        return m_nullBitmap.Filter(constraint.op);
       case jonoondb_api::IndexConstraintOperator::MATCH:
         // TODO: Handle this
       default:
@@ -114,32 +116,29 @@ class EWAHCompressedBitmapIndexerBlob final : public Indexer {
     std::vector<std::shared_ptr<MamaJenniesBitmap>> bitmaps;
     if (lowerConstraint.operandType == OperandType::BLOB &&
         upperConstraint.operandType == OperandType::BLOB) {
-      std::map<BufferImpl, std::shared_ptr<MamaJenniesBitmap>>::const_iterator
-          startIter,
-          endIter;
-
-      if (lowerConstraint.op == IndexConstraintOperator::GREATER_THAN_EQUAL) {
-        startIter = m_compressedBitmaps.lower_bound(lowerConstraint.blobVal);
-      } else {
-        startIter = m_compressedBitmaps.upper_bound(lowerConstraint.blobVal);
-      }
-
-      while (startIter != m_compressedBitmaps.end()) {
-        if (startIter->first.GetData() == nullptr) {
-          continue;
-        }
-
-        if (startIter->first < upperConstraint.blobVal) {
-          bitmaps.push_back(startIter->second);
-        } else if (upperConstraint.op ==
-                       IndexConstraintOperator::LESS_THAN_EQUAL &&
-                   startIter->first == upperConstraint.blobVal) {
-          bitmaps.push_back(startIter->second);
+      auto segments = m_compressedBitmaps.GetSegments();
+      for (auto& segment : *segments) {
+        BitmapMap::Map::const_iterator startIter;
+        if (lowerConstraint.op ==
+            IndexConstraintOperator::GREATER_THAN_EQUAL) {
+          startIter = segment->lower_bound(lowerConstraint.blobVal);
         } else {
-          break;
+          startIter = segment->upper_bound(lowerConstraint.blobVal);
         }
 
-        startIter++;
+        while (startIter != segment->end()) {
+          if (startIter->first < upperConstraint.blobVal) {
+            bitmaps.push_back(startIter->second);
+          } else if (upperConstraint.op ==
+                         IndexConstraintOperator::LESS_THAN_EQUAL &&
+                     startIter->first == upperConstraint.blobVal) {
+            bitmaps.push_back(startIter->second);
+          } else {
+            break;
+          }
+
+          startIter++;
+        }
       }
     }
 
@@ -147,19 +146,23 @@ class EWAHCompressedBitmapIndexerBlob final : public Indexer {
   }
 
  private:
+  typedef SegmentedBitmapMap<BufferImpl> BitmapMap;
+
   EWAHCompressedBitmapIndexerBlob(const IndexStat& indexStat,
-                                  std::vector<std::string>& fieldNameTokens)
+                                  std::unique_ptr<FieldAccessor> fieldAccessor)
       : m_indexStat(indexStat),
-        m_fieldNameTokens(fieldNameTokens),
+        m_fieldAccessor(std::move(fieldAccessor)),
         m_lastInsertedDocId(-1) {}
 
   std::shared_ptr<MamaJenniesBitmap> GetBitmapEQ(const Constraint& constraint) {
     std::vector<std::shared_ptr<MamaJenniesBitmap>> bitmaps;
     if (constraint.operandType == OperandType::BLOB) {
-      auto iter = m_compressedBitmaps.find(constraint.blobVal);
-      if (iter != m_compressedBitmaps.end() &&
-          iter->first.GetData() != nullptr) {
-        bitmaps.push_back(iter->second);
+      auto segments = m_compressedBitmaps.GetSegments();
+      for (auto& segment : *segments) {
+        auto iter = segment->find(constraint.blobVal);
+        if (iter != segment->end()) {
+          bitmaps.push_back(iter->second);
+        }
       }
     }
 
@@ -170,18 +173,17 @@ class EWAHCompressedBitmapIndexerBlob final : public Indexer {
                                                  bool orEqual) {
     std::vector<std::shared_ptr<MamaJenniesBitmap>> bitmaps;
     if (constraint.operandType == OperandType::BLOB) {
-      for (auto& item : m_compressedBitmaps) {
-        if (item.first.GetData() == nullptr) {
-          continue;
-        }
-
-        if (item.first < constraint.blobVal) {
-          bitmaps.push_back(item.second);
-        } else {
-          if (orEqual && item.first == constraint.blobVal) {
+      auto segments = m_compressedBitmaps.GetSegments();
+      for (auto& segment : *segments) {
+        for (auto& item : *segment) {
+          if (item.first < constraint.blobVal) {
             bitmaps.push_back(item.second);
+          } else {
+            if (orEqual && item.first == constraint.blobVal) {
+              bitmaps.push_back(item.second);
+            }
+            break;
           }
-          break;
         }
       }
     }
@@ -193,28 +195,24 @@ class EWAHCompressedBitmapIndexerBlob final : public Indexer {
                                                  bool orEqual) {
     std::vector<std::shared_ptr<MamaJenniesBitmap>> bitmaps;
     if (constraint.operandType == OperandType::BLOB) {
-      std::map<BufferImpl, std::shared_ptr<MamaJenniesBitmap>>::const_iterator
-          iter;
-      if (orEqual) {
-        iter = m_compressedBitmaps.lower_bound(constraint.blobVal);
-      } else {
-        iter = m_compressedBitmaps.upper_bound(constraint.blobVal);
-      }
-
-      while (iter != m_compressedBitmaps.end()) {
-        if (iter->first.GetData() == nullptr) {
-          continue;
+      auto segments = m_compressedBitmaps.GetSegments();
+      for (auto& segment : *segments) {
+        BitmapMap::Map::const_iterator iter;
+        if (orEqual) {
+          iter = segment->lower_bound(constraint.blobVal);
+        } else {
+          iter = segment->upper_bound(constraint.blobVal);
         }
 
-        bitmaps.push_back(iter->second);
-        iter++;
+        while (iter != segment->end()) {
+          bitmaps.push_back(iter->second);
+          iter++;
+        }
       }
     } else {
-      auto bm = make_shared<MamaJenniesBitmap>();
-      for (std::uint64_t i = DOC_ID_START; i < m_lastInsertedDocId; i++) {
-        bm->Add(i);
-      }
-      bitmaps.push_back(bm);
+      // Blob is greater than other types, so every non null value matches
+      bitmaps.push_back(
+          m_nullBitmap.Filter(IndexConstraintOperator::IS_NOT_NULL));
     }
 
     return MamaJenniesBitmap::LogicalOR(bitmaps);
@@ -222,8 +220,8 @@ class EWAHCompressedBitmapIndexerBlob final : public Indexer {
 
   std::uint64_t m_lastInsertedDocId;
   IndexStat m_indexStat;
-  std::vector<std::string> m_fieldNameTokens;
-  std::map<BufferImpl, std::shared_ptr<MamaJenniesBitmap>> m_compressedBitmaps;
-  std::unique_ptr<Document> m_subDoc;
+  std::unique_ptr<FieldAccessor> m_fieldAccessor;
+  NullBitmap m_nullBitmap;
+  BitmapMap m_compressedBitmaps;
 };
 }  // namespace jonoondb_api
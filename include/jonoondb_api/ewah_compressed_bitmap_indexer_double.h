@@ -11,12 +11,17 @@
 #include "jonoondb_api/document.h"
 #include "jonoondb_api/enums.h"
 #include "jonoondb_api/exception_utils.h"
+#include "jonoondb_api/field_accessor.h"
 #include "jonoondb_api/index_info_impl.h"
 #include "jonoondb_api/index_stat.h"
 #include "jonoondb_api/indexer.h"
 #include "jonoondb_api/jonoondb_exceptions.h"
 #include "jonoondb_api/mama_jennies_bitmap.h"
+#include "jonoondb_api/null_bitmap.h"
+#include "jonoondb_api/null_helpers.h"
+#include "jonoondb_api/segmented_bitmap_map.h"
 #include "jonoondb_api/string_utils.h"
+#include "jonoondb_api/value_bitmap.h"
 
 namespace jonoondb_api {
 
@@ -24,6 +29,7 @@ class EWAHCompressedBitmapIndexerDouble final : public Indexer {
  public:
   static void Construct(const IndexInfoImpl& indexInfo,
                         const FieldType& fieldType,
+                        std::unique_ptr<FieldAccessor> fieldAccessor,
                         EWAHCompressedBitmapIndexerDouble*& obj) {
     std::string errorMsg;
     if (indexInfo.GetIndexName().size() == 0) {
@@ -45,10 +51,9 @@ class EWAHCompressedBitmapIndexerDouble final : public Indexer {
       throw InvalidArgumentException(errorMsg, __FILE__, __func__, __LINE__);
     }
 
-    std::vector<std::string> tokens =
-        StringUtils::Split(indexInfo.GetColumnName(), ".");
     IndexStat indexStat(indexInfo, fieldType);
-    obj = new EWAHCompressedBitmapIndexerDouble(indexStat, tokens);
+    obj = new EWAHCompressedBitmapIndexerDouble(indexStat,
+                                                std::move(fieldAccessor));
   }
 
   ~EWAHCompressedBitmapIndexerDouble() override {}
@@ -58,16 +63,19 @@ class EWAHCompressedBitmapIndexerDouble final : public Indexer {
   }
 
   void Insert(std::uint64_t documentID, const Document& document) override {
-    auto val =
-        DocumentUtils::GetFloatValue(document, m_subDoc, m_fieldNameTokens);
-    auto compressedBitmap = m_compressedBitmaps.find(val);
-    if (compressedBitmap == m_compressedBitmaps.end()) {
-      auto bm = shared_ptr<MamaJenniesBitmap>(new MamaJenniesBitmap());
-      bm->Add(documentID);
-      m_compressedBitmaps[val] = bm;
-    } else {
-      compressedBitmap->second->Add(documentID);
+    auto val = m_fieldAccessor->GetFloatValue(document);
+    // Only values equal to the sentinel can be null
+    if (NullHelpers::IsNull(val) && m_fieldAccessor->IsNull(document)) {
+      m_nullBitmap.Add(documentID, true);
+      return;
     }
+
+    m_nullBitmap.Add(documentID, false);
+    m_compressedBitmaps.Add(val, documentID);
+  }
+
+  void PublishInserts() override {
+    m_compressedBitmaps.Publish();
   }
 
   const IndexStat& GetIndexStats() override {
@@ -87,6 +95,9 @@ class EWAHCompressedBitmapIndexerDouble final : public Indexer {
         return GetBitmapGT(constraint);
       case jonoondb_api::IndexConstraintOperator::GREATER_THAN_EQUAL:
         return GetBitmapGTE(constraint);
+      case jonoondb_api::IndexConstraintOperator::IS_NULL:
+      case jonoondb_api::IndexConstraintOperator::IS_NOT_NULL:
+        return m_nullBitmap.Filter(constraint.op);
       case jonoondb_api::IndexConstraintOperator::MATCH:
         // TODO: Handle this
       default:
@@ -103,56 +114,79 @@ class EWAHCompressedBitmapIndexerDouble final : public Indexer {
     std::vector<std::shared_ptr<MamaJenniesBitmap>> bitmaps;
     double lowerVal = GetOperandVal(lowerConstraint);
     double upperVal = GetOperandVal(upperConstraint);
-    std::map<double, std::shared_ptr<MamaJenniesBitmap>>::const_iterator
-        startIter,
-        endIter;
-
-    if (lowerConstraint.op == IndexConstraintOperator::GREATER_THAN_EQUAL) {
-      startIter = m_compressedBitmaps.lower_bound(lowerVal);
-    } else {
-      startIter = m_compressedBitmaps.upper_bound(lowerVal);
-    }
-
-    while (startIter != m_compressedBitmaps.end()) {
-      if (startIter->first < upperVal) {
-        bitmaps.push_back(startIter->second);
-      } else if (upperConstraint.op ==
-                     IndexConstraintOperator::LESS_THAN_EQUAL &&
-                 startIter->first == upperVal) {
-        bitmaps.push_back(startIter->second);
+    auto segments = m_compressedBitmaps.GetSegments();
+    for (auto& segment : *segments) {
+      BitmapMap::Map::const_iterator startIter;
+      if (lowerConstraint.op == IndexConstraintOperator::GREATER_THAN_EQUAL) {
+        startIter = segment->lower_bound(lowerVal);
       } else {
-        break;
+        startIter = segment->upper_bound(lowerVal);
       }
 
-      startIter++;
+      while (startIter != segment->end()) {
+        if (startIter->first < upperVal) {
+          bitmaps.push_back(startIter->second);
+        } else if (upperConstraint.op ==
+                       IndexConstraintOperator::LESS_THAN_EQUAL &&
+                   startIter->first == upperVal) {
+          bitmaps.push_back(startIter->second);
+        } else {
+          break;
+        }
+
+        startIter++;
+      }
     }
 
     return MamaJenniesBitmap::LogicalOR(bitmaps);
   }
 
+  bool TryGetValueBitmaps(std::vector<ValueBitmap>& valueBitmaps) override {
+    auto compressedBitmaps =
+        BitmapMap::Merge(*m_compressedBitmaps.GetSegments());
+    valueBitmaps.clear();
+    valueBitmaps.reserve(compressedBitmaps.size());
+    for (auto& item : compressedBitmaps) {
+      ValueBitmap valueBitmap;
+      valueBitmap.operandType = OperandType::DOUBLE;
+      valueBitmap.operand.doubleVal = item.first;
+      valueBitmap.bitmap = item.second;
+      valueBitmaps.push_back(std::move(valueBitmap));
+    }
+
+    return true;
+  }
+
  private:
-  EWAHCompressedBitmapIndexerDouble(const IndexStat& indexStat,
-                                    std::vector<std::string>& fieldNameTokens)
-      : m_indexStat(indexStat), m_fieldNameTokens(fieldNameTokens) {}
+  typedef SegmentedBitmapMap<double> BitmapMap;
+
+  EWAHCompressedBitmapIndexerDouble(
+      const IndexStat& indexStat,
+      std::unique_ptr<FieldAccessor> fieldAccessor)
+      : m_indexStat(indexStat), m_fieldAccessor(std::move(fieldAccessor)) {}
 
   std::shared_ptr<MamaJenniesBitmap> GetBitmapEQ(const Constraint& constraint) {
     std::vector<std::shared_ptr<MamaJenniesBitmap>> bitmaps;
+    double val;
     if (constraint.operandType == OperandType::INTEGER) {
-      auto iter = m_compressedBitmaps.find(
-          static_cast<double>(constraint.operand.int64Val));
-      if (iter != m_compressedBitmaps.end()) {
-        bitmaps.push_back(iter->second);
-      }
+      val = static_cast<double>(constraint.operand.int64Val);
     } else if (constraint.operandType == OperandType::DOUBLE) {
-      auto iter = m_compressedBitmaps.find(constraint.operand.doubleVal);
-      if (iter != m_compressedBitmaps.end()) {
+      val = constraint.operand.doubleVal;
+    } else {
+      // In all other cases the operand cannot be equal. The cases are:
+      // Operand is a string value, this should not happen because the query
+      // should fail before reaching this point
+      return std::make_shared<MamaJenniesBitmap>();
+    }
+
+    auto segments = m_compressedBitmaps.GetSegments();
+    for (auto& segment : *segments) {
+      auto iter = segment->find(val);
+      if (iter != segment->end()) {
         bitmaps.push_back(iter->second);
       }
     }
 
-    // In all other cases the operand cannot be equal. The cases are:
-    // Operand is a string value, this should not happen because the query
-    // should fail before reaching this point
     return MamaJenniesBitmap::LogicalOR(bitmaps);
   }
 
@@ -160,24 +194,25 @@ class EWAHCompressedBitmapIndexerDouble final : public Indexer {
                                                  bool orEqual) {
     std::vector<std::shared_ptr<MamaJenniesBitmap>> bitmaps;
 
+    double val;
     if (constraint.operandType == OperandType::INTEGER) {
-      double dVal = static_cast<double>(constraint.operand.int64Val);
-      for (auto& item : m_compressedBitmaps) {
-        if (item.first < dVal) {
-          bitmaps.push_back(item.second);
-        } else {
-          if (orEqual && item.first == dVal) {
-            bitmaps.push_back(item.second);
-          }
-          break;
-        }
-      }
+      val = static_cast<double>(constraint.operand.int64Val);
     } else if (constraint.operandType == OperandType::DOUBLE) {
-      for (auto& item : m_compressedBitmaps) {
-        if (item.first < constraint.operand.doubleVal) {
+      val = constraint.operand.doubleVal;
+    } else {
+      // In all other cases the operand cannot be equal. The cases are:
+      // Operand is a string value, this should not happen because the query
+      // should fail before reaching this point
+      return std::make_shared<MamaJenniesBitmap>();
+    }
+
+    auto segments = m_compressedBitmaps.GetSegments();
+    for (auto& segment : *segments) {
+      for (auto& item : *segment) {
+        if (item.first < val) {
           bitmaps.push_back(item.second);
         } else {
-          if (orEqual && item.first == constraint.operand.doubleVal) {
+          if (orEqual && item.first == val) {
             bitmaps.push_back(item.second);
           }
           break;
@@ -185,9 +220,6 @@ class EWAHCompressedBitmapIndexerDouble final : public Indexer {
       }
     }
 
-    // In all other cases the operand cannot be equal. The cases are:
-    // Operand is a string value, this should not happen because the query
-    // should fail before reaching this point
     return MamaJenniesBitmap::LogicalOR(bitmaps);
   }
 
@@ -200,10 +232,13 @@ class EWAHCompressedBitmapIndexerDouble final : public Indexer {
       operandVal = static_cast<double>(constraint.operand.int64Val);
     }
 
-    auto iter = m_compressedBitmaps.upper_bound(operandVal);
-    while (iter != m_compressedBitmaps.end()) {
-      bitmaps.push_back(iter->second);
-      iter++;
+    auto segments = m_compressedBitmaps.GetSegments();
+    for (auto& segment : *segments) {
+      auto iter = segment->upper_bound(operandVal);
+      while (iter != segment->end()) {
+        bitmaps.push_back(iter->second);
+        iter++;
+      }
     }
 
     return MamaJenniesBitmap::LogicalOR(bitmaps);
@@ -219,10 +254,13 @@ class EWAHCompressedBitmapIndexerDouble final : public Indexer {
       operandVal = static_cast<double>(constraint.operand.int64Val);
     }
 
-    auto iter = m_compressedBitmaps.lower_bound(operandVal);
-    while (iter != m_compressedBitmaps.end()) {
-      bitmaps.push_back(iter->second);
-      iter++;
+    auto segments = m_compressedBitmaps.GetSegments();
+    for (auto& segment : *segments) {
+      auto iter = segment->lower_bound(operandVal);
+      while (iter != segment->end()) {
+        bitmaps.push_back(iter->second);
+        iter++;
+      }
     }
 
     return MamaJenniesBitmap::LogicalOR(bitmaps);
@@ -241,11 +279,11 @@ class EWAHCompressedBitmapIndexerDouble final : public Indexer {
   }
 
   IndexStat m_indexStat;
-  std::vector<std::string> m_fieldNameTokens;
+  std::unique_ptr<FieldAccessor> m_fieldAccessor;
+  NullBitmap m_nullBitmap;
   // Todo: We are assuming that double will be 8 bytes (which should be the case
   // mostly), but that is not gauranteed. Change the code to handle this
   // properly
-  std::map<double, std::shared_ptr<MamaJenniesBitmap>> m_compressedBitmaps;
-  std::unique_ptr<Document> m_subDoc;
+  BitmapMap m_compressedBitmaps;
 };
 }  // namespace jonoondb_api
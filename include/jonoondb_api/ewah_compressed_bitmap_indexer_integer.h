@@ -11,12 +11,17 @@
 #include "jonoondb_api/document.h"
 #include "jonoondb_api/enums.h"
 #include "jonoondb_api/exception_utils.h"
+#include "jonoondb_api/field_accessor.h"
 #include "jonoondb_api/index_info_impl.h"
 #include "jonoondb_api/index_stat.h"
 #include "jonoondb_api/indexer.h"
 #include "jonoondb_api/jonoondb_exceptions.h"
 #include "jonoondb_api/mama_jennies_bitmap.h"
+#include "jonoondb_api/null_bitmap.h"
+#include "jonoondb_api/null_helpers.h"
+#include "jonoondb_api/segmented_bitmap_map.h"
 #include "jonoondb_api/string_utils.h"
+#include "jonoondb_api/value_bitmap.h"
 
 namespace jonoondb_api {
 
@@ -24,6 +29,7 @@ class EWAHCompressedBitmapIndexerInteger final : public Indexer {
  public:
   static void Construct(const IndexInfoImpl& indexInfo,
                         const FieldType& fieldType,
+                        std::unique_ptr<FieldAccessor> fieldAccessor,
                         EWAHCompressedBitmapIndexerInteger*& obj) {
     std::string errorMsg;
     if (indexInfo.GetIndexName().size() == 0) {
@@ -45,10 +51,9 @@ class EWAHCompressedBitmapIndexerInteger final : public Indexer {
       throw InvalidArgumentException(errorMsg, __FILE__, __func__, __LINE__);
     }
 
-    std::vector<std::string> tokens =
-        StringUtils::Split(indexInfo.GetColumnName(), ".");
     IndexStat indexStat(indexInfo, fieldType);
-    obj = new EWAHCompressedBitmapIndexerInteger(indexStat, tokens);
+    obj = new EWAHCompressedBitmapIndexerInteger(indexStat,
+                                                 std::move(fieldAccessor));
   }
 
   ~EWAHCompressedBitmapIndexerInteger() override {}
@@ -59,16 +64,19 @@ class EWAHCompressedBitmapIndexerInteger final : public Indexer {
   }
 
   void Insert(std::uint64_t documentID, const Document& document) override {
-    auto val =
-        DocumentUtils::GetIntegerValue(document, m_subDoc, m_fieldNameTokens);
-    auto compressedBitmap = m_compressedBitmaps.find(val);
-    if (compressedBitmap == m_compressedBitmaps.end()) {
-      auto bm = shared_ptr<MamaJenniesBitmap>(new MamaJenniesBitmap());
-      bm->Add(documentID);
-      m_compressedBitmaps[val] = bm;
-    } else {
-      compressedBitmap->second->Add(documentID);
+    auto val = m_fieldAccessor->GetIntegerValue(document);
+    // Only values equal to the sentinel can be null
+    if (NullHelpers::IsNull(val) && m_fieldAccessor->IsNull(document)) {
+      m_nullBitmap.Add(documentID, true);
+      return;
     }
+
+    m_nullBitmap.Add(documentID, false);
+    m_compressedBitmaps.Add(val, documentID);
+  }
+
+  void PublishInserts() override {
+    m_compressedBitmaps.Publish();
   }
 
   const IndexStat& GetIndexStats() override {
@@ -88,6 +96,9 @@ class EWAHCompressedBitmapIndexerInteger final : public Indexer {
         return GetBitmapGT(constraint);
       case jonoondb_api::IndexConstraintOperator::GREATER_THAN_EQUAL:
         return GetBitmapGTE(constraint);
+      case jonoondb_api::IndexConstraintOperator::IS_NULL:
+      case jonoondb_api::IndexConstraintOperator::IS_NOT_NULL:
+        return m_nullBitmap.Filter(constraint.op);
       case jonoondb_api::IndexConstraintOperator::MATCH:
         // TODO: Handle this
       default:
@@ -122,66 +133,89 @@ class EWAHCompressedBitmapIndexerInteger final : public Indexer {
       upperVal = upperConstraint.operand.int64Val;
     }
 
-    std::map<std::int64_t, std::shared_ptr<MamaJenniesBitmap>>::const_iterator
-        startIter,
-        endIter;
-
-    if (lowerConstraint.op == IndexConstraintOperator::GREATER_THAN) {
-      startIter = m_compressedBitmaps.upper_bound(lowerVal);
-    } else {
-      startIter = m_compressedBitmaps.lower_bound(lowerVal);
-    }
+    auto segments = m_compressedBitmaps.GetSegments();
+    for (auto& segment : *segments) {
+      BitmapMap::Map::const_iterator startIter;
+      if (lowerConstraint.op == IndexConstraintOperator::GREATER_THAN) {
+        startIter = segment->upper_bound(lowerVal);
+      } else {
+        startIter = segment->lower_bound(lowerVal);
+      }
 
-    while (startIter != m_compressedBitmaps.end()) {
-      if (startIter->first < upperVal) {
-        bitmaps.push_back(startIter->second);
-      } else if (upperConstraint.op ==
-                 IndexConstraintOperator::LESS_THAN_EQUAL) {
-        if (upperConstraint.operandType == OperandType::DOUBLE) {
-          if (static_cast<double>(startIter->first) ==
-              upperConstraint.operand.doubleVal)
-            bitmaps.push_back(startIter->second);
+      while (startIter != segment->end()) {
+        if (startIter->first < upperVal) {
+          bitmaps.push_back(startIter->second);
+        } else if (upperConstraint.op ==
+                   IndexConstraintOperator::LESS_THAN_EQUAL) {
+          if (upperConstraint.operandType == OperandType::DOUBLE) {
+            if (static_cast<double>(startIter->first) ==
+                upperConstraint.operand.doubleVal)
+              bitmaps.push_back(startIter->second);
+          } else {
+            if (startIter->first == upperConstraint.operand.int64Val)
+              bitmaps.push_back(startIter->second);
+          }
         } else {
-          if (startIter->first == upperConstraint.operand.int64Val)
-            bitmaps.push_back(startIter->second);
+          break;
         }
-      } else {
-        break;
-      }
 
-      startIter++;
+        startIter++;
+      }
     }
 
     return MamaJenniesBitmap::LogicalOR(bitmaps);
   }
 
+  bool TryGetValueBitmaps(std::vector<ValueBitmap>& valueBitmaps) override {
+    auto compressedBitmaps =
+        BitmapMap::Merge(*m_compressedBitmaps.GetSegments());
+    valueBitmaps.clear();
+    valueBitmaps.reserve(compressedBitmaps.size());
+    for (auto& item : compressedBitmaps) {
+      ValueBitmap valueBitmap;
+      valueBitmap.operandType = OperandType::INTEGER;
+      valueBitmap.operand.int64Val = item.first;
+      valueBitmap.bitmap = item.second;
+      valueBitmaps.push_back(std::move(valueBitmap));
+    }
+
+    return true;
+  }
+
  private:
-  EWAHCompressedBitmapIndexerInteger(const IndexStat& indexStat,
-                                     std::vector<std::string>& fieldNameTokens)
-      : m_indexStat(indexStat), m_fieldNameTokens(fieldNameTokens) {}
+  typedef SegmentedBitmapMap<std::int64_t> BitmapMap;
+
+  EWAHCompressedBitmapIndexerInteger(
+      const IndexStat& indexStat,
+      std::unique_ptr<FieldAccessor> fieldAccessor)
+      : m_indexStat(indexStat), m_fieldAccessor(std::move(fieldAccessor)) {}
 
   std::shared_ptr<MamaJenniesBitmap> GetBitmapEQ(const Constraint& constraint) {
     std::vector<std::shared_ptr<MamaJenniesBitmap>> bitmaps;
+    std::int64_t val;
     if (constraint.operandType == OperandType::INTEGER) {
-      auto iter = m_compressedBitmaps.find(constraint.operand.int64Val);
-      if (iter != m_compressedBitmaps.end()) {
-        bitmaps.push_back(iter->second);
-      }
+      val = constraint.operand.int64Val;
     } else if (constraint.operandType == OperandType::DOUBLE) {
       // Check if double has no fractional part
-      std::int64_t intVal =
-          static_cast<std::int64_t>(constraint.operand.doubleVal);
-      if (constraint.operand.doubleVal == intVal) {
-        auto iter = m_compressedBitmaps.find(intVal);
-        if (iter != m_compressedBitmaps.end()) {
-          bitmaps.push_back(iter->second);
-        }
+      val = static_cast<std::int64_t>(constraint.operand.doubleVal);
+      if (constraint.operand.doubleVal != val) {
+        return std::make_shared<MamaJenniesBitmap>();
+      }
+    } else {
+      // In all other cases the operand cannot be equal. The cases are:
+      // Operand is a string value, this should not happen because the query
+      // should fail before reaching this point
+      return std::make_shared<MamaJenniesBitmap>();
+    }
+
+    auto segments = m_compressedBitmaps.GetSegments();
+    for (auto& segment : *segments) {
+      auto iter = segment->find(val);
+      if (iter != segment->end()) {
+        bitmaps.push_back(iter->second);
       }
     }
 
-    // In all other cases the operand cannot be equal. The cases are:
-    // Operand is a string value, this should not happen because the query
-    // should fail before reaching this point
     return MamaJenniesBitmap::LogicalOR(bitmaps);
   }
 
@@ -193,26 +227,30 @@ class EWAHCompressedBitmapIndexerInteger final : public Indexer {
       ceiling = static_cast<int64_t>(std::ceil(constraint.operand.doubleVal));
     }
 
-    if (constraint.operandType == OperandType::INTEGER) {
-      for (auto& item : m_compressedBitmaps) {
-        if (item.first < constraint.operand.int64Val) {
-          bitmaps.push_back(item.second);
-        } else {
-          if (orEqual && item.first == constraint.operand.int64Val) {
+    auto segments = m_compressedBitmaps.GetSegments();
+    for (auto& segment : *segments) {
+      if (constraint.operandType == OperandType::INTEGER) {
+        for (auto& item : *segment) {
+          if (item.first < constraint.operand.int64Val) {
             bitmaps.push_back(item.second);
+          } else {
+            if (orEqual && item.first == constraint.operand.int64Val) {
+              bitmaps.push_back(item.second);
+            }
+            break;
           }
-          break;
         }
-      }
-    } else if (constraint.operandType == OperandType::DOUBLE) {
-      for (auto& item : m_compressedBitmaps) {
-        if (item.first < ceiling) {
-          bitmaps.push_back(item.second);
-        } else {
-          if (orEqual && constraint.operand.doubleVal == (double)item.first) {
+      } else if (constraint.operandType == OperandType::DOUBLE) {
+        for (auto& item : *segment) {
+          if (item.first < ceiling) {
             bitmaps.push_back(item.second);
+          } else {
+            if (orEqual &&
+                constraint.operand.doubleVal == (double)item.first) {
+              bitmaps.push_back(item.second);
+            }
+            break;
           }
-          break;
         }
       }
     }
@@ -230,10 +268,13 @@ class EWAHCompressedBitmapIndexerInteger final : public Indexer {
       operandVal = constraint.operand.int64Val;
     }
 
-    auto iter = m_compressedBitmaps.upper_bound(operandVal);
-    while (iter != m_compressedBitmaps.end()) {
-      bitmaps.push_back(iter->second);
-      iter++;
+    auto segments = m_compressedBitmaps.GetSegments();
+    for (auto& segment : *segments) {
+      auto iter = segment->upper_bound(operandVal);
+      while (iter != segment->end()) {
+        bitmaps.push_back(iter->second);
+        iter++;
+      }
     }
 
     return MamaJenniesBitmap::LogicalOR(bitmaps);
@@ -250,19 +291,21 @@ class EWAHCompressedBitmapIndexerInteger final : public Indexer {
       operandVal = constraint.operand.int64Val;
     }
 
-    auto iter = m_compressedBitmaps.lower_bound(operandVal);
-    while (iter != m_compressedBitmaps.end()) {
-      bitmaps.push_back(iter->second);
-      iter++;
+    auto segments = m_compressedBitmaps.GetSegments();
+    for (auto& segment : *segments) {
+      auto iter = segment->lower_bound(operandVal);
+      while (iter != segment->end()) {
+        bitmaps.push_back(iter->second);
+        iter++;
+      }
     }
 
     return MamaJenniesBitmap::LogicalOR(bitmaps);
   }
 
   IndexStat m_indexStat;
-  std::vector<std::string> m_fieldNameTokens;
-  std::map<std::int64_t, std::shared_ptr<MamaJenniesBitmap>>
-      m_compressedBitmaps;
-  std::unique_ptr<Document> m_subDoc;
+  std::unique_ptr<FieldAccessor> m_fieldAccessor;
+  NullBitmap m_nullBitmap;
+  BitmapMap m_compressedBitmaps;
 };
 }  // namespace jonoondb_api
@@ -11,14 +11,17 @@
 #include "jonoondb_api/document.h"
 #include "jonoondb_api/enums.h"
 #include "jonoondb_api/exception_utils.h"
+#include "jonoondb_api/field_accessor.h"
 #include "jonoondb_api/index_info_impl.h"
 #include "jonoondb_api/index_stat.h"
 #include "jonoondb_api/indexer.h"
 #include "jonoondb_api/jonoondb_exceptions.h"
 #include "jonoondb_api/mama_jennies_bitmap.h"
-#include "jonoondb_api/null_helpers.h"
+#include "jonoondb_api/null_bitmap.h"
+#include "jonoondb_api/segmented_bitmap_map.h"
 #include "jonoondb_api/status_impl.h"
 #include "jonoondb_api/string_utils.h"
+#include "jonoondb_api/value_bitmap.h"
 
 namespace jonoondb_api {
 
@@ -26,6 +29,7 @@ class EWAHCompressedBitmapIndexerString final : public Indexer {
  public:
   static void Construct(const IndexInfoImpl& indexInfo,
                         const FieldType& fieldType,
+                        std::unique_ptr<FieldAccessor> fieldAccessor,
                         EWAHCompressedBitmapIndexerString*& obj) {
     std::string errorMsg;
     if (indexInfo.GetIndexName().empty()) {
@@ -47,10 +51,9 @@ class EWAHCompressedBitmapIndexerString final : public Indexer {
       throw InvalidArgumentException(errorMsg, __FILE__, __func__, __LINE__);
     }
 
-    std::vector<std::string> tokens =
-        StringUtils::Split(indexInfo.GetColumnName(), ".");
     IndexStat indexStat(indexInfo, fieldType);
-    obj = new EWAHCompressedBitmapIndexerString(indexStat, tokens);
+    obj = new EWAHCompressedBitmapIndexerString(indexStat,
+                                                std::move(fieldAccessor));
   }
 
   ~EWAHCompressedBitmapIndexerString() override {}
@@ -60,16 +63,19 @@ class EWAHCompressedBitmapIndexerString final : public Indexer {
   }
 
   void Insert(std::uint64_t documentID, const Document& document) override {
-    auto val =
-        DocumentUtils::GetStringValue(document, m_subDoc, m_fieldNameTokens);
-    auto compressedBitmap = m_compressedBitmaps.find(val);
-    if (compressedBitmap == m_compressedBitmaps.end()) {
-      auto bm = shared_ptr<MamaJenniesBitmap>(new MamaJenniesBitmap());
-      bm->Add(documentID);
-      m_compressedBitmaps[val] = bm;
-    } else {
-      compressedBitmap->second->Add(documentID);
+    std::size_t size;
+    auto str = m_fieldAccessor->GetStringValue(document, size);
+    if (str == nullptr) {
+      m_nullBitmap.Add(documentID, true);
+      return;
     }
+
+    m_nullBitmap.Add(documentID, false);
+    m_compressedBitmaps.Add(std::string(str, size), documentID);
+  }
+
+  void PublishInserts() override {
+    m_compressedBitmaps.Publish();
   }
 
   const IndexStat& GetIndexStats() override {
@@ -78,7 +84,8 @@ class EWAHCompressedBitmapIndexerString final : public Indexer {
 
   std::shared_ptr<MamaJenniesBitmap> Filter(
       const Constraint& constraint) override {
-    assert(constraint.operandType == OperandType::STRING);
+    assert(constraint.operandType == OperandType::STRING ||
+           NullBitmap::IsNullOperator(constraint.op));
     switch (constraint.op) {
       case jonoondb_api::IndexConstraintOperator::EQUAL:
         return GetBitmapEQ(constraint);
@@ -90,6 +97,9 @@ class EWAHCompressedBitmapIndexerString final : public Indexer {
         return GetBitmapGT(constraint, false);
       case jonoondb_api::IndexConstraintOperator::GREATER_THAN_EQUAL:
         return GetBitmapGT(constraint, true);
+      case jonoondb_api::IndexConstraintOperator::IS_NULL:
+      case jonoondb_api::IndexConstraintOperator::IS_NOT_NULL:
+        return m_nullBitmap.Filter(constraint.op);
       case jonoondb_api::IndexConstraintOperator::MATCH:
         // TODO: Handle this
       default:
@@ -106,18 +116,17 @@ class EWAHCompressedBitmapIndexerString final : public Indexer {
     std::vector<std::shared_ptr<MamaJenniesBitmap>> bitmaps;
     if (lowerConstraint.operandType == OperandType::STRING &&
         upperConstraint.operandType == OperandType::STRING) {
-      std::map<std::string, std::shared_ptr<MamaJenniesBitmap>>::const_iterator
-          startIter,
-          endIter;
-
-      if (lowerConstraint.op == IndexConstraintOperator::GREATER_THAN_EQUAL) {
-        startIter = m_compressedBitmaps.lower_bound(lowerConstraint.strVal);
-      } else {
-        startIter = m_compressedBitmaps.upper_bound(lowerConstraint.strVal);
-      }
+      auto segments = m_compressedBitmaps.GetSegments();
+      for (auto& segment : *segments) {
+        BitmapMap::Map::const_iterator startIter;
+        if (lowerConstraint.op ==
+            IndexConstraintOperator::GREATER_THAN_EQUAL) {
+          startIter = segment->lower_bound(lowerConstraint.strVal);
+        } else {
+          startIter = segment->upper_bound(lowerConstraint.strVal);
+        }
 
-      while (startIter != m_compressedBitmaps.end()) {
-        if (not NullHelpers::IsNull(startIter->first)) {
+        while (startIter != segment->end()) {
           if (startIter->first < upperConstraint.strVal) {
             bitmaps.push_back(startIter->second);
           } else if (upperConstraint.op ==
@@ -127,27 +136,48 @@ class EWAHCompressedBitmapIndexerString final : public Indexer {
           } else {
             break;
           }
-        }
 
-        startIter++;
+          startIter++;
+        }
       }
     }
 
     return MamaJenniesBitmap::LogicalOR(bitmaps);
   }
 
+  bool TryGetValueBitmaps(std::vector<ValueBitmap>& valueBitmaps) override {
+    auto compressedBitmaps =
+        BitmapMap::Merge(*m_compressedBitmaps.GetSegments());
+    valueBitmaps.clear();
+    valueBitmaps.reserve(compressedBitmaps.size());
+    for (auto& item : compressedBitmaps) {
+      ValueBitmap valueBitmap;
+      valueBitmap.operandType = OperandType::STRING;
+      valueBitmap.strVal = item.first;
+      valueBitmap.bitmap = item.second;
+      valueBitmaps.push_back(std::move(valueBitmap));
+    }
+
+    return true;
+  }
+
  private:
-  EWAHCompressedBitmapIndexerString(const IndexStat& indexStat,
-                                    std::vector<std::string>& fieldNameTokens)
-      : m_indexStat(indexStat), m_fieldNameTokens(fieldNameTokens) {}
+  typedef SegmentedBitmapMap<std::string> BitmapMap;
+
+  EWAHCompressedBitmapIndexerString(
+      const IndexStat& indexStat,
+      std::unique_ptr<FieldAccessor> fieldAccessor)
+      : m_indexStat(indexStat), m_fieldAccessor(std::move(fieldAccessor)) {}
 
   std::shared_ptr<MamaJenniesBitmap> GetBitmapEQ(const Constraint& constraint) {
     std::vector<std::shared_ptr<MamaJenniesBitmap>> bitmaps;
     if (constraint.operandType == OperandType::STRING) {
-      auto iter = m_compressedBitmaps.find(constraint.strVal);
-      if (iter != m_compressedBitmaps.end() &&
-          !NullHelpers::IsNull(iter->first)) {
-        bitmaps.push_back(iter->second);
+      auto segments = m_compressedBitmaps.GetSegments();
+      for (auto& segment : *segments) {
+        auto iter = segment->find(constraint.strVal);
+        if (iter != segment->end()) {
+          bitmaps.push_back(iter->second);
+        }
       }
     }
 
@@ -158,8 +188,9 @@ class EWAHCompressedBitmapIndexerString final : public Indexer {
                                                  bool orEqual) {
     std::vector<std::shared_ptr<MamaJenniesBitmap>> bitmaps;
     if (constraint.operandType == OperandType::STRING) {
-      for (auto& item : m_compressedBitmaps) {
-        if (not NullHelpers::IsNull(item.first)) {
+      auto segments = m_compressedBitmaps.GetSegments();
+      for (auto& segment : *segments) {
+        for (auto& item : *segment) {
           if (item.first.compare(constraint.strVal) < 0) {
             bitmaps.push_back(item.second);
           } else {
@@ -179,19 +210,19 @@ class EWAHCompressedBitmapIndexerString final : public Indexer {
                                                  bool orEqual) {
     std::vector<std::shared_ptr<MamaJenniesBitmap>> bitmaps;
     if (constraint.operandType == OperandType::STRING) {
-      std::map<std::string, std::shared_ptr<MamaJenniesBitmap>>::const_iterator
-          iter;
-      if (orEqual) {
-        iter = m_compressedBitmaps.lower_bound(constraint.strVal);
-      } else {
-        iter = m_compressedBitmaps.upper_bound(constraint.strVal);
-      }
+      auto segments = m_compressedBitmaps.GetSegments();
+      for (auto& segment : *segments) {
+        BitmapMap::Map::const_iterator iter;
+        if (orEqual) {
+          iter = segment->lower_bound(constraint.strVal);
+        } else {
+          iter = segment->upper_bound(constraint.strVal);
+        }
 
-      while (iter != m_compressedBitmaps.end()) {
-        if (not NullHelpers::IsNull(iter->first)) {
+        while (iter != segment->end()) {
           bitmaps.push_back(iter->second);
+          iter++;
         }
-        iter++;
       }
     }
 
@@ -199,8 +230,8 @@ class EWAHCompressedBitmapIndexerString final : public Indexer {
   }
 
   IndexStat m_indexStat;
-  std::vector<std::string> m_fieldNameTokens;
-  std::map<std::string, std::shared_ptr<MamaJenniesBitmap>> m_compressedBitmaps;
-  std::unique_ptr<Document> m_subDoc;
+  std::unique_ptr<FieldAccessor> m_fieldAccessor;
+  NullBitmap m_nullBitmap;
+  BitmapMap m_compressedBitmaps;
 };
 }  // namespace jonoondb_api
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace jonoondb_api {
+// Forward declarations
+class Document;
+enum class FieldType : std::int8_t;
+
+// FieldAccessor reads the value of a (possibly nested) field e.g. user.name
+// from a document. It is resolved against the schema once, so reading a value
+// does not involve any field name lookups. Null values are returned using the
+// same conventions as null_helpers.h i.e. JONOONDB_NULL_INT64,
+// JONOONDB_NULL_DOUBLE, JONOONDB_NULL_STR and nullptr for blobs. Use IsNull
+// to tell a null apart from a value that happens to equal the sentinel.
+class FieldAccessor {
+ public:
+  virtual ~FieldAccessor() {}
+  virtual const std::string& GetFieldName() const = 0;
+  virtual FieldType GetFieldType() const = 0;
+  virtual std::int64_t GetIntegerValue(const Document& document) const = 0;
+  virtual double GetFloatValue(const Document& document) const = 0;
+  virtual std::string GetStringValue(const Document& document) const = 0;
+  // Returns nullptr if the string is null. The returned pointer is valid as
+  // long as the document buffer is valid.
+  virtual const char* GetStringValue(const Document& document,
+                                     std::size_t& size) const = 0;
+  virtual const char* GetBlobValue(const Document& document,
+                                   std::size_t& size) const = 0;
+  virtual bool IsNull(const Document& document) const = 0;
+};
+}  // namespace jonoondb_api
@@ -24,6 +24,8 @@ class FlatbuffersDocumentSchema final : public DocumentSchema {
   std::size_t GetRootFieldCount() const override;
   void GetRootField(size_t index, Field*& field) const override;
   Field* AllocateField() const override;
+  std::unique_ptr<FieldAccessor> CreateFieldAccessor(
+      const std::string& fieldName) const override;
 
  private:
   std::string m_binarySchema;
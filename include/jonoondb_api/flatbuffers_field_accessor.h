@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "field_accessor.h"
+#include "flatbuffers/reflection.h"
+
+namespace jonoondb_api {
+// Forward declarations
+class Document;
+enum class FieldType : std::int8_t;
+
+// FlatbuffersFieldAccessor compiles a dot(.) separated field path into a chain
+// of vtable offsets. Reading a value only needs the root table of the
+// document and a few pointer reads per nested field.
+class FlatbuffersFieldAccessor final : public FieldAccessor {
+ public:
+  FlatbuffersFieldAccessor(const reflection::Schema& schema,
+                           const std::string& fieldName, FieldType fieldType);
+  const std::string& GetFieldName() const override;
+  FieldType GetFieldType() const override;
+  std::int64_t GetIntegerValue(const Document& document) const override;
+  double GetFloatValue(const Document& document) const override;
+  std::string GetStringValue(const Document& document) const override;
+  const char* GetStringValue(const Document& document,
+                             std::size_t& size) const override;
+  const char* GetBlobValue(const Document& document,
+                           std::size_t& size) const override;
+  bool IsNull(const Document& document) const override;
+
+ private:
+  // One hop in the path from the root table to the object holding the field
+  struct PathStep {
+    flatbuffers::voffset_t offset;
+    bool isStruct;
+  };
+
+  bool TryGetParent(const Document& document, const flatbuffers::Table*& table,
+                    const std::uint8_t*& structure) const;
+  void ThrowInvalidConversion(const char* targetType) const;
+
+  std::string m_fieldName;
+  FieldType m_fieldType;
+  std::vector<PathStep> m_path;
+  flatbuffers::voffset_t m_offset = 0;
+  reflection::BaseType m_baseType = reflection::BaseType::None;
+  reflection::BaseType m_elementType = reflection::BaseType::None;
+  std::int64_t m_defaultInteger = 0;
+  double m_defaultReal = 0;
+  bool m_isDocument = false;
+};
+}  // namespace jonoondb_api
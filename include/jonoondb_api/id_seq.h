@@ -7,16 +7,24 @@
 #include "mama_jennies_bitmap.h"
 
 namespace jonoondb_api {
+// IDSequence hands out document ids in vectors of up to vecSize ids. The ids
+// either come from a bitmap or from the range [0, idCount). The range is
+// generated as the sequence is consumed, so a full scan does no up-front
+// work and stops as soon as the caller stops calling Next.
 class IDSequence final {
  public:
-  IDSequence(std::shared_ptr<MamaJenniesBitmap> bitmap, int vecSize);
+  IDSequence(std::shared_ptr<const MamaJenniesBitmap> bitmap, int vecSize);
+  IDSequence(std::uint64_t idCount, int vecSize);
   const gsl::span<std::uint64_t>& Current();
   bool Next();
 
  private:
-  std::shared_ptr<MamaJenniesBitmap> m_bitmap;
+  std::shared_ptr<const MamaJenniesBitmap> m_bitmap;
   std::unique_ptr<MamaJenniesBitmap::const_iterator> m_iter;
   std::unique_ptr<MamaJenniesBitmap::const_iterator> m_end;
+  // Used instead of the iterators when the sequence is a range
+  std::uint64_t m_nextID;
+  std::uint64_t m_idCount;
   std::vector<std::uint64_t> m_currentVector;
   gsl::span<std::uint64_t> m_currentSpan;
 };
@@ -18,17 +18,25 @@ enum class IndexConstraintOperator : std::int8_t;
 struct Constraint;
 class DocumentIDGenerator;
 class BufferImpl;
+class DocumentSchema;
+struct ColumnAggregate;
+struct ValueBitmap;
 
 class IndexManager {
  public:
-  typedef std::unordered_map<std::string, std::vector<std::unique_ptr<Indexer>>>
+  typedef std::unordered_map<std::string, std::vector<std::shared_ptr<Indexer>>>
       ColumnIndexderMap;
 
   IndexManager(const std::vector<IndexInfoImpl*>& indexes,
-               const std::unordered_map<std::string, FieldType>& columnTypes);
-  void CreateIndex(
-      const IndexInfoImpl& indexInfo,
-      const std::unordered_map<std::string, FieldType>& columnTypes);
+               const DocumentSchema& documentSchema);
+  void CreateIndex(const IndexInfoImpl& indexInfo,
+                   const DocumentSchema& documentSchema);
+  // Publishes a fully built indexer. The caller must make sure that the
+  // indexer has already indexed every document that has been assigned an ID,
+  // i.e. no IndexDocuments call is in flight. Readers either see the old set
+  // of indexers or the new one, never a partially built index.
+  void AddIndexer(std::unique_ptr<Indexer> indexer);
+  bool IndexExists(const std::string& indexName);
   std::uint64_t IndexDocuments(
       DocumentIDGenerator& documentIDGenerator,
       const std::vector<std::unique_ptr<Document>>& documents);
@@ -41,10 +49,11 @@ class IndexManager {
   bool TryGetDoubleValue(std::uint64_t documentID,
                          const std::string& columnName, double& val);
   bool TryGetStringValue(std::uint64_t documentID,
-                         const std::string& columnName, std::string& val);
+                         const std::string& columnName, const char*& val,
+                         std::size_t& size);
 
   bool TryGetBlobValue(std::uint64_t documentID, const std::string& columnName,
-                       BufferImpl& val);
+                       const char*& val, std::size_t& size);
 
   bool TryGetIntegerVector(const gsl::span<std::uint64_t>& documentIDs,
                            const std::string& columnName,
@@ -52,9 +61,26 @@ class IndexManager {
   bool TryGetDoubleVector(const gsl::span<std::uint64_t>& documentIDs,
                           const std::string& columnName,
                           std::vector<double>& values);
+  bool TryGetStringVector(const gsl::span<std::uint64_t>& documentIDs,
+                          const std::string& columnName, ValueBatch& values);
+  bool TryGetBlobVector(const gsl::span<std::uint64_t>& documentIDs,
+                        const std::string& columnName, ValueBatch& values);
+  bool TryAggregate(const MamaJenniesBitmap& documentIDs,
+                    const std::string& columnName,
+                    ColumnAggregate& aggregate);
+  bool TryGetValueBitmaps(const std::string& columnName,
+                          std::vector<ValueBitmap>& valueBitmaps);
 
  private:
-  std::unique_ptr<ColumnIndexderMap> m_columnIndexerMap;
+  // Returns the indexer that should be used to evaluate op or nullptr if
+  // none of the indexers can evaluate it.
+  static Indexer* GetBestIndexer(
+      const std::vector<std::shared_ptr<Indexer>>& indexers,
+      IndexConstraintOperator op);
+
+  // The map is copy-on-write. It is only accessed through std::atomic_load and
+  // std::atomic_store so new indexes can be published while queries run.
+  std::shared_ptr<const ColumnIndexderMap> m_columnIndexerMap;
   std::mutex m_mutex;
 };
 }  // namespace jonoondb_api
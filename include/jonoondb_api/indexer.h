@@ -11,11 +11,18 @@ class IndexStat;
 struct Constraint;
 class MamaJenniesBitmap;
 class BufferImpl;
+class ValueBatch;
+struct ColumnAggregate;
+struct ValueBitmap;
 
 class Indexer {
  public:
   virtual ~Indexer() {}
   virtual void Insert(std::uint64_t documentID, const Document& document) = 0;
+  // Queries run while documents are inserted. Indexers whose Insert does not
+  // make the document visible to them right away do so here, it is called
+  // after every batch of inserts.
+  virtual void PublishInserts() {}
   virtual const IndexStat& GetIndexStats() = 0;
   virtual std::shared_ptr<MamaJenniesBitmap> Filter(
       const Constraint& constraint) = 0;
@@ -30,11 +37,15 @@ class Indexer {
     return false;
   }
 
-  virtual bool TryGetStringValue(std::uint64_t documentID, std::string& val) {
+  // The string and blob values point into the storage of the indexer and
+  // stay valid as long as the indexer, val is nullptr for null values
+  virtual bool TryGetStringValue(std::uint64_t documentID, const char*& val,
+                                 std::size_t& size) {
     return false;
   }
 
-  virtual bool TryGetBlobValue(std::uint64_t documentID, BufferImpl& val) {
+  virtual bool TryGetBlobValue(std::uint64_t documentID, const char*& val,
+                               std::size_t& size) {
     return false;
   }
 
@@ -47,5 +58,28 @@ class Indexer {
                                   std::vector<double>& values) {
     return false;
   }
+
+  virtual bool TryGetStringVector(const gsl::span<std::uint64_t>& documentIDs,
+                                  ValueBatch& values) {
+    return false;
+  }
+
+  virtual bool TryGetBlobVector(const gsl::span<std::uint64_t>& documentIDs,
+                                ValueBatch& values) {
+    return false;
+  }
+
+  // Aggregates the non null values of the documents in documentIDs. Only
+  // indexers that keep the value of every document can do this.
+  virtual bool TryAggregate(const MamaJenniesBitmap& documentIDs,
+                            ColumnAggregate& aggregate) {
+    return false;
+  }
+
+  // Returns every distinct non null value with the documents that have it,
+  // in ascending order of the values. Only inverted indexes can do this.
+  virtual bool TryGetValueBitmaps(std::vector<ValueBitmap>& valueBitmaps) {
+    return false;
+  }
 };
 }  // namespace jonoondb_api
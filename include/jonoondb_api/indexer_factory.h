@@ -8,12 +8,12 @@ namespace jonoondb_api {
 // Forward declarations
 class IndexInfoImpl;
 class Indexer;
-enum class FieldType : std::int8_t;
+class DocumentSchema;
 
 class IndexerFactory {
  public:
   static Indexer* CreateIndexer(const IndexInfoImpl& indexInfo,
-                                const FieldType& fieldType);
+                                const DocumentSchema& documentSchema);
 
  private:
   IndexerFactory() = delete;
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "buffer_impl.h"
+#include "gsl/span.h"
+#include "write_options_impl.h"
+
+namespace jonoondb_api {
+// Forward Declaration
+class DocumentCollection;
+
+// InsertQueue buffers the asynchronous inserts into a collection. Push copies
+// the documents into the queue and returns, a writer thread drains the queue
+// and inserts the documents of all the queued requests that have the same
+// write options with a single MultiInsert. The queue holds at most capacity
+// documents, when it is full Push either waits for the writer or throws
+// InsertQueueFullException.
+class InsertQueue final {
+ public:
+  // Called on the writer thread once the documents of a request are inserted,
+  // error is null if they were. The documents of a request get consecutive
+  // ids starting with firstDocumentID. Their space in the queue is free
+  // again by then. Callbacks must not throw.
+  // The writer inserts nothing while it is in a callback. A callback that
+  // waits for an async insert into the same collection, e.g. by pushing
+  // into the full queue with blockWhenFull or by waiting for the result of
+  // another request, deadlocks.
+  typedef std::function<void(std::uint64_t firstDocumentID,
+                             std::exception_ptr error)>
+      Callback;
+
+  InsertQueue(std::shared_ptr<DocumentCollection> collection,
+              std::size_t capacity, bool blockWhenFull);
+  // Waits for all the queued requests to be inserted
+  ~InsertQueue();
+  InsertQueue(const InsertQueue&) = delete;
+  InsertQueue& operator=(const InsertQueue&) = delete;
+
+  // A request with more documents than the capacity is only queued when the
+  // queue is empty. The callback is not called if Push throws.
+  void Push(const gsl::span<const BufferImpl*>& documents,
+            const WriteOptionsImpl& wo, Callback callback);
+
+ private:
+  struct Request {
+    std::vector<BufferImpl> documents;
+    WriteOptionsImpl wo;
+    Callback callback;
+    // Set by Insert
+    std::uint64_t firstDocumentID = 0;
+    std::exception_ptr error;
+  };
+  void WriterFunc();
+  // Inserts the documents and sets the results of the requests
+  void Insert(std::vector<Request>& requests);
+
+  std::shared_ptr<DocumentCollection> m_collection;
+  std::size_t m_capacity;
+  bool m_blockWhenFull;
+  std::mutex m_mutex;
+  std::condition_variable m_requestQueued;
+  std::condition_variable m_spaceAvailable;
+  std::deque<Request> m_requests;
+  // Documents that are queued or being inserted by the writer
+  std::size_t m_documentCount = 0;
+  bool m_shutdown = false;
+  std::thread m_writerThread;
+};
+}  // namespace jonoondb_api
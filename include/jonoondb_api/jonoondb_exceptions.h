@@ -225,4 +225,17 @@ class ApiMisuseException : public JonoonDBException {
   }
 };
 
+class InsertQueueFullException : public JonoonDBException {
+ public:
+  InsertQueueFullException(const std::string& msg,
+                           const std::string& srcFileName,
+                           const std::string& funcName, std::size_t lineNum)
+      : JonoonDBException(msg, srcFileName, funcName, lineNum) {}
+
+ private:
+  virtual std::string GetType() override {
+    return "InsertQueueFullException";
+  }
+};
+
 }  // namespace jonoondb_api
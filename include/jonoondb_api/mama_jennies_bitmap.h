@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 #include "ewah_boolarray/ewah.h"
 #include "gsl/span.h"
 
@@ -38,6 +39,12 @@ class MamaJenniesBitmap {
   MamaJenniesBitmap& operator=(const MamaJenniesBitmap& other);
   MamaJenniesBitmap& operator=(MamaJenniesBitmap&& other);
   void Add(std::uint64_t x);
+  // Adds all the ids in [start, end), full words are added as a single run
+  // so this takes time proportional to the number of words not ids.
+  void AddRange(std::uint64_t start, std::uint64_t end);
+  // Flips the given ids which have to be sorted and smaller than the size of
+  // the bitmap. This is a single XOR pass over the compressed words.
+  void Flip(const std::vector<std::uint64_t>& ids);
   void LogicalAND(const MamaJenniesBitmap& other,
                   MamaJenniesBitmap& output) const;
   void LogicalOR(const MamaJenniesBitmap& other,
@@ -45,6 +52,13 @@ class MamaJenniesBitmap {
   void LogicalXOR(const MamaJenniesBitmap& other,
                   MamaJenniesBitmap& output) const;
 
+  // Splits the bitmap at the given ids, slices[i] gets the ids in
+  // [ends[i - 1], ends[i]) and the first slice starts at 0. Ids at or above
+  // the last end are dropped. All the ends but the last one have to be
+  // multiples of 64, so the split is a single pass over the compressed words.
+  void Split(const std::vector<std::uint64_t>& ends,
+             std::vector<MamaJenniesBitmap>& slices) const;
+
   static std::shared_ptr<MamaJenniesBitmap> LogicalAND(
       std::vector<std::shared_ptr<MamaJenniesBitmap>>& bitmaps);
   static std::shared_ptr<MamaJenniesBitmap> LogicalOR(
@@ -56,8 +70,8 @@ class MamaJenniesBitmap {
   typedef MamaJenniesBitmapConstIterator const_iterator;
   const_iterator begin() const;
   const_iterator end() const;
-  std::unique_ptr<const_iterator> begin_pointer();
-  std::unique_ptr<const_iterator> end_pointer();
+  std::unique_ptr<const_iterator> begin_pointer() const;
+  std::unique_ptr<const_iterator> end_pointer() const;
 
   void Reset();
 
@@ -65,9 +79,13 @@ class MamaJenniesBitmap {
   void Deserialize(BitmapType type, int version, gsl::span<const char> buffer);
   BitmapType GetType() const;
   bool Empty() const;
+  // Returns the number of ids in the bitmap, this is a popcount over the
+  // compressed words
+  std::uint64_t GetCount() const;
+  // Returns the number of bits the bitmap covers, all its ids are smaller
+  std::uint64_t GetSizeInBits() const;
 
  private:
-  std::uint64_t GetSizeInBits() const;
   MamaJenniesBitmap(
       std::unique_ptr<EWAHBoolArray<std::uint64_t>> ewahBoolArray);
   std::unique_ptr<EWAHBoolArray<std::uint64_t>> m_ewahBoolArray;
@@ -2,12 +2,18 @@
 
 #include <boost/interprocess/file_mapping.hpp>
 #include <boost/interprocess/mapped_region.hpp>
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <sstream>
 #include <string>
+#include "engine_stats.h"
 #include "jonoondb_exceptions.h"
 
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
 namespace jonoondb_api {
 enum class MemoryMappedFileMode : std::int32_t { ReadOnly = 1, ReadWrite = 2 };
 
@@ -52,6 +58,46 @@ class MemoryMappedFile final {
     return offsetAddress;
   }
 
+  // Tells the OS that the given range will be read soon so it can start
+  // reading the pages in the background. This is only a hint, errors are
+  // ignored and on Windows it does nothing.
+  void Prefetch(size_t offset, size_t numBytes) {
+#if !defined(_WIN32)
+    auto regionSize = m_mappedRegion.get_size();
+    if (offset >= regionSize || numBytes == 0) {
+      return;
+    }
+    // Address passed to madvise has to be page aligned
+    auto remainder = offset % m_pageSize;
+    offset -= remainder;
+    numBytes = std::min(numBytes + remainder, regionSize - offset);
+    posix_madvise(GetOffsetAddressAsCharPtr(offset), numBytes,
+                  POSIX_MADV_WILLNEED);
+#endif
+  }
+
+  // Tells the OS that the given range is not needed anymore so it can drop
+  // its pages. The pages of a read only mapping are read again from the file
+  // if they are accessed later. On Windows it does nothing.
+  void Release(size_t offset, size_t numBytes) {
+#if !defined(_WIN32)
+    auto regionSize = m_mappedRegion.get_size();
+    // Only whole pages in the range are released
+    auto begin = (offset + m_pageSize - 1) / m_pageSize * m_pageSize;
+    auto end =
+        std::min(offset + numBytes, regionSize) / m_pageSize * m_pageSize;
+    if (begin >= end) {
+      return;
+    }
+    posix_madvise(GetOffsetAddressAsCharPtr(begin), end - begin,
+                  POSIX_MADV_DONTNEED);
+#endif
+  }
+
+  size_t GetSize() {
+    return m_mappedRegion.get_size();
+  }
+
   size_t GetCurrentWriteOffset() {
     return m_currentWriteOffset;
   }
@@ -98,6 +144,7 @@ class MemoryMappedFile final {
     offset = m_pageSize * quotient;
     numBytes += remainder;
 
+    LatencyTimer timer(EngineLatency::MSYNC);
     if (!m_mappedRegion.flush(offset, numBytes, m_asynchronous)) {
       throw FileIOException(
           "Unexpected error occured while flushing memory mapped file.",
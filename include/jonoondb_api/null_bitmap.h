@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "chunked_vector.h"
+#include "constraint.h"
+#include "mama_jennies_bitmap.h"
+
+namespace jonoondb_api {
+// NullBitmap records which documents have a null value for an indexed field.
+// Indexers use it instead of storing the null sentinels from null_helpers.h
+// as regular values, so value comparisons never have to look for sentinels
+// and IS NULL / IS NOT NULL are answered without touching the values.
+// Documents have to be added in increasing documentID order, which is the
+// order in which indexers receive them.
+class NullBitmap {
+ public:
+  void Add(std::uint64_t documentID, bool isNull) {
+    auto word = documentID / 64;
+    while (word >= m_words.size()) {
+      m_words.emplace_back(0);
+    }
+
+    if (isNull) {
+      m_words[word].fetch_or(1ULL << (documentID % 64),
+                             std::memory_order_relaxed);
+      m_hasNulls.store(true, std::memory_order_relaxed);
+    }
+    m_documentCount.store(documentID + 1, std::memory_order_release);
+  }
+
+  bool IsNull(std::uint64_t documentID) const {
+    auto word = documentID / 64;
+    return word < m_words.size() &&
+           (m_words[word].load(std::memory_order_relaxed) &
+            (1ULL << (documentID % 64))) != 0;
+  }
+
+  bool HasNulls() const {
+    return m_hasNulls.load(std::memory_order_relaxed);
+  }
+
+  static bool IsNullOperator(IndexConstraintOperator op) {
+    return op == IndexConstraintOperator::IS_NULL ||
+           op == IndexConstraintOperator::IS_NOT_NULL;
+  }
+
+  // Returns the documents matching an IS_NULL or IS_NOT_NULL constraint
+  std::shared_ptr<MamaJenniesBitmap> Filter(IndexConstraintOperator op) const {
+    auto bitmap = std::make_shared<MamaJenniesBitmap>();
+    // Only look at the documents added before we started
+    auto documentCount = m_documentCount.load(std::memory_order_acquire);
+    if (op == IndexConstraintOperator::IS_NULL) {
+      if (!HasNulls()) {
+        return bitmap;
+      }
+
+      auto wordCount = (documentCount + 63) / 64;
+      for (std::size_t i = 0; i < wordCount; i++) {
+        auto word = m_words[i].load(std::memory_order_relaxed);
+        if (word == 0) {
+          continue;
+        }
+
+        for (std::uint64_t bit = 0; bit < 64; bit++) {
+          if ((word & (1ULL << bit)) && i * 64 + bit < documentCount) {
+            bitmap->Add(i * 64 + bit);
+          }
+        }
+      }
+    } else {
+      for (std::uint64_t id = 0; id < documentCount; id++) {
+        if (!IsNull(id)) {
+          bitmap->Add(id);
+        }
+      }
+    }
+
+    return bitmap;
+  }
+
+ private:
+  // Queries read the bitmap while documents are added. Bits are only set in
+  // words that already exist and m_documentCount publishes them.
+  ChunkedVector<std::atomic<std::uint64_t>> m_words;
+  std::atomic<std::uint64_t> m_documentCount{0};
+  std::atomic<bool> m_hasNulls{false};
+};
+}  // namespace jonoondb_api
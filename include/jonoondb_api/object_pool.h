@@ -1,14 +1,23 @@
 #pragma once
 
 #include <stdlib.h>
+#include <atomic>
 #include <functional>
-#include <list>
-#include <mutex>
+#include <memory>
+#include <thread>
 #include <vector>
 #include "jonoondb_exceptions.h"
 
 namespace jonoondb_api {
 template <typename ObjectType>
+class ObjectPoolGuard;
+
+// ObjectPool keeps up to poolCapacity idle objects in slots that are taken
+// and filled with atomic exchanges, so Take and Return never block. Every
+// thread starts its search at its own slot, a thread that returns an
+// object usually gets the same object back on its next Take. Take creates
+// objects beyond poolCapacity when every object is in use, TryTake doesn't.
+template <typename ObjectType>
 class ObjectPool final {
  public:
   ObjectPool(int poolInitialiSize, int poolCapacity,
@@ -18,9 +27,9 @@ class ObjectPool final {
                  std::function<void(ObjectType*)>())
       : m_poolInitialiSize(poolInitialiSize),
         m_poolCapacity(poolCapacity),
+        m_objectCount(0),
         m_objectAllocatorFunc(objectAllocatorFunc),
-        m_objectDeallocatorFunc(objectDeallocatorFunc),
-        m_currentObjectIndex(-1) {
+        m_objectDeallocatorFunc(objectDeallocatorFunc) {
     if (m_poolCapacity == 0 || m_poolCapacity < m_poolInitialiSize) {
       throw InvalidArgumentException(
           "Argument poolCapacity cannot be 0 or less than initialPoolSize.",
@@ -43,71 +52,149 @@ class ObjectPool final {
       m_objectResetFunc = objectResetFunc;
     }
 
-    m_objects.resize(m_poolCapacity, nullptr);
+    m_objects.reset(new std::atomic<ObjectType*>[m_poolCapacity]);
+    for (int i = 0; i < m_poolCapacity; i++) {
+      m_objects[i].store(nullptr, std::memory_order_relaxed);
+    }
 
     try {
       for (int i = 0; i < m_poolInitialiSize; i++) {
-        m_objects[i] = InvokeObjectAllocatorFunc();
-        if (m_objects[i] == nullptr) {
+        ObjectType* obj = InvokeObjectAllocatorFunc();
+        if (obj == nullptr) {
           throw JonoonDBException(
               "Object allocation failed. ObjectAllocatorFunc returned nullptr.",
               __FILE__, __func__, __LINE__);
         }
+        m_objects[i].store(obj, std::memory_order_relaxed);
+        m_objectCount.fetch_add(1, std::memory_order_relaxed);
       }
-      m_currentObjectIndex = m_poolInitialiSize - 1;
     } catch (...) {
-      for (int i = 0; i <= m_currentObjectIndex; i++) {
-        if (m_objects[i] != nullptr) {
-          InvokeObjectDeallocatorFunc(m_objects[i]);
-        }
-      }
-
+      DeallocateIdleObjects();
       throw;
     }
   }
 
   ObjectType* Take() {
-    {
-      // The lock will be released when lock goes out of scope
-      std::lock_guard<std::mutex> lock(m_mutex);
-      if (m_currentObjectIndex > -1) {
-        ObjectType* obj = m_objects[m_currentObjectIndex];
-        m_objects[m_currentObjectIndex] = nullptr;
-        m_currentObjectIndex--;
-        return obj;
-      }
+    ObjectType* obj = TryTakeIdle();
+    if (obj != nullptr) {
+      return obj;
     }
 
     // If we are here the we have exhausted all objects of the pool.
     // Construct a new object and hand it to the consumer
-    return InvokeObjectAllocatorFunc();
+    return AllocateObject();
+  }
+
+  // Returns an idle object or a new one if there are less than poolCapacity
+  // objects. Returns nullptr if all poolCapacity objects are in use.
+  ObjectType* TryTake() {
+    ObjectType* obj = TryTakeIdle();
+    if (obj != nullptr) {
+      return obj;
+    }
+
+    auto count = m_objectCount.load(std::memory_order_relaxed);
+    do {
+      if (count >= m_poolCapacity) {
+        return nullptr;
+      }
+    } while (!m_objectCount.compare_exchange_weak(count, count + 1,
+                                                  std::memory_order_relaxed));
+
+    try {
+      return InvokeObjectAllocatorFunc();
+    } catch (...) {
+      m_objectCount.fetch_sub(1, std::memory_order_relaxed);
+      throw;
+    }
   }
 
   void Return(ObjectType* object) {
-    {
-      // The lock will be released when lock goes out of scope
-      std::lock_guard<std::mutex> lock(m_mutex);
-      if (m_currentObjectIndex < (m_poolCapacity - 1)) {
-        InvokeObjectResetFunc(object);
-        m_currentObjectIndex++;
-        m_objects[m_currentObjectIndex] = object;
+    InvokeObjectResetFunc(object);
+    auto start = GetThreadSlot();
+    for (int i = 0; i < m_poolCapacity; i++) {
+      auto& slot = m_objects[(start + i) % m_poolCapacity];
+      ObjectType* expected = nullptr;
+      if (slot.load(std::memory_order_relaxed) == nullptr &&
+          slot.compare_exchange_strong(expected, object,
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed)) {
         return;
       }
     }
 
     // Drop this object to the floor and continue.
     // This will only happen if pool is at max capacity.
+    m_objectCount.fetch_sub(1, std::memory_order_relaxed);
     InvokeObjectDeallocatorFunc(object);
   }
 
-  ~ObjectPool() {
-    for (int i = 0; i <= m_currentObjectIndex; i++) {
-      InvokeObjectDeallocatorFunc(m_objects[i]);
-      m_objects[i] = nullptr;
+  // Takes every idle object out of the pool, calls func with it and returns
+  // it. Objects that are in use at the time are not visited.
+  template <typename Func>
+  void ForEachIdle(Func func) {
+    // All objects are taken out first, a returned object could otherwise
+    // land in a slot that is visited later
+    std::vector<ObjectPoolGuard<ObjectType>> idleObjects;
+    for (int i = 0; i < m_poolCapacity; i++) {
+      ObjectType* obj =
+          m_objects[i].exchange(nullptr, std::memory_order_acquire);
+      if (obj != nullptr) {
+        idleObjects.emplace_back(this, obj);
+      }
+    }
+
+    for (auto& obj : idleObjects) {
+      func(static_cast<ObjectType*>(obj));
     }
   }
 
+  ~ObjectPool() {
+    DeallocateIdleObjects();
+  }
+
  private:
+  static std::size_t GetThreadSlot() {
+    static thread_local std::size_t slot =
+        std::hash<std::thread::id>()(std::this_thread::get_id());
+    return slot;
+  }
+
+  ObjectType* TryTakeIdle() {
+    auto start = GetThreadSlot();
+    for (int i = 0; i < m_poolCapacity; i++) {
+      auto& slot = m_objects[(start + i) % m_poolCapacity];
+      // Skip empty slots without writing to them
+      if (slot.load(std::memory_order_relaxed) != nullptr) {
+        ObjectType* obj = slot.exchange(nullptr, std::memory_order_acquire);
+        if (obj != nullptr) {
+          return obj;
+        }
+      }
+    }
+
+    return nullptr;
+  }
+
+  ObjectType* AllocateObject() {
+    m_objectCount.fetch_add(1, std::memory_order_relaxed);
+    try {
+      return InvokeObjectAllocatorFunc();
+    } catch (...) {
+      m_objectCount.fetch_sub(1, std::memory_order_relaxed);
+      throw;
+    }
+  }
+
+  void DeallocateIdleObjects() {
+    for (int i = 0; i < m_poolCapacity; i++) {
+      ObjectType* obj = m_objects[i].exchange(nullptr);
+      if (obj != nullptr) {
+        InvokeObjectDeallocatorFunc(obj);
+      }
+    }
+  }
+
   inline ObjectType* InvokeObjectAllocatorFunc() {
     return m_objectAllocatorFunc();
   }
@@ -122,14 +209,14 @@ class ObjectPool final {
     }
   }
 
-  std::vector<ObjectType*> m_objects;
+  std::unique_ptr<std::atomic<ObjectType*>[]> m_objects;
   int m_poolInitialiSize;
   int m_poolCapacity;
+  // Number of objects that are idle or in use
+  std::atomic<int> m_objectCount;
   std::function<ObjectType*()> m_objectAllocatorFunc;
   std::function<void(ObjectType*)> m_objectDeallocatorFunc;
   std::function<void(ObjectType*)> m_objectResetFunc;
-  int m_currentObjectIndex;
-  std::mutex m_mutex;
 };
 
 template <typename ObjectType>
@@ -180,6 +267,10 @@ class ObjectPoolGuard {
     return m_obj;
   }
 
+  ObjectType* operator->() const {
+    return m_obj;
+  }
+
  private:
   ObjectPool<ObjectType>* m_pool;
   ObjectType* m_obj;
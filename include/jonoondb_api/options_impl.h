@@ -19,9 +19,39 @@ class OptionsImpl {
   void SetMemoryCleanupThreshold(std::size_t valInBytes);
   std::size_t GetMemoryCleanupThreshold();
 
+  // Maximum number of threads a single query can use, 1 disables intra-query
+  // parallelism
+  void SetMaxQueryThreads(std::size_t value);
+  std::size_t GetMaxQueryThreads() const;
+
+  // Maximum number of threads a single insert uses to verify and compress
+  // its documents
+  void SetMaxInsertThreads(std::size_t value);
+  std::size_t GetMaxInsertThreads() const;
+
+  // Number of data files a collection appends to in parallel, see
+  // BlobManager
+  void SetWriteLanes(std::size_t value);
+  std::size_t GetWriteLanes() const;
+
+  // Maximum number of documents waiting in the insert queue of a collection,
+  // see InsertQueue
+  void SetInsertQueueCapacity(std::size_t value);
+  std::size_t GetInsertQueueCapacity() const;
+
+  // Whether an async insert waits for space in a full insert queue or
+  // throws InsertQueueFullException
+  void SetBlockWhenInsertQueueFull(bool value);
+  bool GetBlockWhenInsertQueueFull() const;
+
  private:
   bool m_createDBIfMissing;
   std::size_t m_maxDataFileSize;
   std::size_t m_memCleanupThresholdInBytes;
+  std::size_t m_maxQueryThreads;
+  std::size_t m_maxInsertThreads;
+  std::size_t m_writeLanes;
+  std::size_t m_insertQueueCapacity;
+  bool m_blockWhenInsertQueueFull;
 };
 }  // namespace jonoondb_api
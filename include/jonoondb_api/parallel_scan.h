@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "mama_jennies_bitmap.h"
+
+namespace jonoondb_api {
+// Forward Declarations
+class DocumentCollection;
+
+// ParallelScan lets the workers of a parallel aggregate query share the
+// filtering of the collection. Every worker aggregates a contiguous range of
+// document ids. The first one that filters the collection computes the
+// bitmap of the whole query and splits it into the ranges, the others only
+// take their slice. The query processor installs it for a worker with a
+// ParallelScanScope, the vtable gets it through Current().
+class ParallelScan final {
+ public:
+  // rangeEnds are the exclusive ends of the ranges, the first range starts
+  // at 0. All the ends but the last one have to be multiples of 64.
+  ParallelScan(const DocumentCollection& collection,
+               std::vector<std::uint64_t> rangeEnds);
+  ParallelScan(const ParallelScan&) = delete;
+  ParallelScan& operator=(const ParallelScan&) = delete;
+
+  // The scan and the range of the current thread, nullptr if the thread is
+  // not a worker of a parallel query
+  static ParallelScan* Current(std::size_t& range);
+  std::uint64_t GetRangeStart(std::size_t range) const;
+  std::uint64_t GetRangeEnd(std::size_t range) const;
+  // Returns true if a scan of collection over [startID, endID) is the scan
+  // of the given range
+  bool IsRangeScan(const DocumentCollection& collection, std::size_t range,
+                   std::int64_t startID, std::int64_t endID) const;
+  // Returns the ids of the range that filter returns. filter is only called
+  // once for all the ranges, it has to return the ids of the whole query.
+  std::shared_ptr<const MamaJenniesBitmap> GetSlice(
+      std::size_t range,
+      const std::function<std::shared_ptr<const MamaJenniesBitmap>()>& filter);
+
+ private:
+  const DocumentCollection& m_collection;
+  std::vector<std::uint64_t> m_rangeEnds;
+  std::mutex m_mutex;
+  bool m_filtered = false;
+  std::exception_ptr m_filterError;
+  std::vector<std::shared_ptr<const MamaJenniesBitmap>> m_slices;
+};
+
+class ParallelScanScope final {
+ public:
+  ParallelScanScope(ParallelScan* scan, std::size_t range);
+  ~ParallelScanScope();
+  ParallelScanScope(const ParallelScanScope&) = delete;
+  ParallelScanScope& operator=(const ParallelScanScope&) = delete;
+
+ private:
+  ParallelScan* m_previousScan;
+  std::size_t m_previousRange;
+};
+}  // namespace jonoondb_api
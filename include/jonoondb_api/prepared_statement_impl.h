@@ -0,0 +1,53 @@
+#pragma once
+
+#include <boost/utility/string_ref.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace jonoondb_api {
+// Forward declarations
+class QueryProcessor;
+class ResultSetImpl;
+
+// A value bound to a statement parameter, type is one of the SQLite
+// fundamental datatypes
+struct ParameterValue {
+  int type;
+  std::int64_t intVal;
+  double doubleVal;
+  std::string bytes;
+};
+
+// PreparedStatementImpl is a SELECT or DELETE statement with ? parameters
+// that can be executed any number of times. The bound values are kept until
+// they are bound again or cleared. Every execution runs the statement from
+// the statement cache of the connection it executes on, so the SQL is only
+// parsed and planned once per connection.
+class PreparedStatementImpl final {
+ public:
+  PreparedStatementImpl(QueryProcessor* queryProcessor, const std::string& sql,
+                        std::int32_t parameterCount, bool isDelete);
+
+  std::int32_t GetParameterCount() const;
+  // Parameters are numbered from 1, like in SQLite
+  void BindInteger(std::int32_t paramIndex, std::int64_t val);
+  void BindDouble(std::int32_t paramIndex, double val);
+  void BindString(std::int32_t paramIndex, const boost::string_ref& val);
+  void BindBlob(std::int32_t paramIndex, const char* val, std::uint64_t size);
+  void BindNull(std::int32_t paramIndex);
+  // Sets all parameters back to NULL
+  void ClearBindings();
+
+  ResultSetImpl ExecuteSelect();
+  // Returns the number of deleted documents
+  std::int64_t ExecuteDelete();
+
+ private:
+  ParameterValue& GetParameter(std::int32_t paramIndex);
+  QueryProcessor* m_queryProcessor;
+  std::string m_sql;
+  bool m_isDelete;
+  std::vector<ParameterValue> m_parameters;
+};
+}  // namespace jonoondb_api
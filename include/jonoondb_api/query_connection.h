@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "guard_funcs.h"
+#include "sqlite3.h"
+#include "statement_cache.h"
+
+namespace jonoondb_api {
+// QueryConnection is a read connection of the query processor together
+// with the state that belongs to it. Every connection has its own private
+// database with the collections declared as virtual tables in its temp
+// schema, so connections never share any SQLite locks.
+struct QueryConnection {
+  QueryConnection(sqlite3* connection, std::size_t statementCacheCapacity)
+      : db(connection, GuardFuncs::SQLite3Close),
+        statementCache(statementCacheCapacity) {}
+
+  // Declared first so it is closed after its statements are finalized
+  std::unique_ptr<sqlite3, void (*)(sqlite3*)> db;
+  StatementCache statementCache;
+  // Schema version of the query processor the vtables were last brought
+  // up to date with
+  std::uint64_t schemaVersion = 0;
+  // The declared collections and the schema version they were added in
+  std::unordered_map<std::string, std::uint64_t> collections;
+  // True while the temp table of an aggregate query exists
+  bool hasPartialAggregate = false;
+  // True while the query processor runs a statement of its own, the
+  // authorizer of the connection only allows queries otherwise
+  bool isInternalStatement = false;
+};
+}  // namespace jonoondb_api
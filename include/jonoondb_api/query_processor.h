@@ -1,34 +1,108 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "guard_funcs.h"
 #include "object_pool.h"
 #include "sqlite3.h"
 
 namespace jonoondb_api {
 // Forward declarations
+class AggregateQuery;
 class DocumentCollection;
+struct DocumentCollectionInfo;
 class DocumentSchema;
+class PreparedStatementImpl;
 class ResultSetImpl;
+class StatementCache;
+class ThreadPool;
+struct ParameterValue;
+struct QueryConnection;
+struct QueryProfile;
+struct PartialRow;
 
 class QueryProcessor final {
  public:
-  QueryProcessor(const std::string& dbPath, const std::string& dbName);
+  QueryProcessor(const std::string& dbName, std::size_t maxQueryThreads);
+  ~QueryProcessor();
   QueryProcessor(const QueryProcessor&) = delete;
   QueryProcessor(QueryProcessor&&) = delete;
   QueryProcessor& operator=(const QueryProcessor&) = delete;
   void AddCollection(const std::shared_ptr<DocumentCollection>& collection);
   void RemoveCollection(const std::string& collectionName);
-  ResultSetImpl ExecuteSelect(const std::string& selectStatement);
+  // If collectProfile is true the resultset carries a QueryProfile of the
+  // execution of the query
+  ResultSetImpl ExecuteSelect(const std::string& selectStatement,
+                              bool collectProfile = false);
   std::int64_t Delete(const std::string& deleteStatement);
+  // Prepares a SELECT or DELETE statement with ? parameters
+  PreparedStatementImpl Prepare(const std::string& statement);
+  ResultSetImpl ExecutePreparedSelect(
+      const std::string& selectStatement,
+      const std::vector<ParameterValue>& parameters);
+  std::int64_t ExecutePreparedDelete(
+      const std::string& deleteStatement,
+      const std::vector<ParameterValue>& parameters);
 
  private:
-  sqlite3* OpenConnection();
-  std::unique_ptr<sqlite3, void (*)(sqlite3*)> m_readWriteDBConnection;
+  // The create statement of a collection vtable and the schema version the
+  // collection was added in
+  struct CollectionVTable {
+    std::uint64_t schemaVersion;
+    std::string createStatement;
+  };
+
+  // Records the query in profile if it is not nullptr
+  ResultSetImpl ExecuteSelectInternal(const std::string& selectStatement,
+                                      QueryProfile* profile);
+  QueryConnection* OpenConnection();
+  void CloseConnection(QueryConnection* connection);
+  // Drops what a query left behind before the connection goes back to the
+  // pool
+  void ResetConnection(QueryConnection* connection);
+  // Takes a connection from the pool with its vtables up to date. If
+  // withinCapacity is true no connection is opened beyond the capacity of
+  // the pool and the guard is empty when all connections are in use.
+  ObjectPoolGuard<QueryConnection> TakeConnection(bool withinCapacity = false);
+  // Declares the added and drops the removed collections on connection,
+  // m_schemaMutex must be held
+  void UpdateSchema(QueryConnection& connection);
+  void UpdateIdleConnections();
+  // Computes the result rows of a column aggregate query from the indexes
+  // of the collection. Returns false if the indexes can't answer the query.
+  bool TryComputeColumnAggregate(const AggregateQuery& query,
+                                 const DocumentCollectionInfo& collectionInfo,
+                                 std::vector<PartialRow>& rows);
+  // Returns false if the partial statement of query is not valid SQL on its
+  // own, e.g. because it refers to an alias of the query
+  bool CanPreparePartialStatement(const AggregateQuery& query);
+  ResultSetImpl ExecuteParallelAggregate(const AggregateQuery& query,
+                                         const DocumentCollection& collection,
+                                         std::uint64_t documentCount,
+                                         std::size_t threadCount);
+  void ExecutePartialAggregate(QueryConnection& connection,
+                               const AggregateQuery& query,
+                               std::int64_t startID, std::int64_t endID,
+                               std::vector<PartialRow>& rows);
   std::unique_ptr<sqlite3, void (*)(sqlite3*)> m_deleteStmtConnection;
-  std::unique_ptr<ObjectPool<sqlite3>> m_dbConnectionPool;
-  std::string m_dbConnStr;
+  // Guards m_deleteStmtConnection and its statement cache
+  std::mutex m_deleteStmtMutex;
+  std::unique_ptr<StatementCache> m_deleteStatementCache;
+  // Guards m_collectionVTables and the schema updates of the connections.
+  // m_schemaVersion is only written with the mutex held, reading it lets
+  // TakeConnection skip the mutex while the schema doesn't change.
+  std::mutex m_schemaMutex;
+  std::unordered_map<std::string, CollectionVTable> m_collectionVTables;
+  std::atomic<std::uint64_t> m_schemaVersion;
+  std::unique_ptr<ObjectPool<QueryConnection>> m_dbConnectionPool;
   std::string m_dbName;
+  std::size_t m_maxQueryThreads;
+  // Declared last, the queued tasks finish before the connections close
+  std::unique_ptr<ThreadPool> m_queryThreadPool;
 };
 }  // namespace jonoondb_api
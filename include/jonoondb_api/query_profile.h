@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace jonoondb_api {
+// How a collection vtable was scanned by one xFilter call
+struct ScanProfile {
+  std::string collectionName;
+  // INDEX FILTER, ROWID RANGE, RANGE SLICE, FULL SCAN or NO MATCH
+  std::string plan;
+  // The constraints xBestIndex handed to xFilter, e.g. "id >"
+  std::vector<std::string> constraints;
+  std::chrono::nanoseconds filterTime = std::chrono::nanoseconds::zero();
+  // Document ids produced by the filter and visited by SQLite
+  std::uint64_t rowsScanned = 0;
+};
+
+// QueryProfile collects where a query spent its time. The query processor
+// installs it as the current profile of the executing thread with a
+// QueryProfileScope, the storage and vtable code add to it through
+// Current(). Profiling is opt in, when no profile is installed Current()
+// returns nullptr and nothing is recorded.
+struct QueryProfile {
+  // The profile the current thread records into, nullptr if there is none
+  static QueryProfile* Current();
+  // Adds the stages and counters of other, used for the worker threads of
+  // parallel queries
+  void Merge(const QueryProfile& other);
+  // A human readable report of the profile
+  std::string ToString() const;
+
+  // How the query processor executed the query
+  std::string plan;
+  // The rows of SQLite's EXPLAIN QUERY PLAN for the statement
+  std::vector<std::string> sqlitePlan;
+  std::vector<ScanProfile> scans;
+  std::size_t workerThreads = 0;
+
+  std::chrono::nanoseconds prepareTime = std::chrono::nanoseconds::zero();
+  std::chrono::nanoseconds filterTime = std::chrono::nanoseconds::zero();
+  std::chrono::nanoseconds fetchTime = std::chrono::nanoseconds::zero();
+  // Time spent in Next and FetchBatch, this includes filtering and fetching
+  std::chrono::nanoseconds executionTime = std::chrono::nanoseconds::zero();
+  std::uint64_t rowsReturned = 0;
+
+  std::uint64_t bitmapsANDed = 0;
+  std::uint64_t bitmapsORed = 0;
+  // Column values served by indexers and read from documents
+  std::uint64_t indexerValues = 0;
+  std::uint64_t documentValues = 0;
+  std::uint64_t documentsFetched = 0;
+  std::uint64_t fetchBatches = 0;
+  std::uint64_t blobsRead = 0;
+  // Bytes read from the data files and produced by decompressing them
+  std::uint64_t bytesRead = 0;
+  std::uint64_t bytesDecompressed = 0;
+  // Lookups of the memory mapped data files in the reader file cache
+  std::uint64_t fileCacheHits = 0;
+  std::uint64_t fileCacheMisses = 0;
+};
+
+// Makes profile the current profile of the thread for its lifetime, profile
+// can be nullptr to stop profiling.
+class QueryProfileScope final {
+ public:
+  explicit QueryProfileScope(QueryProfile* profile);
+  ~QueryProfileScope();
+  QueryProfileScope(const QueryProfileScope&) = delete;
+  QueryProfileScope& operator=(const QueryProfileScope&) = delete;
+
+ private:
+  QueryProfile* m_previous;
+};
+
+// Adds the time from its construction to its destruction to stageTime,
+// does nothing if stageTime is nullptr.
+class StageTimer final {
+ public:
+  explicit StageTimer(std::chrono::nanoseconds* stageTime)
+      : m_stageTime(stageTime) {
+    if (m_stageTime != nullptr) {
+      m_start = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~StageTimer() {
+    if (m_stageTime != nullptr) {
+      *m_stageTime += std::chrono::steady_clock::now() - m_start;
+    }
+  }
+
+  StageTimer(const StageTimer&) = delete;
+  StageTimer& operator=(const StageTimer&) = delete;
+
+ private:
+  std::chrono::nanoseconds* m_stageTime;
+  std::chrono::steady_clock::time_point m_start;
+};
+}  // namespace jonoondb_api
@@ -3,16 +3,48 @@
 #include <boost/utility/string_ref.hpp>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
+#include <string>
+#include <vector>
 #include "enums.h"
 #include "object_pool.h"
 #include "sqlite3.h"
 
 namespace jonoondb_api {
+// Forward declarations
+struct QueryConnection;
+struct QueryProfile;
+
+// Caller owned buffers that FetchBatch fills with the values of one column,
+// laid out like Arrow arrays. The values are converted to type, which is
+// one of INTEGER, DOUBLE, STRING or BLOB.
+struct ColumnBatchBuffers {
+  std::int32_t columnIndex;
+  SqlType type;
+  // Bit i (least significant bit first) is set if row i is not null, needs
+  // (maxRows + 7) / 8 bytes
+  std::uint8_t* validity;
+  // INTEGER and DOUBLE values, one per row
+  std::int64_t* int64Values;
+  double* doubleValues;
+  // STRING and BLOB values, the value of row i is
+  // data[offsets[i], offsets[i + 1]), so offsets needs maxRows + 1 entries
+  std::int64_t* offsets;
+  char* data;
+  std::uint64_t dataCapacity;
+};
+
 class ResultSetImpl {
  public:
-  ResultSetImpl(ObjectPoolGuard<sqlite3> db, const std::string& selectStmt);
+  ResultSetImpl(ObjectPoolGuard<QueryConnection> db,
+                const std::string& selectStmt);
+  // Takes over a statement that is already prepared on db, releaseFunc is
+  // called with the statement instead of finalizing it.
+  ResultSetImpl(ObjectPoolGuard<QueryConnection> db, sqlite3_stmt* stmt,
+                std::function<void(sqlite3_stmt*)> releaseFunc);
+  ~ResultSetImpl();
   ResultSetImpl(ResultSetImpl&& other);
   ResultSetImpl& operator=(ResultSetImpl&& other);
   ResultSetImpl(const ResultSetImpl& other) = delete;
@@ -28,14 +60,34 @@ class ResultSetImpl {
   SqlType GetColumnType(std::int32_t columnIndex);
   const std::string& GetColumnLabel(std::int32_t columnIndex);
   bool IsNull(std::int32_t columnIndex);
+  // Reads up to maxRows rows into the column buffers and returns the number
+  // of rows read, 0 once the resultset is consumed. A row whose strings or
+  // blobs don't fit in the remaining data capacity ends the batch and is
+  // returned first by the next FetchBatch or Next call. If not even the
+  // first row fits an InvalidArgumentException is thrown.
+  std::uint64_t FetchBatch(ColumnBatchBuffers* columns,
+                           std::size_t columnCount, std::uint64_t maxRows);
+  // Makes the resultset record the execution of the query in profile
+  void SetProfile(std::unique_ptr<QueryProfile> profile);
+  // Returns nullptr if the query is not profiled
+  const QueryProfile* GetProfile() const;
 
  private:
-  ObjectPoolGuard<sqlite3> m_db;
-  std::unique_ptr<sqlite3_stmt, void (*)(sqlite3_stmt*)> m_stmt;
+  bool Step();
+  void ReadColumns();
+  bool FitsInBatch(const ColumnBatchBuffers* columns, std::size_t columnCount,
+                   std::uint64_t row);
+  // Declared first so the cursors of the statement never outlive it
+  std::unique_ptr<QueryProfile> m_profile;
+  ObjectPoolGuard<QueryConnection> m_db;
+  // Declared after m_db so the statement is released before the connection
+  std::unique_ptr<sqlite3_stmt, std::function<void(sqlite3_stmt*)>> m_stmt;
   std::map<boost::string_ref, int> m_columnMap;
   std::vector<std::string> m_columnMapStringStore;
   std::vector<int> m_columnSqlType;
   mutable std::string m_tmpStrStorage;
   bool m_resultSetConsumed = false;
+  // The current row was stepped to but not handed out yet
+  bool m_rowPending = false;
 };
 }  // namespace jonoondb_api
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "mama_jennies_bitmap.h"
+
+namespace jonoondb_api {
+// SegmentedBitmapMap is the value to bitmap map of an inverted index. Queries
+// read it without locks while documents are inserted. The writer adds to a
+// private active map and Publish makes a copy of it visible together with
+// the sealed segments, which are immutable maps over older ranges of
+// document ids. Once the active map has SegmentDocumentCount documents it is
+// sealed and segments of the same size are merged, so a collection of n
+// documents has O(log n) segments. A query ORs together the bitmaps the
+// segments have for a value.
+template <typename Key>
+class SegmentedBitmapMap final {
+ public:
+  typedef std::map<Key, std::shared_ptr<MamaJenniesBitmap>> Map;
+  typedef std::vector<std::shared_ptr<const Map>> Segments;
+
+  static const std::uint64_t SegmentDocumentCount = 1024;
+
+  SegmentedBitmapMap() : m_published(std::make_shared<const Segments>()) {}
+
+  // Add and Publish can only be called by the writer
+  void Add(const Key& key, std::uint64_t documentID) {
+    auto iter = m_active.find(key);
+    if (iter == m_active.end()) {
+      iter = m_active.emplace(key, std::make_shared<MamaJenniesBitmap>()).first;
+    }
+    iter->second->Add(documentID);
+    m_activeDocumentCount++;
+    m_changed = true;
+  }
+
+  // Makes the documents added since the last call visible to queries
+  void Publish() {
+    if (!m_changed) {
+      return;
+    }
+    m_changed = false;
+
+    if (m_activeDocumentCount >= SegmentDocumentCount) {
+      Seal();
+      std::atomic_store(&m_published,
+                        std::make_shared<const Segments>(m_sealed));
+      return;
+    }
+
+    // The active map keeps changing so queries get a copy of it
+    auto active = std::make_shared<Map>();
+    for (auto& item : m_active) {
+      active->emplace_hint(
+          active->end(), item.first,
+          std::make_shared<MamaJenniesBitmap>(*item.second));
+    }
+    auto segments = std::make_shared<Segments>(m_sealed);
+    segments->push_back(std::move(active));
+    std::atomic_store(&m_published,
+                      std::shared_ptr<const Segments>(std::move(segments)));
+  }
+
+  // Returns the published segments, neither the maps nor the bitmaps in them
+  // are ever modified
+  std::shared_ptr<const Segments> GetSegments() const {
+    return std::atomic_load(&m_published);
+  }
+
+  // Returns a single map with the bitmaps of all the segments
+  static Map Merge(const Segments& segments) {
+    Map merged;
+    for (auto& segment : segments) {
+      MergeInto(merged, *segment);
+    }
+    return merged;
+  }
+
+ private:
+  // Bitmaps that are in both maps are ORed into a new bitmap, the others are
+  // shared
+  static void MergeInto(Map& target, const Map& source) {
+    for (auto& item : source) {
+      auto iter = target.find(item.first);
+      if (iter == target.end()) {
+        target.emplace(item.first, item.second);
+      } else {
+        auto bitmap = std::make_shared<MamaJenniesBitmap>();
+        iter->second->LogicalOR(*item.second, *bitmap);
+        iter->second = std::move(bitmap);
+      }
+    }
+  }
+
+  void Seal() {
+    // No query has seen the bitmaps of the active map, only copies of them
+    m_sealed.push_back(std::make_shared<const Map>(std::move(m_active)));
+    m_sealedDocumentCounts.push_back(m_activeDocumentCount);
+    m_active.clear();
+    m_activeDocumentCount = 0;
+
+    // Like carrying in a binary counter, merge the newest segment into the
+    // one before it as long as that one is not bigger
+    while (m_sealed.size() > 1 &&
+           m_sealedDocumentCounts[m_sealed.size() - 2] <=
+               m_sealedDocumentCounts.back()) {
+      auto merged = std::make_shared<Map>(*m_sealed[m_sealed.size() - 2]);
+      MergeInto(*merged, *m_sealed.back());
+      auto documentCount = m_sealedDocumentCounts.back() +
+                           m_sealedDocumentCounts[m_sealed.size() - 2];
+      m_sealed.pop_back();
+      m_sealedDocumentCounts.pop_back();
+      m_sealed.back() = std::move(merged);
+      m_sealedDocumentCounts.back() = documentCount;
+    }
+  }
+
+  Map m_active;
+  std::uint64_t m_activeDocumentCount = 0;
+  bool m_changed = false;
+  // Oldest first
+  Segments m_sealed;
+  std::vector<std::uint64_t> m_sealedDocumentCounts;
+  // Only accessed through std::atomic_load and std::atomic_store
+  std::shared_ptr<const Segments> m_published;
+};
+}  // namespace jonoondb_api
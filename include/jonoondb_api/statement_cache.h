@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace jonoondb_api {
+// StatementCache keeps the idle prepared statements of one sqlite3
+// connection keyed by their SQL text, so executing the same SQL again skips
+// parsing and planning. The least recently used statement is finalized once
+// more than capacity statements are idle. A connection is only used by one
+// thread at a time, so the cache is not thread safe.
+class StatementCache final {
+ public:
+  explicit StatementCache(std::size_t capacity);
+  StatementCache(const StatementCache&) = delete;
+  StatementCache& operator=(const StatementCache&) = delete;
+  ~StatementCache();
+
+  // Hands out an idle statement prepared from sql on db or prepares a new
+  // one. Returns the SQLite result code of sqlite3_prepare_v2, stmt is only
+  // set on SQLITE_OK.
+  int Acquire(sqlite3* db, const std::string& sql, sqlite3_stmt*& stmt);
+  // Resets the statement, clears its bindings and keeps it for the next
+  // Acquire of sql, which must be the SQL the statement was acquired with.
+  void Release(const std::string& sql, sqlite3_stmt* stmt);
+  std::size_t GetIdleCount() const;
+
+ private:
+  std::size_t m_capacity;
+  // Idle statements, the most recently released one first
+  std::list<std::pair<std::string, sqlite3_stmt*>> m_idleStatements;
+  std::unordered_multimap<
+      std::string, std::list<std::pair<std::string, sqlite3_stmt*>>::iterator>
+      m_statementMap;
+};
+}  // namespace jonoondb_api
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jonoondb_api {
+// ThreadPool runs tasks on a fixed set of threads in the order they are
+// submitted. The pool is shared by many callers, so a caller that waits for
+// its tasks should work on them as well instead of only waiting; a busy pool
+// then slows it down but never blocks it.
+class ThreadPool final {
+ public:
+  // A pool without threads runs every task on the thread that submits it
+  explicit ThreadPool(std::size_t threadCount);
+  // Runs the tasks that are still queued and joins the threads
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  std::size_t GetThreadCount() const;
+  // Tasks must not throw
+  void Submit(std::function<void()> task);
+
+ private:
+  void WorkerFunc();
+
+  std::mutex m_mutex;
+  std::condition_variable m_taskQueued;
+  std::deque<std::function<void()>> m_tasks;
+  bool m_shutdown = false;
+  std::vector<std::thread> m_threads;
+};
+}  // namespace jonoondb_api
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include "buffer_impl.h"
+#include "database_impl.h"
+#include "flatbuffers/flatbuffers.h"
+#include "flatbuffers/reflection.h"
+#include "gsl/span.h"
+#include "jonoondb_exceptions.h"
+#include "write_options_impl.h"
+
+namespace jonoondb_api {
+// TypedSchema has to be specialized for every flatc generated root type that
+// is used with TypedCollection. A specialization provides:
+//   static const char* GetRootTypeName();
+//     Name of the root type as it appears in the binary schema e.g. LINEITEM.
+template <typename T>
+struct TypedSchema;
+
+// TypedCollection is used for collections whose schema is known at compile
+// time. Inserted documents are verified with the verifier generated by flatc.
+// Fields are read through the reflection based accessors like in any other
+// collection, they walk precomputed vtable offsets and compiled accessors
+// did not read them any faster.
+template <typename T>
+class TypedCollection final {
+ public:
+  // The collection with the given name must already exist in db and its
+  // schema must have T as the root type.
+  TypedCollection(DatabaseImpl& db, const std::string& name)
+      : m_db(db), m_name(name) {
+    if (!HasRootType(m_db.GetCollectionSchema(m_name))) {
+      std::ostringstream ss;
+      ss << "Schema of collection " << m_name << " does not have "
+         << TypedSchema<T>::GetRootTypeName() << " as the root type.";
+      throw InvalidSchemaException(ss.str(), __FILE__, __func__, __LINE__);
+    }
+  }
+
+  static bool HasRootType(const std::string& binarySchema) {
+    flatbuffers::Verifier verifier(
+        reinterpret_cast<const std::uint8_t*>(binarySchema.data()),
+        binarySchema.size());
+    if (!reflection::VerifySchemaBuffer(verifier)) {
+      return false;
+    }
+
+    auto rootTable = reflection::GetSchema(binarySchema.data())->root_table();
+    return rootTable != nullptr &&
+           rootTable->name()->str() == TypedSchema<T>::GetRootTypeName();
+  }
+
+  static const T* GetRoot(const BufferImpl& documentData) {
+    return flatbuffers::GetRoot<T>(documentData.GetData());
+  }
+
+  const std::string& GetName() const {
+    return m_name;
+  }
+
+  void Insert(const BufferImpl& documentData, const WriteOptionsImpl& wo) {
+    if (wo.verifyDocuments) {
+      Verify(documentData, 0);
+    }
+
+    m_db.Insert(m_name.c_str(), documentData,
+                WriteOptionsImpl(wo.compress, false));
+  }
+
+  void MultiInsert(gsl::span<const BufferImpl*>& documents,
+                   const WriteOptionsImpl& wo) {
+    if (wo.verifyDocuments) {
+      for (std::size_t i = 0; i < documents.size(); i++) {
+        Verify(*documents[i], i);
+      }
+    }
+
+    m_db.MultiInsert(m_name, documents, WriteOptionsImpl(wo.compress, false));
+  }
+
+ private:
+  static void Verify(const BufferImpl& documentData, std::size_t index) {
+    flatbuffers::Verifier verifier(
+        reinterpret_cast<const std::uint8_t*>(documentData.GetData()),
+        documentData.GetLength());
+    if (!verifier.VerifyBuffer<T>()) {
+      std::ostringstream ss;
+      ss << "Document at index location " << index << " is not valid.";
+      throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
+    }
+  }
+
+  DatabaseImpl& m_db;
+  std::string m_name;
+};
+}  // namespace jonoondb_api
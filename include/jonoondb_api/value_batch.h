@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace jonoondb_api {
+// ValueBatch holds the string or blob values of a column for a vector of
+// documents. The values are copied back to back into a single arena which is
+// reused across batches, so after the first few batches filling a batch does
+// not allocate. Every value is followed by a NUL so strings can be handed
+// out as C strings.
+class ValueBatch final {
+ public:
+  void Clear() {
+    m_arena.clear();
+    m_offsets.clear();
+    m_sizes.clear();
+  }
+
+  void Add(const char* val, std::size_t size) {
+    if (val == nullptr) {
+      AddNull();
+      return;
+    }
+
+    m_offsets.push_back(static_cast<std::int64_t>(m_arena.size()));
+    m_sizes.push_back(static_cast<int>(size));
+    m_arena.insert(m_arena.end(), val, val + size);
+    m_arena.push_back('\0');
+  }
+
+  void AddNull() {
+    m_offsets.push_back(std::int64_t(NullOffset));
+    m_sizes.push_back(0);
+  }
+
+  std::size_t GetCount() const {
+    return m_offsets.size();
+  }
+
+  bool IsNull(std::size_t index) const {
+    return m_offsets[index] == NullOffset;
+  }
+
+  // Returns nullptr for a null value. The pointer stays valid until the batch
+  // is modified.
+  const char* GetValue(std::size_t index, std::size_t& size) const {
+    size = static_cast<std::size_t>(m_sizes[index]);
+    if (m_offsets[index] == NullOffset) {
+      return nullptr;
+    }
+    return m_arena.data() + m_offsets[index];
+  }
+
+  // Returns a pointer for every value, nullptr for null values. The
+  // pointers stay valid until the batch is modified.
+  const char* const* GetValues() {
+    const char* arena = m_arena.data();
+    m_values.resize(m_offsets.size());
+    for (std::size_t i = 0; i < m_offsets.size(); i++) {
+      m_values[i] = m_offsets[i] == NullOffset ? nullptr : arena + m_offsets[i];
+    }
+    return m_values.data();
+  }
+
+  const int* GetSizes() const {
+    return m_sizes.data();
+  }
+
+ private:
+  static constexpr std::int64_t NullOffset = -1;
+  std::vector<char> m_arena;
+  // Offsets are stored instead of pointers because the arena can move
+  std::vector<std::int64_t> m_offsets;
+  std::vector<int> m_sizes;
+  std::vector<const char*> m_values;
+};
+}  // namespace jonoondb_api
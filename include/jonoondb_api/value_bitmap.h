@@ -0,0 +1,19 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "constraint.h"
+
+namespace jonoondb_api {
+// Forward declarations
+class MamaJenniesBitmap;
+
+// A distinct value of an indexed column and the documents that have it.
+// INTEGER and DOUBLE values are kept in operand, STRING values in strVal.
+struct ValueBitmap {
+  OperandType operandType;
+  Operand operand;
+  std::string strVal;
+  std::shared_ptr<MamaJenniesBitmap> bitmap;
+};
+}  // namespace jonoondb_api
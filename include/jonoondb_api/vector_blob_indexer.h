@@ -1,26 +1,32 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
 #include "buffer_impl.h"
+#include "chunked_vector.h"
 #include "constraint.h"
 #include "document.h"
 #include "enums.h"
 #include "exception_utils.h"
+#include "field_accessor.h"
 #include "index_info_impl.h"
 #include "index_stat.h"
 #include "indexer.h"
 #include "mama_jennies_bitmap.h"
+#include "null_bitmap.h"
 #include "null_helpers.h"
 #include "string_utils.h"
+#include "value_batch.h"
 
 namespace jonoondb_api {
 class VectorBlobIndexer final : public Indexer {
  public:
   VectorBlobIndexer(const IndexInfoImpl& indexInfo,
-                    const FieldType& fieldType) {
+                    const FieldType& fieldType,
+                    std::unique_ptr<FieldAccessor> fieldAccessor) {
     std::string errorMsg;
     if (indexInfo.GetIndexName().size() == 0) {
       errorMsg = "Argument indexInfo has empty name.";
@@ -41,7 +47,7 @@ class VectorBlobIndexer final : public Indexer {
       throw InvalidArgumentException(errorMsg, __FILE__, __func__, __LINE__);
     }
 
-    m_fieldNameTokens = StringUtils::Split(indexInfo.GetColumnName(), ".");
+    m_fieldAccessor = std::move(fieldAccessor);
     m_indexStat = IndexStat(indexInfo, fieldType);
   }
 
@@ -51,10 +57,10 @@ class VectorBlobIndexer final : public Indexer {
 
   void Insert(std::uint64_t documentID, const Document& document) override {
     std::size_t size = 0;
-    auto data = DocumentUtils::GetBlobValue(document, m_subDoc,
-                                            m_fieldNameTokens, size);
+    auto data = m_fieldAccessor->GetBlobValue(document, size);
     assert(m_dataVector.size() == documentID);
-    m_dataVector.push_back(BufferImpl(data, size, size));
+    m_nullBitmap.Add(documentID, data == nullptr);
+    m_dataVector.emplace_back(data, size, size);
   }
 
   const IndexStat& GetIndexStats() override {
@@ -74,6 +80,9 @@ class VectorBlobIndexer final : public Indexer {
         return GetBitmapGT(constraint);
       case jonoondb_api::IndexConstraintOperator::GREATER_THAN_EQUAL:
         return GetBitmapGTE(constraint);
+      case jonoondb_api::IndexConstraintOperator::IS_NULL:
+      case jonoondb_api::IndexConstraintOperator::IS_NOT_NULL:
+        return m_nullBitmap.Filter(constraint.op);
       case jonoondb_api::IndexConstraintOperator::MATCH:
         // TODO: Handle this
       default:
@@ -93,43 +102,47 @@ class VectorBlobIndexer final : public Indexer {
         upperConstraint.operandType == OperandType::BLOB) {
       if (lowerConstraint.op == IndexConstraintOperator::GREATER_THAN &&
           upperConstraint.op == IndexConstraintOperator::LESS_THAN) {
-        for (size_t i = 0; i < m_dataVector.size(); i++) {
-          if (m_dataVector[i] > lowerConstraint.blobVal &&
-              m_dataVector[i] < upperConstraint.blobVal &&
-              m_dataVector[i].GetLength() > 0) {
+        std::uint64_t i = 0;
+        for (const auto& value : m_dataVector) {
+          if (value > lowerConstraint.blobVal &&
+              value < upperConstraint.blobVal && !m_nullBitmap.IsNull(i)) {
             bitmap->Add(i);
           }
+          i++;
         }
       } else if (lowerConstraint.op == IndexConstraintOperator::GREATER_THAN &&
                  upperConstraint.op ==
                      IndexConstraintOperator::LESS_THAN_EQUAL) {
-        for (size_t i = 0; i < m_dataVector.size(); i++) {
-          if (m_dataVector[i] > lowerConstraint.blobVal &&
-              m_dataVector[i] <= upperConstraint.blobVal &&
-              m_dataVector[i].GetLength() > 0) {
+        std::uint64_t i = 0;
+        for (const auto& value : m_dataVector) {
+          if (value > lowerConstraint.blobVal &&
+              value <= upperConstraint.blobVal && !m_nullBitmap.IsNull(i)) {
             bitmap->Add(i);
           }
+          i++;
         }
       } else if (lowerConstraint.op ==
                      IndexConstraintOperator::GREATER_THAN_EQUAL &&
                  upperConstraint.op == IndexConstraintOperator::LESS_THAN) {
-        for (size_t i = 0; i < m_dataVector.size(); i++) {
-          if (m_dataVector[i] >= lowerConstraint.blobVal &&
-              m_dataVector[i] < upperConstraint.blobVal &&
-              m_dataVector[i].GetLength() > 0) {
+        std::uint64_t i = 0;
+        for (const auto& value : m_dataVector) {
+          if (value >= lowerConstraint.blobVal &&
+              value < upperConstraint.blobVal && !m_nullBitmap.IsNull(i)) {
             bitmap->Add(i);
           }
+          i++;
         }
       } else if (lowerConstraint.op ==
                      IndexConstraintOperator::GREATER_THAN_EQUAL &&
                  upperConstraint.op ==
                      IndexConstraintOperator::LESS_THAN_EQUAL) {
-        for (size_t i = 0; i < m_dataVector.size(); i++) {
-          if (m_dataVector[i] >= lowerConstraint.blobVal &&
-              m_dataVector[i] <= upperConstraint.blobVal &&
-              m_dataVector[i].GetLength() > 0) {
+        std::uint64_t i = 0;
+        for (const auto& value : m_dataVector) {
+          if (value >= lowerConstraint.blobVal &&
+              value <= upperConstraint.blobVal && !m_nullBitmap.IsNull(i)) {
             bitmap->Add(i);
           }
+          i++;
         }
       }
     } else if (lowerConstraint.operandType != OperandType::BLOB &&
@@ -145,19 +158,42 @@ class VectorBlobIndexer final : public Indexer {
     return bitmap;
   }
 
-  bool TryGetBlobValue(std::uint64_t documentID, BufferImpl& val) override {
+  bool TryGetBlobValue(std::uint64_t documentID, const char*& val,
+                       std::size_t& size) override {
     if (documentID < m_dataVector.size()) {
-      if (val.GetLength() < m_dataVector[documentID].GetLength()) {
-        val.Resize(m_dataVector[documentID].GetLength());
+      if (m_nullBitmap.IsNull(documentID)) {
+        val = nullptr;
+        size = 0;
+      } else {
+        val = m_dataVector[documentID].GetData();
+        size = m_dataVector[documentID].GetLength();
       }
-      val.Copy(m_dataVector[documentID].GetData(),
-               m_dataVector[documentID].GetLength());
       return true;
     }
 
     return false;
   }
 
+  bool TryGetBlobVector(const gsl::span<std::uint64_t>& documentIDs,
+                        ValueBatch& values) override {
+    values.Clear();
+    auto count = m_dataVector.size();
+    for (auto i = 0; i < documentIDs.size(); i++) {
+      if (documentIDs[i] >= count) {
+        return false;
+      }
+      auto& val = m_dataVector[documentIDs[i]];
+      // Empty blobs are returned as null, same as for a single value
+      if (m_nullBitmap.IsNull(documentIDs[i]) || val.GetLength() == 0) {
+        values.AddNull();
+      } else {
+        values.Add(val.GetData(), val.GetLength());
+      }
+    }
+
+    return true;
+  }
+
  private:
   // We follow the comparison rules between different type from sqlite given at
   // https://www.sqlite.org/datatype3.html#section_4_3
@@ -167,11 +203,12 @@ class VectorBlobIndexer final : public Indexer {
   std::shared_ptr<MamaJenniesBitmap> GetBitmapEQ(const Constraint& constraint) {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     if (constraint.operandType == OperandType::BLOB) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] == constraint.blobVal &&
-            m_dataVector[i].GetLength() > 0) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value == constraint.blobVal && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     }
 
@@ -181,11 +218,12 @@ class VectorBlobIndexer final : public Indexer {
   std::shared_ptr<MamaJenniesBitmap> GetBitmapLT(const Constraint& constraint) {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     if (constraint.operandType == OperandType::BLOB) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] < constraint.blobVal &&
-            m_dataVector[i].GetLength() > 0) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value < constraint.blobVal && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     }
 
@@ -197,11 +235,12 @@ class VectorBlobIndexer final : public Indexer {
       const Constraint& constraint) {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     if (constraint.operandType == OperandType::BLOB) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] <= constraint.blobVal &&
-            m_dataVector[i].GetLength() > 0) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value <= constraint.blobVal && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     }
 
@@ -212,17 +251,16 @@ class VectorBlobIndexer final : public Indexer {
   std::shared_ptr<MamaJenniesBitmap> GetBitmapGT(const Constraint& constraint) {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     if (constraint.operandType == OperandType::BLOB) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] > constraint.blobVal &&
-            m_dataVector[i].GetLength() > 0) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value > constraint.blobVal && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     } else {
       // Blob is greater than other types according to our comparison rules
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        bitmap->Add(i);
-      }
+      return m_nullBitmap.Filter(IndexConstraintOperator::IS_NOT_NULL);
     }
 
     return bitmap;
@@ -232,25 +270,26 @@ class VectorBlobIndexer final : public Indexer {
       const Constraint& constraint) {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     if (constraint.operandType == OperandType::BLOB) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] >= constraint.blobVal &&
-            m_dataVector[i].GetLength() > 0) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value >= constraint.blobVal && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     } else {
       // Blob is greater than other types according to our comparison rules
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        bitmap->Add(i);
-      }
+      return m_nullBitmap.Filter(IndexConstraintOperator::IS_NOT_NULL);
     }
 
     return bitmap;
   }
 
   IndexStat m_indexStat;
-  std::vector<std::string> m_fieldNameTokens;
-  std::vector<BufferImpl> m_dataVector;
-  std::unique_ptr<Document> m_subDoc;
+  std::unique_ptr<FieldAccessor> m_fieldAccessor;
+  // Null documents are stored as empty buffers, filters use m_nullBitmap to
+  // tell them apart from empty blobs.
+  NullBitmap m_nullBitmap;
+  ChunkedVector<BufferImpl> m_dataVector;
 };
 }  // namespace jonoondb_api
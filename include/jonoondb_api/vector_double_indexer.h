@@ -5,21 +5,27 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include "chunked_vector.h"
+#include "column_aggregate.h"
 #include "constraint.h"
 #include "document.h"
 #include "enums.h"
 #include "exception_utils.h"
+#include "field_accessor.h"
 #include "index_info_impl.h"
 #include "index_stat.h"
 #include "indexer.h"
 #include "mama_jennies_bitmap.h"
+#include "null_bitmap.h"
+#include "null_helpers.h"
 #include "string_utils.h"
 
 namespace jonoondb_api {
 class VectorDoubleIndexer final : public Indexer {
  public:
   VectorDoubleIndexer(const IndexInfoImpl& indexInfo,
-                      const FieldType& fieldType) {
+                      const FieldType& fieldType,
+                      std::unique_ptr<FieldAccessor> fieldAccessor) {
     std::string errorMsg;
     if (indexInfo.GetIndexName().size() == 0) {
       errorMsg = "Argument indexInfo has empty name.";
@@ -40,7 +46,7 @@ class VectorDoubleIndexer final : public Indexer {
       throw InvalidArgumentException(errorMsg, __FILE__, __func__, __LINE__);
     }
 
-    m_fieldNameTokens = StringUtils::Split(indexInfo.GetColumnName(), ".");
+    m_fieldAccessor = std::move(fieldAccessor);
     m_indexStat = IndexStat(indexInfo, fieldType);
   }
 
@@ -49,9 +55,11 @@ class VectorDoubleIndexer final : public Indexer {
   }
 
   void Insert(std::uint64_t documentID, const Document& document) override {
-    auto val =
-        DocumentUtils::GetFloatValue(document, m_subDoc, m_fieldNameTokens);
+    auto val = m_fieldAccessor->GetFloatValue(document);
     assert(m_dataVector.size() == documentID);
+    // Only values equal to the sentinel can be null
+    m_nullBitmap.Add(documentID, NullHelpers::IsNull(val) &&
+                                     m_fieldAccessor->IsNull(document));
     m_dataVector.push_back(val);
   }
 
@@ -72,6 +80,9 @@ class VectorDoubleIndexer final : public Indexer {
         return GetBitmapGT(constraint);
       case jonoondb_api::IndexConstraintOperator::GREATER_THAN_EQUAL:
         return GetBitmapGTE(constraint);
+      case jonoondb_api::IndexConstraintOperator::IS_NULL:
+      case jonoondb_api::IndexConstraintOperator::IS_NOT_NULL:
+        return m_nullBitmap.Filter(constraint.op);
       case jonoondb_api::IndexConstraintOperator::MATCH:
         // TODO: Handle this
       default:
@@ -91,33 +102,41 @@ class VectorDoubleIndexer final : public Indexer {
 
     if (lowerConstraint.op == IndexConstraintOperator::GREATER_THAN &&
         upperConstraint.op == IndexConstraintOperator::LESS_THAN) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] > lowerVal && m_dataVector[i] < upperVal) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value > lowerVal && value < upperVal && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     } else if (lowerConstraint.op == IndexConstraintOperator::GREATER_THAN &&
                upperConstraint.op == IndexConstraintOperator::LESS_THAN_EQUAL) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] > lowerVal && m_dataVector[i] <= upperVal) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value > lowerVal && value <= upperVal && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     } else if (lowerConstraint.op ==
                    IndexConstraintOperator::GREATER_THAN_EQUAL &&
                upperConstraint.op == IndexConstraintOperator::LESS_THAN) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] >= lowerVal && m_dataVector[i] < upperVal) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value >= lowerVal && value < upperVal && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     } else if (lowerConstraint.op ==
                    IndexConstraintOperator::GREATER_THAN_EQUAL &&
                upperConstraint.op == IndexConstraintOperator::LESS_THAN_EQUAL) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] >= lowerVal && m_dataVector[i] <= upperVal) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value >= lowerVal && value <= upperVal && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     }
 
@@ -136,8 +155,9 @@ class VectorDoubleIndexer final : public Indexer {
   virtual bool TryGetDoubleVector(const gsl::span<std::uint64_t>& documentIDs,
                                   std::vector<double>& values) override {
     assert(documentIDs.size() == values.size());
+    auto count = m_dataVector.size();
     for (auto i = 0; i < documentIDs.size(); i++) {
-      if (documentIDs[i] >= m_dataVector.size()) {
+      if (documentIDs[i] >= count) {
         return false;
       }
       values[i] = m_dataVector[documentIDs[i]];
@@ -146,6 +166,23 @@ class VectorDoubleIndexer final : public Indexer {
     return true;
   }
 
+  bool TryAggregate(const MamaJenniesBitmap& documentIDs,
+                    ColumnAggregate& aggregate) override {
+    aggregate = ColumnAggregate();
+    aggregate.isInteger = false;
+    auto count = m_dataVector.size();
+    for (auto id : documentIDs) {
+      if (id >= count) {
+        return false;
+      }
+      if (!m_nullBitmap.IsNull(id)) {
+        aggregate.Add(m_dataVector[id]);
+      }
+    }
+
+    return true;
+  }
+
  private:
   inline double GetOperandVal(const Constraint& constraint) {
     double val = 0;
@@ -163,10 +200,12 @@ class VectorDoubleIndexer final : public Indexer {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     double val = GetOperandVal(constraint);
 
-    for (size_t i = 0; i < m_dataVector.size(); i++) {
-      if (m_dataVector[i] == val) {
+    std::uint64_t i = 0;
+    for (const auto& value : m_dataVector) {
+      if (value == val && !m_nullBitmap.IsNull(i)) {
         bitmap->Add(i);
       }
+      i++;
     }
 
     // In all other cases the operand cannot be equal. The cases are:
@@ -179,10 +218,12 @@ class VectorDoubleIndexer final : public Indexer {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     double val = GetOperandVal(constraint);
 
-    for (size_t i = 0; i < m_dataVector.size(); i++) {
-      if (m_dataVector[i] < val) {
+    std::uint64_t i = 0;
+    for (const auto& value : m_dataVector) {
+      if (value < val && !m_nullBitmap.IsNull(i)) {
         bitmap->Add(i);
       }
+      i++;
     }
 
     return bitmap;
@@ -193,10 +234,12 @@ class VectorDoubleIndexer final : public Indexer {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     double val = GetOperandVal(constraint);
 
-    for (size_t i = 0; i < m_dataVector.size(); i++) {
-      if (m_dataVector[i] <= val) {
+    std::uint64_t i = 0;
+    for (const auto& value : m_dataVector) {
+      if (value <= val && !m_nullBitmap.IsNull(i)) {
         bitmap->Add(i);
       }
+      i++;
     }
 
     return bitmap;
@@ -206,10 +249,12 @@ class VectorDoubleIndexer final : public Indexer {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     double val = GetOperandVal(constraint);
 
-    for (size_t i = 0; i < m_dataVector.size(); i++) {
-      if (m_dataVector[i] > val) {
+    std::uint64_t i = 0;
+    for (const auto& value : m_dataVector) {
+      if (value > val && !m_nullBitmap.IsNull(i)) {
         bitmap->Add(i);
       }
+      i++;
     }
 
     return bitmap;
@@ -220,18 +265,22 @@ class VectorDoubleIndexer final : public Indexer {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     double val = GetOperandVal(constraint);
 
-    for (size_t i = 0; i < m_dataVector.size(); i++) {
-      if (m_dataVector[i] >= val) {
+    std::uint64_t i = 0;
+    for (const auto& value : m_dataVector) {
+      if (value >= val && !m_nullBitmap.IsNull(i)) {
         bitmap->Add(i);
       }
+      i++;
     }
 
     return bitmap;
   }
 
   IndexStat m_indexStat;
-  std::vector<std::string> m_fieldNameTokens;
-  std::vector<double> m_dataVector;
-  std::unique_ptr<Document> m_subDoc;
+  std::unique_ptr<FieldAccessor> m_fieldAccessor;
+  // Null documents keep the sentinel in m_dataVector so values are returned
+  // unchanged, filters use m_nullBitmap to skip them.
+  NullBitmap m_nullBitmap;
+  ChunkedVector<double> m_dataVector;
 };
 }  // namespace jonoondb_api
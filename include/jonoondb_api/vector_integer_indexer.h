@@ -7,14 +7,19 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include "chunked_vector.h"
+#include "column_aggregate.h"
 #include "constraint.h"
 #include "document.h"
 #include "enums.h"
 #include "exception_utils.h"
+#include "field_accessor.h"
 #include "index_info_impl.h"
 #include "index_stat.h"
 #include "indexer.h"
 #include "mama_jennies_bitmap.h"
+#include "null_bitmap.h"
+#include "null_helpers.h"
 #include "string_utils.h"
 
 namespace jonoondb_api {
@@ -22,7 +27,8 @@ template <typename T>
 class VectorIntegerIndexer final : public Indexer {
  public:
   VectorIntegerIndexer(const IndexInfoImpl& indexInfo,
-                       const FieldType& fieldType) {
+                       const FieldType& fieldType,
+                       std::unique_ptr<FieldAccessor> fieldAccessor) {
     std::string errorMsg;
     if (indexInfo.GetIndexName().size() == 0) {
       errorMsg = "Argument indexInfo has empty name.";
@@ -43,7 +49,7 @@ class VectorIntegerIndexer final : public Indexer {
       throw InvalidArgumentException(errorMsg, __FILE__, __func__, __LINE__);
     }
 
-    m_fieldNameTokens = StringUtils::Split(indexInfo.GetColumnName(), ".");
+    m_fieldAccessor = std::move(fieldAccessor);
     m_indexStat = IndexStat(indexInfo, fieldType);
   }
 
@@ -53,9 +59,17 @@ class VectorIntegerIndexer final : public Indexer {
   }
 
   void Insert(std::uint64_t documentID, const Document& document) override {
-    auto val =
-        DocumentUtils::GetIntegerValue(document, m_subDoc, m_fieldNameTokens);
+    auto val = m_fieldAccessor->GetIntegerValue(document);
     assert(m_dataVector.size() == documentID);
+    // Only values equal to the sentinel can be null. The sentinel does not
+    // fit in int32_t so null documents store 0 instead.
+    if (NullHelpers::IsNull(val) && m_fieldAccessor->IsNull(document)) {
+      m_nullBitmap.Add(documentID, true);
+      m_dataVector.push_back(0);
+      return;
+    }
+
+    m_nullBitmap.Add(documentID, false);
     assert(val <= std::numeric_limits<T>::max());
     assert(val >= std::numeric_limits<T>::min());
     // We create this class with int32_t as T for int32 and smaller types
@@ -82,6 +96,9 @@ class VectorIntegerIndexer final : public Indexer {
         return GetBitmapGT(constraint, false);
       case jonoondb_api::IndexConstraintOperator::GREATER_THAN_EQUAL:
         return GetBitmapGT(constraint, true);
+      case jonoondb_api::IndexConstraintOperator::IS_NULL:
+      case jonoondb_api::IndexConstraintOperator::IS_NOT_NULL:
+        return m_nullBitmap.Filter(constraint.op);
       case jonoondb_api::IndexConstraintOperator::MATCH:
         // TODO: Handle this
       default:
@@ -122,10 +139,12 @@ class VectorIntegerIndexer final : public Indexer {
       }
     }
 
-    for (size_t i = 0; i < m_dataVector.size(); i++) {
-      if (m_dataVector[i] > lowerVal && m_dataVector[i] < upperVal) {
+    std::uint64_t i = 0;
+    for (const auto& value : m_dataVector) {
+      if (value > lowerVal && value < upperVal && !m_nullBitmap.IsNull(i)) {
         bitmap->Add(i);
       }
+      i++;
     }
 
     return bitmap;
@@ -134,7 +153,8 @@ class VectorIntegerIndexer final : public Indexer {
   bool TryGetIntegerValue(std::uint64_t documentID,
                           std::int64_t& val) override {
     if (documentID < m_dataVector.size()) {
-      val = m_dataVector[documentID];
+      val = m_nullBitmap.IsNull(documentID) ? JONOONDB_NULL_INT64
+                                            : m_dataVector[documentID];
       return true;
     }
 
@@ -144,11 +164,31 @@ class VectorIntegerIndexer final : public Indexer {
   bool TryGetIntegerVector(const gsl::span<std::uint64_t>& documentIDs,
                            std::vector<std::int64_t>& values) override {
     assert(documentIDs.size() == values.size());
+    auto count = m_dataVector.size();
     for (auto i = 0; i < documentIDs.size(); i++) {
-      if (documentIDs[i] >= m_dataVector.size()) {
+      if (documentIDs[i] >= count) {
+        return false;
+      }
+      values[i] = m_nullBitmap.IsNull(documentIDs[i])
+                      ? JONOONDB_NULL_INT64
+                      : m_dataVector[documentIDs[i]];
+    }
+
+    return true;
+  }
+
+  bool TryAggregate(const MamaJenniesBitmap& documentIDs,
+                    ColumnAggregate& aggregate) override {
+    aggregate = ColumnAggregate();
+    aggregate.isInteger = true;
+    auto count = m_dataVector.size();
+    for (auto id : documentIDs) {
+      if (id >= count) {
         return false;
       }
-      values[i] = m_dataVector[documentIDs[i]];
+      if (!m_nullBitmap.IsNull(id)) {
+        aggregate.Add(static_cast<std::int64_t>(m_dataVector[id]));
+      }
     }
 
     return true;
@@ -158,10 +198,12 @@ class VectorIntegerIndexer final : public Indexer {
   std::shared_ptr<MamaJenniesBitmap> GetBitmapEQ(const Constraint& constraint) {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     if (constraint.operandType == OperandType::INTEGER) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] == constraint.operand.int64Val) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value == constraint.operand.int64Val && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     } else if (constraint.operandType == OperandType::DOUBLE) {
       // Check if double has no fractional part. If it has fractional part
@@ -169,10 +211,12 @@ class VectorIntegerIndexer final : public Indexer {
       std::int64_t intVal =
           static_cast<std::int64_t>(constraint.operand.doubleVal);
       if (constraint.operand.doubleVal == intVal) {
-        for (size_t i = 0; i < m_dataVector.size(); i++) {
-          if (m_dataVector[i] == intVal) {
+        std::uint64_t i = 0;
+        for (const auto& value : m_dataVector) {
+          if (value == intVal && !m_nullBitmap.IsNull(i)) {
             bitmap->Add(i);
           }
+          i++;
         }
       }
     }
@@ -198,10 +242,12 @@ class VectorIntegerIndexer final : public Indexer {
       }
     }
 
-    for (size_t i = 0; i < m_dataVector.size(); i++) {
-      if (m_dataVector[i] < valToCmp) {
+    std::uint64_t i = 0;
+    for (const auto& value : m_dataVector) {
+      if (value < valToCmp && !m_nullBitmap.IsNull(i)) {
         bitmap->Add(i);
       }
+      i++;
     }
 
     return bitmap;
@@ -222,18 +268,22 @@ class VectorIntegerIndexer final : public Indexer {
       }
     }
 
-    for (size_t i = 0; i < m_dataVector.size(); i++) {
-      if (m_dataVector[i] > valToCmp) {
+    std::uint64_t i = 0;
+    for (const auto& value : m_dataVector) {
+      if (value > valToCmp && !m_nullBitmap.IsNull(i)) {
         bitmap->Add(i);
       }
+      i++;
     }
 
     return bitmap;
   }
 
   IndexStat m_indexStat;
-  std::vector<std::string> m_fieldNameTokens;
-  std::vector<T> m_dataVector;
-  std::unique_ptr<Document> m_subDoc;
+  std::unique_ptr<FieldAccessor> m_fieldAccessor;
+  // Filters use m_nullBitmap to skip null documents, value reads use it to
+  // return JONOONDB_NULL_INT64 for them.
+  NullBitmap m_nullBitmap;
+  ChunkedVector<T> m_dataVector;
 };
 }  // namespace jonoondb_api
@@ -1,25 +1,31 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
+#include "chunked_vector.h"
 #include "constraint.h"
 #include "document.h"
 #include "enums.h"
 #include "exception_utils.h"
+#include "field_accessor.h"
 #include "index_info_impl.h"
 #include "index_stat.h"
 #include "indexer.h"
 #include "mama_jennies_bitmap.h"
+#include "null_bitmap.h"
 #include "null_helpers.h"
 #include "string_utils.h"
+#include "value_batch.h"
 
 namespace jonoondb_api {
 class VectorStringIndexer final : public Indexer {
  public:
   VectorStringIndexer(const IndexInfoImpl& indexInfo,
-                      const FieldType& fieldType) {
+                      const FieldType& fieldType,
+                      std::unique_ptr<FieldAccessor> fieldAccessor) {
     std::string errorMsg;
     if (indexInfo.GetIndexName().size() == 0) {
       errorMsg = "Argument indexInfo has empty name.";
@@ -40,7 +46,7 @@ class VectorStringIndexer final : public Indexer {
       throw InvalidArgumentException(errorMsg, __FILE__, __func__, __LINE__);
     }
 
-    m_fieldNameTokens = StringUtils::Split(indexInfo.GetColumnName(), ".");
+    m_fieldAccessor = std::move(fieldAccessor);
     m_indexStat = IndexStat(indexInfo, fieldType);
   }
 
@@ -49,10 +55,15 @@ class VectorStringIndexer final : public Indexer {
   }
 
   void Insert(std::uint64_t documentID, const Document& document) override {
-    auto val =
-        DocumentUtils::GetStringValue(document, m_subDoc, m_fieldNameTokens);
+    std::size_t size;
+    auto str = m_fieldAccessor->GetStringValue(document, size);
     assert(m_dataVector.size() == documentID);
-    m_dataVector.push_back(val);
+    m_nullBitmap.Add(documentID, str == nullptr);
+    if (str == nullptr) {
+      m_dataVector.push_back(JONOONDB_NULL_STR);
+    } else {
+      m_dataVector.emplace_back(str, size);
+    }
   }
 
   const IndexStat& GetIndexStats() override {
@@ -72,6 +83,9 @@ class VectorStringIndexer final : public Indexer {
         return GetBitmapGT(constraint);
       case jonoondb_api::IndexConstraintOperator::GREATER_THAN_EQUAL:
         return GetBitmapGTE(constraint);
+      case jonoondb_api::IndexConstraintOperator::IS_NULL:
+      case jonoondb_api::IndexConstraintOperator::IS_NOT_NULL:
+        return m_nullBitmap.Filter(constraint.op);
       case jonoondb_api::IndexConstraintOperator::MATCH:
         // TODO: Handle this
       default:
@@ -91,52 +105,82 @@ class VectorStringIndexer final : public Indexer {
 
     if (lowerConstraint.op == IndexConstraintOperator::GREATER_THAN &&
         upperConstraint.op == IndexConstraintOperator::LESS_THAN) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] > lowerVal && m_dataVector[i] < upperVal &&
-            !NullHelpers::IsNull(m_dataVector[i])) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value > lowerVal && value < upperVal && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     } else if (lowerConstraint.op == IndexConstraintOperator::GREATER_THAN &&
                upperConstraint.op == IndexConstraintOperator::LESS_THAN_EQUAL) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] > lowerVal && m_dataVector[i] <= upperVal &&
-            !NullHelpers::IsNull(m_dataVector[i])) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value > lowerVal && value <= upperVal && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     } else if (lowerConstraint.op ==
                    IndexConstraintOperator::GREATER_THAN_EQUAL &&
                upperConstraint.op == IndexConstraintOperator::LESS_THAN) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] >= lowerVal && m_dataVector[i] < upperVal &&
-            !NullHelpers::IsNull(m_dataVector[i])) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value >= lowerVal && value < upperVal && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     } else if (lowerConstraint.op ==
                    IndexConstraintOperator::GREATER_THAN_EQUAL &&
                upperConstraint.op == IndexConstraintOperator::LESS_THAN_EQUAL) {
-      for (size_t i = 0; i < m_dataVector.size(); i++) {
-        if (m_dataVector[i] >= lowerVal && m_dataVector[i] <= upperVal &&
-            !NullHelpers::IsNull(m_dataVector[i])) {
+      std::uint64_t i = 0;
+      for (const auto& value : m_dataVector) {
+        if (value >= lowerVal && value <= upperVal && !m_nullBitmap.IsNull(i)) {
           bitmap->Add(i);
         }
+        i++;
       }
     }
 
     return bitmap;
   }
 
-  bool TryGetStringValue(std::uint64_t documentID, std::string& val) override {
+  bool TryGetStringValue(std::uint64_t documentID, const char*& val,
+                         std::size_t& size) override {
     if (documentID < m_dataVector.size()) {
-      val = m_dataVector[documentID];
+      if (m_nullBitmap.IsNull(documentID)) {
+        val = nullptr;
+        size = 0;
+      } else {
+        val = m_dataVector[documentID].data();
+        size = m_dataVector[documentID].size();
+      }
       return true;
     }
 
     return false;
   }
 
+  bool TryGetStringVector(const gsl::span<std::uint64_t>& documentIDs,
+                          ValueBatch& values) override {
+    values.Clear();
+    auto count = m_dataVector.size();
+    for (auto i = 0; i < documentIDs.size(); i++) {
+      if (documentIDs[i] >= count) {
+        return false;
+      }
+      if (m_nullBitmap.IsNull(documentIDs[i])) {
+        values.AddNull();
+      } else {
+        auto& val = m_dataVector[documentIDs[i]];
+        values.Add(val.data(), val.size());
+      }
+    }
+
+    return true;
+  }
+
  private:
   inline std::string GetOperandVal(const Constraint& constraint) {
     std::string val;
@@ -153,10 +197,12 @@ class VectorStringIndexer final : public Indexer {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     auto val = GetOperandVal(constraint);
 
-    for (size_t i = 0; i < m_dataVector.size(); i++) {
-      if (m_dataVector[i] == val && !NullHelpers::IsNull(m_dataVector[i])) {
+    std::uint64_t i = 0;
+    for (const auto& value : m_dataVector) {
+      if (value == val && !m_nullBitmap.IsNull(i)) {
         bitmap->Add(i);
       }
+      i++;
     }
 
     return bitmap;
@@ -166,10 +212,12 @@ class VectorStringIndexer final : public Indexer {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     auto val = GetOperandVal(constraint);
 
-    for (size_t i = 0; i < m_dataVector.size(); i++) {
-      if (m_dataVector[i] < val && !NullHelpers::IsNull(m_dataVector[i])) {
+    std::uint64_t i = 0;
+    for (const auto& value : m_dataVector) {
+      if (value < val && !m_nullBitmap.IsNull(i)) {
         bitmap->Add(i);
       }
+      i++;
     }
 
     return bitmap;
@@ -180,10 +228,12 @@ class VectorStringIndexer final : public Indexer {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     auto val = GetOperandVal(constraint);
 
-    for (size_t i = 0; i < m_dataVector.size(); i++) {
-      if (m_dataVector[i] <= val && !NullHelpers::IsNull(m_dataVector[i])) {
+    std::uint64_t i = 0;
+    for (const auto& value : m_dataVector) {
+      if (value <= val && !m_nullBitmap.IsNull(i)) {
         bitmap->Add(i);
       }
+      i++;
     }
 
     return bitmap;
@@ -193,10 +243,12 @@ class VectorStringIndexer final : public Indexer {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     auto val = GetOperandVal(constraint);
 
-    for (size_t i = 0; i < m_dataVector.size(); i++) {
-      if (m_dataVector[i] > val && !NullHelpers::IsNull(m_dataVector[i])) {
+    std::uint64_t i = 0;
+    for (const auto& value : m_dataVector) {
+      if (value > val && !m_nullBitmap.IsNull(i)) {
         bitmap->Add(i);
       }
+      i++;
     }
 
     return bitmap;
@@ -207,18 +259,22 @@ class VectorStringIndexer final : public Indexer {
     auto bitmap = std::make_shared<MamaJenniesBitmap>();
     auto val = GetOperandVal(constraint);
 
-    for (size_t i = 0; i < m_dataVector.size(); i++) {
-      if (m_dataVector[i] >= val && !NullHelpers::IsNull(m_dataVector[i])) {
+    std::uint64_t i = 0;
+    for (const auto& value : m_dataVector) {
+      if (value >= val && !m_nullBitmap.IsNull(i)) {
         bitmap->Add(i);
       }
+      i++;
     }
 
     return bitmap;
   }
 
   IndexStat m_indexStat;
-  std::vector<std::string> m_fieldNameTokens;
-  std::vector<std::string> m_dataVector;
-  std::unique_ptr<Document> m_subDoc;
+  std::unique_ptr<FieldAccessor> m_fieldAccessor;
+  // Null documents keep the sentinel in m_dataVector so values are returned
+  // unchanged, filters use m_nullBitmap to skip them.
+  NullBitmap m_nullBitmap;
+  ChunkedVector<std::string> m_dataVector;
 };
 }  // namespace jonoondb_api
@@ -0,0 +1,710 @@
+#include "aggregate_query.h"
+#include <boost/algorithm/string.hpp>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace jonoondb_api;
+
+namespace {
+struct Token {
+  std::string text;
+  // Quoted identifiers and string literals are never keywords
+  bool quoted;
+  // Position of the token in the statement, end is one past the last char
+  std::size_t begin;
+  std::size_t end;
+};
+
+bool IsIdentifierChar(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_' ||
+         c == '$' || c == '.';
+}
+
+bool Tokenize(const std::string& sql, std::vector<Token>& tokens) {
+  std::size_t pos = 0;
+  while (pos < sql.size()) {
+    auto c = sql[pos];
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      pos++;
+    } else if ((c == '-' && pos + 1 < sql.size() && sql[pos + 1] == '-') ||
+               (c == '/' && pos + 1 < sql.size() && sql[pos + 1] == '*')) {
+      // Comments are rare in generated queries, don't bother with them
+      return false;
+    } else if (c == '\'' || c == '"' || c == '`' || c == '[') {
+      auto closing = c == '[' ? ']' : c;
+      auto end = pos + 1;
+      while (true) {
+        end = sql.find(closing, end);
+        if (end == std::string::npos) {
+          return false;
+        }
+        // A doubled quote character is an escaped quote
+        if (closing != ']' && end + 1 < sql.size() &&
+            sql[end + 1] == closing) {
+          end += 2;
+          continue;
+        }
+        break;
+      }
+      tokens.push_back(
+          Token{sql.substr(pos, end + 1 - pos), true, pos, end + 1});
+      pos = end + 1;
+    } else if (IsIdentifierChar(c)) {
+      auto end = pos;
+      while (end < sql.size() && IsIdentifierChar(sql[end])) {
+        end++;
+      }
+      tokens.push_back(Token{sql.substr(pos, end - pos), false, pos, end});
+      pos = end;
+    } else {
+      tokens.push_back(Token{std::string(1, c), false, pos, pos + 1});
+      pos++;
+    }
+  }
+
+  return true;
+}
+
+bool IsKeyword(const Token& token, const char* keyword) {
+  return !token.quoted && boost::iequals(token.text, keyword);
+}
+
+bool IsAggregateFunction(const Token& token) {
+  return IsKeyword(token, "COUNT") || IsKeyword(token, "SUM") ||
+         IsKeyword(token, "TOTAL") || IsKeyword(token, "MIN") ||
+         IsKeyword(token, "MAX") || IsKeyword(token, "AVG");
+}
+
+bool IsPlainIdentifier(const Token& token) {
+  if (token.quoted) {
+    return token.text[0] != '\'';
+  }
+  return std::isalpha(static_cast<unsigned char>(token.text[0])) ||
+         token.text[0] == '_';
+}
+
+typedef std::pair<std::size_t, std::size_t> Range;
+
+// Splits tokens [start, end) on the commas that are not inside parentheses
+bool SplitOnCommas(const std::vector<Token>& tokens, std::size_t start,
+                   std::size_t end, std::vector<Range>& ranges) {
+  int depth = 0;
+  auto itemStart = start;
+  for (auto i = start; i < end; i++) {
+    if (tokens[i].quoted) {
+      continue;
+    }
+    if (tokens[i].text == "(") {
+      depth++;
+    } else if (tokens[i].text == ")") {
+      depth--;
+    } else if (tokens[i].text == "," && depth == 0) {
+      if (itemStart == i) {
+        return false;
+      }
+      ranges.push_back(Range(itemStart, i));
+      itemStart = i + 1;
+    }
+  }
+
+  if (itemStart == end) {
+    return false;
+  }
+  ranges.push_back(Range(itemStart, end));
+  return true;
+}
+
+// Returns the text of the statement covered by tokens [start, end)
+std::string GetText(const std::string& sql, const std::vector<Token>& tokens,
+                    Range range) {
+  auto begin = tokens[range.first].begin;
+  return sql.substr(begin, tokens[range.second - 1].end - begin);
+}
+
+bool AreSameExpression(const std::vector<Token>& tokens, Range lhs,
+                       Range rhs) {
+  if (lhs.second - lhs.first != rhs.second - rhs.first) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < lhs.second - lhs.first; i++) {
+    auto& left = tokens[lhs.first + i];
+    auto& right = tokens[rhs.first + i];
+    if (left.quoted != right.quoted) {
+      return false;
+    }
+    if (left.quoted ? left.text != right.text
+                    : !boost::iequals(left.text, right.text)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ContainsAggregateCall(const std::vector<Token>& tokens, Range range) {
+  for (auto i = range.first; i + 1 < range.second; i++) {
+    if (IsAggregateFunction(tokens[i]) && tokens[i + 1].text == "(" &&
+        !tokens[i + 1].quoted) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string QuoteName(const std::string& name) {
+  std::string quoted = "\"";
+  for (auto c : name) {
+    if (c == '"') {
+      quoted.push_back('"');
+    }
+    quoted.push_back(c);
+  }
+  quoted.push_back('"');
+  return quoted;
+}
+
+// Returns the name SQLite gives to a result column without an alias. For a
+// column reference it is the column name, otherwise it is the expression
+// text as written.
+std::string GetColumnName(const std::string& sql,
+                          const std::vector<Token>& tokens, Range range) {
+  if (range.second - range.first == 1) {
+    auto& text = tokens[range.first].text;
+    if (text[0] == '"' || text[0] == '`' || text[0] == '[') {
+      return text.substr(1, text.size() - 2);
+    }
+    return text;
+  }
+  return GetText(sql, tokens, range);
+}
+
+// Returns the expression of a result column without its alias, which is
+// either "expr AS alias" or "expr alias"
+Range GetExpressionRange(const std::vector<Token>& tokens, Range item,
+                         bool& hasAlias) {
+  hasAlias = true;
+  if (item.second - item.first >= 3 &&
+      IsKeyword(tokens[item.second - 2], "AS")) {
+    return Range(item.first, item.second - 2);
+  } else if (item.second - item.first >= 2 &&
+             IsPlainIdentifier(tokens[item.second - 1]) &&
+             !IsKeyword(tokens[item.second - 1], "END") &&
+             (tokens[item.second - 2].text == ")" ||
+              IsPlainIdentifier(tokens[item.second - 2]))) {
+    return Range(item.first, item.second - 1);
+  }
+
+  hasAlias = false;
+  return item;
+}
+
+// Returns the name of the column an identifier token refers to
+bool TryGetColumnName(const Token& token, std::string& name) {
+  if (token.quoted) {
+    auto quote = token.text[0];
+    if (quote == '\'') {
+      return false;
+    }
+    name = token.text.substr(1, token.text.size() - 2);
+    if (quote != '[') {
+      boost::replace_all(name, std::string(2, quote), std::string(1, quote));
+    }
+    return true;
+  }
+
+  // Qualified names like tweet.id are left to SQLite
+  if (!IsPlainIdentifier(token) || token.text.find('.') != std::string::npos) {
+    return false;
+  }
+  name = token.text;
+  return true;
+}
+
+// Parses a string literal or an optionally signed numeric literal covering
+// the tokens in range into the operand of condition
+bool TryParseLiteral(const std::vector<Token>& tokens, Range range,
+                     AggregateQuery::Condition& condition) {
+  auto count = range.second - range.first;
+  auto& first = tokens[range.first];
+  if (count == 1 && first.quoted) {
+    if (first.text[0] != '\'') {
+      return false;
+    }
+    condition.operandType = OperandType::STRING;
+    condition.strVal = first.text.substr(1, first.text.size() - 2);
+    boost::replace_all(condition.strVal, "''", "'");
+    return true;
+  }
+
+  bool negative = false;
+  if (count == 2 && !first.quoted && (first.text == "-" || first.text == "+")) {
+    negative = first.text == "-";
+  } else if (count != 1) {
+    return false;
+  }
+
+  auto& number = tokens[range.second - 1];
+  if (number.quoted) {
+    return false;
+  }
+  bool isInteger = true;
+  for (auto c : number.text) {
+    if (c == '.' || c == 'e' || c == 'E') {
+      isInteger = false;
+    } else if (!std::isdigit(static_cast<unsigned char>(c))) {
+      // Identifiers and hex literals
+      return false;
+    }
+  }
+
+  char* end = nullptr;
+  errno = 0;
+  if (isInteger) {
+    auto val = std::strtoll(number.text.c_str(), &end, 10);
+    // SQLite turns integer literals that don't fit in 64 bits into reals,
+    // we leave those to SQLite
+    if (errno == ERANGE) {
+      return false;
+    }
+    condition.operandType = OperandType::INTEGER;
+    condition.intVal = negative ? -val : val;
+  } else {
+    auto val = std::strtod(number.text.c_str(), &end);
+    if (*end != '\0' || errno == ERANGE) {
+      return false;
+    }
+    condition.operandType = OperandType::DOUBLE;
+    condition.doubleVal = negative ? -val : val;
+  }
+  return true;
+}
+
+// Parses a WHERE clause made of "column op literal" terms joined with AND
+bool TryParseConditions(const std::vector<Token>& tokens, Range range,
+                        std::vector<AggregateQuery::Condition>& conditions) {
+  auto termStart = range.first;
+  for (auto i = range.first; i <= range.second; i++) {
+    if (i < range.second && !IsKeyword(tokens[i], "AND")) {
+      if (!tokens[i].quoted &&
+          (tokens[i].text == "(" || tokens[i].text == ")")) {
+        return false;
+      }
+      continue;
+    }
+
+    AggregateQuery::Condition condition;
+    if (i - termStart < 3 ||
+        !TryGetColumnName(tokens[termStart], condition.columnName)) {
+      return false;
+    }
+
+    auto& op = tokens[termStart + 1];
+    if (IsKeyword(op, "IS")) {
+      if (i - termStart == 3 && IsKeyword(tokens[termStart + 2], "NULL")) {
+        condition.op = IndexConstraintOperator::IS_NULL;
+      } else if (i - termStart == 4 &&
+                 IsKeyword(tokens[termStart + 2], "NOT") &&
+                 IsKeyword(tokens[termStart + 3], "NULL")) {
+        condition.op = IndexConstraintOperator::IS_NOT_NULL;
+      } else {
+        return false;
+      }
+    } else {
+      // The tokenizer splits operators into single characters
+      auto& next = tokens[termStart + 2];
+      bool orEqual = !next.quoted && next.text == "=" && next.begin == op.end;
+      if (op.quoted) {
+        return false;
+      } else if (op.text == "=") {
+        condition.op = IndexConstraintOperator::EQUAL;
+      } else if (op.text == "<") {
+        condition.op = orEqual ? IndexConstraintOperator::LESS_THAN_EQUAL
+                               : IndexConstraintOperator::LESS_THAN;
+      } else if (op.text == ">") {
+        condition.op = orEqual ? IndexConstraintOperator::GREATER_THAN_EQUAL
+                               : IndexConstraintOperator::GREATER_THAN;
+      } else {
+        return false;
+      }
+
+      auto operandStart = termStart + (orEqual ? 3 : 2);
+      if (operandStart >= i ||
+          !TryParseLiteral(tokens, Range(operandStart, i), condition)) {
+        return false;
+      }
+    }
+
+    conditions.push_back(std::move(condition));
+    termStart = i + 1;
+  }
+
+  return true;
+}
+}  // namespace
+
+bool AggregateQuery::TryParse(const std::string& selectStatement,
+                              AggregateQuery& query) {
+  std::vector<Token> tokens;
+  if (!Tokenize(selectStatement, tokens)) {
+    return false;
+  }
+
+  if (!tokens.empty() && tokens.back().text == ";" && !tokens.back().quoted) {
+    tokens.pop_back();
+  }
+
+  if (tokens.size() < 4 || !IsKeyword(tokens[0], "SELECT")) {
+    return false;
+  }
+
+  // SELECT DISTINCT is a GROUP BY on all the items
+  bool isDistinct = IsKeyword(tokens[1], "DISTINCT");
+  std::size_t itemsStart = isDistinct ? 2 : 1;
+
+  // Find the clauses and reject everything we can't split into ranges
+  static const char* unsupported[] = {
+      "SELECT", "DISTINCT", "ALL",       "HAVING", "ORDER",  "LIMIT",
+      "UNION",  "INTERSECT", "EXCEPT",   "WINDOW", "OVER",   "FILTER",
+      "JOIN",   "WITH",     "RECURSIVE", "VALUES"};
+  int depth = 0;
+  std::size_t fromIndex = 0, whereIndex = 0, groupIndex = 0;
+  for (std::size_t i = itemsStart; i < tokens.size(); i++) {
+    auto& token = tokens[i];
+    if (token.quoted) {
+      continue;
+    }
+
+    for (auto keyword : unsupported) {
+      if (IsKeyword(token, keyword)) {
+        return false;
+      }
+    }
+
+    if (token.text == "(") {
+      depth++;
+    } else if (token.text == ")") {
+      if (--depth < 0) {
+        return false;
+      }
+    } else if (token.text == ";") {
+      return false;
+    } else if (depth == 0) {
+      if (IsKeyword(token, "FROM") && fromIndex == 0) {
+        fromIndex = i;
+      } else if (IsKeyword(token, "WHERE") && fromIndex != 0 &&
+                 whereIndex == 0) {
+        whereIndex = i;
+      } else if (IsKeyword(token, "GROUP") && i + 1 < tokens.size() &&
+                 IsKeyword(tokens[i + 1], "BY") && fromIndex != 0) {
+        groupIndex = i;
+      }
+    }
+  }
+
+  if (depth != 0 || fromIndex <= itemsStart || fromIndex + 1 >= tokens.size() ||
+      !IsPlainIdentifier(tokens[fromIndex + 1]) ||
+      tokens[fromIndex + 1].quoted) {
+    return false;
+  }
+
+  // The collection has to be followed by WHERE, GROUP BY or nothing, this
+  // rules out aliases and joins
+  auto afterFrom = fromIndex + 2;
+  auto whereEnd = groupIndex != 0 ? groupIndex : tokens.size();
+  if (afterFrom != tokens.size() && afterFrom != whereIndex &&
+      afterFrom != groupIndex) {
+    return false;
+  }
+  if (whereIndex != 0 && whereIndex + 1 >= whereEnd) {
+    return false;
+  }
+
+  std::vector<Range> items;
+  if (!SplitOnCommas(tokens, itemsStart, fromIndex, items)) {
+    return false;
+  }
+
+  std::vector<Range> groupBy;
+  if (isDistinct) {
+    if (groupIndex != 0) {
+      return false;
+    }
+    bool hasAlias;
+    for (auto& item : items) {
+      groupBy.push_back(GetExpressionRange(tokens, item, hasAlias));
+    }
+  } else if (groupIndex != 0) {
+    if (!SplitOnCommas(tokens, groupIndex + 2, tokens.size(), groupBy)) {
+      return false;
+    }
+  }
+
+  for (auto& range : groupBy) {
+    // GROUP BY 1 refers to a result column, we don't resolve those
+    auto& first = tokens[range.first];
+    if (!first.quoted &&
+        std::isdigit(static_cast<unsigned char>(first.text[0]))) {
+      return false;
+    }
+    if (ContainsAggregateCall(tokens, range)) {
+      return false;
+    }
+  }
+
+  AggregateQuery result;
+  result.m_collectionName = tokens[fromIndex + 1].text;
+  result.m_groupByCount = groupBy.size();
+  std::ostringstream partial;
+  partial << "SELECT ";
+  for (std::size_t i = 0; i < groupBy.size(); i++) {
+    partial << GetText(selectStatement, tokens, groupBy[i]) << ", ";
+  }
+  auto partialColumn = groupBy.size();
+  bool hasAggregate = false;
+  // Only a single column can be grouped on using an index
+  bool isColumnAggregate =
+      groupBy.empty() ||
+      (groupBy.size() == 1 && groupBy[0].second - groupBy[0].first == 1 &&
+       TryGetColumnName(tokens[groupBy[0].first], result.m_groupByColumn));
+
+  for (auto& item : items) {
+    SelectItem selectItem;
+    bool hasAlias;
+    auto exprRange = GetExpressionRange(tokens, item, hasAlias);
+
+    if (hasAlias) {
+      selectItem.name =
+          QuoteName(GetColumnName(selectStatement, tokens,
+                                  Range(item.second - 1, item.second)));
+    } else {
+      selectItem.name =
+          QuoteName(GetColumnName(selectStatement, tokens, exprRange));
+    }
+
+    auto& first = tokens[exprRange.first];
+    auto argsRange = Range(exprRange.first + 2, exprRange.second - 1);
+    bool isCall = exprRange.second - exprRange.first >= 4 &&
+                  IsAggregateFunction(first) &&
+                  tokens[exprRange.first + 1].text == "(" &&
+                  tokens[exprRange.second - 1].text == ")";
+    if (isCall) {
+      // Make sure the parentheses of the call enclose the whole expression,
+      // e.g. SUM(a) + SUM(b) is not a single call
+      int callDepth = 0;
+      for (auto i = exprRange.first + 1; i < exprRange.second - 1; i++) {
+        if (tokens[i].quoted) {
+          continue;
+        }
+        if (tokens[i].text == "(") {
+          callDepth++;
+        } else if (tokens[i].text == ")") {
+          callDepth--;
+        }
+        if (callDepth == 0) {
+          isCall = false;
+          break;
+        }
+      }
+    }
+
+    if (isCall) {
+      std::vector<Range> args;
+      if (!SplitOnCommas(tokens, argsRange.first, argsRange.second, args) ||
+          args.size() != 1 || ContainsAggregateCall(tokens, argsRange)) {
+        // MIN and MAX with several arguments are scalar functions
+        return false;
+      }
+
+      auto argText = GetText(selectStatement, tokens, argsRange);
+      selectItem.partialColumn = partialColumn;
+      if (IsKeyword(first, "COUNT")) {
+        selectItem.type = AggregateType::COUNT;
+        partial << "COUNT(" << argText << "), ";
+      } else if (IsKeyword(first, "SUM")) {
+        selectItem.type = AggregateType::SUM;
+        partial << "SUM(" << argText << "), ";
+      } else if (IsKeyword(first, "TOTAL")) {
+        selectItem.type = AggregateType::TOTAL;
+        partial << "TOTAL(" << argText << "), ";
+      } else if (IsKeyword(first, "MIN")) {
+        selectItem.type = AggregateType::MIN;
+        partial << "MIN(" << argText << "), ";
+      } else if (IsKeyword(first, "MAX")) {
+        selectItem.type = AggregateType::MAX;
+        partial << "MAX(" << argText << "), ";
+      } else {
+        // AVG is merged from the sum and the count of each range
+        selectItem.type = AggregateType::AVG;
+        partial << "TOTAL(" << argText << "), COUNT(" << argText << "), ";
+        partialColumn++;
+      }
+      partialColumn++;
+      hasAggregate = true;
+
+      ColumnAggregateItem columnItem;
+      columnItem.type = selectItem.type;
+      auto& arg = tokens[argsRange.first];
+      bool isCountAll = selectItem.type == AggregateType::COUNT &&
+                        !arg.quoted && arg.text == "*";
+      if (argsRange.second - argsRange.first != 1 ||
+          (!isCountAll && !TryGetColumnName(arg, columnItem.columnName))) {
+        isColumnAggregate = false;
+      }
+      result.m_columnAggregateItems.push_back(std::move(columnItem));
+    } else {
+      // Anything that is not an aggregate has to be one of the group keys
+      if (ContainsAggregateCall(tokens, exprRange)) {
+        return false;
+      }
+      selectItem.type = AggregateType::NONE;
+      bool found = false;
+      for (std::size_t i = 0; i < groupBy.size(); i++) {
+        if (AreSameExpression(tokens, exprRange, groupBy[i])) {
+          selectItem.partialColumn = i;
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        return false;
+      }
+      result.m_columnAggregateItems.push_back(
+          ColumnAggregateItem{AggregateType::NONE, result.m_groupByColumn});
+    }
+
+    result.m_selectItems.push_back(selectItem);
+  }
+
+  if (!hasAggregate && !isDistinct) {
+    return false;
+  }
+
+  if (isColumnAggregate && whereIndex != 0) {
+    isColumnAggregate = TryParseConditions(
+        tokens, Range(whereIndex + 1, whereEnd), result.m_conditions);
+  }
+  result.m_isColumnAggregate = isColumnAggregate;
+  if (!isColumnAggregate) {
+    result.m_groupByColumn.clear();
+    result.m_columnAggregateItems.clear();
+    result.m_conditions.clear();
+  }
+
+  result.m_partialColumnCount = partialColumn;
+  // Drop the trailing ", "
+  auto partialSelect = partial.str();
+  partialSelect.resize(partialSelect.size() - 2);
+  partial.str("");
+  partial << partialSelect << " FROM " << result.m_collectionName << " WHERE ";
+  if (whereIndex != 0) {
+    partial << "("
+            << GetText(selectStatement, tokens,
+                       Range(whereIndex + 1, whereEnd))
+            << ") AND ";
+  }
+  partial << "rowid >= ?1 AND rowid < ?2";
+  if (!groupBy.empty()) {
+    partial << " GROUP BY ";
+    for (std::size_t i = 0; i < groupBy.size(); i++) {
+      partial << (i > 0 ? ", " : "")
+              << GetText(selectStatement, tokens, groupBy[i]);
+    }
+  }
+  partial << ";";
+  result.m_partialStatement = partial.str();
+
+  query = std::move(result);
+  return true;
+}
+
+const std::string& AggregateQuery::GetCollectionName() const {
+  return m_collectionName;
+}
+
+const std::string& AggregateQuery::GetPartialStatement() const {
+  return m_partialStatement;
+}
+
+std::size_t AggregateQuery::GetPartialColumnCount() const {
+  return m_partialColumnCount;
+}
+
+std::string AggregateQuery::GetMergeStatement(
+    const std::string& tableName) const {
+  std::ostringstream ss;
+  ss << "SELECT ";
+  for (std::size_t i = 0; i < m_selectItems.size(); i++) {
+    auto& item = m_selectItems[i];
+    auto column = "c" + std::to_string(item.partialColumn);
+    ss << (i > 0 ? ", " : "");
+    switch (item.type) {
+      case AggregateType::NONE:
+        ss << column;
+        break;
+      case AggregateType::COUNT:
+        ss << "COALESCE(SUM(" << column << "), 0)";
+        break;
+      case AggregateType::SUM:
+        ss << "SUM(" << column << ")";
+        break;
+      case AggregateType::TOTAL:
+        ss << "TOTAL(" << column << ")";
+        break;
+      case AggregateType::MIN:
+        ss << "MIN(" << column << ")";
+        break;
+      case AggregateType::MAX:
+        ss << "MAX(" << column << ")";
+        break;
+      case AggregateType::AVG:
+        // Division by a zero count yields NULL, same as AVG of no rows
+        ss << "TOTAL(" << column << ") / SUM(c" << item.partialColumn + 1
+           << ")";
+        break;
+    }
+    ss << " AS " << item.name;
+  }
+
+  ss << " FROM " << tableName;
+  if (m_groupByCount > 0) {
+    ss << " GROUP BY ";
+    for (std::size_t i = 0; i < m_groupByCount; i++) {
+      ss << (i > 0 ? ", " : "") << "c" << i;
+    }
+  }
+  ss << ";";
+  return ss.str();
+}
+
+bool AggregateQuery::IsColumnAggregate() const {
+  return m_isColumnAggregate;
+}
+
+const std::vector<AggregateQuery::ColumnAggregateItem>&
+AggregateQuery::GetColumnAggregateItems() const {
+  return m_columnAggregateItems;
+}
+
+const std::vector<AggregateQuery::Condition>& AggregateQuery::GetConditions()
+    const {
+  return m_conditions;
+}
+
+const std::string& AggregateQuery::GetGroupByColumn() const {
+  return m_groupByColumn;
+}
+
+std::string AggregateQuery::GetResultStatement(
+    const std::string& tableName) const {
+  std::ostringstream ss;
+  ss << "SELECT ";
+  for (std::size_t i = 0; i < m_selectItems.size(); i++) {
+    ss << (i > 0 ? ", " : "") << "c" << i << " AS " << m_selectItems[i].name;
+  }
+  ss << " FROM " << tableName << ";";
+  return ss.str();
+}
@@ -1,15 +1,18 @@
 #include "blob_manager.h"
 #include <assert.h>
+#include <algorithm>
 #include <boost/endian/conversion.hpp>
 #include <boost/filesystem.hpp>
 #include <string>
 #include "blob_metadata.h"
 #include "buffer_impl.h"
+#include "engine_stats.h"
 #include "exception_utils.h"
 #include "file.h"
 #include "filename_manager.h"
 #include "jonoondb_utils/varint.h"
 #include "lz4.h"
+#include "query_profile.h"
 #include "standard_deleters.h"
 
 using namespace std;
@@ -20,7 +23,9 @@ using namespace jonoondb_utils;
 #define DEFAULT_MEM_MAP_LRU_CACHE_SIZE 3
 
 namespace jonoondb_api {
-const uint8_t kBlobHeaderVersion = 1;
+// Version 2 added batch markers. Data files with blobs of a newer version
+// than this are rejected when they are loaded.
+const uint8_t kBlobHeaderVersion = 2;
 
 struct BlobHeader {
   std::uint8_t version;
@@ -28,40 +33,6 @@ struct BlobHeader {
   std::uint64_t blobSize;
   std::uint64_t compSize;
 
-  inline static int GetVarintSize(std::uint64_t num) {
-    if (num < 128) {
-      return 1;
-    } else if (num < 16384) {
-      return 2;
-    } else if (num < 2097152) {
-      return 3;
-    } else if (num < 268435456) {
-      return 4;
-    } else if (num < 34359738368U) {
-      return 5;
-    } else if (num < 4398046511104U) {
-      return 6;
-    } else if (num < 562949953421312U) {
-      return 7;
-    } else if (num < 72057594037927936U) {
-      return 8;
-    } else if (num < 9223372036854775808U) {
-      return 9;
-    } else {
-      return 10;
-    }
-  }
-
-  inline static int GetHeaderSize(std::uint64_t blobSize, int compBlobSize) {
-    auto num1 = GetVarintSize(blobSize);
-    auto num2 = 0;
-    if (compBlobSize > -1) {
-      num2 = GetVarintSize(compBlobSize);
-    }
-
-    return num1 + num2 + 1;  // 1 is the fixed size for verAndFlags
-  }
-
   inline static void ReadBlobHeader(char*& offsetAddress, BlobHeader& header) {
     // Header: VerAndFlags (1 Byte) + SizeOfBlob (varint)
     //         + CompressedBlobSize [only if compressed] (varint)
@@ -97,31 +68,68 @@ struct BlobHeader {
     }
   }
 
-  inline static int WriteBlobHeader(
-      std::shared_ptr<MemoryMappedFile>& memMappedFile,
-      const BlobHeader& header) {
+  inline static std::uint8_t ReadVersion(const char* offsetAddress) {
+    return static_cast<std::uint8_t>(*offsetAddress) >> 4;
+  }
+
+  // A batch marker is a header with the batch marker flag followed by the id
+  // of the first document of the batch. The id is a fixed size little endian
+  // number so Commit can fill it in after the blobs are written.
+  static const int BatchMarkerSize = 1 + sizeof(std::uint64_t);
+  static const std::uint8_t BatchMarkerFlag = 2;
+
+  inline static bool IsBatchMarker(const char* offsetAddress) {
+    return (static_cast<std::uint8_t>(*offsetAddress) & BatchMarkerFlag) != 0;
+  }
+
+  inline static std::uint64_t ReadBatchMarker(char*& offsetAddress) {
+    std::uint64_t documentID;
+    memcpy(&documentID, offsetAddress + 1, sizeof(documentID));
+    offsetAddress += BatchMarkerSize;
+    return boost::endian::little_to_native(documentID);
+  }
+
+  inline static void WriteBatchMarker(MemoryMappedFile& memMappedFile) {
+    std::uint8_t verAndFlags = 0;
+    verAndFlags |= kBlobHeaderVersion << 4;  // version
+    verAndFlags |= BatchMarkerFlag;
+    memMappedFile.WriteAtCurrentPosition(&verAndFlags, sizeof(verAndFlags));
+    std::uint64_t documentID = 0;
+    memMappedFile.WriteAtCurrentPosition(&documentID, sizeof(documentID));
+  }
+
+  inline static void SetBatchMarkerID(MemoryMappedFile& memMappedFile,
+                                      std::size_t offset,
+                                      std::uint64_t documentID) {
+    boost::endian::native_to_little_inplace(documentID);
+    memcpy(memMappedFile.GetOffsetAddressAsCharPtr(offset + 1), &documentID,
+           sizeof(documentID));
+  }
+
+  // Header size is at most 1 byte plus 2 varints
+  static const int MaxHeaderSize = 1 + 2 * kMaxVarintBytes;
+
+  inline static int WriteBlobHeader(char* offsetAddress,
+                                    const BlobHeader& header) {
     // Write the header
     // Header: VerAndFlags (1 Byte) + SizeOfBlob (varint)
     //         + CompressedBlobSize [only if compressed] (varint)
     std::uint8_t verAndFlags = 0;
-    verAndFlags |= 1 << 4;                     // version
+    verAndFlags |= header.version << 4;        // version
     verAndFlags |= header.compressed ? 1 : 0;  // compression flag
+    memcpy(offsetAddress, &verAndFlags, sizeof(verAndFlags));
+    int bytesWritten = sizeof(verAndFlags);
 
-    memMappedFile->WriteAtCurrentPosition(&verAndFlags, sizeof(verAndFlags));
-
-    std::uint8_t varIntBuffer[kMaxVarintBytes];
-    auto varintSize = Varint::EncodeVarint(header.blobSize, varIntBuffer);
-    int varintSum = varintSize;
-    memMappedFile->WriteAtCurrentPosition(&varIntBuffer, varintSize);
-
+    bytesWritten += Varint::EncodeVarint(
+        header.blobSize,
+        reinterpret_cast<std::uint8_t*>(offsetAddress + bytesWritten));
     if (header.compressed) {
-      varintSize = Varint::EncodeVarint(header.compSize, varIntBuffer);
-      varintSum += varintSize;
-      memMappedFile->WriteAtCurrentPosition(&varIntBuffer, varintSize);
+      bytesWritten += Varint::EncodeVarint(
+          header.compSize,
+          reinterpret_cast<std::uint8_t*>(offsetAddress + bytesWritten));
     }
 
-    // return bytes written
-    return sizeof(verAndFlags) + varintSum;
+    return bytesWritten;
   }
 };
 }  // namespace jonoondb_api
@@ -138,134 +146,309 @@ int GetCompressedSize(std::uint64_t size) {
   return LZ4_compressBound(static_cast<int>(size));
 }
 
+std::size_t BlobManager::EncodedBlobs::GetCount() const {
+  return m_ends.size();
+}
+
+BlobManager::PendingBatch::~PendingBatch() {
+  if (m_laneLock.owns_lock() && !m_committed) {
+    // Drop the blobs, the next batch of the lane overwrites them
+    for (auto run = m_runs.rbegin(); run != m_runs.rend(); ++run) {
+      run->file->SetCurrentWriteOffset(run->startOffset);
+    }
+  }
+}
+
 BlobManager::BlobManager(unique_ptr<FileNameManager> fileNameManager,
-                         size_t maxDataFileSize, bool synchronous)
+                         size_t maxDataFileSize, bool synchronous,
+                         std::size_t writeLanes)
     : m_fileNameManager(move(fileNameManager)),
       m_maxDataFileSize(maxDataFileSize),
-      m_currentBlobFile(nullptr),
+      m_readerFiles(DEFAULT_MEM_MAP_LRU_CACHE_SIZE),
       m_synchronous(synchronous),
-      m_readerFiles(DEFAULT_MEM_MAP_LRU_CACHE_SIZE) {
-  m_fileNameManager->GetCurrentDataFileInfo(true, m_currentBlobFileInfo);
-  path pathObj(m_currentBlobFileInfo.fileNameWithPath);
+      m_writeBatchMarkers(writeLanes > 1) {
+  for (std::size_t i = 0; i < std::max<std::size_t>(writeLanes, 1); i++) {
+    m_writeLanes.push_back(std::make_unique<WriteLane>());
+  }
+
+  // The first lane continues the current data file, the other lanes start a
+  // new file when they write their first batch
+  auto& lane = *m_writeLanes[0];
+  m_fileNameManager->GetCurrentDataFileInfo(true, lane.fileInfo);
+  path pathObj(lane.fileInfo.fileNameWithPath);
   // Check if the file exist or do we have to create it
   if (!boost::filesystem::exists(pathObj)) {
-    File::FastAllocate(m_currentBlobFileInfo.fileNameWithPath,
-                       m_maxDataFileSize);
+    File::FastAllocate(lane.fileInfo.fileNameWithPath, m_maxDataFileSize);
   }
   // We have the file lets memory map it
-  m_currentBlobFile.reset(
-      new MemoryMappedFile(m_currentBlobFileInfo.fileNameWithPath,
-                           MemoryMappedFileMode::ReadWrite, 0, !m_synchronous));
-
-  // Set the MemMapFile offset
-  if (m_currentBlobFileInfo.dataLength != -1) {
-    m_currentBlobFile->SetCurrentWriteOffset(m_currentBlobFileInfo.dataLength);
-    // Reset the data length of the blob file, we will set it on file switch or
-    // shutdown
-    m_fileNameManager->UpdateDataFileLength(
-        m_currentBlobFileInfo.fileKey,
-        m_currentBlobFile->GetCurrentWriteOffset());
+  lane.file.reset(new MemoryMappedFile(lane.fileInfo.fileNameWithPath,
+                                       MemoryMappedFileMode::ReadWrite, 0,
+                                       !m_synchronous));
+
+  // Set the MemMapFile offset, anything after the persisted length belongs
+  // to batches that were never committed
+  if (lane.fileInfo.dataLength != -1) {
+    lane.file->SetCurrentWriteOffset(lane.fileInfo.dataLength);
   }
 
-  m_readerFiles.Add(m_currentBlobFileInfo.fileKey, m_currentBlobFile, false);
+  m_readerFiles.Add(lane.fileInfo.fileKey, lane.file, false);
 }
 
 void BlobManager::Put(const BufferImpl& blob, BlobMetadata& blobMetadata,
                       bool compress) {
-  // Lock will be acquired on the next line and released when lock goes out of
-  // scope
-  lock_guard<mutex> lock(m_writeMutex);
-  size_t currentOffsetInFile = m_currentBlobFile->GetCurrentWriteOffset();
-  int compSize = compress ? GetCompressedSize(blob.GetLength()) : -1;
-  int headerSize = BlobHeader::GetHeaderSize(blob.GetLength(), compSize);
-  auto estimatedBytesToWrite =
-      headerSize + (compress ? compSize : blob.GetLength());
-
-  if (estimatedBytesToWrite + currentOffsetInFile > m_maxDataFileSize) {
-    SwitchToNewDataFile();
-    currentOffsetInFile = m_currentBlobFile->GetCurrentWriteOffset();
-  }
-
-  try {
-    size_t bytesWritten = PutInternal(blob, blobMetadata, compress);
-    // Flush the contents to ensure durability
-    Flush(currentOffsetInFile, bytesWritten);
-  } catch (...) {
-    m_currentBlobFile->SetCurrentWriteOffset(currentOffsetInFile);
-    throw;
-  }
-
-  // Set the file length
-  m_fileNameManager->UpdateDataFileLength(
-      m_currentBlobFileInfo.fileKey,
-      m_currentBlobFile->GetCurrentWriteOffset());
+  std::vector<const BufferImpl*> blobs = {&blob};
+  std::vector<BlobMetadata> blobMetadataVec(1);
+  MultiPut(blobs, blobMetadataVec, compress);
+  blobMetadata = blobMetadataVec[0];
 }
 
 void BlobManager::MultiPut(gsl::span<const BufferImpl*> blobs,
                            std::vector<BlobMetadata>& blobMetadataVec,
                            bool compress) {
+  assert(!m_writeBatchMarkers);
+  PendingBatch batch;
+  MultiPut(blobs, blobMetadataVec, compress, batch);
+  Commit(batch, 0);
+}
+
+void BlobManager::MultiPut(gsl::span<const BufferImpl*> blobs,
+                           std::vector<BlobMetadata>& blobMetadataVec,
+                           bool compress, PendingBatch& batch) {
   assert(blobs.size() == blobMetadataVec.size());
-  size_t bytesWritten = 0, totalBytesWrittenInFile = 0;
-  // Lock will be acquired on the next line and released when lock goes out of
-  // scope
-  lock_guard<mutex> lock(m_writeMutex);
-  size_t baseOffsetInFile = m_currentBlobFile->GetCurrentWriteOffset();
-
-  for (int i = 0; i < blobs.size(); i++) {
-    size_t currentOffset = m_currentBlobFile->GetCurrentWriteOffset();
-    int compSize = compress ? GetCompressedSize(blobs[i]->GetLength()) : -1;
-    int headerSize = BlobHeader::GetHeaderSize(blobs[i]->GetLength(), compSize);
-    auto estimatedBytesToWrite =
-        headerSize + (compress ? compSize : blobs[i]->GetLength());
-    if (estimatedBytesToWrite + currentOffset > m_maxDataFileSize) {
-      // The file size will exceed the m_maxDataFileSize if blob is written in
-      // the current file First flush the contents if required
-      try {
-        Flush(baseOffsetInFile, totalBytesWrittenInFile);
-      } catch (...) {
-        m_currentBlobFile->SetCurrentWriteOffset(baseOffsetInFile);
-        throw;
-      }
-      // Now lets switch to a new file
-      SwitchToNewDataFile();
+  EncodedBlobs encodedBlobs;
+  for (auto blob : blobs) {
+    Encode(*blob, compress, encodedBlobs);
+  }
+  Append(encodedBlobs, blobMetadataVec, batch);
+}
 
-      // Reset baseOffset and totalBytesWritten
-      baseOffsetInFile = m_currentBlobFile->GetCurrentWriteOffset();
-      totalBytesWrittenInFile = 0;
+void BlobManager::Encode(const BufferImpl& blob, bool compress,
+                         EncodedBlobs& encodedBlobs) {
+  BlobHeader header;
+  header.version = kBlobHeaderVersion;
+  header.compressed = compress;
+  header.blobSize = blob.GetLength();
+  const char* payload = blob.GetData();
+  std::size_t payloadSize = blob.GetLength();
+  if (compress) {
+    auto& compBuffer = encodedBlobs.m_compBuffer;
+    auto maxCompSize = GetCompressedSize(blob.GetLength());
+    if (maxCompSize > compBuffer.GetCapacity()) {
+      compBuffer.Resize(maxCompSize);
     }
+    auto compSize = LZ4_compress_default(
+        blob.GetData(), compBuffer.GetDataForWrite(), blob.GetLength(),
+        compBuffer.GetCapacity());
+    if (compSize == 0) {
+      std::ostringstream ss;
+      ss << "Failed to compress blob of size " << blob.GetLength() << ".";
+      throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
+    }
+    header.compSize = compSize;
+    payload = compBuffer.GetData();
+    payloadSize = compSize;
+  }
+
+  char headerBytes[BlobHeader::MaxHeaderSize];
+  auto headerSize = BlobHeader::WriteBlobHeader(headerBytes, header);
+  auto& data = encodedBlobs.m_data;
+  data.insert(data.end(), headerBytes, headerBytes + headerSize);
+  data.insert(data.end(), payload, payload + payloadSize);
+  encodedBlobs.m_ends.push_back(data.size());
+}
+
+void BlobManager::Append(const EncodedBlobs& encodedBlobs,
+                         gsl::span<BlobMetadata> blobMetadata,
+                         PendingBatch& batch) {
+  auto& ends = encodedBlobs.m_ends;
+  assert(ends.size() == static_cast<std::size_t>(blobMetadata.size()));
+  if (!batch.m_laneLock.owns_lock()) {
+    batch.m_lane = &LockWriteLane(batch.m_laneLock);
+    if (batch.m_lane->file == nullptr) {
+      SwitchToNewDataFile(*batch.m_lane);
+    }
+    StartFileRun(*batch.m_lane, 0, batch);
+  }
 
-    try {
-      bytesWritten = PutInternal(*blobs[i], blobMetadataVec[i], compress);
-    } catch (...) {
-      m_currentBlobFile->SetCurrentWriteOffset(baseOffsetInFile);
-      throw;
+  // If we throw, the destructor of the batch drops what we have written
+  auto& lane = *batch.m_lane;
+  auto flushOffset = lane.file->GetCurrentWriteOffset();
+  std::size_t next = 0;
+  while (next < ends.size()) {
+    // Copy all the blobs that fit in the current file at once
+    auto begin = next == 0 ? 0 : ends[next - 1];
+    auto offset = lane.file->GetCurrentWriteOffset();
+    auto end = next;
+    while (end < ends.size() &&
+           offset + ends[end] - begin <= m_maxDataFileSize) {
+      auto blobBegin = end == 0 ? 0 : ends[end - 1];
+      blobMetadata[end].fileKey = lane.fileInfo.fileKey;
+      blobMetadata[end].offset = offset + blobBegin - begin;
+      end++;
     }
 
-    totalBytesWrittenInFile += bytesWritten;
+    if (end > next) {
+      lane.file->WriteAtCurrentPosition(encodedBlobs.m_data.data() + begin,
+                                        ends[end - 1] - begin);
+      next = end;
+    } else if (batch.m_runs.back().startOffset == 0 &&
+               batch.m_runs.back().firstBlob == batch.m_blobCount + next) {
+      // Not even an empty data file has room for the blob
+      std::ostringstream ss;
+      ss << "Blob of size " << ends[next] - begin
+         << " bytes does not fit in a data file of size " << m_maxDataFileSize
+         << " bytes.";
+      throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
+    }
+
+    if (next < ends.size()) {
+      // The next blob will exceed the m_maxDataFileSize if it is written in
+      // the current file. Flush what we wrote to it and continue in a new
+      // file.
+      auto& run = batch.m_runs.back();
+      run.endOffset = lane.file->GetCurrentWriteOffset();
+      if (!batch.m_deferSync) {
+        lane.file->Flush(flushOffset, run.endOffset - flushOffset);
+      }
+      SwitchToNewDataFile(lane);
+      StartFileRun(lane, batch.m_blobCount + next, batch);
+      flushOffset = lane.file->GetCurrentWriteOffset();
+    }
   }
 
   // Flush to make sure all blobs are written to disk
-  try {
-    Flush(baseOffsetInFile, totalBytesWrittenInFile);
-  } catch (...) {
-    m_currentBlobFile->SetCurrentWriteOffset(baseOffsetInFile);
-    throw;
+  auto& run = batch.m_runs.back();
+  run.endOffset = lane.file->GetCurrentWriteOffset();
+  if (!batch.m_deferSync) {
+    lane.file->Flush(flushOffset, run.endOffset - flushOffset);
+  }
+  batch.m_blobCount += ends.size();
+}
+
+void BlobManager::Commit(PendingBatch& batch, std::uint64_t firstDocumentID) {
+  assert(batch.m_laneLock.owns_lock());
+  if (!batch.m_deferSync) {
+    SyncDeferred();
+  }
+
+  for (auto& run : batch.m_runs) {
+    if (run.hasBatchMarker) {
+      BlobHeader::SetBatchMarkerID(*run.file, run.startOffset,
+                                   firstDocumentID + run.firstBlob);
+      if (!batch.m_deferSync) {
+        run.file->Flush(run.startOffset, BlobHeader::BatchMarkerSize);
+      }
+    }
+
+    if (batch.m_deferSync) {
+      std::lock_guard<std::mutex> lock(m_deferredRunsMutex);
+      m_deferredRuns.push_back(run);
+    } else {
+      // Set the file length
+      m_fileNameManager->UpdateDataFileLength(run.fileKey, run.endOffset);
+    }
+  }
+
+  batch.m_committed = true;
+  batch.m_laneLock.unlock();
+}
+
+void BlobManager::SyncDeferred() {
+  std::lock_guard<std::mutex> lock(m_deferredRunsMutex);
+  auto& runs = m_deferredRuns;
+  std::size_t i = 0;
+  while (i < runs.size()) {
+    // Consecutive runs that continue each other in a file are flushed and
+    // persisted together
+    auto end = i + 1;
+    while (end < runs.size() && runs[end].fileKey == runs[i].fileKey &&
+           runs[end].startOffset == runs[end - 1].endOffset) {
+      end++;
+    }
+    auto& last = runs[end - 1];
+    runs[i].file->Flush(runs[i].startOffset,
+                        last.endOffset - runs[i].startOffset);
+    m_fileNameManager->UpdateDataFileLength(last.fileKey, last.endOffset);
+    i = end;
   }
+  runs.clear();
+}
 
-  // Set the file length
-  m_fileNameManager->UpdateDataFileLength(
-      m_currentBlobFileInfo.fileKey,
-      m_currentBlobFile->GetCurrentWriteOffset());
+void BlobManager::EnableBatchMarkers() {
+  m_writeBatchMarkers = true;
 }
 
 void BlobManager::Get(const BlobMetadata& blobMetaData, BufferImpl& blob) {
+  auto memMapFile = GetReaderFile(blobMetaData.fileKey);
+  ReadBlob(*memMapFile, blobMetaData.offset, blob);
+}
+
+void BlobManager::MultiGet(const std::vector<BlobMetadata>& blobMetadataVec,
+                           std::vector<BufferImpl>& blobs) {
+  if (blobs.size() < blobMetadataVec.size()) {
+    blobs.resize(blobMetadataVec.size());
+  }
+
+  // Visit the blobs in file and offset order, this way each data file is
+  // looked up once and the reads walk forward through the mapped pages.
+  std::vector<std::size_t> order(blobMetadataVec.size());
+  for (std::size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](std::size_t l, std::size_t r) {
+    auto& lhs = blobMetadataVec[l];
+    auto& rhs = blobMetadataVec[r];
+    return lhs.fileKey < rhs.fileKey ||
+           (lhs.fileKey == rhs.fileKey && lhs.offset < rhs.offset);
+  });
+
+  std::size_t groupStart = 0;
+  while (groupStart < order.size()) {
+    auto fileKey = blobMetadataVec[order[groupStart]].fileKey;
+    auto groupEnd = groupStart + 1;
+    while (groupEnd < order.size() &&
+           blobMetadataVec[order[groupEnd]].fileKey == fileKey) {
+      groupEnd++;
+    }
+
+    auto memMapFile = GetReaderFile(fileKey);
+    // Ask the OS to page in all the blobs of this file before we touch the
+    // first one. Blobs that are close together are covered by a single hint,
+    // otherwise we only hint the page holding the start of each blob.
+    auto firstOffset = blobMetadataVec[order[groupStart]].offset;
+    auto lastOffset = blobMetadataVec[order[groupEnd - 1]].offset;
+    if (lastOffset - firstOffset <= MaxPrefetchSpan) {
+      memMapFile->Prefetch(firstOffset, lastOffset - firstOffset + 1);
+    } else {
+      for (auto i = groupStart; i < groupEnd; i++) {
+        memMapFile->Prefetch(blobMetadataVec[order[i]].offset, 1);
+      }
+    }
+
+    for (auto i = groupStart; i < groupEnd; i++) {
+      ReadBlob(*memMapFile, blobMetadataVec[order[i]].offset,
+               blobs[order[i]]);
+    }
+
+    groupStart = groupEnd;
+  }
+}
+
+std::shared_ptr<MemoryMappedFile> BlobManager::GetReaderFile(
+    std::int32_t fileKey) {
   // Get the FileInfo
   auto fileInfo = make_shared<FileInfo>();
-  m_fileNameManager->GetFileInfo(blobMetaData.fileKey, fileInfo);
+  m_fileNameManager->GetFileInfo(fileKey, fileInfo);
 
   // Get the file to read the data from
   std::shared_ptr<MemoryMappedFile> memMapFile;
-  if (!m_readerFiles.Find(fileInfo->fileKey, memMapFile)) {
+  bool cached = m_readerFiles.Find(fileInfo->fileKey, memMapFile);
+  EngineStats::Add(cached ? EngineCounter::DATA_FILE_CACHE_HITS
+                          : EngineCounter::DATA_FILE_CACHE_MISSES);
+  if (auto profile = QueryProfile::Current()) {
+    cached ? profile->fileCacheHits++ : profile->fileCacheMisses++;
+  }
+  if (!cached) {
     // Open the memmap file
     memMapFile.reset(new MemoryMappedFile(fileInfo->fileNameWithPath.c_str(),
                                           MemoryMappedFileMode::ReadOnly, 0,
@@ -275,9 +458,13 @@ void BlobManager::Get(const BlobMetadata& blobMetaData, BufferImpl& blob) {
     m_readerFiles.Add(fileInfo->fileKey, memMapFile, true);
   }
 
+  return memMapFile;
+}
+
+void BlobManager::ReadBlob(MemoryMappedFile& memMapFile, std::int64_t offset,
+                           BufferImpl& blob) {
   // Read the data from the file
-  char* offsetAddress =
-      memMapFile->GetOffsetAddressAsCharPtr(blobMetaData.offset);
+  char* offsetAddress = memMapFile.GetOffsetAddressAsCharPtr(offset);
 
   // Now read the header.
   BlobHeader header;
@@ -287,15 +474,26 @@ void BlobManager::Get(const BlobMetadata& blobMetaData, BufferImpl& blob) {
     blob.Resize(header.blobSize);
   }
 
+  if (auto profile = QueryProfile::Current()) {
+    profile->blobsRead++;
+    profile->bytesRead += header.compressed ? header.compSize : header.blobSize;
+    if (header.compressed) {
+      profile->bytesDecompressed += header.blobSize;
+    }
+  }
+
   // Read Blob contents
+  EngineStats::Add(EngineCounter::DOCUMENTS_FETCHED);
   if (header.compressed) {
     // Decompress the data
+    LatencyTimer timer(EngineLatency::DECOMPRESSION);
+    EngineStats::Add(EngineCounter::BYTES_DECOMPRESSED, header.blobSize);
     int val = LZ4_decompress_fast(offsetAddress, blob.GetDataForWrite(),
                                   header.blobSize);
     if (val < 0) {
       std::ostringstream ss;
       ss << "Decompression failed while reading blob from file "
-         << memMapFile->GetFileName() << " at offset " << blobMetaData.offset
+         << memMapFile.GetFileName() << " at offset " << offset
          << ". Error code returned by compression lib " << val << ".";
     }
     blob.SetLength(header.blobSize);
@@ -305,133 +503,158 @@ void BlobManager::Get(const BlobMetadata& blobMetaData, BufferImpl& blob) {
 }
 
 void BlobManager::UnmapLRUDataFiles() {
-  m_readerFiles.PerformEviction();
+  auto evictedCount = m_readerFiles.PerformEviction();
+  EngineStats::Add(EngineCounter::MEMORY_WATCHER_EVICTIONS, evictedCount);
 }
 
-BlobIterator::BlobIterator(FileInfo fileInfo)
+BlobIterator::BlobIterator(FileInfo fileInfo, std::uint64_t firstDocumentID)
     : m_fileInfo(std::move(fileInfo)),
       m_memMapFile(m_fileInfo.fileNameWithPath, MemoryMappedFileMode::ReadOnly,
                    0, true),
-      m_currentOffsetAddress(m_memMapFile.GetOffsetAddressAsCharPtr(0)) {}
+      m_currentOffsetAddress(m_memMapFile.GetOffsetAddressAsCharPtr(0)),
+      m_nextDocumentID(firstDocumentID),
+      m_hasBatchMarkers(false) {}
 
 std::size_t BlobIterator::GetNextBatch(
-    std::vector<BufferImpl>& blobs,
-    std::vector<BlobMetadata>& blobMetadataVec) {
+    std::vector<BufferImpl>& blobs, std::vector<BlobMetadata>& blobMetadataVec,
+    std::vector<std::uint64_t>& documentIDs) {
   assert(blobs.size() == blobMetadataVec.size());
+  assert(blobs.size() == documentIDs.size());
   assert(blobs.size() > 0);
 
   std::size_t batchSize = 0;
 
-  for (size_t i = 0; i < blobs.size(); i++) {
+  while (batchSize < blobs.size()) {
     auto position = m_currentOffsetAddress -
                     static_cast<char*>(m_memMapFile.GetBaseAddress());
     if (position >= m_fileInfo.dataLength) {
       // We are at the end of file
       break;
     }
+
+    // A newer version may frame its blobs differently
+    auto version = BlobHeader::ReadVersion(m_currentOffsetAddress);
+    if (version > kBlobHeaderVersion) {
+      std::ostringstream ss;
+      ss << "Data file " << m_fileInfo.fileNameWithPath << " has a blob of "
+         << "version " << static_cast<int>(version) << " at offset "
+         << position << ", the highest supported version is "
+         << static_cast<int>(kBlobHeaderVersion) << ".";
+      throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
+    }
+
+    if (BlobHeader::IsBatchMarker(m_currentOffsetAddress)) {
+      m_nextDocumentID = BlobHeader::ReadBatchMarker(m_currentOffsetAddress);
+      m_hasBatchMarkers = true;
+      continue;
+    }
+
     // Now read the header.
     BlobHeader header;
     BlobHeader::ReadBlobHeader(m_currentOffsetAddress, header);
+    auto& blob = blobs[batchSize];
 
     if (header.compressed) {
-      if (blobs[i].GetCapacity() < header.blobSize) {
+      if (blob.GetCapacity() < header.blobSize) {
         // Passed in buffer is not big enough.
         // Lets resize it to 2x, these buffers
         // are reused again and it will reduce the amount of
         // total memory allocations.
-        blobs[i].Resize((header.blobSize) * 2);
+        blob.Resize((header.blobSize) * 2);
       }
       // Decompress the data
-      int val = LZ4_decompress_fast(
-          m_currentOffsetAddress, blobs[i].GetDataForWrite(), header.blobSize);
+      int val = LZ4_decompress_fast(m_currentOffsetAddress,
+                                    blob.GetDataForWrite(), header.blobSize);
       if (val < 0) {
         std::ostringstream ss;
         ss << "Decompression failed while reading blob from file "
            << m_fileInfo.fileNameWithPath << " at offset " << position
            << ". Error code returned by compression lib " << val << ".";
       }
-      blobs[i].SetLength(header.blobSize);
+      blob.SetLength(header.blobSize);
       m_currentOffsetAddress += header.compSize;
     } else {
-      blobs[i] = std::move(BufferImpl(m_currentOffsetAddress, header.blobSize,
-                                      header.blobSize, StandardDeleteNoOp));
+      blob = std::move(BufferImpl(m_currentOffsetAddress, header.blobSize,
+                                  header.blobSize, StandardDeleteNoOp));
       m_currentOffsetAddress += header.blobSize;
     }
 
-    blobMetadataVec[i].fileKey = m_fileInfo.fileKey;
-    blobMetadataVec[i].offset = position;
+    blobMetadataVec[batchSize].fileKey = m_fileInfo.fileKey;
+    blobMetadataVec[batchSize].offset = position;
+    documentIDs[batchSize] = m_nextDocumentID++;
     ++batchSize;
   }
 
   return batchSize;
 }
 
-inline void BlobManager::Flush(size_t offset, size_t numBytes) {
-  m_currentBlobFile->Flush(offset, numBytes);
+std::uint64_t BlobIterator::GetNextDocumentID() const {
+  return m_nextDocumentID;
+}
+
+bool BlobIterator::HasBatchMarkers() const {
+  return m_hasBatchMarkers;
+}
+
+BlobManager::WriteLane& BlobManager::LockWriteLane(
+    std::unique_lock<std::mutex>& lock) {
+  // Take the first free lane, a single writer always gets the first one so
+  // the other lanes only get files once there are concurrent writers
+  for (auto& lane : m_writeLanes) {
+    std::unique_lock<std::mutex> laneLock(lane->mutex, std::try_to_lock);
+    if (laneLock.owns_lock()) {
+      lock = std::move(laneLock);
+      return *lane;
+    }
+  }
+
+  // All the lanes are busy, spread the waiting writers over them
+  auto& lane = *m_writeLanes[m_nextWriteLane++ % m_writeLanes.size()];
+  lock = std::unique_lock<std::mutex>(lane.mutex);
+  return lane;
 }
 
-void BlobManager::SwitchToNewDataFile() {
+void BlobManager::SwitchToNewDataFile(WriteLane& lane) {
+  EngineStats::Add(EngineCounter::DATA_FILE_SWITCHES);
   FileInfo fileInfo;
   m_fileNameManager->GetNextDataFileInfo(fileInfo);
   File::FastAllocate(fileInfo.fileNameWithPath, m_maxDataFileSize);
 
-  auto file = std::make_unique<MemoryMappedFile>(
+  auto file = std::make_shared<MemoryMappedFile>(
       fileInfo.fileNameWithPath, MemoryMappedFileMode::ReadWrite, 0,
       !m_synchronous);
-  m_fileNameManager->UpdateDataFileLength(
-      m_currentBlobFileInfo.fileKey,
-      m_currentBlobFile->GetCurrentWriteOffset());
 
-  // Set the evictable flag on the current file before switching
-  bool retVal = m_readerFiles.SetEvictable(m_currentBlobFileInfo.fileKey, true);
-  assert(retVal);
+  // The length of the current file was persisted by the commits of the
+  // batches in it. Set the evictable flag on it before switching.
+  if (lane.file != nullptr) {
+    bool retVal = m_readerFiles.SetEvictable(lane.fileInfo.fileKey, true);
+    assert(retVal);
+  }
 
-  m_currentBlobFileInfo = fileInfo;
-  m_currentBlobFile.reset(file.release());
-  m_readerFiles.Add(m_currentBlobFileInfo.fileKey, m_currentBlobFile, false);
+  lane.fileInfo = fileInfo;
+  lane.file = std::move(file);
+  m_readerFiles.Add(lane.fileInfo.fileKey, lane.file, false);
 }
 
-size_t BlobManager::PutInternal(const BufferImpl& blob,
-                                BlobMetadata& blobMetadata, bool compress) {
-  BlobHeader header;
-  header.version = kBlobHeaderVersion;
-  header.compressed = compress;
-  size_t bytesWritten = 0;
-  // Record the current offset.
-  size_t offset = m_currentBlobFile->GetCurrentWriteOffset();
-  // Compress if required and capture the storage size of blob
-  if (compress) {
-    auto maxCompSize = GetCompressedSize(blob.GetLength());
-    if (maxCompSize > m_compBuffer.GetCapacity()) {
-      m_compBuffer.Resize(maxCompSize);
-    }
-    auto compSize =
-        LZ4_compress_default(blob.GetData(), m_compBuffer.GetDataForWrite(),
-                             blob.GetLength(), m_compBuffer.GetCapacity());
-    if (compSize == 0) {
-      // throw
-    }
-    m_compBuffer.SetLength(compSize);
-    header.compSize = compSize;
-    header.blobSize = blob.GetLength();
-    // Write the header
-    auto headerBytes = BlobHeader::WriteBlobHeader(m_currentBlobFile, header);
-    // Write the blob contents
-    m_currentBlobFile->WriteAtCurrentPosition(m_compBuffer.GetData(),
-                                              m_compBuffer.GetLength());
-    bytesWritten = headerBytes + m_compBuffer.GetLength();
-  } else {
-    header.blobSize = blob.GetLength();
-    // Write the header
-    auto headerBytes = BlobHeader::WriteBlobHeader(m_currentBlobFile, header);
-    // Write the blob contents
-    m_currentBlobFile->WriteAtCurrentPosition(blob.GetData(), blob.GetLength());
-    bytesWritten = headerBytes + blob.GetLength();
+void BlobManager::StartFileRun(WriteLane& lane, std::size_t firstBlob,
+                               PendingBatch& batch) {
+  if (m_writeBatchMarkers &&
+      lane.file->GetCurrentWriteOffset() + BlobHeader::BatchMarkerSize >
+          m_maxDataFileSize) {
+    SwitchToNewDataFile(lane);
   }
 
-  // 6. Fill and return blobMetaData
-  blobMetadata.offset = offset;
-  blobMetadata.fileKey = m_currentBlobFileInfo.fileKey;
-
-  return bytesWritten;
+  PendingBatch::FileRun run;
+  run.fileKey = lane.fileInfo.fileKey;
+  run.file = lane.file;
+  run.startOffset = lane.file->GetCurrentWriteOffset();
+  run.endOffset = run.startOffset;
+  run.firstBlob = firstBlob;
+  run.hasBatchMarker = m_writeBatchMarkers;
+  batch.m_runs.push_back(std::move(run));
+
+  if (m_writeBatchMarkers) {
+    // Commit fills in the id
+    BlobHeader::WriteBatchMarker(*lane.file);
+  }
 }
@@ -1,13 +1,19 @@
 #include "cdatabase.h"
 #include <boost/utility/string_ref.hpp>
 #include <sstream>
+#include <vector>
 #include "buffer_impl.h"
+#include "bulk_import_impl.h"
 #include "database_impl.h"
+#include "engine_stats.h"
 #include "enums.h"
 #include "gsl/span.h"
 #include "index_info_impl.h"
+#include "insert_queue.h"
 #include "jonoondb_exceptions.h"
 #include "options_impl.h"
+#include "prepared_statement_impl.h"
+#include "query_profile.h"
 #include "resultset_impl.h"
 #include "status_impl.h"
 #include "write_options_impl.h"
@@ -115,6 +121,10 @@ bool TranslateExceptions(Fn&& fn, status_ptr& sts) {
     sts = new status(jonoondb_status_codes::status_apimisusecode, ex.what(),
                      ex.GetSourceFileName(), ex.GetFunctionName(),
                      ex.GetLineNumber());
+  } catch (const InsertQueueFullException& ex) {
+    sts = new status(jonoondb_status_codes::status_insertqueuefullcode,
+                     ex.what(), ex.GetSourceFileName(), ex.GetFunctionName(),
+                     ex.GetLineNumber());
   } catch (const JonoonDBException& ex) {
     sts = new status(jonoondb_status_codes::status_genericerrorcode, ex.what(),
                      ex.GetSourceFileName(), ex.GetFunctionName(),
@@ -137,11 +147,12 @@ IndexType ToIndexType(std::int32_t type) {
   switch (static_cast<IndexType>(type)) {
     case IndexType::INVERTED_COMPRESSED_BITMAP:
     case IndexType::VECTOR:
+    case IndexType::BLOOM_FILTER:
       return static_cast<IndexType>(type);
     default:
       throw InvalidArgumentException(
           "Argument type is not valid. Allowed values are "
-          "{INVERTED_COMPRESSED_BITMAP = 1, VECTOR = 2}.",
+          "{INVERTED_COMPRESSED_BITMAP = 1, VECTOR = 2, BLOOM_FILTER = 3}.",
           __FILE__, __func__, __LINE__);
   }
 }
@@ -225,6 +236,47 @@ void jonoondb_options_setmemorycleanupthreshold(options_ptr opt,
   opt->impl.SetMemoryCleanupThreshold(valueInBytes);
 }
 
+uint64_t jonoondb_options_getmaxquerythreads(options_ptr opt) {
+  return opt->impl.GetMaxQueryThreads();
+}
+
+void jonoondb_options_setmaxquerythreads(options_ptr opt, uint64_t value) {
+  opt->impl.SetMaxQueryThreads(value);
+}
+
+uint64_t jonoondb_options_getmaxinsertthreads(options_ptr opt) {
+  return opt->impl.GetMaxInsertThreads();
+}
+
+void jonoondb_options_setmaxinsertthreads(options_ptr opt, uint64_t value) {
+  opt->impl.SetMaxInsertThreads(value);
+}
+
+uint64_t jonoondb_options_getwritelanes(options_ptr opt) {
+  return opt->impl.GetWriteLanes();
+}
+
+void jonoondb_options_setwritelanes(options_ptr opt, uint64_t value) {
+  opt->impl.SetWriteLanes(value);
+}
+
+uint64_t jonoondb_options_getinsertqueuecapacity(options_ptr opt) {
+  return opt->impl.GetInsertQueueCapacity();
+}
+
+void jonoondb_options_setinsertqueuecapacity(options_ptr opt, uint64_t value) {
+  opt->impl.SetInsertQueueCapacity(value);
+}
+
+bool jonoondb_options_getblockwheninsertqueuefull(options_ptr opt) {
+  return opt->impl.GetBlockWhenInsertQueueFull();
+}
+
+void jonoondb_options_setblockwheninsertqueuefull(options_ptr opt,
+                                                  bool value) {
+  opt->impl.SetBlockWhenInsertQueueFull(value);
+}
+
 //
 // WriteOptions Functions
 //
@@ -483,6 +535,8 @@ struct resultset {
   resultset(ResultSetImpl&& val) : impl(std::move(val)) {}
 
   ResultSetImpl impl;
+  // Backs the string returned by jonoondb_resultset_getprofile
+  std::string profileReport;
 };
 
 void jonoondb_resultset_destruct(resultset_ptr rs) {
@@ -586,6 +640,125 @@ int32_t jonoondb_resultset_isnull(resultset_ptr rs, int32_t columnIndex,
   return val ? 1 : 0;
 }
 
+uint64_t jonoondb_resultset_fetchbatch(resultset_ptr rs,
+                                       jonoondb_column_vector* columns,
+                                       uint64_t columnCount, uint64_t maxRows,
+                                       status_ptr* sts) {
+  uint64_t val;
+  TranslateExceptions(
+      [&] {
+        std::vector<ColumnBatchBuffers> buffers(columnCount);
+        for (uint64_t i = 0; i < columnCount; i++) {
+          auto& column = columns[i];
+          buffers[i] = {column.columnIndex,
+                        static_cast<SqlType>(column.type),
+                        column.validity,
+                        column.int64Values,
+                        column.doubleValues,
+                        column.offsets,
+                        column.data,
+                        column.dataCapacity};
+        }
+        val = rs->impl.FetchBatch(buffers.data(), buffers.size(), maxRows);
+      },
+      *sts);
+  return val;
+}
+
+const char* jonoondb_resultset_getprofile(resultset_ptr rs,
+                                          uint64_t** retValSize,
+                                          status_ptr* sts) {
+  char* strPtr;
+  TranslateExceptions(
+      [&] {
+        auto profile = rs->impl.GetProfile();
+        if (profile == nullptr) {
+          throw ApiMisuseException(
+              "The resultset has no profile, the query was not executed "
+              "with profiling.",
+              __FILE__, __func__, __LINE__);
+        }
+        rs->profileReport = profile->ToString();
+        **retValSize = rs->profileReport.size();
+        strPtr = const_cast<char*>(rs->profileReport.c_str());
+      },
+      *sts);
+  return strPtr;
+}
+
+//
+// PreparedStatement Functions
+//
+struct preparedstatement {
+  preparedstatement(PreparedStatementImpl&& val) : impl(std::move(val)) {}
+
+  PreparedStatementImpl impl;
+};
+
+void jonoondb_preparedstatement_destruct(preparedstatement_ptr ps) {
+  delete ps;
+}
+
+int32_t jonoondb_preparedstatement_getparametercount(
+    preparedstatement_ptr ps) {
+  return ps->impl.GetParameterCount();
+}
+
+void jonoondb_preparedstatement_bindinteger(preparedstatement_ptr ps,
+                                            int32_t paramIndex, int64_t val,
+                                            status_ptr* sts) {
+  TranslateExceptions([&] { ps->impl.BindInteger(paramIndex, val); }, *sts);
+}
+
+void jonoondb_preparedstatement_binddouble(preparedstatement_ptr ps,
+                                           int32_t paramIndex, double val,
+                                           status_ptr* sts) {
+  TranslateExceptions([&] { ps->impl.BindDouble(paramIndex, val); }, *sts);
+}
+
+void jonoondb_preparedstatement_bindstring(preparedstatement_ptr ps,
+                                           int32_t paramIndex,
+                                           const char* val, uint64_t valLength,
+                                           status_ptr* sts) {
+  TranslateExceptions(
+      [&] {
+        ps->impl.BindString(paramIndex, boost::string_ref(val, valLength));
+      },
+      *sts);
+}
+
+void jonoondb_preparedstatement_bindblob(preparedstatement_ptr ps,
+                                         int32_t paramIndex, const char* val,
+                                         uint64_t valLength,
+                                         status_ptr* sts) {
+  TranslateExceptions([&] { ps->impl.BindBlob(paramIndex, val, valLength); },
+                      *sts);
+}
+
+void jonoondb_preparedstatement_bindnull(preparedstatement_ptr ps,
+                                         int32_t paramIndex, status_ptr* sts) {
+  TranslateExceptions([&] { ps->impl.BindNull(paramIndex); }, *sts);
+}
+
+void jonoondb_preparedstatement_clearbindings(preparedstatement_ptr ps) {
+  ps->impl.ClearBindings();
+}
+
+resultset_ptr jonoondb_preparedstatement_executeselect(
+    preparedstatement_ptr ps, status_ptr* sts) {
+  resultset_ptr val;
+  TranslateExceptions([&] { val = new resultset(ps->impl.ExecuteSelect()); },
+                      *sts);
+  return val;
+}
+
+int64_t jonoondb_preparedstatement_executedelete(preparedstatement_ptr ps,
+                                                 status_ptr* sts) {
+  int64_t val;
+  TranslateExceptions([&] { val = ps->impl.ExecuteDelete(); }, *sts);
+  return val;
+}
+
 //
 // Database
 //
@@ -631,6 +804,13 @@ void jonoondb_database_createcollection(database_ptr db, const char* name,
       *sts);
 }
 
+void jonoondb_database_createindex(database_ptr db, const char* collectionName,
+                                   const indexinfo_ptr indexInfo,
+                                   status_ptr* sts) {
+  TranslateExceptions(
+      [&] { db->impl.CreateIndex(collectionName, indexInfo->impl); }, *sts);
+}
+
 void jonoondb_database_insert(database_ptr db, const char* collectionName,
                               const jonoondb_buffer_ptr documentData,
                               const write_options_ptr wo, status_ptr* sts) {
@@ -659,6 +839,75 @@ void jonoondb_database_multi_insert(database_ptr db, const char* collectionName,
       *sts);
 }
 
+static InsertQueue::Callback ToInsertCallback(jonoondb_insert_callback callback,
+                                              void* context) {
+  return [callback, context](std::uint64_t firstDocumentID,
+                             std::exception_ptr error) {
+    status_ptr sts = nullptr;
+    if (error) {
+      TranslateExceptions([&] { std::rethrow_exception(error); }, sts);
+    }
+    callback(context, firstDocumentID, sts);
+    delete sts;
+  };
+}
+
+void jonoondb_database_insert_async(database_ptr db, const char* collectionName,
+                                    const jonoondb_buffer_ptr documentData,
+                                    const write_options_ptr wo,
+                                    jonoondb_insert_callback callback,
+                                    void* context, status_ptr* sts) {
+  TranslateExceptions(
+      [&] {
+        const BufferImpl* document = &documentData->impl;
+        gsl::span<const BufferImpl*> documents(&document, 1);
+        db->impl.MultiInsertAsync(collectionName, documents, wo->impl,
+                                  ToInsertCallback(callback, context));
+      },
+      *sts);
+}
+
+void jonoondb_database_multi_insert_async(
+    database_ptr db, const char* collectionName, uint64_t collectionNameLength,
+    const jonoondb_buffer_ptr* documentArr, uint64_t documentArrLength,
+    const write_options_ptr wo, jonoondb_insert_callback callback,
+    void* context, status_ptr* sts) {
+  TranslateExceptions(
+      [&] {
+        boost::string_ref colName(collectionName, collectionNameLength);
+        // Todo: Use a safer cast than C Style cast
+        const BufferImpl** start = (const BufferImpl**)documentArr;
+        gsl::span<const BufferImpl*> documents(start, documentArrLength);
+        db->impl.MultiInsertAsync(colName, documents, wo->impl,
+                                  ToInsertCallback(callback, context));
+      },
+      *sts);
+}
+
+void jonoondb_database_bulkimport(database_ptr db, const char* collectionName,
+                                  const char* filePath,
+                                  const jonoondb_bulkimport_options* opt,
+                                  jonoondb_bulkimport_result* result,
+                                  status_ptr* sts) {
+  TranslateExceptions(
+      [&] {
+        BulkImportOptionsImpl options;
+        options.wo = WriteOptionsImpl(opt->compress, opt->verifyDocuments);
+        options.bigEndianSizes = opt->bigEndianSizes;
+        options.syncEachBatch = opt->syncEachBatch;
+        if (opt->batchSize > 0) {
+          options.batchSize = opt->batchSize;
+        }
+
+        BulkImportResultImpl importResult;
+        db->impl.BulkImport(collectionName, filePath, options, importResult);
+        result->documentCount = importResult.documentCount;
+        result->byteCount = importResult.byteCount;
+        result->elapsedNanoseconds = importResult.elapsedNanoseconds;
+      },
+      *sts);
+}
+
 resultset_ptr jonoondb_database_executeselect(database_ptr db,
                                               const char* selectStmt,
                                               uint64_t selectStmtLength,
@@ -675,6 +924,20 @@ resultset_ptr jonoondb_database_executeselect(database_ptr db,
   return val;
 }
 
+resultset_ptr jonoondb_database_executeselectprofiled(
+    database_ptr db, const char* selectStmt, uint64_t selectStmtLength,
+    status_ptr* sts) {
+  resultset_ptr val;
+  TranslateExceptions(
+      [&] {
+        std::string selectStatement(selectStmt, selectStmtLength);
+        val = new resultset(db->impl.ExecuteSelect(selectStatement, true));
+      },
+      *sts);
+
+  return val;
+}
+
 JONOONDB_API_EXPORT int64_t jonoondb_database_delete(database_ptr db,
                                                      const char* deleteStmt,
                                                      uint64_t deleteStmtLength,
@@ -691,4 +954,45 @@ JONOONDB_API_EXPORT int64_t jonoondb_database_delete(database_ptr db,
   return val;
 }
 
+uint64_t jonoondb_database_getenginestats(database_ptr db,
+                                          jonoondb_engine_stat* stats,
+                                          uint64_t statsCapacity,
+                                          status_ptr* sts) {
+  uint64_t val;
+  TranslateExceptions(
+      [&] {
+        auto engineStats = EngineStats::GetStats();
+        for (uint64_t i = 0; i < engineStats.size() && i < statsCapacity;
+             i++) {
+          auto& stat = engineStats[i];
+          stats[i] = {stat.name,
+                      stat.isLatency ? 1 : 0,
+                      stat.count,
+                      stat.totalNanoseconds,
+                      stat.p50Nanoseconds,
+                      stat.p99Nanoseconds,
+                      stat.maxNanoseconds};
+        }
+        val = engineStats.size();
+      },
+      *sts);
+
+  return val;
+}
+
+preparedstatement_ptr jonoondb_database_prepare(database_ptr db,
+                                                const char* stmt,
+                                                uint64_t stmtLength,
+                                                status_ptr* sts) {
+  preparedstatement_ptr val;
+  TranslateExceptions(
+      [&] {
+        std::string statement(stmt, stmtLength);
+        val = new preparedstatement(db->impl.Prepare(statement));
+      },
+      *sts);
+
+  return val;
+}
+
 }  // extern "C"
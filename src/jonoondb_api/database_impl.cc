@@ -1,20 +1,25 @@
 #include "database_impl.h"
 #include <stdio.h>
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <sstream>
 #include <string>
 #include "blob_manager.h"
+#include "bulk_import_impl.h"
 #include "database_metadata_manager.h"
 #include "document_collection.h"
 #include "document_collection_dictionary.h"
+#include "document_schema.h"
 #include "enums.h"
 #include "filename_manager.h"
 #include "index_info_impl.h"
 #include "index_manager.h"
+#include "insert_queue.h"
 #include "jonoondb_api/delete_vector.h"
 #include "jonoondb_api/write_options_impl.h"
 #include "options_impl.h"
+#include "prepared_statement_impl.h"
 #include "proc_utils.h"
 #include "query_processor.h"
 #include "resultset_impl.h"
@@ -82,8 +87,13 @@ DatabaseImpl::DatabaseImpl(const std::string& dbPath, const std::string& dbName,
   m_dbMetadataMgrImpl = std::make_unique<DatabaseMetadataManager>(
       dbPath, dbName, options.GetCreateDBIfMissing());
 
+  // The thread that inserts is one of the insert threads
+  m_insertThreadPool = std::make_shared<ThreadPool>(
+      std::max<std::size_t>(options.GetMaxInsertThreads(), 1) - 1);
+
   // Initialize query processor
-  m_queryProcessor = std::make_unique<QueryProcessor>(dbPath, dbName);
+  m_queryProcessor =
+      std::make_unique<QueryProcessor>(dbName, options.GetMaxQueryThreads());
 
   std::vector<CollectionMetadata> collectionsInfo;
   m_dbMetadataMgrImpl->GetExistingCollections(collectionsInfo);
@@ -110,6 +120,8 @@ DatabaseImpl::DatabaseImpl(const std::string& dbPath, const std::string& dbName,
 }
 
 DatabaseImpl::~DatabaseImpl() {
+  // Wait for the queued inserts before we close the collections
+  m_insertQueues.clear();
   {
     std::unique_lock<std::mutex> lock(m_memWatcherMutex);
     m_shutdownMemWatcher = true;
@@ -158,6 +170,38 @@ void DatabaseImpl::CreateCollection(
   m_collectionContainer[*m_collectionNameStore.back()] = documentCollection;
 }
 
+void DatabaseImpl::CreateIndex(const std::string& collectionName,
+                               const IndexInfoImpl& indexInfo) {
+  auto item = m_collectionContainer.find(collectionName);
+  if (item == m_collectionContainer.end()) {
+    std::ostringstream ss;
+    ss << "Collection \"" << collectionName << "\" not found.";
+    throw CollectionNotFoundException(ss.str(), __FILE__, __func__, __LINE__);
+  }
+
+  // Persist the index first. If we crash while the index is being built, it
+  // will be built from the data files when the database is opened next time.
+  m_dbMetadataMgrImpl->AddIndex(collectionName, indexInfo);
+  try {
+    item->second->CreateIndex(indexInfo);
+  } catch (...) {
+    m_dbMetadataMgrImpl->RemoveIndex(collectionName, indexInfo.GetIndexName());
+    throw;
+  }
+}
+
+const std::string& DatabaseImpl::GetCollectionSchema(
+    const std::string& collectionName) {
+  auto item = m_collectionContainer.find(collectionName);
+  if (item == m_collectionContainer.end()) {
+    std::ostringstream ss;
+    ss << "Collection \"" << collectionName << "\" not found.";
+    throw CollectionNotFoundException(ss.str(), __FILE__, __func__, __LINE__);
+  }
+
+  return item->second->GetDocumentSchema()->GetSchemaText();
+}
+
 void DatabaseImpl::Insert(const char* collectionName,
                           const BufferImpl& documentData,
                           const WriteOptionsImpl& wo) {
@@ -188,14 +232,60 @@ void DatabaseImpl::MultiInsert(const boost::string_ref& collectionName,
   item->second->MultiInsert(documents, wo);
 }
 
-ResultSetImpl DatabaseImpl::ExecuteSelect(const std::string& selectStatement) {
-  return m_queryProcessor->ExecuteSelect(selectStatement);
+void DatabaseImpl::MultiInsertAsync(const boost::string_ref& collectionName,
+                                    gsl::span<const BufferImpl*>& documents,
+                                    const WriteOptionsImpl& wo,
+                                    InsertQueue::Callback callback) {
+  auto item = m_collectionContainer.find(collectionName);
+  if (item == m_collectionContainer.end()) {
+    std::ostringstream ss;
+    ss << "Collection \"" << collectionName << "\" not found.";
+    throw CollectionNotFoundException(ss.str(), __FILE__, __func__, __LINE__);
+  }
+
+  InsertQueue* queue;
+  {
+    std::lock_guard<std::mutex> lock(m_insertQueuesMutex);
+    auto& entry = m_insertQueues[item->first];
+    if (!entry) {
+      entry = std::make_unique<InsertQueue>(
+          item->second, m_options.GetInsertQueueCapacity(),
+          m_options.GetBlockWhenInsertQueueFull());
+    }
+    queue = entry.get();
+  }
+
+  // Push can wait for the writer so we don't hold the lock
+  queue->Push(documents, wo, std::move(callback));
+}
+
+void DatabaseImpl::BulkImport(const std::string& collectionName,
+                              const std::string& filePath,
+                              const BulkImportOptionsImpl& options,
+                              BulkImportResultImpl& result) {
+  auto item = m_collectionContainer.find(collectionName);
+  if (item == m_collectionContainer.end()) {
+    std::ostringstream ss;
+    ss << "Collection \"" << collectionName << "\" not found.";
+    throw CollectionNotFoundException(ss.str(), __FILE__, __func__, __LINE__);
+  }
+
+  item->second->BulkImport(filePath, options, result);
+}
+
+ResultSetImpl DatabaseImpl::ExecuteSelect(const std::string& selectStatement,
+                                          bool collectProfile) {
+  return m_queryProcessor->ExecuteSelect(selectStatement, collectProfile);
 }
 
 std::int64_t DatabaseImpl::Delete(const std::string& deleteStatement) {
   return m_queryProcessor->Delete(deleteStatement);
 }
 
+PreparedStatementImpl DatabaseImpl::Prepare(const std::string& statement) {
+  return m_queryProcessor->Prepare(statement);
+}
+
 std::shared_ptr<DocumentCollection> DatabaseImpl::CreateCollectionInternal(
     const std::string& name, SchemaType schemaType, const std::string& schema,
     const std::vector<IndexInfoImpl*>& indexes,
@@ -205,10 +295,12 @@ std::shared_ptr<DocumentCollection> DatabaseImpl::CreateCollectionInternal(
                                                m_dbMetadataMgrImpl->GetDBName(),
                                                name, false);
 
-  auto bm = std::make_unique<BlobManager>(move(fnm),
-                                          m_options.GetMaxDataFileSize(), true);
+  auto bm = std::make_unique<BlobManager>(
+      move(fnm), m_options.GetMaxDataFileSize(), true,
+      m_options.GetWriteLanes());
 
   return std::make_shared<DocumentCollection>(
       m_dbMetadataMgrImpl->GetDBPath(), m_dbMetadataMgrImpl->GetDBName(), name,
-      schemaType, schema, indexes, move(bm), dataFilesToLoad);
+      schemaType, schema, indexes, move(bm), dataFilesToLoad,
+      m_insertThreadPool);
 }
\ No newline at end of file
@@ -206,6 +206,47 @@ void DatabaseMetadataManager::AddCollection(
   }
 }
 
+void DatabaseMetadataManager::AddIndex(const std::string& collectionName,
+                                       const IndexInfoImpl& indexInfo) {
+  // A single insert statement is atomic, no explicit transaction is needed
+  CreateIndex(collectionName, indexInfo);
+}
+
+void DatabaseMetadataManager::RemoveIndex(const std::string& collectionName,
+                                          const std::string& indexName) {
+  static std::string sqlText =
+      "DELETE FROM CollectionIndex WHERE CollectionName = ? AND IndexName = ?";
+  sqlite3_stmt* sqlStmt = nullptr;
+  int code = sqlite3_prepare_v2(m_metadataDBConnection.get(), sqlText.c_str(),
+                                sqlText.size(),
+                                &sqlStmt,  // statement that is to be prepared
+                                nullptr  // pointer to unused portion of stmt
+  );
+  if (code != SQLITE_OK) {
+    throw SQLException(sqlite3_errstr(code), __FILE__, __func__, __LINE__);
+  }
+
+  std::unique_ptr<sqlite3_stmt, void (*)(sqlite3_stmt*)> statementGuard(
+      sqlStmt, GuardFuncs::SQLite3Finalize);
+
+  code = sqlite3_bind_text(sqlStmt, 1, collectionName.c_str(),
+                           collectionName.size(), SQLITE_STATIC);
+  if (code != SQLITE_OK) {
+    throw SQLException(sqlite3_errstr(code), __FILE__, __func__, __LINE__);
+  }
+
+  code = sqlite3_bind_text(sqlStmt, 2, indexName.c_str(), indexName.size(),
+                           SQLITE_STATIC);
+  if (code != SQLITE_OK) {
+    throw SQLException(sqlite3_errstr(code), __FILE__, __func__, __LINE__);
+  }
+
+  code = sqlite3_step(sqlStmt);
+  if (code != SQLITE_DONE) {
+    throw SQLException(sqlite3_errstr(code), __FILE__, __func__, __LINE__);
+  }
+}
+
 const std::string& DatabaseMetadataManager::GetDBPath() const {
   return m_dbPath;
 }
@@ -1,5 +1,7 @@
+#include <algorithm>
 #include "jonoondb_api/delete_vector.h"
 #include "jonoondb_api/document_collection.h"
+#include "jonoondb_api/engine_stats.h"
 #include "jonoondb_api/guard_funcs.h"
 #include "jonoondb_api/jonoondb_exceptions.h"
 #include "jonoondb_api/sqlite_utils.h"
@@ -10,14 +12,25 @@ using namespace boost::filesystem;
 using namespace gsl;
 using namespace jonoondb_api;
 
+namespace {
+// The log is never compacted before it has this many rows, this keeps small
+// deletes from rewriting the snapshot over and over.
+const std::uint64_t MinLogDocCountForCompaction = 4096;
+}  // namespace
+
 DeleteVector::DeleteVector(const string& dbPath, const string& dbName,
                            const string& collectionName, bool createDBIfMissing,
                            uint64_t nextDocId)
     : m_collectionName(collectionName),
       m_nextDocumentId(nextDocId),
+      m_snapshotDocCount(0),
+      m_logDocCount(0),
       m_dbConnection(nullptr, GuardFuncs::SQLite3Close),
       m_updateStmt(nullptr, GuardFuncs::SQLite3Finalize),
-      m_selectStmt(nullptr, GuardFuncs::SQLite3Finalize) {
+      m_selectStmt(nullptr, GuardFuncs::SQLite3Finalize),
+      m_insertLogStmt(nullptr, GuardFuncs::SQLite3Finalize),
+      m_selectLogStmt(nullptr, GuardFuncs::SQLite3Finalize),
+      m_clearLogStmt(nullptr, GuardFuncs::SQLite3Finalize) {
   path normalizedPath;
   m_dbConnection = SQLiteUtils::NormalizePathAndCreateDBConnection(
       dbPath, dbName, createDBIfMissing, normalizedPath);
@@ -30,63 +43,96 @@ DeleteVector::DeleteVector(const string& dbPath, const string& dbName,
     InsertEmptyDeleteVector();
   } else {
     LoadBitmap();
+    LoadLog();
   }
 
-  m_isDirty = m_nextDocumentId > 0;
+  BuildBitmap();
 }
 
 void DeleteVector::OnDocumentDeleted(uint64_t docId) {
-  assert(docId < m_nextDocumentId);
-  assert(m_deletedDocIds.find(docId) == m_deletedDocIds.end());
-
-  m_deletedDocIds.insert(docId);
+  OnDocumentsDeleted({docId});
+}
 
-  if (*m_deletedDocIds.rbegin() == docId) {
-    m_deleteVecSerializationBitmap.Add(docId);
-  } else {
-    m_deleteVecSerializationBitmap.Reset();
-    for (auto id : m_deletedDocIds) {
-      m_deleteVecSerializationBitmap.Add(id);
+void DeleteVector::OnDocumentsDeleted(const std::vector<uint64_t>& docIds) {
+  std::lock_guard<std::mutex> lock(m_deleteMutex);
+  std::vector<uint64_t> newDocIds;
+  newDocIds.reserve(docIds.size());
+  for (auto id : docIds) {
+    assert(id < m_nextDocumentId);
+    if (m_deletedDocIds.find(id) == m_deletedDocIds.end()) {
+      newDocIds.push_back(id);
     }
   }
+  // The log has a row per id
+  std::sort(newDocIds.begin(), newDocIds.end());
+  newDocIds.erase(std::unique(newDocIds.begin(), newDocIds.end()),
+                  newDocIds.end());
+  if (newDocIds.empty()) {
+    return;
+  }
 
-  try {
-    StoreBitmap();
-    m_isDirty = true;
-  } catch (...) {
-    // rollback in-memory changes
-    m_deletedDocIds.erase(docId);
-    m_deleteVecSerializationBitmap.Reset();
-    for (auto id : m_deletedDocIds) {
-      m_deleteVecSerializationBitmap.Add(id);
-    }
-    throw;
+  WriteToLog(newDocIds);
+
+  m_deletedDocIds.insert(newDocIds.begin(), newDocIds.end());
+  {
+    std::lock_guard<std::mutex> patchLock(m_patchMutex);
+    m_unpatchedDocIds.insert(m_unpatchedDocIds.end(), newDocIds.begin(),
+                             newDocIds.end());
   }
+  m_hasDeletes.store(true, std::memory_order_release);
+
+  MaybeCompactLog();
 }
 
-const MamaJenniesBitmap& DeleteVector::GetDeleteVectorBitmap() {
-  MaybeReconstructBitmap();
+std::shared_ptr<const MamaJenniesBitmap> DeleteVector::GetDeleteVectorBitmap() {
+  std::lock_guard<std::mutex> lock(m_patchMutex);
+  if (!m_unpatchedDocIds.empty()) {
+    PatchBitmap(m_unpatchedDocIds);
+    m_unpatchedDocIds.clear();
+  }
   return m_deleteVecBitmap;
 }
 
+bool DeleteVector::HasDeletes() const {
+  return m_hasDeletes.load(std::memory_order_acquire);
+}
+
 void DeleteVector::OnDocumentsInserted(std::uint64_t nextDocId) {
   assert(nextDocId > m_nextDocumentId);
+  // New documents are live, extend the bitmap with a run of ones
+  std::lock_guard<std::mutex> lock(m_patchMutex);
+  GetWritableBitmap().AddRange(m_nextDocumentId, nextDocId);
   m_nextDocumentId = nextDocId;
-  m_isDirty = true;
 }
 
-void DeleteVector::MaybeReconstructBitmap() {
-  if (m_isDirty) {
-    m_deleteVecBitmap.Reset();
-    for (auto& id : m_deletedDocIds) {
-      m_deleteVecBitmap.Add(id);
-    }
-    // Its important to add a id that is last_doc_id + 1 at the end of the
-    // bitmap so that the length of bitmap is correct
-    m_deleteVecBitmap.Add(m_nextDocumentId);
-    m_deleteVecBitmap.InPlaceLogicalNOT();
-    m_isDirty = false;
+void DeleteVector::BuildBitmap() {
+  EngineStats::Add(EngineCounter::DELETE_VECTOR_REBUILDS);
+  auto bitmap = std::make_shared<MamaJenniesBitmap>();
+  uint64_t start = 0;
+  for (auto id : m_deletedDocIds) {
+    bitmap->AddRange(start, id);
+    start = id + 1;
+  }
+  bitmap->AddRange(start, m_nextDocumentId);
+
+  std::lock_guard<std::mutex> lock(m_patchMutex);
+  m_deleteVecBitmap = std::move(bitmap);
+  m_hasDeletes.store(!m_deletedDocIds.empty(), std::memory_order_release);
+}
+
+void DeleteVector::PatchBitmap(std::vector<uint64_t> docIds) {
+  EngineStats::Add(EngineCounter::DELETE_VECTOR_PATCHES);
+  std::sort(docIds.begin(), docIds.end());
+  GetWritableBitmap().Flip(docIds);
+}
+
+MamaJenniesBitmap& DeleteVector::GetWritableBitmap() {
+  // The caller holds m_patchMutex, so no query can take a new reference while
+  // we check for existing ones
+  if (m_deleteVecBitmap.use_count() > 1) {
+    m_deleteVecBitmap = std::make_shared<MamaJenniesBitmap>(*m_deleteVecBitmap);
   }
+  return *m_deleteVecBitmap;
 }
 
 void DeleteVector::InsertEmptyDeleteVector() {
@@ -122,6 +168,97 @@ void DeleteVector::InsertEmptyDeleteVector() {
   }
 }
 
+void DeleteVector::WriteToLog(const std::vector<uint64_t>& docIds) {
+  int sqliteCode = sqlite3_exec(m_dbConnection.get(), "BEGIN", 0, 0, 0);
+  SQLiteUtils::HandleSQLiteCode(sqliteCode);
+
+  try {
+    for (auto id : docIds) {
+      std::unique_ptr<sqlite3_stmt, void (*)(sqlite3_stmt*)> statementGuard(
+          m_insertLogStmt.get(), SQLiteUtils::ClearAndResetStatement);
+
+      sqliteCode = sqlite3_bind_text(m_insertLogStmt.get(),
+                                     1,  // Index of wildcard
+                                     m_collectionName.c_str(),
+                                     -1,  // -1 means go until NULL char
+                                     SQLITE_STATIC);
+      SQLiteUtils::HandleSQLiteCode(sqliteCode);
+
+      sqliteCode =
+          sqlite3_bind_int64(m_insertLogStmt.get(),
+                             2,  // Index of wildcard
+                             static_cast<sqlite3_int64>(id));
+      SQLiteUtils::HandleSQLiteCode(sqliteCode);
+
+      sqliteCode = sqlite3_step(m_insertLogStmt.get());
+      if (sqliteCode != SQLITE_DONE) {
+        throw SQLException(sqlite3_errstr(sqliteCode), __FILE__, __func__,
+                           __LINE__);
+      }
+    }
+  } catch (...) {
+    sqlite3_exec(m_dbConnection.get(), "ROLLBACK", 0, 0, 0);
+    throw;
+  }
+
+  sqliteCode = sqlite3_exec(m_dbConnection.get(), "COMMIT", 0, 0, 0);
+  if (sqliteCode != SQLITE_OK) {
+    sqlite3_exec(m_dbConnection.get(), "ROLLBACK", 0, 0, 0);
+    throw SQLException(sqlite3_errstr(sqliteCode), __FILE__, __func__,
+                       __LINE__);
+  }
+
+  m_logDocCount += docIds.size();
+}
+
+void DeleteVector::MaybeCompactLog() {
+  if (m_logDocCount <
+      std::max(MinLogDocCountForCompaction, m_snapshotDocCount)) {
+    return;
+  }
+
+  // m_deletedDocIds is sorted so the snapshot is built in a single pass
+  m_deleteVecSerializationBitmap.Reset();
+  for (auto id : m_deletedDocIds) {
+    m_deleteVecSerializationBitmap.Add(id);
+  }
+
+  int sqliteCode = sqlite3_exec(m_dbConnection.get(), "BEGIN", 0, 0, 0);
+  if (sqliteCode != SQLITE_OK) {
+    return;
+  }
+
+  try {
+    StoreBitmap();
+
+    std::unique_ptr<sqlite3_stmt, void (*)(sqlite3_stmt*)> statementGuard(
+        m_clearLogStmt.get(), SQLiteUtils::ClearAndResetStatement);
+    sqliteCode = sqlite3_bind_text(m_clearLogStmt.get(), 1,
+                                   m_collectionName.c_str(), -1, SQLITE_STATIC);
+    SQLiteUtils::HandleSQLiteCode(sqliteCode);
+
+    sqliteCode = sqlite3_step(m_clearLogStmt.get());
+    if (sqliteCode != SQLITE_DONE) {
+      throw SQLException(sqlite3_errstr(sqliteCode), __FILE__, __func__,
+                         __LINE__);
+    }
+  } catch (...) {
+    // The deletes are already durable in the log, a failed compaction is
+    // simply retried after the next commit
+    sqlite3_exec(m_dbConnection.get(), "ROLLBACK", 0, 0, 0);
+    return;
+  }
+
+  if (sqlite3_exec(m_dbConnection.get(), "COMMIT", 0, 0, 0) != SQLITE_OK) {
+    sqlite3_exec(m_dbConnection.get(), "ROLLBACK", 0, 0, 0);
+    return;
+  }
+
+  m_snapshotDocCount = m_deletedDocIds.size();
+  m_logDocCount = 0;
+  EngineStats::Add(EngineCounter::DELETE_LOG_COMPACTIONS);
+}
+
 void DeleteVector::StoreBitmap() {
   // store bitmap persistently
   m_deleteVecSerializationBitmap.Serialize(m_bitmapBuffer);
@@ -177,8 +314,9 @@ void DeleteVector::LoadBitmap() {
       span<const char> s(data, length);
       m_deleteVecSerializationBitmap.Deserialize(type, version, s);
       for (auto docId : m_deleteVecSerializationBitmap) {
-        m_deletedDocIds.insert(docId);
+        m_deletedDocIds.insert(m_deletedDocIds.end(), docId);
       }
+      m_snapshotDocCount = m_deletedDocIds.size();
     }
   } else if (sqliteCode == SQLITE_DONE) {
     ostringstream ss;
@@ -190,6 +328,26 @@ void DeleteVector::LoadBitmap() {
   }
 }
 
+void DeleteVector::LoadLog() {
+  std::unique_ptr<sqlite3_stmt, void (*)(sqlite3_stmt*)> statementGuard(
+      m_selectLogStmt.get(), SQLiteUtils::ClearAndResetStatement);
+
+  int sqliteCode = sqlite3_bind_text(
+      m_selectLogStmt.get(), 1, m_collectionName.c_str(), -1, SQLITE_STATIC);
+  SQLiteUtils::HandleSQLiteCode(sqliteCode);
+
+  while ((sqliteCode = sqlite3_step(m_selectLogStmt.get())) == SQLITE_ROW) {
+    m_deletedDocIds.insert(
+        static_cast<uint64_t>(sqlite3_column_int64(m_selectLogStmt.get(), 0)));
+    m_logDocCount++;
+  }
+
+  if (sqliteCode != SQLITE_DONE) {
+    throw SQLException(sqlite3_errstr(sqliteCode), __FILE__, __func__,
+                       __LINE__);
+  }
+}
+
 void DeleteVector::InitializeTableAndStatements() {
   // create the necessary table if it does not exist
   string sql =
@@ -197,7 +355,11 @@ void DeleteVector::InitializeTableAndStatements() {
       "CollectionName TEXT PRIMARY KEY,"
       "DeleteVectorType INT,"
       "Version INT,"
-      "DeleteVectorData BLOB)";
+      "DeleteVectorData BLOB);"
+      "CREATE TABLE IF NOT EXISTS CollectionDeleteLog ("
+      "CollectionName TEXT,"
+      "DocumentID INTEGER,"
+      "PRIMARY KEY (CollectionName, DocumentID))";
 
   int sqliteCode = sqlite3_exec(m_dbConnection.get(), sql.c_str(), nullptr,
                                 nullptr, nullptr);
@@ -222,6 +384,30 @@ void DeleteVector::InitializeTableAndStatements() {
                          -1, &stmt, 0);
   m_selectStmt.reset(stmt);
   SQLiteUtils::HandleSQLiteCode(sqliteCode);
+
+  stmt = nullptr;
+  sqliteCode = sqlite3_prepare_v2(m_dbConnection.get(),
+                                  "INSERT INTO CollectionDeleteLog "
+                                  "(CollectionName, DocumentID) VALUES (?, ?)",
+                                  -1, &stmt, 0);
+  m_insertLogStmt.reset(stmt);
+  SQLiteUtils::HandleSQLiteCode(sqliteCode);
+
+  stmt = nullptr;
+  sqliteCode = sqlite3_prepare_v2(m_dbConnection.get(),
+                                  "SELECT DocumentID FROM CollectionDeleteLog "
+                                  "WHERE CollectionName = ?",
+                                  -1, &stmt, 0);
+  m_selectLogStmt.reset(stmt);
+  SQLiteUtils::HandleSQLiteCode(sqliteCode);
+
+  stmt = nullptr;
+  sqliteCode = sqlite3_prepare_v2(m_dbConnection.get(),
+                                  "DELETE FROM CollectionDeleteLog "
+                                  "WHERE CollectionName = ?",
+                                  -1, &stmt, 0);
+  m_clearLogStmt.reset(stmt);
+  SQLiteUtils::HandleSQLiteCode(sqliteCode);
 }
 
 int64_t DeleteVector::GetRowCount() {
@@ -1,40 +1,235 @@
 #include "document_collection.h"
+#include <algorithm>
 #include <boost/filesystem.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <map>
 #include <string>
 #include <unordered_map>
 #include "blob_manager.h"
 #include "buffer_impl.h"
+#include "bulk_import_impl.h"
+#include "column_aggregate.h"
 #include "constraint.h"
 #include "document.h"
 #include "document_factory.h"
 #include "document_schema.h"
 #include "document_schema_factory.h"
+#include "endian_utils.h"
+#include "engine_stats.h"
 #include "enums.h"
 #include "exception_utils.h"
+#include "field_accessor.h"
 #include "file_info.h"
 #include "filename_manager.h"
+#include "id_seq.h"
 #include "index_info_impl.h"
 #include "index_manager.h"
 #include "index_stat.h"
+#include "indexer.h"
+#include "indexer_factory.h"
 #include "jonoondb_api/delete_vector.h"
 #include "jonoondb_api/write_options_impl.h"
 #include "jonoondb_exceptions.h"
 #include "mama_jennies_bitmap.h"
+#include "memory_mapped_file.h"
+#include "query_profile.h"
 #include "sqlite3.h"
 #include "sqlite_utils.h"
 #include "string_utils.h"
+#include "thread_pool.h"
+#include "value_batch.h"
+#include "value_bitmap.h"
 
 using namespace jonoondb_api;
 using namespace boost::filesystem;
 
+namespace {
+// Inserts verify and encode the documents in chunks of this size, a batch
+// with more than one chunk is prepared by several threads
+const std::size_t InsertChunkSize = 1024;
+
+// A bulk import batch ends after this many bytes of documents even if it has
+// fewer documents than the batch size
+const std::size_t MaxImportBatchBytes = 64 * 1024 * 1024;
+
+// Creates, verifies and encodes the documents of a batch in chunks and
+// appends them to the data files. Tasks on the insert thread pool start on
+// the chunks when the writer is constructed. Write appends the chunks in
+// order and prepares the chunks no task has taken yet itself, so a batch
+// never waits for a pool that is busy with other batches. Appending is only
+// a copy, so the write lane is not held while we compress.
+class BatchWriter final {
+ public:
+  BatchWriter(const DocumentSchema& schema,
+              const gsl::span<const BufferImpl*>& documents,
+              const WriteOptionsImpl& wo, ThreadPool& threadPool)
+      : m_state(std::make_shared<State>(schema, documents, wo)) {
+    // This thread prepares chunks too, the pool only helps with the others
+    auto chunkCount = m_state->chunks.size();
+    auto taskCount = chunkCount > 1
+                         ? std::min(threadPool.GetThreadCount(), chunkCount - 1)
+                         : 0;
+    for (std::size_t t = 0; t < taskCount; t++) {
+      auto state = m_state;
+      threadPool.Submit([state] {
+        while (state->TryPrepareNextChunk()) {
+        }
+      });
+    }
+  }
+
+  ~BatchWriter() {
+    // Tasks that start after this don't touch the documents anymore
+    std::unique_lock<std::mutex> lock(m_state->mutex);
+    m_state->stop = true;
+    m_state->chunkReady.wait(lock, [&] { return m_state->running == 0; });
+  }
+
+  BatchWriter(const BatchWriter&) = delete;
+  BatchWriter& operator=(const BatchWriter&) = delete;
+
+  void Write(BlobManager& blobManager, BlobManager::PendingBatch& batch) {
+    auto& state = *m_state;
+    for (std::size_t c = 0; c < state.chunks.size(); c++) {
+      {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        while (!state.chunks[c].ready) {
+          if (state.nextChunk < state.chunks.size()) {
+            lock.unlock();
+            state.TryPrepareNextChunk();
+            lock.lock();
+          } else {
+            state.chunkReady.wait(lock);
+          }
+        }
+
+        if (state.chunks[c].error) {
+          std::rethrow_exception(state.chunks[c].error);
+        }
+      }
+
+      auto& blobs = state.chunks[c].blobs;
+      gsl::span<BlobMetadata> blobMetadata(
+          &state.blobMetadataVec[c * InsertChunkSize], blobs.GetCount());
+      blobManager.Append(blobs, blobMetadata, batch);
+      // The chunk is in the data file now
+      blobs = BlobManager::EncodedBlobs();
+    }
+  }
+
+  std::vector<std::unique_ptr<Document>>& GetDocuments() {
+    return m_state->docs;
+  }
+
+  std::vector<BlobMetadata>& GetBlobMetadata() {
+    return m_state->blobMetadataVec;
+  }
+
+ private:
+  struct Chunk {
+    BlobManager::EncodedBlobs blobs;
+    std::exception_ptr error;
+    bool ready = false;
+  };
+
+  // Shared with the pool tasks, a task can start after the writer is gone
+  struct State {
+    State(const DocumentSchema& schema,
+          const gsl::span<const BufferImpl*>& documents,
+          const WriteOptionsImpl& wo)
+        : schema(schema),
+          documents(documents),
+          wo(wo),
+          docs(documents.size()),
+          blobMetadataVec(documents.size()),
+          chunks((docs.size() + InsertChunkSize - 1) / InsertChunkSize) {}
+
+    // Returns false if there is no chunk left to prepare
+    bool TryPrepareNextChunk() {
+      std::size_t c;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stop || nextChunk >= chunks.size()) {
+          return false;
+        }
+        c = nextChunk++;
+        running++;
+      }
+
+      try {
+        PrepareChunk(c);
+      } catch (...) {
+        chunks[c].error = std::current_exception();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        chunks[c].ready = true;
+        running--;
+      }
+      chunkReady.notify_all();
+      return true;
+    }
+
+    void PrepareChunk(std::size_t c) {
+      auto end = std::min(docs.size(), (c + 1) * InsertChunkSize);
+      for (auto i = c * InsertChunkSize; i < end; i++) {
+        docs[i] = DocumentFactory::CreateDocument(schema, *documents[i]);
+        if (wo.verifyDocuments && !docs[i]->Verify()) {
+          std::ostringstream ss;
+          ss << "Document at index location " << i << " is not valid.";
+          throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
+        }
+        BlobManager::Encode(*documents[i], wo.compress, chunks[c].blobs);
+      }
+    }
+
+    const DocumentSchema& schema;
+    gsl::span<const BufferImpl*> documents;
+    WriteOptionsImpl wo;
+    std::vector<std::unique_ptr<Document>> docs;
+    std::vector<BlobMetadata> blobMetadataVec;
+    std::vector<Chunk> chunks;
+    std::mutex mutex;
+    // Signaled when a chunk is ready and when running drops
+    std::condition_variable chunkReady;
+    std::size_t nextChunk = 0;
+    // Chunks that are being prepared
+    std::size_t running = 0;
+    bool stop = false;
+  };
+
+  std::shared_ptr<State> m_state;
+};
+
+// Returns bitmap without the ids that are documentCount or bigger
+std::shared_ptr<const MamaJenniesBitmap> LimitToDocumentCount(
+    std::shared_ptr<const MamaJenniesBitmap> bitmap,
+    std::uint64_t documentCount) {
+  if (bitmap->GetSizeInBits() <= documentCount) {
+    return bitmap;
+  }
+
+  MamaJenniesBitmap visible;
+  visible.AddRange(0, documentCount);
+  auto result = std::make_shared<MamaJenniesBitmap>();
+  bitmap->LogicalAND(visible, *result);
+  return result;
+}
+}  // namespace
+
 DocumentCollection::DocumentCollection(
     const std::string& dbPath, const std::string& dbName,
     const std::string& name, SchemaType schemaType, const std::string& schema,
     const std::vector<IndexInfoImpl*>& indexes,
     std::unique_ptr<BlobManager> blobManager,
-    const std::vector<FileInfo>& dataFilesToLoad)
+    const std::vector<FileInfo>& dataFilesToLoad,
+    std::shared_ptr<ThreadPool> insertThreadPool)
     : m_blobManager(move(blobManager)),
-      m_dbConnection(nullptr, SQLiteUtils::CloseSQLiteConnection) {
+      m_dbConnection(nullptr, SQLiteUtils::CloseSQLiteConnection),
+      m_insertThreadPool(move(insertThreadPool)) {
   path normalizedPath;
   m_dbConnection = SQLiteUtils::NormalizePathAndCreateDBConnection(
       dbPath, dbName, false, normalizedPath);
@@ -43,19 +238,43 @@ DocumentCollection::DocumentCollection(
   m_documentSchema.reset(
       DocumentSchemaFactory::CreateDocumentSchema(schema, schemaType));
 
-  unordered_map<string, FieldType> columnTypes;
-  PopulateColumnTypes(indexes, *m_documentSchema.get(), columnTypes);
-  m_indexManager.reset(new IndexManager(indexes, columnTypes));
+  m_indexManager.reset(new IndexManager(indexes, *m_documentSchema));
 
-  // Load the data files
+  // Load the data files. Documents get their ids in the order they are in
+  // the files unless the collection was written with several write lanes,
+  // then batch markers in the files have the ids. Documents that come before
+  // the ones with smaller ids wait in pending until those are loaded.
+  std::map<std::uint64_t, BlobMetadata> pending;
+  std::uint64_t nextID = 0;
+  bool hasBatchMarkers = false;
   for (auto& file : dataFilesToLoad) {
-    BlobIterator iter(file);
+    BlobIterator iter(file, nextID);
     const std::size_t desiredBatchSize = 10000;
     std::vector<BufferImpl> blobs(desiredBatchSize);
     std::vector<BlobMetadata> blobMetadataVec(desiredBatchSize);
+    std::vector<std::uint64_t> documentIDs(desiredBatchSize);
     std::size_t actualBatchSize = 0;
 
-    while ((actualBatchSize = iter.GetNextBatch(blobs, blobMetadataVec)) > 0) {
+    while ((actualBatchSize = iter.GetNextBatch(blobs, blobMetadataVec,
+                                                documentIDs)) > 0) {
+      // The ids only go up within a file, so the batch has the next ids if
+      // its first and last documents have the right ones
+      auto startID = m_documentIDMap.size();
+      if (!pending.empty() || documentIDs[0] != startID ||
+          documentIDs[actualBatchSize - 1] != startID + actualBatchSize - 1) {
+        for (size_t i = 0; i < actualBatchSize; i++) {
+          if (documentIDs[i] < startID ||
+              !pending.emplace(documentIDs[i], blobMetadataVec[i]).second) {
+            std::ostringstream ss;
+            ss << "Document id " << documentIDs[i] << " of collection "
+               << m_name << " is in the data files more than once.";
+            throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
+          }
+        }
+        IndexPendingDocuments(pending);
+        continue;
+      }
+
       std::vector<std::unique_ptr<Document>> docs;
       for (size_t i = 0; i < actualBatchSize; i++) {
         // Todo optimize the creation of doc creation
@@ -64,53 +283,75 @@ DocumentCollection::DocumentCollection(
             DocumentFactory::CreateDocument(*m_documentSchema, blobs[i]));
       }
 
-      auto startID =
-          m_indexManager->IndexDocuments(m_documentIDGenerator, docs);
+      startID = m_indexManager->IndexDocuments(m_documentIDGenerator, docs);
       assert(startID == m_documentIDMap.size());
-      m_documentIDMap.insert(m_documentIDMap.end(), blobMetadataVec.begin(),
+      m_documentIDMap.append(blobMetadataVec.begin(),
                              blobMetadataVec.begin() + actualBatchSize);
     }
+
+    nextID = iter.GetNextDocumentID();
+    hasBatchMarkers = hasBatchMarkers || iter.HasBatchMarkers();
+  }
+
+  if (!pending.empty()) {
+    // Batches are committed in id order so this can't happen unless the
+    // files are damaged
+    std::ostringstream ss;
+    ss << "Documents of collection " << m_name << " with ids from "
+       << m_documentIDMap.size() << " to " << pending.begin()->first
+       << " are missing in the data files.";
+    throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
+  }
+
+  if (hasBatchMarkers) {
+    m_blobManager->EnableBatchMarkers();
   }
 
   m_deleteVector.reset(
       new DeleteVector(dbPath, dbName, m_name, false, m_documentIDMap.size()));
 }
 
-void DocumentCollection::Insert(const BufferImpl& documentData,
-                                const WriteOptionsImpl& wo) {
+std::uint64_t DocumentCollection::Insert(const BufferImpl& documentData,
+                                         const WriteOptionsImpl& wo) {
   std::vector<const BufferImpl*> vec = {&documentData};
   gsl::span<const BufferImpl*> span = vec;
-  MultiInsert(span, wo);
+  return MultiInsert(span, wo);
 }
 
-void jonoondb_api::DocumentCollection::MultiInsert(
+std::uint64_t jonoondb_api::DocumentCollection::MultiInsert(
     gsl::span<const BufferImpl*>& documents, const WriteOptionsImpl& wo) {
   if (documents.empty())
-    return;
-
-  std::vector<std::unique_ptr<Document>> docs;
-
-  for (size_t i = 0; i < documents.size(); i++) {
-    docs.push_back(
-        DocumentFactory::CreateDocument(*m_documentSchema, *documents[i]));
-    if (wo.verifyDocuments && !docs.back()->Verify()) {
-      ostringstream ss;
-      ss << "Document at index location " << i << " is not valid.";
-      throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
-    }
-  }
+    return GetDocumentCount();
+
+  LatencyTimer timer(EngineLatency::INSERT_BATCH);
+  // The blobs are written to a write lane before we take the insert lock, so
+  // batches on different lanes are compressed and flushed in parallel. The
+  // batches get their ids under the lock, in the order they are committed.
+  BatchWriter writer(*m_documentSchema, documents, wo, *m_insertThreadPool);
+  BlobManager::PendingBatch batch;
+  writer.Write(*m_blobManager, batch);
+  return CommitDocuments(writer.GetDocuments(), writer.GetBlobMetadata(),
+                         batch);
+}
 
+std::uint64_t DocumentCollection::CommitDocuments(
+    std::vector<std::unique_ptr<Document>>& docs,
+    std::vector<BlobMetadata>& blobMetadataVec,
+    BlobManager::PendingBatch& batch) {
+  std::lock_guard<std::mutex> lock(m_insertMutex);
   // Indexing should not fail after we have called ValidateForIndexing
   try {
     auto startID = m_indexManager->IndexDocuments(m_documentIDGenerator, docs);
     assert(startID == m_documentIDMap.size());
 
-    std::vector<BlobMetadata> blobMetadataVec(documents.size());
-    m_blobManager->MultiPut(documents, blobMetadataVec, wo.compress);
-    m_documentIDMap.insert(m_documentIDMap.end(), blobMetadataVec.begin(),
-                           blobMetadataVec.end());
-
+    m_blobManager->Commit(batch, startID);
+    // The delete vector has to cover the new documents before queries can
+    // see them. Appending to m_documentIDMap commits the documents, it moves
+    // the watermark returned by GetDocumentCount.
     m_deleteVector->OnDocumentsInserted(startID + docs.size());
+    m_documentIDMap.append(blobMetadataVec.begin(), blobMetadataVec.end());
+    EngineStats::Add(EngineCounter::DOCUMENTS_INSERTED, docs.size());
+    return startID;
   } catch (...) {
     // This is a serious error. Handling the exception at this point will leave
     // DB in a invalid state. Only sane thing we can do here is to log the error
@@ -119,10 +360,166 @@ void jonoondb_api::DocumentCollection::MultiInsert(
   }
 }
 
+void DocumentCollection::BulkImport(const std::string& filePath,
+                                    const BulkImportOptionsImpl& options,
+                                    BulkImportResultImpl& result) {
+  auto startTime = std::chrono::steady_clock::now();
+  if (!exists(filePath)) {
+    std::ostringstream ss;
+    ss << "File " << filePath << " does not exist.";
+    throw FileIOException(ss.str(), __FILE__, __func__, __LINE__);
+  }
+
+  result = BulkImportResultImpl();
+  auto fileSize = static_cast<std::size_t>(file_size(filePath));
+  if (fileSize == 0) {
+    return;
+  }
+
+  // The documents are read straight from the mapped file, each batch holds
+  // views over its documents until they are indexed
+  struct ImportBatch {
+    std::vector<BufferImpl> documents;
+    std::vector<const BufferImpl*> documentPtrs;
+    std::unique_ptr<BatchWriter> writer;
+    std::size_t beginOffset;
+    std::size_t endOffset;
+  };
+  MemoryMappedFile file(filePath, MemoryMappedFileMode::ReadOnly, 0, true);
+  auto swapSizes = options.bigEndianSizes == EndianUtils::IsLittleEndianMachine;
+  auto batchSize = std::max<std::size_t>(options.batchSize, 1);
+  std::size_t offset = 0;
+  auto readBatch = [&]() -> std::unique_ptr<ImportBatch> {
+    if (offset >= fileSize) {
+      return nullptr;
+    }
+
+    auto importBatch = std::make_unique<ImportBatch>();
+    importBatch->beginOffset = offset;
+    while (offset < fileSize && importBatch->documents.size() < batchSize &&
+           offset - importBatch->beginOffset < MaxImportBatchBytes) {
+      std::uint32_t size = 0;
+      if (fileSize - offset >= sizeof(size)) {
+        memcpy(&size, file.GetOffsetAddressAsCharPtr(offset), sizeof(size));
+        if (swapSizes) {
+          boost::endian::endian_reverse_inplace(size);
+        }
+      }
+      if (size == 0 || fileSize - offset - sizeof(size) < size) {
+        std::ostringstream ss;
+        ss << "File " << filePath << " has no valid document at offset "
+           << offset << ".";
+        throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
+      }
+
+      offset += sizeof(size);
+      importBatch->documents.emplace_back(
+          file.GetOffsetAddressAsCharPtr(offset), size, size, nullptr);
+      offset += size;
+    }
+    importBatch->endOffset = offset;
+
+    for (auto& document : importBatch->documents) {
+      importBatch->documentPtrs.push_back(&document);
+    }
+    gsl::span<const BufferImpl*> documents = importBatch->documentPtrs;
+    importBatch->writer = std::make_unique<BatchWriter>(
+        *m_documentSchema, documents, options.wo, *m_insertThreadPool);
+    // Start reading the pages of the batch after this one
+    file.Prefetch(offset, offset - importBatch->beginOffset);
+    return importBatch;
+  };
+
+  try {
+    auto current = readBatch();
+    while (current) {
+      BlobManager::PendingBatch batch(!options.syncEachBatch);
+      current->writer->Write(*m_blobManager, batch);
+
+      // The workers prepare the next batch while we index this one. If the
+      // next batch is bad we still commit this one.
+      std::unique_ptr<ImportBatch> next;
+      std::exception_ptr readError;
+      try {
+        next = readBatch();
+      } catch (...) {
+        readError = std::current_exception();
+      }
+
+      CommitDocuments(current->writer->GetDocuments(),
+                      current->writer->GetBlobMetadata(), batch);
+      result.documentCount += current->documents.size();
+      auto beginOffset = current->beginOffset;
+      auto endOffset = current->endOffset;
+      current = std::move(next);
+      // The documents are in the data files and indexes, we don't need their
+      // pages anymore
+      file.Release(beginOffset, endOffset - beginOffset);
+      if (readError) {
+        std::rethrow_exception(readError);
+      }
+    }
+  } catch (...) {
+    // Persist the batches that were committed before the failure
+    m_blobManager->SyncDeferred();
+    throw;
+  }
+
+  m_blobManager->SyncDeferred();
+  result.byteCount = fileSize;
+  result.elapsedNanoseconds =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - startTime)
+          .count();
+}
+
+void DocumentCollection::CreateIndex(const IndexInfoImpl& indexInfo) {
+  if (m_indexManager->IndexExists(indexInfo.GetIndexName())) {
+    std::ostringstream ss;
+    ss << "Index with name " << indexInfo.GetIndexName() << " already exists.";
+    throw IndexAlreadyExistException(ss.str(), __FILE__, __func__, __LINE__);
+  }
+
+  std::unique_ptr<Indexer> indexer(
+      IndexerFactory::CreateIndexer(indexInfo, *m_documentSchema));
+
+  // Index the existing documents in batches. The insert lock is only held
+  // while we copy the metadata of the next batch, so inserts keep flowing
+  // while we read and index the documents. Once the remaining tail is small
+  // we index it while holding the lock and publish the index atomically.
+  const std::size_t batchSize = 10000;
+  std::uint64_t nextID = 0;
+  std::vector<BlobMetadata> blobs;
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(m_insertMutex);
+      auto lastID = m_documentIDMap.size();
+      auto count = std::min<std::uint64_t>(lastID - nextID, batchSize);
+      blobs.clear();
+      for (std::uint64_t id = nextID; id < nextID + count; id++) {
+        blobs.push_back(m_documentIDMap[id]);
+      }
+
+      if (lastID - nextID <= batchSize) {
+        IndexExistingDocuments(*indexer, nextID, blobs);
+        m_indexManager->AddIndexer(move(indexer));
+        return;
+      }
+    }
+
+    IndexExistingDocuments(*indexer, nextID, blobs);
+    nextID += blobs.size();
+  }
+}
+
 const std::string& DocumentCollection::GetName() {
   return m_name;
 }
 
+std::uint64_t DocumentCollection::GetDocumentCount() const {
+  return m_documentIDMap.size();
+}
+
 const std::shared_ptr<DocumentSchema>& DocumentCollection::GetDocumentSchema() {
   return m_documentSchema;
 }
@@ -133,29 +530,45 @@ bool DocumentCollection::TryGetBestIndex(const std::string& columnName,
   return m_indexManager->TryGetBestIndex(columnName, op, indexStat);
 }
 
-std::shared_ptr<MamaJenniesBitmap> DocumentCollection::Filter(
-    const std::vector<Constraint>& constraints) {
-  auto bitmap = std::make_shared<MamaJenniesBitmap>();
+std::shared_ptr<const MamaJenniesBitmap> DocumentCollection::Filter(
+    const std::vector<Constraint>& constraints, std::uint64_t documentCount) {
+  // Inserts index a document before they commit it, so the indexes can
+  // already have ids above the watermark
+  std::shared_ptr<const MamaJenniesBitmap> bitmap;
   if (constraints.size() > 0) {
-    bitmap = m_indexManager->Filter(constraints);
+    bitmap = LimitToDocumentCount(m_indexManager->Filter(constraints),
+                                  documentCount);
   } else {
     // Return all the ids
-    auto lastID = m_documentIDMap.size();
-    for (std::size_t i = 0; i < lastID; i++) {
-      bitmap->Add(i);
-    }
+    auto allIDs = std::make_shared<MamaJenniesBitmap>();
+    allIDs->AddRange(0, documentCount);
+    bitmap = std::move(allIDs);
   }
 
-  if (m_deleteVector->GetDeleteVectorBitmap().Empty()) {
+  if (!m_deleteVector->HasDeletes()) {
     return bitmap;
   } else {
     auto resultWithDelVector = std::make_shared<MamaJenniesBitmap>();
-    bitmap->LogicalAND(m_deleteVector->GetDeleteVectorBitmap(),
+    bitmap->LogicalAND(*m_deleteVector->GetDeleteVectorBitmap(),
                        *resultWithDelVector.get());
     return resultWithDelVector;
   }
 }
 
+std::unique_ptr<IDSequence> DocumentCollection::Scan(
+    int vecSize, std::uint64_t documentCount) {
+  if (!m_deleteVector->HasDeletes()) {
+    return std::make_unique<IDSequence>(documentCount, vecSize);
+  }
+
+  // The snapshot is never changed, but it can cover documents above the
+  // watermark
+  return std::make_unique<IDSequence>(
+      LimitToDocumentCount(m_deleteVector->GetDeleteVectorBitmap(),
+                           documentCount),
+      vecSize);
+}
+
 void DocumentCollection::GetDocumentAndBuffer(
     std::uint64_t docID, std::unique_ptr<Document>& document,
     BufferImpl& buffer) const {
@@ -166,12 +579,44 @@ void DocumentCollection::GetDocumentAndBuffer(
     throw MissingDocumentException(ss.str(), __FILE__, __func__, __LINE__);
   }
 
-  m_blobManager->Get(m_documentIDMap.at(docID), buffer);
+  m_blobManager->Get(m_documentIDMap[docID], buffer);
   document = DocumentFactory::CreateDocument(*m_documentSchema, buffer);
 }
 
+void DocumentCollection::GetDocumentsAndBuffers(
+    const gsl::span<std::uint64_t>& docIDs,
+    std::vector<std::unique_ptr<Document>>& documents,
+    std::vector<BufferImpl>& buffers) const {
+  auto profile = QueryProfile::Current();
+  StageTimer timer(profile ? &profile->fetchTime : nullptr);
+  if (profile) {
+    profile->documentsFetched += docIDs.size();
+    profile->fetchBatches++;
+  }
+
+  std::vector<BlobMetadata> blobMetadataVec;
+  blobMetadataVec.reserve(docIDs.size());
+  for (auto docID : docIDs) {
+    if (docID >= m_documentIDMap.size()) {
+      ostringstream ss;
+      ss << "Document with ID '" << docID << "' does not exist in collection "
+         << m_name << ".";
+      throw MissingDocumentException(ss.str(), __FILE__, __func__, __LINE__);
+    }
+    blobMetadataVec.push_back(m_documentIDMap[docID]);
+  }
+
+  m_blobManager->MultiGet(blobMetadataVec, buffers);
+  documents.resize(docIDs.size());
+  for (std::size_t i = 0; i < documents.size(); i++) {
+    documents[i] = DocumentFactory::CreateDocument(*m_documentSchema,
+                                                   buffers[i]);
+  }
+}
+
 bool DocumentCollection::TryGetBlobFieldFromIndexer(
-    std::uint64_t docID, const std::string& columnName, BufferImpl& val) const {
+    std::uint64_t docID, const std::string& columnName, const char*& val,
+    std::size_t& size) const {
   if (docID >= m_documentIDMap.size()) {
     ostringstream ss;
     ss << "Document with ID '" << docID << "' does exist in collection "
@@ -180,7 +625,7 @@ bool DocumentCollection::TryGetBlobFieldFromIndexer(
   }
 
   // lets see if we can get this value from any index
-  if (m_indexManager->TryGetBlobValue(docID, columnName, val)) {
+  if (m_indexManager->TryGetBlobValue(docID, columnName, val, size)) {
     return true;
   }
 
@@ -223,8 +668,8 @@ bool DocumentCollection::TryGetFloatFieldFromIndexer(
 }
 
 bool DocumentCollection::TryGetStringFieldFromIndexer(
-    std::uint64_t docID, const std::string& columnName,
-    std::string& val) const {
+    std::uint64_t docID, const std::string& columnName, const char*& val,
+    std::size_t& size) const {
   if (docID >= m_documentIDMap.size()) {
     ostringstream ss;
     ss << "Document with ID '" << docID << "' does exist in collection "
@@ -233,7 +678,7 @@ bool DocumentCollection::TryGetStringFieldFromIndexer(
   }
 
   // lets see if we can get this value from any index
-  if (m_indexManager->TryGetStringValue(docID, columnName, val)) {
+  if (m_indexManager->TryGetStringValue(docID, columnName, val, size)) {
     return true;
   }
 
@@ -241,89 +686,112 @@ bool DocumentCollection::TryGetStringFieldFromIndexer(
 }
 
 void DocumentCollection::GetDocumentFieldsAsIntegerVector(
-    const gsl::span<std::uint64_t>& docIDs, const std::string& columnName,
-    const std::vector<std::string>& tokens,
+    const gsl::span<std::uint64_t>& docIDs, const FieldAccessor& fieldAccessor,
     std::vector<std::int64_t>& values) const {
-  if (tokens.size() == 0) {
-    throw InvalidArgumentException("Argument tokens is empty.", __FILE__, "",
-                                   __LINE__);
-  }
-
-  if (m_indexManager->TryGetIntegerVector(docIDs, columnName, values)) {
+  if (m_indexManager->TryGetIntegerVector(
+          docIDs, fieldAccessor.GetFieldName(), values)) {
     // We have the values
     return;
   }
 
-  BufferImpl buffer;
   assert(docIDs.size() == values.size());
-  std::unique_ptr<Document> subDoc;
+  std::vector<std::unique_ptr<Document>> documents;
+  std::vector<BufferImpl> buffers;
+  GetDocumentsAndBuffers(docIDs, documents, buffers);
   for (int i = 0; i < docIDs.size(); i++) {
-    if (docIDs[i] >= m_documentIDMap.size()) {
-      ostringstream ss;
-      ss << "Document with ID '" << docIDs[i] << "' does exist in collection "
-         << m_name << ".";
-      throw MissingDocumentException(ss.str(), __FILE__, __func__, __LINE__);
-    }
-
-    m_blobManager->Get(m_documentIDMap.at(docIDs[i]), buffer);
-
-    auto document = DocumentFactory::CreateDocument(*m_documentSchema, buffer);
-    if (!subDoc) {
-      subDoc = document->AllocateSubDocument();
-    }
-    values[i] = DocumentUtils::GetIntegerValue(*document.get(), subDoc, tokens);
+    auto& document = documents[i];
+    values[i] = fieldAccessor.GetIntegerValue(*document);
   }
 }
 
 void DocumentCollection::GetDocumentFieldsAsDoubleVector(
-    const gsl::span<std::uint64_t>& docIDs, const std::string& columnName,
-    const std::vector<std::string>& tokens, std::vector<double>& values) const {
-  if (tokens.size() == 0) {
-    throw InvalidArgumentException("Argument tokens is empty.", __FILE__, "",
-                                   __LINE__);
-  }
-
-  if (m_indexManager->TryGetDoubleVector(docIDs, columnName, values)) {
+    const gsl::span<std::uint64_t>& docIDs, const FieldAccessor& fieldAccessor,
+    std::vector<double>& values) const {
+  if (m_indexManager->TryGetDoubleVector(
+          docIDs, fieldAccessor.GetFieldName(), values)) {
     // We have the values
     return;
   }
 
-  BufferImpl buffer;
   assert(docIDs.size() == values.size());
-  std::unique_ptr<Document> subDoc;
+  std::vector<std::unique_ptr<Document>> documents;
+  std::vector<BufferImpl> buffers;
+  GetDocumentsAndBuffers(docIDs, documents, buffers);
   for (int i = 0; i < docIDs.size(); i++) {
-    if (docIDs[i] >= m_documentIDMap.size()) {
-      ostringstream ss;
-      ss << "Document with ID '" << docIDs[i]
-         << "' does not exist in collection " << m_name << ".";
-      throw MissingDocumentException(ss.str(), __FILE__, __func__, __LINE__);
-    }
+    auto& document = documents[i];
+    values[i] = fieldAccessor.GetFloatValue(*document);
+  }
+}
 
-    m_blobManager->Get(m_documentIDMap.at(docIDs[i]), buffer);
+bool DocumentCollection::TryGetStringVectorFromIndexer(
+    const gsl::span<std::uint64_t>& docIDs, const std::string& columnName,
+    ValueBatch& values) const {
+  return m_indexManager->TryGetStringVector(docIDs, columnName, values);
+}
 
-    auto document = DocumentFactory::CreateDocument(*m_documentSchema, buffer);
-    if (!subDoc) {
-      subDoc = document->AllocateSubDocument();
-    }
-    values[i] = DocumentUtils::GetFloatValue(*document.get(), subDoc, tokens);
-  }
+bool DocumentCollection::TryGetBlobVectorFromIndexer(
+    const gsl::span<std::uint64_t>& docIDs, const std::string& columnName,
+    ValueBatch& values) const {
+  return m_indexManager->TryGetBlobVector(docIDs, columnName, values);
+}
+
+bool DocumentCollection::TryAggregateFromIndexer(
+    const MamaJenniesBitmap& docIDs, const std::string& columnName,
+    ColumnAggregate& aggregate) const {
+  return m_indexManager->TryAggregate(docIDs, columnName, aggregate);
+}
+
+bool DocumentCollection::TryGetValueBitmapsFromIndexer(
+    const std::string& columnName,
+    std::vector<ValueBitmap>& valueBitmaps) const {
+  return m_indexManager->TryGetValueBitmaps(columnName, valueBitmaps);
 }
 
 void DocumentCollection::UnmapLRUDataFiles() {
   m_blobManager->UnmapLRUDataFiles();
 }
 
-void DocumentCollection::AddToDeleteVector(std::uint64_t docId) {
-  m_deleteVector->OnDocumentDeleted(docId);
+void DocumentCollection::AddToDeleteVector(
+    const std::vector<std::uint64_t>& ids) {
+  m_deleteVector->OnDocumentsDeleted(ids);
 }
 
-void DocumentCollection::PopulateColumnTypes(
-    const std::vector<IndexInfoImpl*>& indexes,
-    const DocumentSchema& documentSchema,
-    std::unordered_map<string, FieldType>& columnTypes) {
-  for (std::size_t i = 0; i < indexes.size(); i++) {
-    columnTypes.insert(pair<string, FieldType>(
-        indexes[i]->GetColumnName(),
-        documentSchema.GetFieldType(indexes[i]->GetColumnName())));
+void DocumentCollection::IndexPendingDocuments(
+    std::map<std::uint64_t, BlobMetadata>& pending) {
+  const std::size_t batchSize = 10000;
+  std::vector<BlobMetadata> blobMetadataVec;
+  std::vector<BufferImpl> blobs;
+  while (!pending.empty() && pending.begin()->first == m_documentIDMap.size()) {
+    // Take the run of consecutive ids at the start of pending
+    blobMetadataVec.clear();
+    auto iter = pending.begin();
+    while (iter != pending.end() && blobMetadataVec.size() < batchSize &&
+           iter->first == m_documentIDMap.size() + blobMetadataVec.size()) {
+      blobMetadataVec.push_back(iter->second);
+      iter = pending.erase(iter);
+    }
+
+    m_blobManager->MultiGet(blobMetadataVec, blobs);
+    std::vector<std::unique_ptr<Document>> docs;
+    for (size_t i = 0; i < blobMetadataVec.size(); i++) {
+      docs.push_back(
+          DocumentFactory::CreateDocument(*m_documentSchema, blobs[i]));
+    }
+
+    auto startID = m_indexManager->IndexDocuments(m_documentIDGenerator, docs);
+    assert(startID == m_documentIDMap.size());
+    m_documentIDMap.append(blobMetadataVec.begin(), blobMetadataVec.end());
+  }
+}
+
+void DocumentCollection::IndexExistingDocuments(
+    Indexer& indexer, std::uint64_t startID,
+    const std::vector<BlobMetadata>& blobs) {
+  BufferImpl buffer;
+  for (std::size_t i = 0; i < blobs.size(); i++) {
+    m_blobManager->Get(blobs[i], buffer);
+    auto document = DocumentFactory::CreateDocument(*m_documentSchema, buffer);
+    indexer.Insert(startID + i, *document);
   }
+  indexer.PublishInserts();
 }
@@ -0,0 +1,142 @@
+#include "engine_stats.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+using namespace jonoondb_api;
+
+namespace {
+const std::size_t ShardCount = 16;
+// Bucket 0 counts samples of 0ns, bucket i samples in [2^(i-1), 2^i) ns
+const std::size_t BucketCount = 64;
+const std::size_t CounterCount =
+    static_cast<std::size_t>(EngineCounter::COUNT);
+const std::size_t LatencyCount =
+    static_cast<std::size_t>(EngineLatency::COUNT);
+
+const char* CounterNames[CounterCount] = {
+    "documents_inserted",       "documents_fetched",
+    "bytes_decompressed",       "data_file_switches",
+    "data_file_cache_hits",     "data_file_cache_misses",
+    "memory_watcher_evictions", "delete_vector_rebuilds",
+    "delete_vector_patches",    "delete_log_compactions",
+    "connection_pool_misses"};
+
+const char* LatencyNames[LatencyCount] = {"insert_batch", "msync",
+                                          "decompression",
+                                          "connection_pool_wait"};
+
+struct Histogram {
+  std::array<std::atomic<std::uint64_t>, BucketCount> buckets;
+  std::atomic<std::uint64_t> totalNanoseconds;
+  std::atomic<std::uint64_t> maxNanoseconds;
+};
+
+// Shards are cache line aligned so threads using different shards don't
+// contend on the same lines
+struct alignas(64) Shard {
+  std::array<std::atomic<std::uint64_t>, CounterCount> counters;
+  std::array<Histogram, LatencyCount> histograms;
+};
+
+// Zero initialized because it has static storage duration
+Shard s_shards[ShardCount];
+std::atomic<std::size_t> s_nextShard(0);
+
+Shard& GetThreadShard() {
+  static thread_local Shard* shard =
+      &s_shards[s_nextShard.fetch_add(1, std::memory_order_relaxed) %
+                ShardCount];
+  return *shard;
+}
+
+std::size_t GetBucket(std::uint64_t nanoseconds) {
+  std::size_t bucket = 0;
+  while (nanoseconds > 0 && bucket < BucketCount - 1) {
+    nanoseconds >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+std::uint64_t GetBucketUpperBound(std::size_t bucket) {
+  return bucket == 0 ? 0 : (std::uint64_t(1) << bucket) - 1;
+}
+
+// Returns the upper bound of the bucket holding the sample at percentile
+std::uint64_t GetPercentile(
+    const std::array<std::uint64_t, BucketCount>& buckets,
+    std::uint64_t count, std::uint64_t percentile) {
+  if (count == 0) {
+    return 0;
+  }
+
+  // The rank of the sample, rounded up
+  std::uint64_t rank = (count * percentile + 99) / 100;
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < BucketCount; i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return GetBucketUpperBound(i);
+    }
+  }
+  return GetBucketUpperBound(BucketCount - 1);
+}
+}  // namespace
+
+void EngineStats::Add(EngineCounter counter, std::uint64_t value) {
+  GetThreadShard()
+      .counters[static_cast<std::size_t>(counter)]
+      .fetch_add(value, std::memory_order_relaxed);
+}
+
+void EngineStats::Record(EngineLatency latency,
+                         std::chrono::nanoseconds duration) {
+  auto nanoseconds = static_cast<std::uint64_t>(
+      duration.count() < 0 ? 0 : duration.count());
+  auto& histogram =
+      GetThreadShard().histograms[static_cast<std::size_t>(latency)];
+  histogram.buckets[GetBucket(nanoseconds)].fetch_add(
+      1, std::memory_order_relaxed);
+  histogram.totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+  auto max = histogram.maxNanoseconds.load(std::memory_order_relaxed);
+  while (nanoseconds > max &&
+         !histogram.maxNanoseconds.compare_exchange_weak(
+             max, nanoseconds, std::memory_order_relaxed)) {
+  }
+}
+
+std::vector<EngineStat> EngineStats::GetStats() {
+  std::vector<EngineStat> stats;
+  for (std::size_t i = 0; i < CounterCount; i++) {
+    EngineStat stat = {CounterNames[i], false, 0, 0, 0, 0, 0};
+    for (auto& shard : s_shards) {
+      stat.count += shard.counters[i].load(std::memory_order_relaxed);
+    }
+    stats.push_back(stat);
+  }
+
+  for (std::size_t i = 0; i < LatencyCount; i++) {
+    EngineStat stat = {LatencyNames[i], true, 0, 0, 0, 0, 0};
+    std::array<std::uint64_t, BucketCount> buckets = {};
+    for (auto& shard : s_shards) {
+      auto& histogram = shard.histograms[i];
+      for (std::size_t j = 0; j < BucketCount; j++) {
+        auto samples = histogram.buckets[j].load(std::memory_order_relaxed);
+        buckets[j] += samples;
+        stat.count += samples;
+      }
+      stat.totalNanoseconds +=
+          histogram.totalNanoseconds.load(std::memory_order_relaxed);
+      stat.maxNanoseconds = std::max(
+          stat.maxNanoseconds,
+          histogram.maxNanoseconds.load(std::memory_order_relaxed));
+    }
+    stat.p50Nanoseconds = GetPercentile(buckets, stat.count, 50);
+    stat.p99Nanoseconds = GetPercentile(buckets, stat.count, 99);
+    stats.push_back(stat);
+  }
+
+  return stats;
+}
@@ -8,6 +8,7 @@
 #include "jonoondb_api/exception_utils.h"
 #include "jonoondb_api/field.h"
 #include "jonoondb_api/flatbuffers_field.h"
+#include "jonoondb_api/flatbuffers_field_accessor.h"
 #include "jonoondb_api/jonoondb_exceptions.h"
 #include "jonoondb_api/string_utils.h"
 
@@ -119,6 +120,17 @@ Field* FlatbuffersDocumentSchema::AllocateField() const {
   return new FlatbuffersField();
 }
 
+std::unique_ptr<FieldAccessor> FlatbuffersDocumentSchema::CreateFieldAccessor(
+    const std::string& fieldName) const {
+  if (fieldName == "_document") {
+    return std::make_unique<FlatbuffersFieldAccessor>(*m_schema, fieldName,
+                                                      FieldType::BLOB);
+  }
+
+  return std::make_unique<FlatbuffersFieldAccessor>(*m_schema, fieldName,
+                                                    GetFieldType(fieldName));
+}
+
 FieldType FlatbuffersDocumentSchema::MapFlatbuffersToJonoonDBType(
     reflection::BaseType flatbuffersType) {
   switch (flatbuffersType) {
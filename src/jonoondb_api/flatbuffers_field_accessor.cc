@@ -0,0 +1,280 @@
+#include "flatbuffers_field_accessor.h"
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include "buffer_impl.h"
+#include "document.h"
+#include "exception_utils.h"
+#include "field.h"
+#include "jonoondb_exceptions.h"
+#include "null_helpers.h"
+#include "string_utils.h"
+
+using namespace std;
+using namespace jonoondb_api;
+using namespace flatbuffers;
+
+static inline int64_t ReadInteger(reflection::BaseType type,
+                                  const uint8_t* data) {
+  switch (type) {
+    case reflection::UType:
+    case reflection::Bool:
+    case reflection::UByte:
+      return ReadScalar<uint8_t>(data);
+    case reflection::Byte:
+      return ReadScalar<int8_t>(data);
+    case reflection::Short:
+      return ReadScalar<int16_t>(data);
+    case reflection::UShort:
+      return ReadScalar<uint16_t>(data);
+    case reflection::Int:
+      return ReadScalar<int32_t>(data);
+    case reflection::UInt:
+      return ReadScalar<uint32_t>(data);
+    case reflection::Long:
+      return ReadScalar<int64_t>(data);
+    default:
+      return GetAnyValueI(type, data);
+  }
+}
+
+static inline double ReadFloat(reflection::BaseType type,
+                               const uint8_t* data) {
+  switch (type) {
+    case reflection::Float:
+      return ReadScalar<float>(data);
+    case reflection::Double:
+      return ReadScalar<double>(data);
+    default:
+      return GetAnyValueF(type, data);
+  }
+}
+
+FlatbuffersFieldAccessor::FlatbuffersFieldAccessor(
+    const reflection::Schema& schema, const std::string& fieldName,
+    FieldType fieldType)
+    : m_fieldName(fieldName), m_fieldType(fieldType) {
+  if (fieldName == "_document") {
+    // Hidden column that represents the whole document
+    m_isDocument = true;
+    return;
+  }
+
+  auto tokens = StringUtils::Split(fieldName, ".");
+  if (tokens.size() == 0) {
+    throw InvalidArgumentException("Argument fieldName is empty.", __FILE__,
+                                   __func__, __LINE__);
+  }
+
+  auto obj = schema.root_table();
+  for (size_t i = 0; i < tokens.size() - 1; i++) {
+    auto fieldDef = obj->fields()->LookupByKey(tokens[i].c_str());
+    if (fieldDef == nullptr) {
+      throw JonoonDBException(
+          ExceptionUtils::GetMissingFieldErrorString(tokens[i]), __FILE__,
+          __func__, __LINE__);
+    }
+
+    if (fieldDef->type()->base_type() != reflection::BaseType::Obj) {
+      throw JonoonDBException(
+          ExceptionUtils::GetInvalidStructFieldErrorString(tokens[i],
+                                                           fieldName),
+          __FILE__, __func__, __LINE__);
+    }
+
+    obj = schema.objects()->Get(fieldDef->type()->index());
+    m_path.push_back(PathStep{fieldDef->offset(), obj->is_struct() != 0});
+  }
+
+  auto fieldDef = obj->fields()->LookupByKey(tokens.back().c_str());
+  if (fieldDef == nullptr) {
+    throw JonoonDBException(
+        ExceptionUtils::GetMissingFieldErrorString(fieldName), __FILE__,
+        __func__, __LINE__);
+  }
+
+  m_offset = fieldDef->offset();
+  m_baseType = fieldDef->type()->base_type();
+  m_elementType = fieldDef->type()->element();
+  m_defaultInteger = fieldDef->default_integer();
+  m_defaultReal = fieldDef->default_real();
+}
+
+const std::string& FlatbuffersFieldAccessor::GetFieldName() const {
+  return m_fieldName;
+}
+
+FieldType FlatbuffersFieldAccessor::GetFieldType() const {
+  return m_fieldType;
+}
+
+std::int64_t FlatbuffersFieldAccessor::GetIntegerValue(
+    const Document& document) const {
+  if (m_isDocument || m_baseType == reflection::BaseType::Obj ||
+      m_baseType == reflection::BaseType::Vector ||
+      m_baseType == reflection::BaseType::Union) {
+    ThrowInvalidConversion("a 64 bit integer");
+  }
+
+  const Table* table;
+  const uint8_t* structure;
+  if (!TryGetParent(document, table, structure)) {
+    return JONOONDB_NULL_INT64;
+  }
+
+  if (structure) {
+    return ReadInteger(m_baseType, structure + m_offset);
+  }
+
+  auto fieldPtr = table->GetAddressOf(m_offset);
+  return fieldPtr ? ReadInteger(m_baseType, fieldPtr) : m_defaultInteger;
+}
+
+double FlatbuffersFieldAccessor::GetFloatValue(const Document& document) const {
+  if (m_isDocument || m_baseType == reflection::BaseType::Obj ||
+      m_baseType == reflection::BaseType::Vector ||
+      m_baseType == reflection::BaseType::Union) {
+    ThrowInvalidConversion("a 64 bit floating value");
+  }
+
+  const Table* table;
+  const uint8_t* structure;
+  if (!TryGetParent(document, table, structure)) {
+    return JONOONDB_NULL_DOUBLE;
+  }
+
+  if (structure) {
+    return ReadFloat(m_baseType, structure + m_offset);
+  }
+
+  auto fieldPtr = table->GetAddressOf(m_offset);
+  return fieldPtr ? ReadFloat(m_baseType, fieldPtr) : m_defaultReal;
+}
+
+std::string FlatbuffersFieldAccessor::GetStringValue(
+    const Document& document) const {
+  std::size_t size;
+  auto str = GetStringValue(document, size);
+  if (str == nullptr) {
+    return JONOONDB_NULL_STR;
+  }
+
+  return std::string(str, size);
+}
+
+const char* FlatbuffersFieldAccessor::GetStringValue(const Document& document,
+                                                     std::size_t& size) const {
+  if (m_isDocument || m_baseType != reflection::BaseType::String) {
+    ThrowInvalidConversion("string");
+  }
+
+  size = 0;
+  const Table* table;
+  const uint8_t* structure;
+  // strings can only occur in tables so no need to handle structs here
+  if (!TryGetParent(document, table, structure)) {
+    return nullptr;
+  }
+
+  auto str = table->GetPointer<const String*>(m_offset);
+  if (str == nullptr) {
+    return nullptr;
+  }
+
+  size = str->size();
+  return str->c_str();
+}
+
+const char* FlatbuffersFieldAccessor::GetBlobValue(const Document& document,
+                                                   std::size_t& size) const {
+  if (m_isDocument) {
+    auto buffer = document.GetRawBuffer();
+    size = buffer->GetLength();
+    return buffer->GetData();
+  }
+
+  if (m_baseType != reflection::BaseType::Vector ||
+      (m_elementType != reflection::BaseType::Byte &&
+       m_elementType != reflection::BaseType::UByte)) {
+    ThrowInvalidConversion("blob");
+  }
+
+  size = 0;
+  const Table* table;
+  const uint8_t* structure;
+  // vectors can only occur in tables so no need to handle structs
+  if (!TryGetParent(document, table, structure)) {
+    return nullptr;
+  }
+
+  auto vec = table->GetPointer<const Vector<char>*>(m_offset);
+  if (vec == nullptr) {
+    return nullptr;
+  }
+
+  size = vec->size();
+  return vec->data();
+}
+
+bool FlatbuffersFieldAccessor::IsNull(const Document& document) const {
+  if (m_isDocument) {
+    return false;
+  }
+
+  const Table* table;
+  const uint8_t* structure;
+  if (!TryGetParent(document, table, structure)) {
+    return true;
+  }
+
+  if (structure) {
+    return false;
+  }
+
+  switch (m_baseType) {
+    case reflection::BaseType::String:
+    case reflection::BaseType::Vector:
+    case reflection::BaseType::Obj:
+    case reflection::BaseType::Union:
+      return table->GetAddressOf(m_offset) == nullptr;
+    default:
+      // Missing scalars have the default value from the schema
+      return false;
+  }
+}
+
+bool FlatbuffersFieldAccessor::TryGetParent(
+    const Document& document, const flatbuffers::Table*& table,
+    const std::uint8_t*& structure) const {
+  table = GetAnyRoot(
+      reinterpret_cast<const uint8_t*>(document.GetRawBuffer()->GetData()));
+  structure = nullptr;
+  for (auto& step : m_path) {
+    if (structure) {
+      // struct nested in a struct, offset is the byte offset in the parent
+      structure += step.offset;
+    } else if (step.isStruct) {
+      structure = table->GetStruct<const uint8_t*>(step.offset);
+      if (structure == nullptr) {
+        return false;
+      }
+    } else {
+      table = table->GetPointer<const Table*>(step.offset);
+      if (table == nullptr) {
+        // this means that this nested field is null
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+void FlatbuffersFieldAccessor::ThrowInvalidConversion(
+    const char* targetType) const {
+  std::ostringstream ss;
+  ss << "Field " << m_fieldName << " has FieldType "
+     << GetFieldString(m_fieldType)
+     << " and it cannot be safely converted into " << targetType << ".";
+  throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
+}
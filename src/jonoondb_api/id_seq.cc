@@ -3,31 +3,41 @@
 using namespace jonoondb_api;
 using namespace gsl;
 
-IDSequence::IDSequence(std::shared_ptr<MamaJenniesBitmap> bitmap, int vecSize)
-    : m_bitmap(move(bitmap)) {
+IDSequence::IDSequence(std::shared_ptr<const MamaJenniesBitmap> bitmap,
+                       int vecSize)
+    : m_bitmap(move(bitmap)), m_nextID(0), m_idCount(0) {
   m_currentVector.resize(vecSize);
   m_currentSpan = span<std::uint64_t>(m_currentVector.data(), 0);
   m_iter = m_bitmap->begin_pointer();
   m_end = m_bitmap->end_pointer();
 }
 
+IDSequence::IDSequence(std::uint64_t idCount, int vecSize)
+    : m_nextID(0), m_idCount(idCount) {
+  m_currentVector.resize(vecSize);
+  m_currentSpan = span<std::uint64_t>(m_currentVector.data(), 0);
+}
+
 const span<std::uint64_t>& IDSequence::Current() {
   return m_currentSpan;
 }
 
 bool IDSequence::Next() {
-  if (*(m_iter) >= *(m_end)) {
-    m_currentSpan = span<std::uint64_t>(m_currentVector.data(), 0);
-    return false;
-  }
-
   int index = 0;
-  while (index < m_currentVector.size() && *(m_iter) < *(m_end)) {
-    m_currentVector[index] = m_iter->operator*();
-    ++(*m_iter);
-    index++;
+  if (m_bitmap) {
+    while (index < m_currentVector.size() && *(m_iter) < *(m_end)) {
+      m_currentVector[index] = m_iter->operator*();
+      ++(*m_iter);
+      index++;
+    }
+  } else {
+    while (index < m_currentVector.size() && m_nextID < m_idCount) {
+      m_currentVector[index] = m_nextID;
+      m_nextID++;
+      index++;
+    }
   }
 
   m_currentSpan = span<std::uint64_t>(m_currentVector.data(), index);
-  return true;
+  return index > 0;
 }
@@ -3,6 +3,7 @@
 #include <memory>
 #include <sstream>
 #include "jonoondb_api/buffer_impl.h"
+#include "jonoondb_api/column_aggregate.h"
 #include "jonoondb_api/constraint.h"
 #include "jonoondb_api/document.h"
 #include "jonoondb_api/document_id_generator.h"
@@ -17,37 +18,47 @@
 using namespace std;
 using namespace jonoondb_api;
 
-IndexManager::IndexManager(
-    const std::vector<IndexInfoImpl*>& indexes,
-    const std::unordered_map<std::string, FieldType>& columnTypes)
-    : m_columnIndexerMap(new ColumnIndexderMap()) {
+IndexManager::IndexManager(const std::vector<IndexInfoImpl*>& indexes,
+                           const DocumentSchema& documentSchema) {
+  auto columnIndexerMap = make_shared<ColumnIndexderMap>();
   for (size_t i = 0; i < indexes.size(); i++) {
-    auto it = columnTypes.find(indexes[i]->GetColumnName());
-    if (it == columnTypes.end()) {
-      ostringstream ss;
-      ss << "The field type for " << indexes[i]->GetColumnName()
-         << " could not be determined.";
-      throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
-    }
-    unique_ptr<Indexer> indexer(
-        IndexerFactory::CreateIndexer(*indexes[i], it->second));
-    (*m_columnIndexerMap)[indexes[i]->GetColumnName()].push_back(move(indexer));
+    shared_ptr<Indexer> indexer(
+        IndexerFactory::CreateIndexer(*indexes[i], documentSchema));
+    (*columnIndexerMap)[indexes[i]->GetColumnName()].push_back(indexer);
   }
+  m_columnIndexerMap = columnIndexerMap;
 }
 
-void IndexManager::CreateIndex(
-    const IndexInfoImpl& indexInfo,
-    const std::unordered_map<std::string, FieldType>& columnTypes) {
-  auto it = columnTypes.find(indexInfo.GetColumnName());
-  if (it == columnTypes.end()) {
-    ostringstream ss;
-    ss << "The field type for " << indexInfo.GetColumnName()
-       << " could not be determined.";
-    throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
-  }
+void IndexManager::CreateIndex(const IndexInfoImpl& indexInfo,
+                               const DocumentSchema& documentSchema) {
   unique_ptr<Indexer> indexer(
-      IndexerFactory::CreateIndexer(indexInfo, it->second));
-  (*m_columnIndexerMap)[indexInfo.GetColumnName()].push_back(move(indexer));
+      IndexerFactory::CreateIndexer(indexInfo, documentSchema));
+  AddIndexer(move(indexer));
+}
+
+void IndexManager::AddIndexer(std::unique_ptr<Indexer> indexer) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto columnName = indexer->GetIndexStats().GetIndexInfo().GetColumnName();
+  // Copy the map and swap it in, readers holding the old map are unaffected
+  auto columnIndexerMap =
+      make_shared<ColumnIndexderMap>(*std::atomic_load(&m_columnIndexerMap));
+  (*columnIndexerMap)[columnName].push_back(move(indexer));
+  std::atomic_store(&m_columnIndexerMap,
+                    shared_ptr<const ColumnIndexderMap>(columnIndexerMap));
+}
+
+bool IndexManager::IndexExists(const std::string& indexName) {
+  auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
+  for (const auto& columnIndexerMapPair : *columnIndexerMap) {
+    for (const auto& indexer : columnIndexerMapPair.second) {
+      if (indexer->GetIndexStats().GetIndexInfo().GetIndexName() ==
+          indexName) {
+        return true;
+      }
+    }
+  }
+
+  return false;
 }
 
 std::uint64_t IndexManager::IndexDocuments(
@@ -58,14 +69,21 @@ std::uint64_t IndexManager::IndexDocuments(
     std::unique_lock<std::mutex> lock(m_mutex);
     startID = documentIDGenerator.ReserveID(documents.size());
     auto documentID = startID;
+    auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
     for (const auto& doc : documents) {
-      for (const auto& columnIndexerMapPair : *m_columnIndexerMap) {
+      for (const auto& columnIndexerMapPair : *columnIndexerMap) {
         for (const auto& indexer : columnIndexerMapPair.second) {
           indexer->Insert(documentID, *doc);
         }
       }
       ++documentID;
     }
+
+    for (const auto& columnIndexerMapPair : *columnIndexerMap) {
+      for (const auto& indexer : columnIndexerMapPair.second) {
+        indexer->PublishInserts();
+      }
+    }
   }
 
   return startID;
@@ -74,8 +92,9 @@ std::uint64_t IndexManager::IndexDocuments(
 bool IndexManager::TryGetBestIndex(const std::string& columnName,
                                    IndexConstraintOperator op,
                                    IndexStat& indexStat) {
-  auto columnIndexerIter = m_columnIndexerMap->find(columnName);
-  if (columnIndexerIter == m_columnIndexerMap->end()) {
+  auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
+  auto columnIndexerIter = columnIndexerMap->find(columnName);
+  if (columnIndexerIter == columnIndexerMap->end()) {
     return false;
   }
 
@@ -90,27 +109,36 @@ bool IndexManager::TryGetBestIndex(const std::string& columnName,
   }
 
   assert(columnIndexerIter->second.size() > 0);
-  // Todo: When we have different kinds of indexes,
-  // Add the logic to select the best index for the column
-  indexStat = columnIndexerIter->second[0]->GetIndexStats();
+  auto indexer = GetBestIndexer(columnIndexerIter->second, op);
+  if (indexer == nullptr) {
+    return false;
+  }
+
+  indexStat = indexer->GetIndexStats();
   return true;
 }
 
 std::shared_ptr<MamaJenniesBitmap> IndexManager::Filter(
     const std::vector<Constraint>& constraints) {
   std::vector<std::shared_ptr<MamaJenniesBitmap>> bitmaps;
+  auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
   for (std::size_t i = 0; i < constraints.size(); i++) {
-    auto columnIndexerIter =
-        m_columnIndexerMap->find(constraints[i].columnName);
-    if (columnIndexerIter == m_columnIndexerMap->end()) {
+    auto columnIndexerIter = columnIndexerMap->find(constraints[i].columnName);
+    if (columnIndexerIter == columnIndexerMap->end()) {
       std::ostringstream ss;
       ss << "Cannot apply filter operation on field "
          << constraints[i].columnName
          << " because no indexes exist on this field.";
       throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
     }
-    // Todo: When we have different kinds of indexes,
-    // Add the logic to select the best index for the column
+    auto indexer = GetBestIndexer(columnIndexerIter->second, constraints[i].op);
+    if (indexer == nullptr) {
+      std::ostringstream ss;
+      ss << "Cannot apply filter operation on field "
+         << constraints[i].columnName
+         << " because no index on this field supports the operator.";
+      throw JonoonDBException(ss.str(), __FILE__, __func__, __LINE__);
+    }
 
     // First lets see if we have range condition e.g. val > 10 AND val < 20
     // We look for adjacent constraints if they are on the same column and are
@@ -122,8 +150,7 @@ std::shared_ptr<MamaJenniesBitmap> IndexManager::Filter(
          constraints[i].op == IndexConstraintOperator::GREATER_THAN_EQUAL) &&
         (constraints[i + 1].op == IndexConstraintOperator::LESS_THAN ||
          constraints[i + 1].op == IndexConstraintOperator::LESS_THAN_EQUAL)) {
-      auto bm = columnIndexerIter->second[0]->FilterRange(constraints[i],
-                                                          constraints[i + 1]);
+      auto bm = indexer->FilterRange(constraints[i], constraints[i + 1]);
       bitmaps.push_back(bm);
       i++;  // advance i because we have processed 2 constraints
     } else {
@@ -135,7 +162,7 @@ std::shared_ptr<MamaJenniesBitmap> IndexManager::Filter(
       bitmaps.clear();
       break;
       }*/
-      auto bm = columnIndexerIter->second[0]->Filter(constraints[i]);
+      auto bm = indexer->Filter(constraints[i]);
       bitmaps.push_back(bm);
     }
   }
@@ -143,11 +170,31 @@ std::shared_ptr<MamaJenniesBitmap> IndexManager::Filter(
   return MamaJenniesBitmap::LogicalAND(bitmaps);
 }
 
+Indexer* IndexManager::GetBestIndexer(
+    const std::vector<std::shared_ptr<Indexer>>& indexers,
+    IndexConstraintOperator op) {
+  // Exact indexes are always preferred. A bloom filter index only answers
+  // equality and its result still needs to be rechecked.
+  Indexer* bloomIndexer = nullptr;
+  for (auto& indexer : indexers) {
+    if (indexer->GetIndexStats().GetIndexInfo().GetType() !=
+        IndexType::BLOOM_FILTER) {
+      return indexer.get();
+    } else if (bloomIndexer == nullptr &&
+               op == IndexConstraintOperator::EQUAL) {
+      bloomIndexer = indexer.get();
+    }
+  }
+
+  return bloomIndexer;
+}
+
 bool IndexManager::TryGetIntegerValue(std::uint64_t documentID,
                                       const std::string& columnName,
                                       std::int64_t& val) {
-  auto columnIndexerIter = m_columnIndexerMap->find(columnName);
-  if (columnIndexerIter != m_columnIndexerMap->end()) {
+  auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
+  auto columnIndexerIter = columnIndexerMap->find(columnName);
+  if (columnIndexerIter != columnIndexerMap->end()) {
     for (auto& indexer : columnIndexerIter->second) {
       if (indexer->GetIndexStats().GetIndexInfo().GetType() ==
           IndexType::VECTOR) {
@@ -162,8 +209,9 @@ bool IndexManager::TryGetIntegerValue(std::uint64_t documentID,
 bool IndexManager::TryGetDoubleValue(std::uint64_t documentID,
                                      const std::string& columnName,
                                      double& val) {
-  auto columnIndexerIter = m_columnIndexerMap->find(columnName);
-  if (columnIndexerIter != m_columnIndexerMap->end()) {
+  auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
+  auto columnIndexerIter = columnIndexerMap->find(columnName);
+  if (columnIndexerIter != columnIndexerMap->end()) {
     for (auto& indexer : columnIndexerIter->second) {
       if (indexer->GetIndexStats().GetIndexInfo().GetType() ==
           IndexType::VECTOR) {
@@ -177,13 +225,14 @@ bool IndexManager::TryGetDoubleValue(std::uint64_t documentID,
 
 bool IndexManager::TryGetStringValue(std::uint64_t documentID,
                                      const std::string& columnName,
-                                     std::string& val) {
-  auto columnIndexerIter = m_columnIndexerMap->find(columnName);
-  if (columnIndexerIter != m_columnIndexerMap->end()) {
+                                     const char*& val, std::size_t& size) {
+  auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
+  auto columnIndexerIter = columnIndexerMap->find(columnName);
+  if (columnIndexerIter != columnIndexerMap->end()) {
     for (auto& indexer : columnIndexerIter->second) {
       if (indexer->GetIndexStats().GetIndexInfo().GetType() ==
           IndexType::VECTOR) {
-        return indexer->TryGetStringValue(documentID, val);
+        return indexer->TryGetStringValue(documentID, val, size);
       }
     }
   }
@@ -193,13 +242,14 @@ bool IndexManager::TryGetStringValue(std::uint64_t documentID,
 
 bool IndexManager::TryGetBlobValue(std::uint64_t documentID,
                                    const std::string& columnName,
-                                   BufferImpl& val) {
-  auto columnIndexerIter = m_columnIndexerMap->find(columnName);
-  if (columnIndexerIter != m_columnIndexerMap->end()) {
+                                   const char*& val, std::size_t& size) {
+  auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
+  auto columnIndexerIter = columnIndexerMap->find(columnName);
+  if (columnIndexerIter != columnIndexerMap->end()) {
     for (auto& indexer : columnIndexerIter->second) {
       if (indexer->GetIndexStats().GetIndexInfo().GetType() ==
           IndexType::VECTOR) {
-        return indexer->TryGetBlobValue(documentID, val);
+        return indexer->TryGetBlobValue(documentID, val, size);
       }
     }
   }
@@ -210,8 +260,9 @@ bool IndexManager::TryGetBlobValue(std::uint64_t documentID,
 bool IndexManager::TryGetIntegerVector(
     const gsl::span<std::uint64_t>& documentIDs, const std::string& columnName,
     std::vector<std::int64_t>& values) {
-  auto columnIndexerIter = m_columnIndexerMap->find(columnName);
-  if (columnIndexerIter != m_columnIndexerMap->end()) {
+  auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
+  auto columnIndexerIter = columnIndexerMap->find(columnName);
+  if (columnIndexerIter != columnIndexerMap->end()) {
     for (auto& indexer : columnIndexerIter->second) {
       if (indexer->GetIndexStats().GetIndexInfo().GetType() ==
           IndexType::VECTOR) {
@@ -226,8 +277,9 @@ bool IndexManager::TryGetIntegerVector(
 bool IndexManager::TryGetDoubleVector(
     const gsl::span<std::uint64_t>& documentIDs, const std::string& columnName,
     std::vector<double>& values) {
-  auto columnIndexerIter = m_columnIndexerMap->find(columnName);
-  if (columnIndexerIter != m_columnIndexerMap->end()) {
+  auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
+  auto columnIndexerIter = columnIndexerMap->find(columnName);
+  if (columnIndexerIter != columnIndexerMap->end()) {
     for (auto& indexer : columnIndexerIter->second) {
       if (indexer->GetIndexStats().GetIndexInfo().GetType() ==
           IndexType::VECTOR) {
@@ -238,3 +290,70 @@ bool IndexManager::TryGetDoubleVector(
 
   return false;
 }
+
+bool IndexManager::TryGetStringVector(
+    const gsl::span<std::uint64_t>& documentIDs, const std::string& columnName,
+    ValueBatch& values) {
+  auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
+  auto columnIndexerIter = columnIndexerMap->find(columnName);
+  if (columnIndexerIter != columnIndexerMap->end()) {
+    for (auto& indexer : columnIndexerIter->second) {
+      if (indexer->GetIndexStats().GetIndexInfo().GetType() ==
+          IndexType::VECTOR) {
+        return indexer->TryGetStringVector(documentIDs, values);
+      }
+    }
+  }
+
+  return false;
+}
+
+bool IndexManager::TryGetBlobVector(
+    const gsl::span<std::uint64_t>& documentIDs, const std::string& columnName,
+    ValueBatch& values) {
+  auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
+  auto columnIndexerIter = columnIndexerMap->find(columnName);
+  if (columnIndexerIter != columnIndexerMap->end()) {
+    for (auto& indexer : columnIndexerIter->second) {
+      if (indexer->GetIndexStats().GetIndexInfo().GetType() ==
+          IndexType::VECTOR) {
+        return indexer->TryGetBlobVector(documentIDs, values);
+      }
+    }
+  }
+
+  return false;
+}
+
+bool IndexManager::TryAggregate(const MamaJenniesBitmap& documentIDs,
+                                const std::string& columnName,
+                                ColumnAggregate& aggregate) {
+  auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
+  auto columnIndexerIter = columnIndexerMap->find(columnName);
+  if (columnIndexerIter != columnIndexerMap->end()) {
+    for (auto& indexer : columnIndexerIter->second) {
+      if (indexer->GetIndexStats().GetIndexInfo().GetType() ==
+          IndexType::VECTOR) {
+        return indexer->TryAggregate(documentIDs, aggregate);
+      }
+    }
+  }
+
+  return false;
+}
+
+bool IndexManager::TryGetValueBitmaps(const std::string& columnName,
+                                      std::vector<ValueBitmap>& valueBitmaps) {
+  auto columnIndexerMap = std::atomic_load(&m_columnIndexerMap);
+  auto columnIndexerIter = columnIndexerMap->find(columnName);
+  if (columnIndexerIter != columnIndexerMap->end()) {
+    for (auto& indexer : columnIndexerIter->second) {
+      if (indexer->GetIndexStats().GetIndexInfo().GetType() ==
+          IndexType::INVERTED_COMPRESSED_BITMAP) {
+        return indexer->TryGetValueBitmaps(valueBitmaps);
+      }
+    }
+  }
+
+  return false;
+}
@@ -1,10 +1,13 @@
 #include "jonoondb_api/indexer_factory.h"
 #include <sstream>
+#include "jonoondb_api/bloom_filter_indexer.h"
+#include "jonoondb_api/document_schema.h"
 #include "jonoondb_api/enums.h"
 #include "jonoondb_api/ewah_compressed_bitmap_indexer_blob.h"
 #include "jonoondb_api/ewah_compressed_bitmap_indexer_double.h"
 #include "jonoondb_api/ewah_compressed_bitmap_indexer_integer.h"
 #include "jonoondb_api/ewah_compressed_bitmap_indexer_string.h"
+#include "jonoondb_api/field_accessor.h"
 #include "jonoondb_api/index_info_impl.h"
 #include "jonoondb_api/jonoondb_exceptions.h"
 #include "jonoondb_api/vector_blob_indexer.h"
@@ -16,45 +19,61 @@ using namespace std;
 using namespace jonoondb_api;
 
 Indexer* IndexerFactory::CreateIndexer(const IndexInfoImpl& indexInfo,
-                                       const FieldType& fieldType) {
+                                       const DocumentSchema& documentSchema) {
+  auto fieldType = documentSchema.GetFieldType(indexInfo.GetColumnName());
+  // The accessor is resolved once here, indexers use it to read the field
+  // value from each document without looking up the field by name.
+  auto fieldAccessor =
+      documentSchema.CreateFieldAccessor(indexInfo.GetColumnName());
   switch (indexInfo.GetType()) {
     case IndexType::INVERTED_COMPRESSED_BITMAP: {
       if (fieldType == FieldType::DOUBLE || fieldType == FieldType::FLOAT) {
         EWAHCompressedBitmapIndexerDouble* ewahIndexer;
-        EWAHCompressedBitmapIndexerDouble::Construct(indexInfo, fieldType,
-                                                     ewahIndexer);
+        EWAHCompressedBitmapIndexerDouble::Construct(
+            indexInfo, fieldType, std::move(fieldAccessor), ewahIndexer);
         return static_cast<Indexer*>(ewahIndexer);
       } else if (fieldType == FieldType::STRING) {
         EWAHCompressedBitmapIndexerString* ewahIndexer;
-        EWAHCompressedBitmapIndexerString::Construct(indexInfo, fieldType,
-                                                     ewahIndexer);
+        EWAHCompressedBitmapIndexerString::Construct(
+            indexInfo, fieldType, std::move(fieldAccessor), ewahIndexer);
         return static_cast<Indexer*>(ewahIndexer);
       } else if (fieldType == FieldType::BLOB) {
         EWAHCompressedBitmapIndexerBlob* ewahIndexer;
-        EWAHCompressedBitmapIndexerBlob::Construct(indexInfo, fieldType,
-                                                   ewahIndexer);
+        EWAHCompressedBitmapIndexerBlob::Construct(
+            indexInfo, fieldType, std::move(fieldAccessor), ewahIndexer);
         return static_cast<Indexer*>(ewahIndexer);
       } else {
         EWAHCompressedBitmapIndexerInteger* ewahIndexer;
-        EWAHCompressedBitmapIndexerInteger::Construct(indexInfo, fieldType,
-                                                      ewahIndexer);
+        EWAHCompressedBitmapIndexerInteger::Construct(
+            indexInfo, fieldType, std::move(fieldAccessor), ewahIndexer);
         return static_cast<Indexer*>(ewahIndexer);
       }
     }
     case IndexType::VECTOR: {
       if (fieldType == FieldType::STRING) {
-        return new VectorStringIndexer(indexInfo, fieldType);
+        return new VectorStringIndexer(indexInfo, fieldType,
+                                       std::move(fieldAccessor));
       } else if (fieldType == FieldType::DOUBLE ||
                  fieldType == FieldType::FLOAT) {
-        return new VectorDoubleIndexer(indexInfo, fieldType);
+        return new VectorDoubleIndexer(indexInfo, fieldType,
+                                       std::move(fieldAccessor));
       } else if (fieldType == FieldType::INT64) {
-        return new VectorIntegerIndexer<std::int64_t>(indexInfo, fieldType);
+        return new VectorIntegerIndexer<std::int64_t>(
+            indexInfo, fieldType, std::move(fieldAccessor));
       } else if (fieldType == FieldType::BLOB) {
-        return new VectorBlobIndexer(indexInfo, fieldType);
+        return new VectorBlobIndexer(indexInfo, fieldType,
+                                     std::move(fieldAccessor));
       } else {
-        return new VectorIntegerIndexer<std::int32_t>(indexInfo, fieldType);
+        return new VectorIntegerIndexer<std::int32_t>(
+            indexInfo, fieldType, std::move(fieldAccessor));
       }
     }
+    case IndexType::BLOOM_FILTER: {
+      BloomFilterIndexer* bloomIndexer;
+      BloomFilterIndexer::Construct(indexInfo, fieldType,
+                                    std::move(fieldAccessor), bloomIndexer);
+      return static_cast<Indexer*>(bloomIndexer);
+    }
 
     default:
       std::ostringstream ss;
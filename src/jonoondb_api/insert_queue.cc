@@ -0,0 +1,139 @@
+#include "insert_queue.h"
+#include <sstream>
+#include <string>
+#include "document_collection.h"
+#include "jonoondb_exceptions.h"
+
+using namespace jonoondb_api;
+
+InsertQueue::InsertQueue(std::shared_ptr<DocumentCollection> collection,
+                         std::size_t capacity, bool blockWhenFull)
+    : m_collection(std::move(collection)),
+      m_capacity(capacity),
+      m_blockWhenFull(blockWhenFull) {
+  m_writerThread = std::thread(&InsertQueue::WriterFunc, this);
+}
+
+InsertQueue::~InsertQueue() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_shutdown = true;
+  }
+  m_requestQueued.notify_one();
+  if (m_writerThread.joinable()) {
+    m_writerThread.join();
+  }
+}
+
+void InsertQueue::Push(const gsl::span<const BufferImpl*>& documents,
+                       const WriteOptionsImpl& wo, Callback callback) {
+  // Copy the documents before we take the lock, the caller can reuse its
+  // buffers as soon as we return
+  Request request;
+  request.documents.reserve(documents.size());
+  for (auto document : documents) {
+    request.documents.emplace_back(document->GetData(), document->GetLength(),
+                                   document->GetLength());
+  }
+  request.wo = wo;
+  request.callback = std::move(callback);
+
+  auto documentCount = request.documents.size();
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto hasSpace = [&] {
+    return m_documentCount == 0 ||
+           m_documentCount + documentCount <= m_capacity;
+  };
+  if (!hasSpace()) {
+    if (!m_blockWhenFull) {
+      std::ostringstream ss;
+      ss << "Insert queue of collection \"" << m_collection->GetName()
+         << "\" is full, it has " << m_documentCount
+         << " documents and the capacity is " << m_capacity << ".";
+      throw InsertQueueFullException(ss.str(), __FILE__, __func__, __LINE__);
+    }
+    m_spaceAvailable.wait(lock, hasSpace);
+  }
+
+  m_requests.push_back(std::move(request));
+  m_documentCount += documentCount;
+  lock.unlock();
+  m_requestQueued.notify_one();
+}
+
+void InsertQueue::WriterFunc() {
+  std::vector<Request> requests;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_requestQueued.wait(lock,
+                           [&] { return m_shutdown || !m_requests.empty(); });
+      if (m_requests.empty()) {
+        // We only stop once everything queued before the shutdown is in
+        break;
+      }
+
+      // Take the requests at the front that can go in one MultiInsert
+      auto wo = m_requests.front().wo;
+      while (!m_requests.empty() &&
+             m_requests.front().wo.compress == wo.compress &&
+             m_requests.front().wo.verifyDocuments == wo.verifyDocuments) {
+        requests.push_back(std::move(m_requests.front()));
+        m_requests.pop_front();
+      }
+    }
+
+    Insert(requests);
+
+    std::size_t documentCount = 0;
+    for (auto& request : requests) {
+      documentCount += request.documents.size();
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_documentCount -= documentCount;
+    }
+    m_spaceAvailable.notify_all();
+
+    // Free the space first, so it is there once a result is reported
+    for (auto& request : requests) {
+      request.callback(request.firstDocumentID, request.error);
+    }
+    requests.clear();
+  }
+}
+
+void InsertQueue::Insert(std::vector<Request>& requests) {
+  std::vector<const BufferImpl*> documents;
+  for (auto& request : requests) {
+    for (auto& document : request.documents) {
+      documents.push_back(&document);
+    }
+  }
+
+  gsl::span<const BufferImpl*> span = documents;
+  std::uint64_t firstDocumentID;
+  try {
+    firstDocumentID = m_collection->MultiInsert(span, requests[0].wo);
+  } catch (...) {
+    if (requests.size() == 1) {
+      requests[0].error = std::current_exception();
+      return;
+    }
+
+    // A failed MultiInsert inserts nothing, so we insert the requests one by
+    // one to fail only the ones that have a bad document
+    for (auto& request : requests) {
+      std::vector<Request> single;
+      single.push_back(std::move(request));
+      Insert(single);
+      request = std::move(single[0]);
+    }
+    return;
+  }
+
+  for (auto& request : requests) {
+    request.firstDocumentID = firstDocumentID;
+    firstDocumentID += request.documents.size();
+  }
+}
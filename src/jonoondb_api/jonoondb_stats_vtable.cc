@@ -0,0 +1,178 @@
+#include <cstdint>
+#include <new>
+#include <vector>
+#include "jonoondb_api/engine_stats.h"
+#include "sqlite3ext.h"
+
+using namespace jonoondb_api;
+
+// sqlite3_api is defined by jonoondb_vtable.cc
+SQLITE_EXTENSION_INIT3;
+
+// jonoondb_stats is an eponymous vtable, it exists on every query connection
+// without being created and returns one row per engine counter and latency:
+//   SELECT * FROM jonoondb_stats;
+// Every scan reads a fresh snapshot of EngineStats.
+enum StatsColumn {
+  NAME,
+  TYPE,
+  COUNT,
+  TOTAL_NS,
+  P50_NS,
+  P99_NS,
+  MAX_NS
+};
+
+struct jonoondb_stats_cursor {
+  sqlite3_vtab_cursor cur;
+  std::vector<EngineStat> stats;
+  std::size_t index = 0;
+};
+
+static int jonoondb_stats_connect(sqlite3* db, void* udp, int argc,
+                                  const char* const* argv,
+                                  sqlite3_vtab** vtab, char** errmsg) {
+  int code = sqlite3_declare_vtab(
+      db,
+      "CREATE TABLE x(name TEXT, type TEXT, count INTEGER, total_ns INTEGER, "
+      "p50_ns INTEGER, p99_ns INTEGER, max_ns INTEGER)");
+  if (code != SQLITE_OK) {
+    return code;
+  }
+
+  *vtab = static_cast<sqlite3_vtab*>(sqlite3_malloc(sizeof(sqlite3_vtab)));
+  if (*vtab == nullptr) {
+    return SQLITE_NOMEM;
+  }
+  **vtab = sqlite3_vtab();
+  return SQLITE_OK;
+}
+
+static int jonoondb_stats_disconnect(sqlite3_vtab* vtab) {
+  sqlite3_free(vtab);
+  return SQLITE_OK;
+}
+
+static int jonoondb_stats_bestindex(sqlite3_vtab* vtab,
+                                    sqlite3_index_info* info) {
+  // There are only a few rows, every query scans all of them
+  info->estimatedCost = 1;
+  return SQLITE_OK;
+}
+
+static int jonoondb_stats_open(sqlite3_vtab* vtab, sqlite3_vtab_cursor** cur) {
+  auto cursor = new (std::nothrow) jonoondb_stats_cursor();
+  if (cursor == nullptr) {
+    return SQLITE_NOMEM;
+  }
+  *cur = reinterpret_cast<sqlite3_vtab_cursor*>(cursor);
+  return SQLITE_OK;
+}
+
+static int jonoondb_stats_close(sqlite3_vtab_cursor* cur) {
+  delete reinterpret_cast<jonoondb_stats_cursor*>(cur);
+  return SQLITE_OK;
+}
+
+static int jonoondb_stats_filter(sqlite3_vtab_cursor* cur, int idxnum,
+                                 const char* idxstr, int argc,
+                                 sqlite3_value** value) {
+  auto cursor = reinterpret_cast<jonoondb_stats_cursor*>(cur);
+  try {
+    cursor->stats = EngineStats::GetStats();
+  } catch (std::bad_alloc&) {
+    return SQLITE_NOMEM;
+  }
+  cursor->index = 0;
+  return SQLITE_OK;
+}
+
+static int jonoondb_stats_next(sqlite3_vtab_cursor* cur) {
+  reinterpret_cast<jonoondb_stats_cursor*>(cur)->index++;
+  return SQLITE_OK;
+}
+
+static int jonoondb_stats_eof(sqlite3_vtab_cursor* cur) {
+  auto cursor = reinterpret_cast<jonoondb_stats_cursor*>(cur);
+  return cursor->index >= cursor->stats.size();
+}
+
+// The time columns are NULL for counters
+static void SetLatencyResult(sqlite3_context* ctx, const EngineStat& stat,
+                             std::uint64_t val) {
+  if (stat.isLatency) {
+    sqlite3_result_int64(ctx, val);
+  } else {
+    sqlite3_result_null(ctx);
+  }
+}
+
+static int jonoondb_stats_column(sqlite3_vtab_cursor* cur,
+                                 sqlite3_context* ctx, int cidx) {
+  auto cursor = reinterpret_cast<jonoondb_stats_cursor*>(cur);
+  auto& stat = cursor->stats[cursor->index];
+  switch (cidx) {
+    case NAME:
+      sqlite3_result_text(ctx, stat.name, -1, SQLITE_STATIC);
+      break;
+    case TYPE:
+      sqlite3_result_text(ctx, stat.isLatency ? "latency" : "counter", -1,
+                          SQLITE_STATIC);
+      break;
+    case COUNT:
+      sqlite3_result_int64(ctx, stat.count);
+      break;
+    case TOTAL_NS:
+      SetLatencyResult(ctx, stat, stat.totalNanoseconds);
+      break;
+    case P50_NS:
+      SetLatencyResult(ctx, stat, stat.p50Nanoseconds);
+      break;
+    case P99_NS:
+      SetLatencyResult(ctx, stat, stat.p99Nanoseconds);
+      break;
+    default:
+      SetLatencyResult(ctx, stat, stat.maxNanoseconds);
+      break;
+  }
+  return SQLITE_OK;
+}
+
+static int jonoondb_stats_rowid(sqlite3_vtab_cursor* cur,
+                                sqlite3_int64* rowid) {
+  *rowid = reinterpret_cast<jonoondb_stats_cursor*>(cur)->index;
+  return SQLITE_OK;
+}
+
+static sqlite3_module jonoondb_stats_mod = {
+    1,                         /* iVersion        */
+    NULL,                      /* xCreate()       */
+    jonoondb_stats_connect,    /* xConnect()      */
+    jonoondb_stats_bestindex,  /* xBestIndex()    */
+    jonoondb_stats_disconnect, /* xDisconnect()   */
+    NULL,                      /* xDestroy()      */
+    jonoondb_stats_open,       /* xOpen()         */
+    jonoondb_stats_close,      /* xClose()        */
+    jonoondb_stats_filter,     /* xFilter()       */
+    jonoondb_stats_next,       /* xNext()         */
+    jonoondb_stats_eof,        /* xEof()          */
+    jonoondb_stats_column,     /* xColumn()       */
+    jonoondb_stats_rowid,      /* xRowid()        */
+    NULL,                      /* xUpdate()       */
+    NULL,                      /* xBegin()        */
+    NULL,                      /* xSync()         */
+    NULL,                      /* xCommit()       */
+    NULL,                      /* xRollback()     */
+    NULL,                      /* xFindFunction() */
+    NULL,                      /* xRename()       */
+    NULL,                      /* xSavepoint()    */
+    NULL,                      /* xRelease()      */
+    NULL,                      /* xRollbackTo()   */
+    NULL,                      /* xColumnVec()    */
+    NULL                       /* xNextVec()      */
+};
+
+int jonoondb_stats_vtable_init(sqlite3* db) {
+  return sqlite3_create_module(db, "jonoondb_stats", &jonoondb_stats_mod,
+                               NULL);
+}
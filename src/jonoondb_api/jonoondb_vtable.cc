@@ -1,7 +1,11 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstring>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -21,6 +25,9 @@
 #include "jonoondb_api/jonoondb_exceptions.h"
 #include "jonoondb_api/mama_jennies_bitmap.h"
 #include "jonoondb_api/null_helpers.h"
+#include "jonoondb_api/parallel_scan.h"
+#include "jonoondb_api/query_profile.h"
+#include "jonoondb_api/value_batch.h"
 #include "sqlite3ext.h"
 
 using namespace jonoondb_api;
@@ -33,14 +40,22 @@ struct jonoondb_vtab {
   sqlite3_vtab vtab;
   // This collection object is shared with the DatabaseImpl object
   std::shared_ptr<DocumentCollectionInfo> collectionInfo;
+  // Rows deleted by the current transaction of this connection
+  std::vector<std::uint64_t> pendingDeletes;
+};
+
+struct ColumnBatch {
+  std::vector<std::int64_t> integers;
+  std::vector<double> doubles;
+  ValueBatch values;
+  // Whether values were gathered from an indexer for the current batch
+  bool loaded = false;
+  bool fromIndexer = false;
 };
 
 struct jonoondb_cursor {
   jonoondb_cursor(std::shared_ptr<DocumentCollectionInfo>& colInfo)
-      : collectionInfo(colInfo),
-        documentID(0),
-        document(nullptr),
-        idSeq_index(-1) {}
+      : collectionInfo(colInfo), idSeq_index(-1), batchLoaded(false) {}
 
   sqlite3_vtab_cursor cur;
   // we can keep reference here because we will always close the
@@ -48,12 +63,51 @@ struct jonoondb_cursor {
   std::shared_ptr<DocumentCollectionInfo>& collectionInfo;
   std::unique_ptr<IDSequence> idSeq;
   int idSeq_index;
-  BufferImpl buffer;  // buffer to keep the current doc
-  std::unique_ptr<Document> document;
-  std::unique_ptr<Document> subDocument;
-  std::uint64_t documentID;
+  // The watermark of the collection when xFilter was called, the cursor
+  // never returns documents committed after it
+  std::uint64_t documentCount = 0;
+  // Documents of the current batch of idSeq, batchDocuments[i] is the
+  // document for idSeq->Current()[i] and is backed by batchBuffers[i]. They
+  // are read together the first time a column can't be served by an indexer.
+  std::vector<BufferImpl> batchBuffers;
+  std::vector<std::unique_ptr<Document>> batchDocuments;
+  bool batchLoaded;
+  // Per column storage for the vectors returned by xColumnVec and for the
+  // string and blob values gathered from indexers by xColumn. It is reused
+  // for every batch so the values are handed to SQLite without a copy, they
+  // stay valid until the cursor moves to the next batch.
+  std::vector<ColumnBatch> columnBatches;
+  // The profile of the query that last called xFilter and the index of the
+  // scan in it, profile is nullptr if the query is not profiled
+  QueryProfile* profile = nullptr;
+  std::size_t scanIndex = 0;
 };
 
+// Forgets the documents and column values read for the previous batch
+static void ResetBatch(jonoondb_cursor* jdbCursor) {
+  jdbCursor->batchLoaded = false;
+  for (auto& batch : jdbCursor->columnBatches) {
+    batch.loaded = false;
+  }
+}
+
+static ColumnBatch& GetColumnBatch(jonoondb_cursor* jdbCursor, int cidx) {
+  auto columnCount = jdbCursor->collectionInfo->columnsInfo.size();
+  if (jdbCursor->columnBatches.size() < columnCount) {
+    jdbCursor->columnBatches.resize(columnCount);
+  }
+  return jdbCursor->columnBatches.at(cidx);
+}
+
+// These were added in SQLite 3.21, the values are part of the stable
+// interface so we can recognize them when running against a newer SQLite.
+#ifndef SQLITE_INDEX_CONSTRAINT_ISNOTNULL
+#define SQLITE_INDEX_CONSTRAINT_ISNOTNULL 70
+#endif
+#ifndef SQLITE_INDEX_CONSTRAINT_ISNULL
+#define SQLITE_INDEX_CONSTRAINT_ISNULL 71
+#endif
+
 static IndexConstraintOperator MapSQLiteToJonoonDBOperator(unsigned char op) {
   switch (op) {
     case SQLITE_INDEX_CONSTRAINT_EQ:
@@ -74,6 +128,10 @@ static IndexConstraintOperator MapSQLiteToJonoonDBOperator(unsigned char op) {
       return IndexConstraintOperator::GLOB;
     case SQLITE_INDEX_CONSTRAINT_REGEXP:
       return IndexConstraintOperator::REGEX;
+    case SQLITE_INDEX_CONSTRAINT_ISNULL:
+      return IndexConstraintOperator::IS_NULL;
+    case SQLITE_INDEX_CONSTRAINT_ISNOTNULL:
+      return IndexConstraintOperator::IS_NOT_NULL;
     default: {
       std::ostringstream ss;
       ss << "Invalid SQL operator " << op << " encountered.";
@@ -82,6 +140,119 @@ static IndexConstraintOperator MapSQLiteToJonoonDBOperator(unsigned char op) {
   }
 }
 
+static const char* GetOperatorText(IndexConstraintOperator op) {
+  switch (op) {
+    case IndexConstraintOperator::EQUAL:
+      return "=";
+    case IndexConstraintOperator::LESS_THAN:
+      return "<";
+    case IndexConstraintOperator::LESS_THAN_EQUAL:
+      return "<=";
+    case IndexConstraintOperator::GREATER_THAN:
+      return ">";
+    case IndexConstraintOperator::GREATER_THAN_EQUAL:
+      return ">=";
+    case IndexConstraintOperator::MATCH:
+      return "MATCH";
+    case IndexConstraintOperator::LIKE:
+      return "LIKE";
+    case IndexConstraintOperator::GLOB:
+      return "GLOB";
+    case IndexConstraintOperator::REGEX:
+      return "REGEXP";
+    case IndexConstraintOperator::IS_NULL:
+      return "IS NULL";
+    default:
+      return "IS NOT NULL";
+  }
+}
+
+// RowIDRange collects the constraints on rowid i.e. the documentID into the
+// range of ids [start, end) that can satisfy all of them.
+struct RowIDRange {
+  std::int64_t start = 0;
+  std::int64_t end = std::numeric_limits<std::int64_t>::max();
+  bool restricted = false;
+
+  static bool IsSupportedOperator(IndexConstraintOperator op) {
+    return op == IndexConstraintOperator::EQUAL ||
+           op == IndexConstraintOperator::LESS_THAN ||
+           op == IndexConstraintOperator::LESS_THAN_EQUAL ||
+           op == IndexConstraintOperator::GREATER_THAN ||
+           op == IndexConstraintOperator::GREATER_THAN_EQUAL;
+  }
+
+  void Add(IndexConstraintOperator op, sqlite3_value* value) {
+    restricted = true;
+    switch (sqlite3_value_type(value)) {
+      case SQLITE_INTEGER:
+        AddBound(op, sqlite3_value_int64(value));
+        break;
+      case SQLITE_FLOAT: {
+        auto val = sqlite3_value_double(value);
+        if (op == IndexConstraintOperator::EQUAL && val != std::floor(val)) {
+          SetEmpty();
+        } else if (op == IndexConstraintOperator::GREATER_THAN ||
+                   op == IndexConstraintOperator::LESS_THAN_EQUAL) {
+          AddBound(op, ToInt64(std::floor(val)));
+        } else {
+          AddBound(op, ToInt64(std::ceil(val)));
+        }
+        break;
+      }
+      case SQLITE_NULL:
+        // Comparisons with NULL are never true
+        SetEmpty();
+        break;
+      default:
+        // Text and blobs sort after all numbers
+        if (op != IndexConstraintOperator::LESS_THAN &&
+            op != IndexConstraintOperator::LESS_THAN_EQUAL) {
+          SetEmpty();
+        }
+        break;
+    }
+  }
+
+ private:
+  static std::int64_t ToInt64(double val) {
+    if (val >= static_cast<double>(std::numeric_limits<std::int64_t>::max())) {
+      return std::numeric_limits<std::int64_t>::max();
+    } else if (val <=
+               static_cast<double>(std::numeric_limits<std::int64_t>::min())) {
+      return std::numeric_limits<std::int64_t>::min();
+    }
+    return static_cast<std::int64_t>(val);
+  }
+
+  void AddBound(IndexConstraintOperator op, std::int64_t val) {
+    // One past val, end is exclusive
+    auto next = val == std::numeric_limits<std::int64_t>::max() ? val : val + 1;
+    switch (op) {
+      case IndexConstraintOperator::EQUAL:
+        start = std::max(start, val);
+        end = std::min(end, next);
+        break;
+      case IndexConstraintOperator::GREATER_THAN:
+        start = std::max(start, next);
+        break;
+      case IndexConstraintOperator::GREATER_THAN_EQUAL:
+        start = std::max(start, val);
+        break;
+      case IndexConstraintOperator::LESS_THAN:
+        end = std::min(end, val);
+        break;
+      default:
+        end = std::min(end, next);
+        break;
+    }
+  }
+
+  void SetEmpty() {
+    end = 0;
+  }
+};
+
 int GetSQLiteType(FieldType fieldType) {
   switch (fieldType) {
     case jonoondb_api::FieldType::INT8:
@@ -186,21 +357,31 @@ static int jonoondb_bestindex(sqlite3_vtab* vtab, sqlite3_index_info* info) {
     std::string sbuf;
     for (int i = 0; i < info->nConstraint; i++) {
       if (info->aConstraint[i].usable) {
+        IndexConstraintOperator op =
+            MapSQLiteToJonoonDBOperator(info->aConstraint[i].op);
         if (info->aConstraint[i].iColumn == -1) {
-          // Means someone has used RowID in contraint
-          // "Queries on RowID are not allowed.";
-          return SQLITE_ERROR;
+          // Rowid is the documentID so comparisons on it are answered
+          // exactly by restricting the ids we return.
+          if (!RowIDRange::IsSupportedOperator(op)) {
+            continue;
+          }
+          info->aConstraintUsage[i].argvIndex = ++argvIndex;
+          info->aConstraintUsage[i].omit = 1;
+          sbuf.append((char*)&info->aConstraint[i].iColumn, sizeof(int));
+          sbuf.append((char*)&op, sizeof(IndexConstraintOperator));
+          continue;
         }
 
-        IndexConstraintOperator op =
-            MapSQLiteToJonoonDBOperator(info->aConstraint[i].op);
         if (jdbVtab->collectionInfo->collection->TryGetBestIndex(
                 jdbVtab->collectionInfo
                     ->columnsInfo[info->aConstraint[i].iColumn]
                     .columnName,
                 op, indexStat)) {
           info->aConstraintUsage[i].argvIndex = ++argvIndex;
-          info->aConstraintUsage[i].omit = 1;
+          // Bloom filter indexes return false positives so SQLite has to
+          // evaluate the constraint again on the rows we return.
+          info->aConstraintUsage[i].omit =
+              indexStat.GetIndexInfo().GetType() != IndexType::BLOOM_FILTER;
           assert(sizeof(int) == sizeof(info->aConstraint[i].iColumn));
           assert(sizeof(IndexConstraintOperator) == sizeof(op));
           // type of info->aConstraint[i].iColumn is int
@@ -252,7 +433,7 @@ static int jonoondb_open(sqlite3_vtab* vtab, sqlite3_vtab_cursor** cur) {
 }
 
 static int jonoondb_close(sqlite3_vtab_cursor* cur) {
-  delete cur;
+  delete reinterpret_cast<jonoondb_cursor*>(cur);
   return SQLITE_OK;
 }
 
@@ -261,9 +442,13 @@ static int jonoondb_filter(sqlite3_vtab_cursor* cur, int idxnum,
                            sqlite3_value** value) {
   try {
     auto cursor = reinterpret_cast<jonoondb_cursor*>(cur);
+    auto profile = QueryProfile::Current();
+    std::vector<std::string> constraintTexts;
+    std::vector<Constraint> constraints;
+    RowIDRange rowIDRange;
+    bool matchesNothing = false;
     // Get the constraints
     if (argc > 0) {
-      std::vector<Constraint> constraints;
       auto currIndex = idxstr;
 
       while (currIndex < (idxstr + idxnum)) {
@@ -277,9 +462,31 @@ static int jonoondb_filter(sqlite3_vtab_cursor* cur, int idxnum,
         memcpy(&op, currIndex, sizeof(IndexConstraintOperator));
         currIndex += sizeof(IndexConstraintOperator);
 
+        if (profile) {
+          constraintTexts.push_back(
+              (colIndex == -1
+                   ? std::string("rowid")
+                   : cursor->collectionInfo->columnsInfo[colIndex].columnName) +
+              " " + GetOperatorText(op));
+        }
+
+        if (colIndex == -1) {
+          rowIDRange.Add(op, *value);
+          value++;
+          continue;
+        }
+
         Constraint constraint(
             cursor->collectionInfo->columnsInfo[colIndex].columnName, op);
         std::size_t size = 0;
+        if (op == IndexConstraintOperator::IS_NULL ||
+            op == IndexConstraintOperator::IS_NOT_NULL) {
+          // These operators don't have an operand, SQLite passes a NULL
+          constraints.push_back(std::move(constraint));
+          value++;
+          continue;
+        }
+
         switch (sqlite3_value_type(*value)) {
           case SQLITE_INTEGER:
             constraint.operandType = OperandType::INTEGER;
@@ -301,6 +508,11 @@ static int jonoondb_filter(sqlite3_vtab_cursor* cur, int idxnum,
             constraint.blobVal.Copy(
                 static_cast<const char*>(sqlite3_value_blob(*value)), size);
             break;
+          case SQLITE_NULL:
+            // Comparisons with NULL are never true, this happens when NULL
+            // is bound to a parameter
+            matchesNothing = true;
+            break;
           default:
             std::ostringstream ss;
             ss << "Argument value has sql type " << sqlite3_value_type(*value)
@@ -312,14 +524,74 @@ static int jonoondb_filter(sqlite3_vtab_cursor* cur, int idxnum,
         constraints.push_back(std::move(constraint));
         value++;
       }
+    }
 
+    auto& collection = *cursor->collectionInfo->collection;
+    cursor->documentCount = collection.GetDocumentCount();
+    std::chrono::steady_clock::time_point filterStart;
+    if (profile) {
+      filterStart = std::chrono::steady_clock::now();
+    }
+    // The range of a worker of a parallel query, the query is filtered once
+    // for all the workers
+    std::size_t range = 0;
+    auto parallelScan =
+        rowIDRange.restricted ? ParallelScan::Current(range) : nullptr;
+    if (parallelScan &&
+        !parallelScan->IsRangeScan(collection, range, rowIDRange.start,
+                                   rowIDRange.end)) {
+      parallelScan = nullptr;
+    }
+    const char* plan;
+    if (matchesNothing) {
+      plan = "NO MATCH";
       cursor->idSeq = std::make_unique<IDSequence>(
-          cursor->collectionInfo->collection->Filter(constraints), VECTOR_SIZE);
+          std::make_shared<MamaJenniesBitmap>(), VECTOR_SIZE);
+    } else if (parallelScan) {
+      plan = "RANGE SLICE";
+      auto filter = [&] {
+        return collection.Filter(constraints, cursor->documentCount);
+      };
+      cursor->idSeq = std::make_unique<IDSequence>(
+          parallelScan->GetSlice(range, filter), VECTOR_SIZE);
+    } else if (rowIDRange.restricted) {
+      plan = "ROWID RANGE";
+      auto bitmap = collection.Filter(constraints, cursor->documentCount);
+      MamaJenniesBitmap rangeBitmap;
+      auto start = std::max<std::int64_t>(rowIDRange.start, 0);
+      auto end =
+          std::min<std::int64_t>(rowIDRange.end, cursor->documentCount);
+      if (start < end) {
+        rangeBitmap.AddRange(start, end);
+      }
+      auto result = std::make_shared<MamaJenniesBitmap>();
+      bitmap->LogicalAND(rangeBitmap, *result);
+      cursor->idSeq = std::make_unique<IDSequence>(result, VECTOR_SIZE);
+    } else if (argc > 0) {
+      plan = "INDEX FILTER";
+      cursor->idSeq =
+          std::make_unique<IDSequence>(
+              collection.Filter(constraints, cursor->documentCount),
+              VECTOR_SIZE);
     } else {
       // We need to do a full scan
-      cursor->idSeq = std::make_unique<IDSequence>(
-          cursor->collectionInfo->collection->Filter(std::vector<Constraint>()),
-          VECTOR_SIZE);
+      plan = "FULL SCAN";
+      cursor->idSeq = collection.Scan(VECTOR_SIZE, cursor->documentCount);
+    }
+    ResetBatch(cursor);
+
+    cursor->profile = profile;
+    if (profile) {
+      std::chrono::nanoseconds filterTime =
+          std::chrono::steady_clock::now() - filterStart;
+      ScanProfile scan;
+      scan.collectionName = collection.GetName();
+      scan.plan = plan;
+      scan.constraints = std::move(constraintTexts);
+      scan.filterTime = filterTime;
+      profile->filterTime += filterTime;
+      profile->scans.push_back(std::move(scan));
+      cursor->scanIndex = profile->scans.size() - 1;
     }
   } catch (JonoonDBException& ex) {
     AllocateAndCopy(ex.to_string(), &cur->pVtab->zErrMsg);
@@ -337,6 +609,14 @@ static int jonoondb_filter(sqlite3_vtab_cursor* cur, int idxnum,
   return SQLITE_OK;
 }
 
+// Adds the ids of the batch the cursor moved to to its scan profile
+static void ProfileBatch(jonoondb_cursor* jdbCursor) {
+  if (jdbCursor->profile) {
+    jdbCursor->profile->scans[jdbCursor->scanIndex].rowsScanned +=
+        jdbCursor->idSeq->Current().size();
+  }
+}
+
 static int jonoondb_next(sqlite3_vtab_cursor* cur) {
   auto jdbCursor = (jonoondb_cursor*)cur;
   ++jdbCursor->idSeq_index;
@@ -346,7 +626,10 @@ static int jonoondb_next(sqlite3_vtab_cursor* cur) {
 
 static int jonoondb_next_vec(sqlite3_vtab_cursor* cur) {
   auto jdbCursor = (jonoondb_cursor*)cur;
-  jdbCursor->idSeq->Next();
+  if (jdbCursor->idSeq->Next()) {
+    ProfileBatch(jdbCursor);
+  }
+  ResetBatch(jdbCursor);
 
   return SQLITE_OK;
 }
@@ -358,6 +641,8 @@ static int jonoondb_eof(sqlite3_vtab_cursor* cur) {
     if (jdbCursor->idSeq->Next()) {
       // Seq has more ids
       jdbCursor->idSeq_index = 0;
+      ResetBatch(jdbCursor);
+      ProfileBatch(jdbCursor);
       return 0;
     }
   } else if (jdbCursor->idSeq_index < jdbCursor->idSeq->Current().size()) {
@@ -368,6 +653,8 @@ static int jonoondb_eof(sqlite3_vtab_cursor* cur) {
     if (jdbCursor->idSeq->Next()) {
       // Seq has more ids
       jdbCursor->idSeq_index = 0;
+      ResetBatch(jdbCursor);
+      ProfileBatch(jdbCursor);
       return 0;
     }
   }
@@ -389,7 +676,7 @@ static int jonoondb_update(sqlite3_vtab* vtab, int argc, sqlite3_value** argv,
       if (sqlite3_value_type(*argv) == SQLITE_INTEGER) {
         jonoondb_vtab* v = (jonoondb_vtab*)vtab;
         int64_t rowIdToDelete = sqlite3_value_int64(*argv);
-        v->collectionInfo->collection->AddToDeleteVector(rowIdToDelete);
+        v->pendingDeletes.push_back(rowIdToDelete);
       } else {
         // This should never happen
         return SQLITE_ERROR;
@@ -405,77 +692,107 @@ static int jonoondb_update(sqlite3_vtab* vtab, int argc, sqlite3_value** argv,
   return SQLITE_OK;
 }
 
+// String and blob values are handed to SQLite in place, they point into the
+// documents of the current batch or into the storage of a VECTOR indexer.
+// Unlike SQLITE_STATIC values, values with a destructor are copied by SQLite
+// when it keeps them past the current row, e.g. for MIN and MAX, so it never
+// reads them after the cursor moved on. There is nothing to free.
+static void KeepValue(void*) {}
+
 void Sqlite3ResultBlob(sqlite3_context* ctx, const char* val,
                        std::size_t size) {
   if (val == nullptr || size == 0) {
     sqlite3_result_null(ctx);
   } else {
-    // SQLITE_TRANSIENT causes SQLite to copy
-    sqlite3_result_blob64(ctx, val, size, SQLITE_TRANSIENT);
+    sqlite3_result_blob64(ctx, val, size, KeepValue);
+  }
+}
+
+static void Sqlite3ResultText(sqlite3_context* ctx, const char* val,
+                              std::size_t size) {
+  if (val == nullptr) {
+    sqlite3_result_null(ctx);
+    return;
   }
+
+  sqlite3_result_text64(ctx, val, size, KeepValue, SQLITE_UTF8);
+}
+
+// Returns the document the cursor is positioned on. The first call for a
+// batch reads the documents of the whole batch with a single MultiGet so the
+// blob reads are sorted and prefetched instead of faulted in one at a time.
+static const Document& GetCurrentDocument(jonoondb_cursor* jdbCursor) {
+  if (!jdbCursor->batchLoaded) {
+    jdbCursor->collectionInfo->collection->GetDocumentsAndBuffers(
+        jdbCursor->idSeq->Current(), jdbCursor->batchDocuments,
+        jdbCursor->batchBuffers);
+    jdbCursor->batchLoaded = true;
+  }
+
+  return *jdbCursor->batchDocuments[jdbCursor->idSeq_index];
+}
+
+// String and blob columns that have a VECTOR index are gathered for the whole
+// batch on its first cell, so they cost one indexer call per batch instead of
+// one per cell. Returns false if the column has to be read from the documents.
+static bool LoadIndexedColumn(jonoondb_cursor* jdbCursor,
+                              const ColumnInfo& columnInfo, int cidx) {
+  auto& batch = GetColumnBatch(jdbCursor, cidx);
+  if (!batch.loaded) {
+    auto& collection = *jdbCursor->collectionInfo->collection;
+    auto& docIDs = jdbCursor->idSeq->Current();
+    if (columnInfo.columnType == FieldType::STRING) {
+      batch.fromIndexer = collection.TryGetStringVectorFromIndexer(
+          docIDs, columnInfo.columnName, batch.values);
+    } else {
+      batch.fromIndexer = collection.TryGetBlobVectorFromIndexer(
+          docIDs, columnInfo.columnName, batch.values);
+    }
+    batch.loaded = true;
+  }
+
+  return batch.fromIndexer;
 }
 
 static int jonoondb_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx,
                            int cidx) {
   try {
-    static ColumnInfo documentColumnInfo("_document", FieldType::BLOB,
-                                         std::vector<std::string>{"_document"});
     jonoondb_cursor* jdbCursor = (jonoondb_cursor*)cur;
-    ColumnInfo* columnInfo = &documentColumnInfo;
-    if (cidx < jdbCursor->collectionInfo->columnsInfo.size()) {
-      columnInfo = &jdbCursor->collectionInfo->columnsInfo.at(cidx);
-    }
+    // The hidden _document column is the last entry in columnsInfo
+    ColumnInfo* columnInfo = &jdbCursor->collectionInfo->columnsInfo.at(cidx);
+    auto& fieldAccessor = *columnInfo->fieldAccessor;
 
     auto currentDocID = jdbCursor->idSeq->Current()[jdbCursor->idSeq_index];
+    bool fromIndexer = false;
     if (columnInfo->columnType == FieldType::STRING) {
       // Get the string value
-      std::string val;
-      // First check if we have the current document already cached on our side
-      if (jdbCursor->document && jdbCursor->documentID == currentDocID) {
-        val = DocumentUtils::GetStringValue(*jdbCursor->document.get(),
-                                            jdbCursor->subDocument,
-                                            columnInfo->columnNameTokens);
+      const char* val = nullptr;
+      std::size_t size = 0;
+      fromIndexer = LoadIndexedColumn(jdbCursor, *columnInfo, cidx);
+      if (fromIndexer) {
+        val = jdbCursor->columnBatches[cidx].values.GetValue(
+            jdbCursor->idSeq_index, size);
       } else {
-        if (!jdbCursor->collectionInfo->collection
-                 ->TryGetStringFieldFromIndexer(currentDocID,
-                                                columnInfo->columnName, val)) {
-          jdbCursor->collectionInfo->collection->GetDocumentAndBuffer(
-              currentDocID, jdbCursor->document, jdbCursor->buffer);
-          jdbCursor->documentID = currentDocID;
-          val = DocumentUtils::GetStringValue(*jdbCursor->document.get(),
-                                              jdbCursor->subDocument,
-                                              columnInfo->columnNameTokens);
-        }
+        val = fieldAccessor.GetStringValue(GetCurrentDocument(jdbCursor),
+                                           size);
       }
 
-      // First check if string is null
-      if (NullHelpers::IsNull(val)) {
-        sqlite3_result_null(ctx);
-      } else {
-        // SQLITE_TRANSIENT causes SQLite to copy the string on its side
-        sqlite3_result_text(ctx, val.c_str(), val.size(), SQLITE_TRANSIENT);
-      }
+      Sqlite3ResultText(ctx, val, size);
     } else if (columnInfo->columnType == FieldType::INT64 ||
                columnInfo->columnType == FieldType::INT32 ||
                columnInfo->columnType == FieldType::INT16 ||
                columnInfo->columnType == FieldType::INT8) {
       // Get the integer value
       std::int64_t val;
-      // First check if we have the current document already cached on our side
-      if (jdbCursor->document && jdbCursor->documentID == currentDocID) {
-        val = DocumentUtils::GetIntegerValue(*jdbCursor->document.get(),
-                                             jdbCursor->subDocument,
-                                             columnInfo->columnNameTokens);
+      // First check if we have the current batch already loaded on our side
+      if (jdbCursor->batchLoaded) {
+        val = fieldAccessor.GetIntegerValue(GetCurrentDocument(jdbCursor));
       } else {
-        if (!jdbCursor->collectionInfo->collection
-                 ->TryGetIntegerFieldFromIndexer(currentDocID,
-                                                 columnInfo->columnName, val)) {
-          jdbCursor->collectionInfo->collection->GetDocumentAndBuffer(
-              currentDocID, jdbCursor->document, jdbCursor->buffer);
-          jdbCursor->documentID = currentDocID;
-          val = DocumentUtils::GetIntegerValue(*jdbCursor->document.get(),
-                                               jdbCursor->subDocument,
-                                               columnInfo->columnNameTokens);
+        fromIndexer = jdbCursor->collectionInfo->collection
+                          ->TryGetIntegerFieldFromIndexer(
+                              currentDocID, columnInfo->columnName, val);
+        if (!fromIndexer) {
+          val = fieldAccessor.GetIntegerValue(GetCurrentDocument(jdbCursor));
         }
       }
 
@@ -486,44 +803,29 @@ static int jonoondb_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx,
       }
     } else if (columnInfo->columnType == FieldType::BLOB) {
       // Get the blob value
+      const char* val = nullptr;
       std::size_t size = 0;
-      if (jdbCursor->document && jdbCursor->documentID == currentDocID) {
-        auto val = DocumentUtils::GetBlobValue(
-            *jdbCursor->document.get(), jdbCursor->subDocument,
-            columnInfo->columnNameTokens, size);
-        Sqlite3ResultBlob(ctx, val, size);
+      fromIndexer = LoadIndexedColumn(jdbCursor, *columnInfo, cidx);
+      if (fromIndexer) {
+        val = jdbCursor->columnBatches[cidx].values.GetValue(
+            jdbCursor->idSeq_index, size);
       } else {
-        BufferImpl blobVal;
-        if (jdbCursor->collectionInfo->collection->TryGetBlobFieldFromIndexer(
-                currentDocID, columnInfo->columnName, blobVal)) {
-          Sqlite3ResultBlob(ctx, blobVal.GetData(), blobVal.GetLength());
-        } else {
-          jdbCursor->collectionInfo->collection->GetDocumentAndBuffer(
-              currentDocID, jdbCursor->document, jdbCursor->buffer);
-          jdbCursor->documentID = currentDocID;
-          auto val = DocumentUtils::GetBlobValue(
-              *jdbCursor->document.get(), jdbCursor->subDocument,
-              columnInfo->columnNameTokens, size);
-          Sqlite3ResultBlob(ctx, val, size);
-        }
+        val = fieldAccessor.GetBlobValue(GetCurrentDocument(jdbCursor), size);
       }
+
+      Sqlite3ResultBlob(ctx, val, size);
     } else {
       // Get the floating value
       double val;
-      // First check if we have the current document already cached on our side
-      if (jdbCursor->document && jdbCursor->documentID == currentDocID) {
-        val = DocumentUtils::GetFloatValue(*jdbCursor->document.get(),
-                                           jdbCursor->subDocument,
-                                           columnInfo->columnNameTokens);
+      // First check if we have the current batch already loaded on our side
+      if (jdbCursor->batchLoaded) {
+        val = fieldAccessor.GetFloatValue(GetCurrentDocument(jdbCursor));
       } else {
-        if (!jdbCursor->collectionInfo->collection->TryGetFloatFieldFromIndexer(
-                currentDocID, columnInfo->columnName, val)) {
-          jdbCursor->collectionInfo->collection->GetDocumentAndBuffer(
-              currentDocID, jdbCursor->document, jdbCursor->buffer);
-          jdbCursor->documentID = currentDocID;
-          val = DocumentUtils::GetFloatValue(*jdbCursor->document.get(),
-                                             jdbCursor->subDocument,
-                                             columnInfo->columnNameTokens);
+        fromIndexer =
+            jdbCursor->collectionInfo->collection->TryGetFloatFieldFromIndexer(
+                currentDocID, columnInfo->columnName, val);
+        if (!fromIndexer) {
+          val = fieldAccessor.GetFloatValue(GetCurrentDocument(jdbCursor));
         }
       }
 
@@ -533,12 +835,17 @@ static int jonoondb_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx,
         sqlite3_result_double(ctx, val);
       }
     }
+
+    if (jdbCursor->profile) {
+      fromIndexer ? jdbCursor->profile->indexerValues++
+                  : jdbCursor->profile->documentValues++;
+    }
   } catch (JonoonDBException& ex) {
     AllocateAndCopy(ex.to_string(), &cur->pVtab->zErrMsg);
     return SQLITE_ERROR;
   } catch (std::exception& ex) {
     std::ostringstream errMessage;
-    errMessage << "Exception caugth in jonoondb_column function. Error: "
+    errMessage << "Exception caught in jonoondb_column function. Error: "
                << ex.what();
     auto str = errMessage.str();
     AllocateAndCopy(str, &cur->pVtab->zErrMsg);
@@ -549,46 +856,52 @@ static int jonoondb_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx,
   return SQLITE_OK;
 }
 
+// The engine has vector results for integers and doubles only. String and
+// blob columns are returned a cell at a time by jonoondb_column, which serves
+// them from the batch gathered by LoadIndexedColumn.
 static int jonoondb_column_vec(sqlite3_vtab_cursor* cur, sqlite3_context* ctx,
                                int cidx) {
   try {
     jonoondb_cursor* jdbCursor = (jonoondb_cursor*)cur;
-    auto& columnInfo = jdbCursor->collectionInfo->columnsInfo[cidx];
-
-    if (columnInfo.columnType == FieldType::STRING) {
-      // Get the string value
-
-    } else if (columnInfo.columnType == FieldType::INT64 ||
-               columnInfo.columnType == FieldType::INT32 ||
-               columnInfo.columnType == FieldType::INT16 ||
-               columnInfo.columnType == FieldType::INT8) {
+    auto& columnInfo = jdbCursor->collectionInfo->columnsInfo.at(cidx);
+    auto& collection = *jdbCursor->collectionInfo->collection;
+    auto& docIDs = jdbCursor->idSeq->Current();
+    auto& batch = GetColumnBatch(jdbCursor, cidx);
+
+    if (columnInfo.columnType == FieldType::INT64 ||
+        columnInfo.columnType == FieldType::INT32 ||
+        columnInfo.columnType == FieldType::INT16 ||
+        columnInfo.columnType == FieldType::INT8) {
       // Get the integer vector
-      // Todo: Try to get values vector from object pool (optimization)
-      // Then we can use SQLITE_STATIC instead of SQLITE_TRANSIENT
-      std::vector<std::int64_t> values;
-      values.resize(jdbCursor->idSeq->Current().size());
-      jdbCursor->collectionInfo->collection->GetDocumentFieldsAsIntegerVector(
-          jdbCursor->idSeq->Current(), columnInfo.columnName,
-          columnInfo.columnNameTokens, values);
-      sqlite3_result_int64_vec(ctx, (void*)values.data(), values.size(),
-                               SQLITE_TRANSIENT);
+      batch.integers.resize(docIDs.size());
+      collection.GetDocumentFieldsAsIntegerVector(
+          docIDs, *columnInfo.fieldAccessor, batch.integers);
+      sqlite3_result_int64_vec(ctx, (void*)batch.integers.data(),
+                               batch.integers.size(), SQLITE_STATIC);
+    } else if (columnInfo.columnType == FieldType::DOUBLE ||
+               columnInfo.columnType == FieldType::FLOAT) {
+      // Get the floating value vector
+      batch.doubles.resize(docIDs.size());
+      collection.GetDocumentFieldsAsDoubleVector(
+          docIDs, *columnInfo.fieldAccessor, batch.doubles);
+      sqlite3_result_double_vec(ctx, (void*)batch.doubles.data(),
+                                batch.doubles.size(), SQLITE_STATIC);
     } else {
-      // Get the floating value
-      std::vector<double> values;
-      values.resize(jdbCursor->idSeq->Current().size());
-      jdbCursor->collectionInfo->collection->GetDocumentFieldsAsDoubleVector(
-          jdbCursor->idSeq->Current(), columnInfo.columnName,
-          columnInfo.columnNameTokens, values);
-      sqlite3_result_double_vec(ctx, (void*)values.data(), values.size(),
-                                SQLITE_TRANSIENT);
+      std::ostringstream ss;
+      ss << "Column " << columnInfo.columnName
+         << " has no vector results, only integer and floating point columns "
+            "have.";
+      AllocateAndCopy(ss.str(), &cur->pVtab->zErrMsg);
+      return SQLITE_ERROR;
     }
   } catch (JonoonDBException& ex) {
     AllocateAndCopy(ex.to_string(), &cur->pVtab->zErrMsg);
     return SQLITE_ERROR;
   } catch (std::exception& ex) {
     std::ostringstream errMessage;
-    errMessage << "Exception caugth in jonoondb_column function. Error: "
-               << ex.what();
+    errMessage
+        << "Exception caught in jonoondb_column_vec function. Error: "
+        << ex.what();
     auto str = errMessage.str();
     AllocateAndCopy(str, &cur->pVtab->zErrMsg);
 
@@ -602,20 +915,38 @@ static int jonoondb_rename(sqlite3_vtab* vtab, const char* newname) {
   return SQLITE_ERROR;
 }
 
+// SQLite calls the transaction methods only for statements that modify the
+// table i.e. deletes. Rows deleted by xUpdate are buffered in the vtab of the
+// connection and persisted in one go in xSync, so a statement deleting N rows
+// does not issue N writes, and transactions on other connections never see
+// or touch them. xSync can still fail and make SQLite roll back, xCommit
+// can't so it has nothing left to do.
 static int jonoondb_begin(sqlite3_vtab* vtab) {
-  return SQLITE_ERROR;
+  jonoondb_vtab* v = (jonoondb_vtab*)vtab;
+  v->pendingDeletes.clear();
+  return SQLITE_OK;
 }
 
 static int jonoondb_sync(sqlite3_vtab* vtab) {
-  return SQLITE_ERROR;
+  jonoondb_vtab* v = (jonoondb_vtab*)vtab;
+  try {
+    v->collectionInfo->collection->AddToDeleteVector(v->pendingDeletes);
+  } catch (std::exception& ex) {
+    return SQLITE_ERROR;
+  }
+
+  v->pendingDeletes.clear();
+  return SQLITE_OK;
 }
 
 static int jonoondb_commit(sqlite3_vtab* vtab) {
-  return SQLITE_ERROR;
+  return SQLITE_OK;
 }
 
 static int jonoondb_rollback(sqlite3_vtab* vtab) {
-  return SQLITE_ERROR;
+  jonoondb_vtab* v = (jonoondb_vtab*)vtab;
+  v->pendingDeletes.clear();
+  return SQLITE_OK;
 }
 
 static int jonoondb_xFindFunction(
@@ -643,22 +974,30 @@ static sqlite3_module jonoondb_mod = {
     jonoondb_column,     /* xColumn()       */
     jonoondb_rowid,      /* xRowid()        */
     jonoondb_update,     /* xUpdate()       */
-    NULL,                /* xBegin()        */
-    NULL,                /* xSync()         */
-    NULL,                /* xCommit()       */
-    NULL,                /* xRollback()     */
+    jonoondb_begin,      /* xBegin()        */
+    jonoondb_sync,       /* xSync()         */
+    jonoondb_commit,     /* xCommit()       */
+    jonoondb_rollback,   /* xRollback()     */
     NULL,                /* xFindFunction() */
     NULL,                /* xRename()       */
     NULL,                /* xSavepoint()    */
     NULL,                /* xRelease()      */
-    NULL                 /* xRollbackTo()   */
+    NULL,                /* xRollbackTo()   */
+    // The vector callbacks are not wired in. jonoondb_column_vec has no
+    // vector results for string and blob columns, and the engine would call
+    // it for every column of the cursor.
+    NULL,                /* xColumnVec()    */
+    NULL                 /* xNextVec()      */
 };
 
-//  jonoondb_column_vec,    /* xColumnVec()    */
-//  jonoondb_next_vec       /* xNextVec()      */
+int jonoondb_stats_vtable_init(sqlite3* db);
 
 int jonoondb_vtable_init(sqlite3* db, char** error,
                          const sqlite3_api_routines* api) {
   SQLITE_EXTENSION_INIT2(api);
-  return sqlite3_create_module(db, "jonoondb_vtable", &jonoondb_mod, NULL);
+  int code = sqlite3_create_module(db, "jonoondb_vtable", &jonoondb_mod, NULL);
+  if (code != SQLITE_OK) {
+    return code;
+  }
+  return jonoondb_stats_vtable_init(db);
 }
@@ -1,4 +1,5 @@
 #include "jonoondb_api/mama_jennies_bitmap.h"
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -6,6 +7,7 @@
 #include "jonoondb_api/buffer_impl.h"
 #include "jonoondb_api/endian_utils.h"
 #include "jonoondb_api/jonoondb_exceptions.h"
+#include "jonoondb_api/query_profile.h"
 
 using namespace jonoondb_api;
 using namespace gsl;
@@ -97,6 +99,56 @@ void MamaJenniesBitmap::Add(std::uint64_t x) {
   }
 }
 
+void MamaJenniesBitmap::AddRange(std::uint64_t start, std::uint64_t end) {
+  if (start < GetSizeInBits()) {
+    throw JonoonDBException(
+        "AddRange to bitmap failed. Most probably the entries were not added "
+        "in increasing order.",
+        __FILE__, __func__, __LINE__);
+  }
+
+  const std::uint64_t wordInBits = 64;
+  auto id = start;
+  // Set the bits up to the next word boundary one at a time
+  for (; id < end && id % wordInBits != 0; id++) {
+    m_ewahBoolArray->set(id);
+  }
+
+  auto words = (end - id) / wordInBits;
+  if (words > 0) {
+    // The run has to start exactly at the current size of the bitmap
+    m_ewahBoolArray->padWithZeroes(id);
+    m_ewahBoolArray->addStreamOfEmptyWords(true, words);
+    id += words * wordInBits;
+  }
+
+  for (; id < end; id++) {
+    m_ewahBoolArray->set(id);
+  }
+}
+
+void MamaJenniesBitmap::Flip(const std::vector<std::uint64_t>& ids) {
+  if (ids.empty()) {
+    return;
+  }
+
+  EWAHBoolArray<std::uint64_t> mask;
+  for (auto id : ids) {
+    if (!mask.set(id)) {
+      throw JonoonDBException("Ids to flip have to be sorted and unique.",
+                              __FILE__, __func__, __LINE__);
+    }
+  }
+
+  auto sizeInBits = GetSizeInBits();
+  auto output = std::make_unique<EWAHBoolArray<std::uint64_t>>();
+  m_ewahBoolArray->logicalxor(mask, *output);
+  // logicalxor rounds the size up to a full word, restore it so the bitmap
+  // can still be extended from where it ended
+  output->setSizeInBits(sizeInBits);
+  m_ewahBoolArray = std::move(output);
+}
+
 std::uint64_t MamaJenniesBitmap::GetSizeInBits() const {
   return m_ewahBoolArray->sizeInBits();
 }
@@ -124,6 +176,9 @@ std::shared_ptr<MamaJenniesBitmap> MamaJenniesBitmap::LogicalAND(
     return bitmaps[0];
   }
   // ok we have more than 1 bitmap
+  if (auto profile = QueryProfile::Current()) {
+    profile->bitmapsANDed += bitmaps.size();
+  }
   std::shared_ptr<MamaJenniesBitmap> b1 = std::make_shared<MamaJenniesBitmap>();
   std::shared_ptr<MamaJenniesBitmap> b2 = std::make_shared<MamaJenniesBitmap>();
 
@@ -154,6 +209,9 @@ std::shared_ptr<MamaJenniesBitmap> MamaJenniesBitmap::LogicalOR(
     return bitmaps[0];
   }
   // ok we have more than 1 bitmap
+  if (auto profile = QueryProfile::Current()) {
+    profile->bitmapsORed += bitmaps.size();
+  }
   std::shared_ptr<MamaJenniesBitmap> b1 = std::make_shared<MamaJenniesBitmap>();
   std::shared_ptr<MamaJenniesBitmap> b2 = std::make_shared<MamaJenniesBitmap>();
 
@@ -171,6 +229,94 @@ std::shared_ptr<MamaJenniesBitmap> MamaJenniesBitmap::LogicalOR(
   return flipper ? b1 : b2;
 }
 
+void MamaJenniesBitmap::Split(const std::vector<std::uint64_t>& ends,
+                              std::vector<MamaJenniesBitmap>& slices) const {
+  const std::uint64_t wordInBits = 64;
+  std::uint64_t start = 0;
+  for (std::size_t i = 0; i < ends.size(); i++) {
+    if (ends[i] < start ||
+        (i + 1 < ends.size() && ends[i] % wordInBits != 0)) {
+      throw InvalidArgumentException(
+          "Split ends have to be increasing multiples of 64, only the last "
+          "end can be any id.",
+          __FILE__, __func__, __LINE__);
+    }
+    start = ends[i];
+  }
+
+  slices.clear();
+  slices.resize(ends.size());
+  if (ends.empty()) {
+    return;
+  }
+
+  // Every slice starts with a run of zeroes up to its first id
+  for (std::size_t i = 1; i < slices.size(); i++) {
+    slices[i].m_ewahBoolArray->addStreamOfEmptyWords(
+        false, ends[i - 1] / wordInBits);
+  }
+
+  // word is the index of the next word of this bitmap, it goes to the first
+  // slice that ends above it
+  std::size_t slice = 0;
+  std::uint64_t word = 0;
+  auto skipFullSlices = [&] {
+    while (slice < ends.size() && word * wordInBits >= ends[slice]) {
+      slice++;
+    }
+  };
+  auto addLiteral = [&](std::uint64_t value) {
+    skipFullSlices();
+    if (slice == ends.size()) {
+      return;
+    }
+    if ((word + 1) * wordInBits > ends[slice]) {
+      // The last slice can end within a word
+      value &= (static_cast<std::uint64_t>(1) << (ends[slice] % wordInBits)) -
+               1;
+    }
+    slices[slice].m_ewahBoolArray->addWord(value);
+    word++;
+  };
+  auto addRun = [&](bool bit, std::uint64_t count) {
+    while (count > 0) {
+      skipFullSlices();
+      if (slice == ends.size()) {
+        return;
+      }
+      auto fullWords = ends[slice] / wordInBits;
+      if (word < fullWords) {
+        auto runLength = std::min(count, fullWords - word);
+        slices[slice].m_ewahBoolArray->addStreamOfEmptyWords(bit, runLength);
+        word += runLength;
+        count -= runLength;
+      } else {
+        addLiteral(bit ? ~static_cast<std::uint64_t>(0) : 0);
+        count--;
+      }
+    }
+  };
+
+  auto iter = m_ewahBoolArray->raw_iterator();
+  while (iter.hasNext() && slice < ends.size()) {
+    auto& rlw = iter.next();
+    addRun(rlw.getRunningBit(), rlw.getRunningLength());
+    auto literals = iter.dirtyWords();
+    for (std::size_t i = 0; i < rlw.getNumberOfLiteralWords(); i++) {
+      addLiteral(literals[i]);
+    }
+  }
+
+  for (std::size_t i = 0; i < slices.size(); i++) {
+    auto& slicedArray = *slices[i].m_ewahBoolArray;
+    if (slicedArray.sizeInBits() < ends[i]) {
+      slicedArray.padWithZeroes(ends[i]);
+    } else {
+      slicedArray.setSizeInBits(ends[i]);
+    }
+  }
+}
+
 void MamaJenniesBitmap::LogicalNOT(MamaJenniesBitmap& output) const {
   m_ewahBoolArray->logicalnot(*output.m_ewahBoolArray);
 }
@@ -190,13 +336,13 @@ MamaJenniesBitmap::const_iterator MamaJenniesBitmap::end() const {
 }
 
 std::unique_ptr<MamaJenniesBitmap::const_iterator>
-MamaJenniesBitmap::begin_pointer() {
+MamaJenniesBitmap::begin_pointer() const {
   auto iter = m_ewahBoolArray->begin();
   return std::make_unique<const_iterator>(iter);
 }
 
 std::unique_ptr<MamaJenniesBitmap::const_iterator>
-MamaJenniesBitmap::end_pointer() {
+MamaJenniesBitmap::end_pointer() const {
   auto iter = m_ewahBoolArray->end();
   return std::make_unique<const_iterator>(iter);
 }
@@ -275,3 +421,7 @@ BitmapType MamaJenniesBitmap::GetType() const {
 bool MamaJenniesBitmap::Empty() const {
   return m_ewahBoolArray->sizeInBits() == 0;
 }
+
+std::uint64_t MamaJenniesBitmap::GetCount() const {
+  return m_ewahBoolArray->numberOfOnes();
+}
@@ -1,18 +1,35 @@
 #include "options_impl.h"
+#include <algorithm>
+#include <thread>
 
 using namespace jonoondb_api;
 
+static std::size_t GetDefaultThreadCount() {
+  // hardware_concurrency returns 0 when it can't tell
+  return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
 OptionsImpl::OptionsImpl() {
   m_createDBIfMissing = true;
   m_maxDataFileSize = 1024L * 1024L * 512L;                       // 512 MB
   m_memCleanupThresholdInBytes = 1024LL * 1024LL * 1024LL * 4LL;  // 4 GB
+  m_maxQueryThreads = GetDefaultThreadCount();
+  m_maxInsertThreads = GetDefaultThreadCount();
+  m_writeLanes = 1;
+  m_insertQueueCapacity = 100000;
+  m_blockWhenInsertQueueFull = true;
 }
 
 OptionsImpl::OptionsImpl(bool createDBIfMissing, size_t maxDataFileSize,
                          std::size_t memClenupThresholdInBytes)
     : m_createDBIfMissing(createDBIfMissing),
       m_maxDataFileSize(maxDataFileSize),
-      m_memCleanupThresholdInBytes(memClenupThresholdInBytes) {}
+      m_memCleanupThresholdInBytes(memClenupThresholdInBytes),
+      m_maxQueryThreads(GetDefaultThreadCount()),
+      m_maxInsertThreads(GetDefaultThreadCount()),
+      m_writeLanes(1),
+      m_insertQueueCapacity(100000),
+      m_blockWhenInsertQueueFull(true) {}
 
 void OptionsImpl::SetCreateDBIfMissing(bool value) {
   m_createDBIfMissing = value;
@@ -37,3 +54,43 @@ void OptionsImpl::SetMemoryCleanupThreshold(std::size_t valInBytes) {
 std::size_t OptionsImpl::GetMemoryCleanupThreshold() {
   return m_memCleanupThresholdInBytes;
 }
+
+void OptionsImpl::SetMaxQueryThreads(std::size_t value) {
+  m_maxQueryThreads = value;
+}
+
+std::size_t OptionsImpl::GetMaxQueryThreads() const {
+  return m_maxQueryThreads;
+}
+
+void OptionsImpl::SetMaxInsertThreads(std::size_t value) {
+  m_maxInsertThreads = value;
+}
+
+std::size_t OptionsImpl::GetMaxInsertThreads() const {
+  return m_maxInsertThreads;
+}
+
+void OptionsImpl::SetWriteLanes(std::size_t value) {
+  m_writeLanes = value;
+}
+
+std::size_t OptionsImpl::GetWriteLanes() const {
+  return m_writeLanes;
+}
+
+void OptionsImpl::SetInsertQueueCapacity(std::size_t value) {
+  m_insertQueueCapacity = value;
+}
+
+std::size_t OptionsImpl::GetInsertQueueCapacity() const {
+  return m_insertQueueCapacity;
+}
+
+void OptionsImpl::SetBlockWhenInsertQueueFull(bool value) {
+  m_blockWhenInsertQueueFull = value;
+}
+
+bool OptionsImpl::GetBlockWhenInsertQueueFull() const {
+  return m_blockWhenInsertQueueFull;
+}
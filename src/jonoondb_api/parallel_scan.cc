@@ -0,0 +1,68 @@
+#include "parallel_scan.h"
+
+using namespace jonoondb_api;
+
+static thread_local ParallelScan* s_currentScan = nullptr;
+static thread_local std::size_t s_currentRange = 0;
+
+ParallelScan::ParallelScan(const DocumentCollection& collection,
+                           std::vector<std::uint64_t> rangeEnds)
+    : m_collection(collection), m_rangeEnds(std::move(rangeEnds)) {}
+
+ParallelScan* ParallelScan::Current(std::size_t& range) {
+  range = s_currentRange;
+  return s_currentScan;
+}
+
+std::uint64_t ParallelScan::GetRangeStart(std::size_t range) const {
+  return range == 0 ? 0 : m_rangeEnds[range - 1];
+}
+
+std::uint64_t ParallelScan::GetRangeEnd(std::size_t range) const {
+  return m_rangeEnds[range];
+}
+
+bool ParallelScan::IsRangeScan(const DocumentCollection& collection,
+                               std::size_t range, std::int64_t startID,
+                               std::int64_t endID) const {
+  return &collection == &m_collection && range < m_rangeEnds.size() &&
+         startID == static_cast<std::int64_t>(GetRangeStart(range)) &&
+         endID == static_cast<std::int64_t>(GetRangeEnd(range));
+}
+
+std::shared_ptr<const MamaJenniesBitmap> ParallelScan::GetSlice(
+    std::size_t range,
+    const std::function<std::shared_ptr<const MamaJenniesBitmap>()>& filter) {
+  // The other workers wait for the first one, filtering the collection
+  // again would not be faster
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_filtered) {
+    m_filtered = true;
+    try {
+      std::vector<MamaJenniesBitmap> slices;
+      filter()->Split(m_rangeEnds, slices);
+      for (auto& slice : slices) {
+        m_slices.push_back(
+            std::make_shared<MamaJenniesBitmap>(std::move(slice)));
+      }
+    } catch (...) {
+      m_filterError = std::current_exception();
+    }
+  }
+
+  if (m_filterError) {
+    std::rethrow_exception(m_filterError);
+  }
+  return m_slices.at(range);
+}
+
+ParallelScanScope::ParallelScanScope(ParallelScan* scan, std::size_t range)
+    : m_previousScan(s_currentScan), m_previousRange(s_currentRange) {
+  s_currentScan = scan;
+  s_currentRange = range;
+}
+
+ParallelScanScope::~ParallelScanScope() {
+  s_currentScan = m_previousScan;
+  s_currentRange = m_previousRange;
+}
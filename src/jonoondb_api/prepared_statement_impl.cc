@@ -0,0 +1,94 @@
+#include "prepared_statement_impl.h"
+#include <sstream>
+#include "jonoondb_exceptions.h"
+#include "query_processor.h"
+#include "resultset_impl.h"
+#include "sqlite3.h"
+
+using namespace jonoondb_api;
+
+PreparedStatementImpl::PreparedStatementImpl(QueryProcessor* queryProcessor,
+                                             const std::string& sql,
+                                             std::int32_t parameterCount,
+                                             bool isDelete)
+    : m_queryProcessor(queryProcessor),
+      m_sql(sql),
+      m_isDelete(isDelete),
+      m_parameters(parameterCount) {
+  ClearBindings();
+}
+
+std::int32_t PreparedStatementImpl::GetParameterCount() const {
+  return static_cast<std::int32_t>(m_parameters.size());
+}
+
+void PreparedStatementImpl::BindInteger(std::int32_t paramIndex,
+                                        std::int64_t val) {
+  auto& param = GetParameter(paramIndex);
+  param.type = SQLITE_INTEGER;
+  param.intVal = val;
+}
+
+void PreparedStatementImpl::BindDouble(std::int32_t paramIndex, double val) {
+  auto& param = GetParameter(paramIndex);
+  param.type = SQLITE_FLOAT;
+  param.doubleVal = val;
+}
+
+void PreparedStatementImpl::BindString(std::int32_t paramIndex,
+                                       const boost::string_ref& val) {
+  auto& param = GetParameter(paramIndex);
+  param.type = SQLITE_TEXT;
+  param.bytes.assign(val.data(), val.size());
+}
+
+void PreparedStatementImpl::BindBlob(std::int32_t paramIndex, const char* val,
+                                     std::uint64_t size) {
+  auto& param = GetParameter(paramIndex);
+  param.type = SQLITE_BLOB;
+  param.bytes.assign(val, size);
+}
+
+void PreparedStatementImpl::BindNull(std::int32_t paramIndex) {
+  auto& param = GetParameter(paramIndex);
+  param.type = SQLITE_NULL;
+  param.bytes.clear();
+}
+
+void PreparedStatementImpl::ClearBindings() {
+  for (auto& param : m_parameters) {
+    param.type = SQLITE_NULL;
+    param.bytes.clear();
+  }
+}
+
+ResultSetImpl PreparedStatementImpl::ExecuteSelect() {
+  if (m_isDelete) {
+    throw ApiMisuseException(
+        "ExecuteSelect cannot execute a delete statement, use ExecuteDelete.",
+        __FILE__, __func__, __LINE__);
+  }
+
+  return m_queryProcessor->ExecutePreparedSelect(m_sql, m_parameters);
+}
+
+std::int64_t PreparedStatementImpl::ExecuteDelete() {
+  if (!m_isDelete) {
+    throw ApiMisuseException(
+        "ExecuteDelete cannot execute a select statement, use ExecuteSelect.",
+        __FILE__, __func__, __LINE__);
+  }
+
+  return m_queryProcessor->ExecutePreparedDelete(m_sql, m_parameters);
+}
+
+ParameterValue& PreparedStatementImpl::GetParameter(std::int32_t paramIndex) {
+  if (paramIndex < 1 || paramIndex > m_parameters.size()) {
+    std::ostringstream ss;
+    ss << "Argument paramIndex " << paramIndex << " is out of range, the "
+       << "statement has " << m_parameters.size() << " parameter(s).";
+    throw IndexOutOfBoundException(ss.str(), __FILE__, __func__, __LINE__);
+  }
+
+  return m_parameters[paramIndex - 1];
+}
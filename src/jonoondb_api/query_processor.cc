@@ -1,26 +1,92 @@
 #include "query_processor.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include "aggregate_query.h"
+#include "column_aggregate.h"
+#include "constraint.h"
 #include "document_collection.h"
 #include "document_collection_dictionary.h"
 #include "document_schema.h"
+#include "engine_stats.h"
 #include "enums.h"
 #include "exception_utils.h"
 #include "field.h"
 #include "guard_funcs.h"
+#include "index_info_impl.h"
+#include "index_stat.h"
 #include "jonoondb_api/sqlite_utils.h"
 #include "jonoondb_exceptions.h"
-#include "path_utils.h"
+#include "mama_jennies_bitmap.h"
+#include "null_bitmap.h"
+#include "parallel_scan.h"
+#include "prepared_statement_impl.h"
+#include "query_connection.h"
+#include "query_profile.h"
 #include "resultset_impl.h"
 #include "sqlite3.h"
+#include "statement_cache.h"
 #include "string_utils.h"
+#include "thread_pool.h"
+#include "value_bitmap.h"
 
 using namespace jonoondb_api;
 using namespace boost::filesystem;
 using namespace std;
 
+namespace jonoondb_api {
+// A row produced by a partial aggregate query or computed from the indexes.
+// The rows are read on the worker connections and written to the merge
+// connection afterwards, so the values are copied out of SQLite.
+struct PartialValue {
+  int type;
+  std::int64_t intVal;
+  double doubleVal;
+  std::string bytes;
+};
+
+struct PartialRow {
+  std::vector<PartialValue> values;
+};
+
+// The ranges of a parallel aggregate query. Pool threads that start after
+// every range is taken return without touching the query.
+struct ParallelAggregateState {
+  ParallelAggregateState(const AggregateQuery& aggregateQuery,
+                         const DocumentCollection& collection,
+                         std::vector<std::uint64_t> rangeEnds,
+                         bool collectProfile)
+      : query(aggregateQuery),
+        partialRows(rangeEnds.size()),
+        errors(rangeEnds.size()),
+        profiles(collectProfile ? rangeEnds.size() : 0),
+        scan(collection, std::move(rangeEnds)) {}
+
+  const AggregateQuery& query;
+  std::vector<std::vector<PartialRow>> partialRows;
+  std::vector<std::exception_ptr> errors;
+  std::vector<QueryProfile> profiles;
+  std::mutex mutex;
+  std::condition_variable rangeDone;
+  std::size_t nextRange = 0;
+  std::size_t doneCount = 0;
+  ParallelScan scan;
+};
+}  // namespace jonoondb_api
+
+// Splitting a query only pays off if every thread gets at least this many
+// documents to aggregate
+const std::uint64_t MinDocumentsPerQueryThread = 8192;
+const char* PartialAggregateTableName = "temp.jonoondb_partial_aggregate";
+// Number of idle prepared statements kept per connection
+const std::size_t StatementCacheCapacity = 64;
+
 struct sqlite3_api_routines;
 int jonoondb_vtable_init(sqlite3* db, char** error,
                          const sqlite3_api_routines* api);
@@ -47,46 +113,244 @@ static int jonoondb_delete_auth_callback(void* /*userData*/, int actionCode,
   return SQLITE_DENY;
 }
 
-QueryProcessor::QueryProcessor(const std::string& dbPath,
-                               const std::string& dbName)
-    : m_readWriteDBConnection(nullptr, GuardFuncs::SQLite3Close),
-      m_deleteStmtConnection(nullptr, GuardFuncs::SQLite3Close),
-      m_dbConnectionPool(nullptr),
-      m_dbName(dbName) {
-  std::string normalizedDBPath = PathUtils::NormalizePath(dbPath);
-  normalizedDBPath += dbName;
-  boost::replace_all(normalizedDBPath, "/", "_");
-  boost::replace_all(normalizedDBPath, ":", "_");
-  boost::replace_all(normalizedDBPath, ".", "_");
+// Read connections are handed the statements of ExecuteSelect, they may
+// only read. Declaring the collections and storing partial aggregates runs
+// within an InternalStatementScope.
+static int jonoondb_read_auth_callback(void* userData, int actionCode,
+                                       const char* param1,
+                                       const char* /*param2*/,
+                                       const char* /*dbName*/,
+                                       const char* /*triggerName*/) {
+  auto connection = static_cast<QueryConnection*>(userData);
+  if (connection->isInternalStatement || actionCode == SQLITE_SELECT ||
+      actionCode == SQLITE_READ || actionCode == SQLITE_FUNCTION ||
+      actionCode == SQLITE_RECURSIVE) {
+    return SQLITE_OK;
+  } else if (IsMasterTableOperation(actionCode, param1)) {
+    // SQLite declares eponymous vtables like jonoondb_stats on first use
+    return SQLITE_OK;
+  }
+  return SQLITE_DENY;
+}
+
+// Lets the query processor run its own statements on a read connection
+class InternalStatementScope final {
+ public:
+  explicit InternalStatementScope(QueryConnection& connection)
+      : m_connection(connection) {
+    m_connection.isInternalStatement = true;
+  }
+
+  ~InternalStatementScope() {
+    m_connection.isInternalStatement = false;
+  }
+
+  InternalStatementScope(const InternalStatementScope&) = delete;
+  InternalStatementScope& operator=(const InternalStatementScope&) = delete;
+
+ private:
+  QueryConnection& m_connection;
+};
+
+static void ThrowSQLiteError(sqlite3* db, int code) {
+  const char* errMsg = sqlite3_errmsg(db);
+  if (errMsg != nullptr) {
+    throw SQLException(errMsg, __FILE__, __func__, __LINE__);
+  }
+
+  throw SQLException(sqlite3_errstr(code), __FILE__, __func__, __LINE__);
+}
+
+// Adds the rows of SQLite's EXPLAIN QUERY PLAN for sql to the plan of the
+// profile. Errors are ignored, they are reported when sql itself is prepared.
+static void ExplainQueryPlan(sqlite3* db, const std::string& sql,
+                             QueryProfile& profile) {
+  std::string explainSql = "EXPLAIN QUERY PLAN " + sql;
+  sqlite3_stmt* stmt = nullptr;
+  int code = sqlite3_prepare_v2(db, explainSql.c_str(), explainSql.size(),
+                                &stmt, nullptr);
+  std::unique_ptr<sqlite3_stmt, void (*)(sqlite3_stmt*)> stmtGuard(
+      stmt, GuardFuncs::SQLite3Finalize);
+  if (code != SQLITE_OK || stmt == nullptr) {
+    return;
+  }
+
+  // The rows are id, parent, notused, detail. Nested rows are indented under
+  // their parent.
+  std::map<int, int> depths;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    auto id = sqlite3_column_int(stmt, 0);
+    auto parentIter = depths.find(sqlite3_column_int(stmt, 1));
+    auto depth = parentIter == depths.end() ? 0 : parentIter->second + 1;
+    depths[id] = depth;
+    auto detail = sqlite3_column_text(stmt, 3);
+    profile.sqlitePlan.push_back(
+        std::string(depth * 2, ' ') +
+        (detail ? reinterpret_cast<const char*>(detail) : ""));
+  }
+}
+
+// Executes a statement that declares or drops a vtable. The authorizer of the
+// delete connection doesn't allow these, so it is removed for the statement.
+static void ExecuteSchemaStatement(sqlite3* db, const std::string& sql,
+                                   bool isDeleteConnection) {
+  if (isDeleteConnection) {
+    sqlite3_set_authorizer(db, nullptr, nullptr);
+  }
+  char* errMsg = nullptr;
+  int code = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg);
+  if (isDeleteConnection) {
+    sqlite3_set_authorizer(db, jonoondb_delete_auth_callback, nullptr);
+  }
+  SQLiteUtils::HandleSQLiteCode(code, errMsg);
+}
+
+// Stores the rows in a temp table of db, the columns of the table are named
+// c0, c1 ... in the order of the row values
+static void StoreRows(QueryConnection& connection, std::size_t columnCount,
+                      const std::vector<std::vector<PartialRow>>& rowGroups) {
+  InternalStatementScope scope(connection);
+  sqlite3* db = connection.db.get();
+  connection.hasPartialAggregate = true;
+  std::ostringstream ss;
+  ss << "DROP TABLE IF EXISTS " << PartialAggregateTableName << ";"
+     << "CREATE TABLE " << PartialAggregateTableName << " (";
+  for (std::size_t i = 0; i < columnCount; i++) {
+    ss << (i > 0 ? ", " : "") << "c" << i;
+  }
+  ss << ");";
+  char* errMsg = nullptr;
+  int code = sqlite3_exec(db, ss.str().c_str(), nullptr, nullptr, &errMsg);
+  SQLiteUtils::HandleSQLiteCode(code, errMsg);
+
+  ss.str("");
+  ss << "INSERT INTO " << PartialAggregateTableName << " VALUES (";
+  for (std::size_t i = 0; i < columnCount; i++) {
+    ss << (i > 0 ? ", ?" : "?");
+  }
+  ss << ");";
+  auto insertSql = ss.str();
+  sqlite3_stmt* stmt = nullptr;
+  code = sqlite3_prepare_v2(db, insertSql.c_str(), insertSql.size(), &stmt,
+                            nullptr);
+  std::unique_ptr<sqlite3_stmt, void (*)(sqlite3_stmt*)> stmtGuard(
+      stmt, GuardFuncs::SQLite3Finalize);
+  if (code != SQLITE_OK) {
+    ThrowSQLiteError(db, code);
+  }
+
+  code = sqlite3_exec(db, "BEGIN", nullptr, nullptr, &errMsg);
+  SQLiteUtils::HandleSQLiteCode(code, errMsg);
+  try {
+    for (auto& rows : rowGroups) {
+      for (auto& row : rows) {
+        for (int i = 0; i < row.values.size(); i++) {
+          auto& value = row.values[i];
+          switch (value.type) {
+            case SQLITE_INTEGER:
+              code = sqlite3_bind_int64(stmt, i + 1, value.intVal);
+              break;
+            case SQLITE_FLOAT:
+              code = sqlite3_bind_double(stmt, i + 1, value.doubleVal);
+              break;
+            case SQLITE_TEXT:
+              code = sqlite3_bind_text(stmt, i + 1, value.bytes.data(),
+                                       value.bytes.size(), SQLITE_STATIC);
+              break;
+            case SQLITE_BLOB:
+              code = sqlite3_bind_blob(stmt, i + 1, value.bytes.data(),
+                                       value.bytes.size(), SQLITE_STATIC);
+              break;
+            default:
+              code = sqlite3_bind_null(stmt, i + 1);
+              break;
+          }
+          SQLiteUtils::HandleSQLiteCode(code);
+        }
 
-  m_dbConnStr = "file::";
-  m_dbConnStr += normalizedDBPath;
-  m_dbConnStr += "?mode=memory&cache=shared";
+        code = sqlite3_step(stmt);
+        if (code != SQLITE_DONE) {
+          ThrowSQLiteError(db, code);
+        }
+        SQLiteUtils::ClearAndResetStatement(stmt);
+      }
+    }
+  } catch (...) {
+    sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+    throw;
+  }
+
+  code = sqlite3_exec(db, "COMMIT", nullptr, nullptr, &errMsg);
+  SQLiteUtils::HandleSQLiteCode(code, errMsg);
+}
+
+static void BindParameters(sqlite3_stmt* stmt,
+                           const std::vector<ParameterValue>& parameters) {
+  // The values are copied because the prepared statement can be bound again
+  // while the resultset of an earlier execution is still being read
+  for (int i = 0; i < parameters.size(); i++) {
+    auto& value = parameters[i];
+    int code;
+    switch (value.type) {
+      case SQLITE_INTEGER:
+        code = sqlite3_bind_int64(stmt, i + 1, value.intVal);
+        break;
+      case SQLITE_FLOAT:
+        code = sqlite3_bind_double(stmt, i + 1, value.doubleVal);
+        break;
+      case SQLITE_TEXT:
+        code = sqlite3_bind_text(stmt, i + 1, value.bytes.data(),
+                                 value.bytes.size(), SQLITE_TRANSIENT);
+        break;
+      case SQLITE_BLOB:
+        code = sqlite3_bind_blob(stmt, i + 1, value.bytes.data(),
+                                 value.bytes.size(), SQLITE_TRANSIENT);
+        break;
+      default:
+        code = sqlite3_bind_null(stmt, i + 1);
+        break;
+    }
+    SQLiteUtils::HandleSQLiteCode(code);
+  }
+}
 
+QueryProcessor::QueryProcessor(const std::string& dbName,
+                               std::size_t maxQueryThreads)
+    : m_deleteStmtConnection(nullptr, GuardFuncs::SQLite3Close),
+      m_schemaVersion(0),
+      m_dbConnectionPool(nullptr),
+      m_dbName(dbName),
+      m_maxQueryThreads(maxQueryThreads) {
   int code = sqlite3_auto_extension((void (*)(void))jonoondb_vtable_init);
   SQLiteUtils::HandleSQLiteCode(code);
 
   sqlite3* db = nullptr;
-  code = sqlite3_open_v2(
-      m_dbConnStr.c_str(), &db,
-      SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, nullptr);
-  m_readWriteDBConnection.reset(db);
-  SQLiteUtils::HandleSQLiteCode(code);
-
-  db = nullptr;
-  code = sqlite3_open_v2(m_dbConnStr.c_str(), &db,
-                         SQLITE_OPEN_READWRITE | SQLITE_OPEN_URI, nullptr);
+  code = sqlite3_open_v2(":memory:", &db, SQLITE_OPEN_READWRITE, nullptr);
   m_deleteStmtConnection.reset(db);
   SQLiteUtils::HandleSQLiteCode(code);
   code = sqlite3_set_authorizer(db, jonoondb_delete_auth_callback, nullptr);
   SQLiteUtils::HandleSQLiteCode(code);
+  m_deleteStatementCache.reset(new StatementCache(StatementCacheCapacity));
+
+  // Initialize the connection pool with enough connections for a parallel
+  // query and its merge step, more are opened up to the capacity when
+  // queries run concurrently
+  int poolSize = static_cast<int>(m_maxQueryThreads) + 1;
+  m_dbConnectionPool.reset(new ObjectPool<QueryConnection>(
+      poolSize, poolSize * 2, std::bind(&QueryProcessor::OpenConnection, this),
+      std::bind(&QueryProcessor::CloseConnection, this, std::placeholders::_1),
+      std::bind(&QueryProcessor::ResetConnection, this,
+                std::placeholders::_1)));
 
-  // Initialize the connection pool
-  m_dbConnectionPool.reset(new ObjectPool<sqlite3>(
-      5, 10, std::bind(&QueryProcessor::OpenConnection, this),
-      GuardFuncs::SQLite3Close));
+  // The thread that runs a parallel query is one of the query threads
+  m_queryThreadPool.reset(
+      new ThreadPool(std::max<std::size_t>(m_maxQueryThreads, 1) - 1));
 }
 
+// The members are destroyed in reverse order, the statement caches are
+// destroyed before the connections they belong to are closed
+QueryProcessor::~QueryProcessor() = default;
+
 const char* GetSQLiteTypeString(FieldType fieldType) {
   static std::string integer = "INTEGER";
   static std::string real = "REAL";
@@ -116,7 +380,8 @@ const char* GetSQLiteTypeString(FieldType fieldType) {
   }
 }
 
-void BuildCreateTableStatement(const Field* complexField,
+void BuildCreateTableStatement(const DocumentSchema& documentSchema,
+                               const Field* complexField,
                                std::list<std::string>& prefixes,
                                std::ostringstream& stringStream,
                                std::vector<ColumnInfo>& columnNames) {
@@ -130,7 +395,8 @@ void BuildCreateTableStatement(const Field* complexField,
 
     if (field->GetType() == FieldType::COMPLEX) {
       prefixes.push_back(field->GetName());
-      BuildCreateTableStatement(field, prefixes, stringStream, columnNames);
+      BuildCreateTableStatement(documentSchema, field, prefixes, stringStream,
+                                columnNames);
     } else if (field->GetType() == FieldType::UNION ||
                field->GetType() == FieldType::VECTOR) {
       // We don't support these types yet for querying
@@ -141,8 +407,9 @@ void BuildCreateTableStatement(const Field* complexField,
         fullName.append(prefix).append(".");
       }
       fullName.append(field->GetName());
-      columnNames.push_back(ColumnInfo(fullName, field->GetType(),
-                                       StringUtils::Split(fullName, ".")));
+      columnNames.push_back(
+          ColumnInfo(fullName, field->GetType(),
+                     documentSchema.CreateFieldAccessor(fullName)));
       stringStream << "'" << fullName << "'"
                    << " " << GetSQLiteTypeString(field->GetType());
       stringStream << ", ";
@@ -157,19 +424,21 @@ void BuildCreateTableStatement(const Field* complexField,
 void GenerateCreateTableStatementForCollection(
     const std::shared_ptr<DocumentCollection>& collection,
     std::ostringstream& stringStream, std::vector<ColumnInfo>& columnNames) {
-  Field* field = collection->GetDocumentSchema()->AllocateField();
+  auto& documentSchema = *collection->GetDocumentSchema();
+  Field* field = documentSchema.AllocateField();
   std::unique_ptr<Field, void (*)(Field*)> fieldGuard(field,
                                                       GuardFuncs::DisposeField);
 
   stringStream.clear();
   stringStream << "CREATE TABLE " << collection->GetName() << " (";
-  auto count = collection->GetDocumentSchema()->GetRootFieldCount();
+  auto count = documentSchema.GetRootFieldCount();
   for (size_t i = 0; i < count; i++) {
-    collection->GetDocumentSchema()->GetRootField(i, field);
+    documentSchema.GetRootField(i, field);
     if (field->GetType() == FieldType::COMPLEX) {
       std::list<std::string> prefixes;
       prefixes.push_back(field->GetName());
-      BuildCreateTableStatement(field, prefixes, stringStream, columnNames);
+      BuildCreateTableStatement(documentSchema, field, prefixes, stringStream,
+                                columnNames);
     } else if (field->GetType() == FieldType::UNION ||
                field->GetType() == FieldType::VECTOR) {
       // We don't support these types yet for querying
@@ -177,14 +446,18 @@ void GenerateCreateTableStatementForCollection(
     } else {
       columnNames.push_back(
           ColumnInfo(field->GetName(), field->GetType(),
-                     StringUtils::Split(field->GetName(), ".")));
+                     documentSchema.CreateFieldAccessor(field->GetName())));
       stringStream << field->GetName() << " "
                    << GetSQLiteTypeString(field->GetType());
       stringStream << ", ";
     }
   }
 
-  // Add hidden columns
+  // Add hidden columns, they come after all the visible columns so their
+  // column index in the vtable matches their position in columnNames
+  columnNames.push_back(ColumnInfo(
+      "_document", FieldType::BLOB,
+      documentSchema.CreateFieldAccessor("_document")));
   stringStream << "_document BLOB HIDDEN);";
 }
 
@@ -203,47 +476,126 @@ void QueryProcessor::AddCollection(
   key.append(m_dbName).append(">").append(collection->GetName()).append("'");
   DocumentCollectionDictionary::Instance()->Insert(key, docColInfo);
 
+  // Every connection has its own database, the vtables are declared in the
+  // temp schema so the read only connections can declare them as well
   std::ostringstream sqlStmt;
-  sqlStmt << "CREATE VIRTUAL TABLE " << collection->GetName()
+  sqlStmt << "CREATE VIRTUAL TABLE temp." << collection->GetName()
           << " USING jonoondb_vtable(" << key << ")";
+  auto createStmt = sqlStmt.str();
 
-  char* errMsg;
-  int code = sqlite3_exec(m_readWriteDBConnection.get(), sqlStmt.str().c_str(),
-                          nullptr, nullptr, &errMsg);
-  if (code != SQLITE_OK) {
+  try {
+    std::lock_guard<std::mutex> lock(m_deleteStmtMutex);
+    ExecuteSchemaStatement(m_deleteStmtConnection.get(), createStmt, true);
+  } catch (...) {
     // DocumentCollectionDictionary should have the collection after successful
     // addition. This is required when jonoondb_connect is called instead on
     // jonoondb_create. However if we fail to add the collection then it should
     // be removed.
     DocumentCollectionDictionary::Instance()->Remove(key);
-    SQLiteUtils::HandleSQLiteCode(code, errMsg);
+    throw;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_schemaMutex);
+    auto version = m_schemaVersion.load(std::memory_order_relaxed) + 1;
+    m_collectionVTables[collection->GetName()] = {version, createStmt};
+    m_schemaVersion.store(version, std::memory_order_release);
   }
+  UpdateIdleConnections();
 }
 
 void jonoondb_api::QueryProcessor::RemoveCollection(
     const std::string& collectionName) {
-  std::string stmt = "DROP TABLE IF EXISTS ";
+  std::string stmt = "DROP TABLE IF EXISTS temp.";
   stmt.append(collectionName).append(";");
-  char* errMsg;
-  int code = sqlite3_exec(m_readWriteDBConnection.get(), stmt.c_str(), nullptr,
-                          nullptr, &errMsg);
-  SQLiteUtils::HandleSQLiteCode(code, errMsg);
+  {
+    std::lock_guard<std::mutex> lock(m_deleteStmtMutex);
+    ExecuteSchemaStatement(m_deleteStmtConnection.get(), stmt, true);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_schemaMutex);
+    m_collectionVTables.erase(collectionName);
+    m_schemaVersion.store(m_schemaVersion.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_release);
+  }
+  UpdateIdleConnections();
 
   std::string key("'");
   key.append(m_dbName).append(">").append(collectionName).append("'");
   DocumentCollectionDictionary::Instance()->Remove(key);
 }
 
-ResultSetImpl QueryProcessor::ExecuteSelect(
-    const std::string& selectStatement) {
-  // connection comming from m_dbConnectionPool are readonly
-  // so we dont have to worry about sql injection
-  return ResultSetImpl(ObjectPoolGuard<sqlite3>(m_dbConnectionPool.get(),
-                                                m_dbConnectionPool->Take()),
-                       selectStatement);
+ResultSetImpl QueryProcessor::ExecuteSelect(const std::string& selectStatement,
+                                            bool collectProfile) {
+  if (!collectProfile) {
+    return ExecuteSelectInternal(selectStatement, nullptr);
+  }
+
+  // Everything the query does until the resultset is returned is recorded
+  // on this thread, the resultset records its own execution
+  auto profile = std::make_unique<QueryProfile>();
+  ResultSetImpl resultSet = [&] {
+    QueryProfileScope scope(profile.get());
+    StageTimer timer(&profile->prepareTime);
+    return ExecuteSelectInternal(selectStatement, profile.get());
+  }();
+  resultSet.SetProfile(std::move(profile));
+  return resultSet;
+}
+
+ResultSetImpl QueryProcessor::ExecuteSelectInternal(
+    const std::string& selectStatement, QueryProfile* profile) {
+  AggregateQuery query;
+  std::shared_ptr<DocumentCollectionInfo> collectionInfo;
+  if (AggregateQuery::TryParse(selectStatement, query)) {
+    std::string key("'");
+    key.append(m_dbName).append(">").append(query.GetCollectionName())
+        .append("'");
+    DocumentCollectionDictionary::Instance()->TryGet(key, collectionInfo);
+  }
+
+  if (collectionInfo) {
+    // Aggregates the indexes can answer don't need to read any document
+    std::vector<std::vector<PartialRow>> rows(1);
+    if (query.IsColumnAggregate() &&
+        TryComputeColumnAggregate(query, *collectionInfo, rows[0])) {
+      if (profile) {
+        profile->plan = "INDEX AGGREGATE";
+      }
+      auto connection = TakeConnection();
+      StoreRows(*connection, query.GetColumnAggregateItems().size(), rows);
+      return ResultSetImpl(std::move(connection),
+                           query.GetResultStatement(PartialAggregateTableName));
+    }
+
+    // Aggregates over big collections are split across threads
+    auto documentCount = collectionInfo->collection->GetDocumentCount();
+    auto threadCount = std::min<std::uint64_t>(
+        m_maxQueryThreads, documentCount / MinDocumentsPerQueryThread);
+    // The partial statement doesn't keep the aliases of the query, if it
+    // refers to one SQLite runs the whole query
+    if (threadCount > 1 && CanPreparePartialStatement(query)) {
+      if (profile) {
+        profile->plan = "PARALLEL AGGREGATE";
+        profile->workerThreads = threadCount;
+      }
+      return ExecuteParallelAggregate(query, *collectionInfo->collection,
+                                      documentCount, threadCount);
+    }
+  }
+
+  // The authorizer of the connection rejects everything but queries
+  auto connection = TakeConnection();
+  if (profile) {
+    profile->plan = "SQLITE";
+    ExplainQueryPlan(connection->db.get(), selectStatement, *profile);
+  }
+  return ResultSetImpl(std::move(connection), selectStatement);
 }
 
 std::int64_t QueryProcessor::Delete(const std::string& deleteStatement) {
+  std::lock_guard<std::mutex> lock(m_deleteStmtMutex);
   char* errMsg;
   int code = sqlite3_exec(m_deleteStmtConnection.get(), deleteStatement.c_str(),
                           nullptr, nullptr, &errMsg);
@@ -261,14 +613,597 @@ std::int64_t QueryProcessor::Delete(const std::string& deleteStatement) {
   return sqlite3_changes(m_deleteStmtConnection.get());
 }
 
-sqlite3* QueryProcessor::OpenConnection() {
+static void ThrowDeleteNotAllowed() {
+  throw ApiMisuseException(
+      "Only delete and select statement is allowed on delete API.", __FILE__,
+      __func__, __LINE__);
+}
+
+PreparedStatementImpl QueryProcessor::Prepare(const std::string& statement) {
+  // Queries are prepared on a read connection, the statement stays in the
+  // cache of the connection for the first execution
+  {
+    auto connection = TakeConnection();
+    auto& cache = connection->statementCache;
+    sqlite3_stmt* stmt = nullptr;
+    int code = cache.Acquire(connection->db.get(), statement, stmt);
+    if (code == SQLITE_OK && stmt == nullptr) {
+      throw InvalidArgumentException(
+          "Argument statement does not contain a SQL statement.", __FILE__,
+          __func__, __LINE__);
+    }
+
+    if (code == SQLITE_OK) {
+      // Transaction statements are read only as well but return no columns
+      bool isQuery = sqlite3_stmt_readonly(stmt) != 0 &&
+                     sqlite3_column_count(stmt) > 0;
+      auto parameterCount = sqlite3_bind_parameter_count(stmt);
+      cache.Release(statement, stmt);
+      if (isQuery) {
+        return PreparedStatementImpl(this, statement, parameterCount, false);
+      }
+    }
+  }
+
+  // Anything else has to be a delete, the authorizer of the delete
+  // connection rejects all other statements
+  std::lock_guard<std::mutex> lock(m_deleteStmtMutex);
+  sqlite3* db = m_deleteStmtConnection.get();
+  sqlite3_stmt* stmt = nullptr;
+  int code = m_deleteStatementCache->Acquire(db, statement, stmt);
+  if (code == SQLITE_AUTH) {
+    ThrowDeleteNotAllowed();
+  } else if (code != SQLITE_OK) {
+    ThrowSQLiteError(db, code);
+  }
+
+  bool isReadOnly = sqlite3_stmt_readonly(stmt) != 0;
+  auto parameterCount = sqlite3_bind_parameter_count(stmt);
+  m_deleteStatementCache->Release(statement, stmt);
+  if (isReadOnly) {
+    ThrowDeleteNotAllowed();
+  }
+
+  return PreparedStatementImpl(this, statement, parameterCount, true);
+}
+
+ResultSetImpl QueryProcessor::ExecutePreparedSelect(
+    const std::string& selectStatement,
+    const std::vector<ParameterValue>& parameters) {
+  auto connection = TakeConnection();
+  auto cache = &connection->statementCache;
+  sqlite3_stmt* stmt = nullptr;
+  int code = cache->Acquire(connection->db.get(), selectStatement, stmt);
+  if (code != SQLITE_OK) {
+    ThrowSQLiteError(connection->db.get(), code);
+  }
+
+  // The statement goes back to the cache when the resultset is destroyed
+  std::function<void(sqlite3_stmt*)> releaseFunc =
+      [cache, selectStatement](sqlite3_stmt* stmt) {
+        cache->Release(selectStatement, stmt);
+      };
+  std::unique_ptr<sqlite3_stmt, std::function<void(sqlite3_stmt*)>> stmtGuard(
+      stmt, releaseFunc);
+  BindParameters(stmt, parameters);
+
+  return ResultSetImpl(std::move(connection), stmtGuard.release(),
+                       std::move(releaseFunc));
+}
+
+std::int64_t QueryProcessor::ExecutePreparedDelete(
+    const std::string& deleteStatement,
+    const std::vector<ParameterValue>& parameters) {
+  std::lock_guard<std::mutex> lock(m_deleteStmtMutex);
+  sqlite3* db = m_deleteStmtConnection.get();
+  auto cache = m_deleteStatementCache.get();
+  sqlite3_stmt* stmt = nullptr;
+  int code = cache->Acquire(db, deleteStatement, stmt);
+  if (code == SQLITE_AUTH) {
+    ThrowDeleteNotAllowed();
+  } else if (code != SQLITE_OK) {
+    ThrowSQLiteError(db, code);
+  }
+
+  std::unique_ptr<sqlite3_stmt, std::function<void(sqlite3_stmt*)>> stmtGuard(
+      stmt, [cache, &deleteStatement](sqlite3_stmt* stmt) {
+        cache->Release(deleteStatement, stmt);
+      });
+  BindParameters(stmt, parameters);
+  code = sqlite3_step(stmt);
+  if (code != SQLITE_DONE) {
+    ThrowSQLiteError(db, code);
+  }
+
+  return sqlite3_changes(db);
+}
+
+ResultSetImpl QueryProcessor::ExecuteParallelAggregate(
+    const AggregateQuery& query, const DocumentCollection& collection,
+    std::uint64_t documentCount, std::size_t threadCount) {
+  // Every range is a contiguous range of document ids that is aggregated on
+  // its own connection. Workers of a profiled query record into the profile
+  // of their range, they are merged into the profile of the query at the
+  // end. The ranges start at multiples of 64, so the filtered ids of the
+  // query can be split into them word by word.
+  std::vector<std::uint64_t> rangeEnds(threadCount);
+  for (std::size_t i = 0; i + 1 < threadCount; i++) {
+    rangeEnds[i] = documentCount * (i + 1) / threadCount / 64 * 64;
+  }
+  rangeEnds.back() = documentCount;
+  auto profile = QueryProfile::Current();
+  auto state = std::make_shared<ParallelAggregateState>(
+      query, collection, std::move(rangeEnds), profile != nullptr);
+  // Pool threads only help with a connection the pool has room for, the
+  // ranges they can't take are left to this thread
+  auto runRanges = [this, state](bool withinCapacity) {
+    auto connection = TakeConnection(withinCapacity);
+    if (static_cast<QueryConnection*>(connection) == nullptr) {
+      return;
+    }
+
+    while (true) {
+      std::size_t i;
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->nextRange == state->partialRows.size()) {
+          return;
+        }
+        i = state->nextRange++;
+      }
+
+      std::int64_t startID = state->scan.GetRangeStart(i);
+      std::int64_t endID = state->scan.GetRangeEnd(i);
+      try {
+        QueryProfileScope scope(state->profiles.empty() ? nullptr
+                                                        : &state->profiles[i]);
+        ParallelScanScope scanScope(&state->scan, i);
+        ExecutePartialAggregate(*connection, state->query, startID, endID,
+                                state->partialRows[i]);
+      } catch (...) {
+        state->errors[i] = std::current_exception();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->doneCount++;
+      }
+      state->rangeDone.notify_all();
+    }
+  };
+
+  // This thread aggregates ranges too, the pool only helps with the others
+  auto taskCount =
+      std::min(m_queryThreadPool->GetThreadCount(), threadCount - 1);
+  for (std::size_t t = 0; t < taskCount; t++) {
+    m_queryThreadPool->Submit([runRanges] { runRanges(true); });
+  }
+  runRanges(false);
+  {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->rangeDone.wait(
+        lock, [&] { return state->doneCount == state->partialRows.size(); });
+  }
+
+  for (auto& error : state->errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  for (auto& rangeProfile : state->profiles) {
+    profile->Merge(rangeProfile);
+  }
+
+  // Store the partial rows in a temp table of the connection that will back
+  // the resultset and run the merge query on it
+  auto connection = TakeConnection();
+  StoreRows(*connection, query.GetPartialColumnCount(), state->partialRows);
+  return ResultSetImpl(std::move(connection),
+                       query.GetMergeStatement(PartialAggregateTableName));
+}
+
+bool QueryProcessor::CanPreparePartialStatement(const AggregateQuery& query) {
+  auto connection = TakeConnection();
+  auto& cache = connection->statementCache;
+  auto& sql = query.GetPartialStatement();
+  sqlite3_stmt* stmt = nullptr;
+  if (cache.Acquire(connection->db.get(), sql, stmt) != SQLITE_OK) {
+    return false;
+  }
+
+  // The statement stays in the cache for the range this thread aggregates
+  cache.Release(sql, stmt);
+  return true;
+}
+
+void QueryProcessor::ExecutePartialAggregate(QueryConnection& connection,
+                                             const AggregateQuery& query,
+                                             std::int64_t startID,
+                                             std::int64_t endID,
+                                             std::vector<PartialRow>& rows) {
+  sqlite3* db = connection.db.get();
+  auto& sql = query.GetPartialStatement();
+  // Every execution of the query runs the same partial statement, so it is
+  // worth keeping
+  auto cache = &connection.statementCache;
+  sqlite3_stmt* stmt = nullptr;
+  int code = cache->Acquire(db, sql, stmt);
+  if (code != SQLITE_OK) {
+    ThrowSQLiteError(db, code);
+  }
+  std::unique_ptr<sqlite3_stmt, std::function<void(sqlite3_stmt*)>> stmtGuard(
+      stmt, [cache, &sql](sqlite3_stmt* stmt) { cache->Release(sql, stmt); });
+
+  SQLiteUtils::HandleSQLiteCode(sqlite3_bind_int64(stmt, 1, startID));
+  SQLiteUtils::HandleSQLiteCode(sqlite3_bind_int64(stmt, 2, endID));
+
+  auto columnCount = query.GetPartialColumnCount();
+  while ((code = sqlite3_step(stmt)) == SQLITE_ROW) {
+    PartialRow row;
+    row.values.resize(columnCount);
+    for (int i = 0; i < columnCount; i++) {
+      auto& value = row.values[i];
+      value.type = sqlite3_column_type(stmt, i);
+      switch (value.type) {
+        case SQLITE_INTEGER:
+          value.intVal = sqlite3_column_int64(stmt, i);
+          break;
+        case SQLITE_FLOAT:
+          value.doubleVal = sqlite3_column_double(stmt, i);
+          break;
+        case SQLITE_TEXT:
+          value.bytes.assign(
+              reinterpret_cast<const char*>(sqlite3_column_text(stmt, i)),
+              sqlite3_column_bytes(stmt, i));
+          break;
+        case SQLITE_BLOB:
+          // sqlite3_column_blob returns nullptr for an empty blob
+          if (sqlite3_column_bytes(stmt, i) > 0) {
+            value.bytes.assign(
+                static_cast<const char*>(sqlite3_column_blob(stmt, i)),
+                sqlite3_column_bytes(stmt, i));
+          }
+          break;
+        default:
+          break;
+      }
+    }
+    rows.push_back(std::move(row));
+  }
+
+  if (code != SQLITE_DONE) {
+    ThrowSQLiteError(db, code);
+  }
+}
+
+static const ColumnInfo* FindColumn(
+    const DocumentCollectionInfo& collectionInfo,
+    const std::string& columnName) {
+  // SQLite column names are case insensitive
+  for (auto& column : collectionInfo.columnsInfo) {
+    if (boost::iequals(column.columnName, columnName)) {
+      return &column;
+    }
+  }
+  return nullptr;
+}
+
+static bool IsNumericType(FieldType fieldType) {
+  return fieldType == FieldType::INT8 || fieldType == FieldType::INT16 ||
+         fieldType == FieldType::INT32 || fieldType == FieldType::INT64 ||
+         fieldType == FieldType::FLOAT || fieldType == FieldType::DOUBLE;
+}
+
+static void SetInteger(PartialValue& value, std::int64_t val) {
+  value.type = SQLITE_INTEGER;
+  value.intVal = val;
+}
+
+static void SetDouble(PartialValue& value, double val) {
+  value.type = SQLITE_FLOAT;
+  value.doubleVal = val;
+}
+
+// Computes the result row of the documents in documentIDs, key is the value
+// of the group by column for the group
+static bool TryComputeAggregateRow(
+    const AggregateQuery& query, const DocumentCollectionInfo& collectionInfo,
+    const PartialValue& key, const MamaJenniesBitmap& documentIDs,
+    PartialRow& row) {
+  auto& collection = *collectionInfo.collection;
+  std::map<std::string, ColumnAggregate> aggregates;
+  row.values.clear();
+  for (auto& item : query.GetColumnAggregateItems()) {
+    PartialValue value;
+    value.type = SQLITE_NULL;
+    if (item.type == AggregateQuery::AggregateType::NONE) {
+      row.values.push_back(key);
+      continue;
+    } else if (item.columnName.empty()) {
+      // COUNT(*) is the number of documents in the group
+      SetInteger(value, documentIDs.GetCount());
+      row.values.push_back(std::move(value));
+      continue;
+    }
+
+    auto column = FindColumn(collectionInfo, item.columnName);
+    if (column == nullptr) {
+      return false;
+    }
+
+    auto iter = aggregates.find(column->columnName);
+    if (iter == aggregates.end()) {
+      ColumnAggregate aggregate;
+      if (!collection.TryAggregateFromIndexer(documentIDs, column->columnName,
+                                              aggregate)) {
+        return false;
+      }
+      iter = aggregates.emplace(column->columnName, aggregate).first;
+    }
+
+    // Aggregates of no values are NULL except for COUNT and TOTAL
+    auto& aggregate = iter->second;
+    switch (item.type) {
+      case AggregateQuery::AggregateType::COUNT:
+        SetInteger(value, aggregate.count);
+        break;
+      case AggregateQuery::AggregateType::TOTAL:
+        SetDouble(value, aggregate.doubleSum);
+        break;
+      case AggregateQuery::AggregateType::SUM:
+        if (aggregate.count == 0) {
+          break;
+        } else if (!aggregate.isInteger) {
+          SetDouble(value, aggregate.doubleSum);
+        } else if (!aggregate.intSumOverflow) {
+          SetInteger(value, aggregate.intSum);
+        } else {
+          // Let SQLite report the integer overflow
+          return false;
+        }
+        break;
+      case AggregateQuery::AggregateType::AVG:
+        if (aggregate.count > 0) {
+          SetDouble(value, aggregate.doubleSum / aggregate.count);
+        }
+        break;
+      case AggregateQuery::AggregateType::MIN:
+        if (aggregate.count > 0 && aggregate.isInteger) {
+          SetInteger(value, aggregate.intMin);
+        } else if (aggregate.count > 0) {
+          SetDouble(value, aggregate.doubleMin);
+        }
+        break;
+      case AggregateQuery::AggregateType::MAX:
+        if (aggregate.count > 0 && aggregate.isInteger) {
+          SetInteger(value, aggregate.intMax);
+        } else if (aggregate.count > 0) {
+          SetDouble(value, aggregate.doubleMax);
+        }
+        break;
+      default:
+        return false;
+    }
+    row.values.push_back(std::move(value));
+  }
+
+  return true;
+}
+
+bool QueryProcessor::TryComputeColumnAggregate(
+    const AggregateQuery& query, const DocumentCollectionInfo& collectionInfo,
+    std::vector<PartialRow>& rows) {
+  auto& collection = *collectionInfo.collection;
+  // Every condition has to be evaluated exactly by an index. Bloom filters
+  // have false positives and comparisons between different types follow
+  // SQLite affinity rules, both are left to SQLite.
+  std::vector<Constraint> constraints;
+  for (auto& condition : query.GetConditions()) {
+    auto column = FindColumn(collectionInfo, condition.columnName);
+    if (column == nullptr) {
+      return false;
+    }
+
+    if (!NullBitmap::IsNullOperator(condition.op)) {
+      bool isString = condition.operandType == OperandType::STRING;
+      if (isString ? column->columnType != FieldType::STRING
+                   : !IsNumericType(column->columnType)) {
+        return false;
+      }
+    }
+
+    IndexStat indexStat;
+    if (!collection.TryGetBestIndex(column->columnName, condition.op,
+                                    indexStat) ||
+        indexStat.GetIndexInfo().GetType() == IndexType::BLOOM_FILTER) {
+      return false;
+    }
+
+    Constraint constraint(column->columnName, condition.op);
+    constraint.operandType = condition.operandType;
+    if (condition.operandType == OperandType::INTEGER) {
+      constraint.operand.int64Val = condition.intVal;
+    } else if (condition.operandType == OperandType::DOUBLE) {
+      constraint.operand.doubleVal = condition.doubleVal;
+    } else {
+      constraint.strVal = condition.strVal;
+    }
+    constraints.push_back(std::move(constraint));
+  }
+
+  // Both filters below clip to the same watermark
+  auto documentCount = collection.GetDocumentCount();
+  auto bitmap = collection.Filter(constraints, documentCount);
+  rows.clear();
+  if (query.GetGroupByColumn().empty()) {
+    PartialValue noKey;
+    noKey.type = SQLITE_NULL;
+    PartialRow row;
+    if (!TryComputeAggregateRow(query, collectionInfo, noKey, *bitmap, row)) {
+      return false;
+    }
+    rows.push_back(std::move(row));
+    return true;
+  }
+
+  // Every group is the AND of the filter and the documents of one value in
+  // the inverted index of the group by column
+  auto column = FindColumn(collectionInfo, query.GetGroupByColumn());
+  std::vector<ValueBitmap> valueBitmaps;
+  IndexStat indexStat;
+  if (column == nullptr ||
+      !collection.TryGetValueBitmapsFromIndexer(column->columnName,
+                                                valueBitmaps) ||
+      !collection.TryGetBestIndex(column->columnName,
+                                  IndexConstraintOperator::IS_NULL,
+                                  indexStat)) {
+    return false;
+  }
+
+  // SQLite puts the NULL group first
+  std::vector<Constraint> nullConstraints;
+  nullConstraints.push_back(
+      Constraint(column->columnName, IndexConstraintOperator::IS_NULL));
+  PartialValue key;
+  key.type = SQLITE_NULL;
+  MamaJenniesBitmap groupBitmap;
+  collection.Filter(nullConstraints, documentCount)
+      ->LogicalAND(*bitmap, groupBitmap);
+  if (groupBitmap.GetCount() > 0) {
+    PartialRow row;
+    if (!TryComputeAggregateRow(query, collectionInfo, key, groupBitmap,
+                                row)) {
+      return false;
+    }
+    rows.push_back(std::move(row));
+  }
+
+  for (auto& valueBitmap : valueBitmaps) {
+    groupBitmap.Reset();
+    valueBitmap.bitmap->LogicalAND(*bitmap, groupBitmap);
+    if (groupBitmap.GetCount() == 0) {
+      continue;
+    }
+
+    if (valueBitmap.operandType == OperandType::INTEGER) {
+      SetInteger(key, valueBitmap.operand.int64Val);
+    } else if (valueBitmap.operandType == OperandType::DOUBLE) {
+      SetDouble(key, valueBitmap.operand.doubleVal);
+    } else {
+      key.type = SQLITE_TEXT;
+      key.bytes = std::move(valueBitmap.strVal);
+    }
+
+    PartialRow row;
+    if (!TryComputeAggregateRow(query, collectionInfo, key, groupBitmap,
+                                row)) {
+      return false;
+    }
+    rows.push_back(std::move(row));
+  }
+
+  return true;
+}
+
+QueryConnection* QueryProcessor::OpenConnection() {
+  // A connection is only used by one thread at a time, so SQLite doesn't
+  // need to serialize the calls on it
   sqlite3* db = nullptr;
-  int code = sqlite3_open_v2(m_dbConnStr.c_str(), &db,
-                             SQLITE_OPEN_READONLY | SQLITE_OPEN_URI, nullptr);
+  int code = sqlite3_open_v2(":memory:", &db,
+                             SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX,
+                             nullptr);
   if (code != SQLITE_OK) {
     sqlite3_close(db);
     throw SQLException(sqlite3_errstr(code), __FILE__, __func__, __LINE__);
   }
 
-  return db;
-}
\ No newline at end of file
+  // The pool is only set once its initial connections are opened, later
+  // connections are opened because the pool ran out of idle ones
+  if (m_dbConnectionPool) {
+    EngineStats::Add(EngineCounter::CONNECTION_POOL_MISSES);
+  }
+
+  // New connections get the vtables declared before they are handed out
+  std::unique_ptr<QueryConnection> connection(
+      new QueryConnection(db, StatementCacheCapacity));
+  code = sqlite3_set_authorizer(db, jonoondb_read_auth_callback,
+                                connection.get());
+  SQLiteUtils::HandleSQLiteCode(code);
+  std::lock_guard<std::mutex> lock(m_schemaMutex);
+  UpdateSchema(*connection);
+  return connection.release();
+}
+
+void QueryProcessor::CloseConnection(QueryConnection* connection) {
+  delete connection;
+}
+
+void QueryProcessor::ResetConnection(QueryConnection* connection) {
+  // This runs when the connection is returned, so errors can't be thrown.
+  // The next aggregate query drops the table if it is still there.
+  if (connection->hasPartialAggregate) {
+    InternalStatementScope scope(*connection);
+    std::string stmt = "DROP TABLE IF EXISTS ";
+    stmt.append(PartialAggregateTableName).append(";");
+    sqlite3_exec(connection->db.get(), stmt.c_str(), nullptr, nullptr,
+                 nullptr);
+    connection->hasPartialAggregate = false;
+  }
+}
+
+ObjectPoolGuard<QueryConnection> QueryProcessor::TakeConnection(
+    bool withinCapacity) {
+  // Covers opening a connection when the pool is empty and waiting for the
+  // schema mutex to bring an idle connection up to date
+  LatencyTimer timer(EngineLatency::CONNECTION_POOL_WAIT);
+  auto obj = withinCapacity ? m_dbConnectionPool->TryTake()
+                            : m_dbConnectionPool->Take();
+  if (obj == nullptr) {
+    return ObjectPoolGuard<QueryConnection>();
+  }
+
+  ObjectPoolGuard<QueryConnection> connection(m_dbConnectionPool.get(), obj);
+  if (connection->schemaVersion !=
+      m_schemaVersion.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(m_schemaMutex);
+    UpdateSchema(*connection);
+  }
+
+  return connection;
+}
+
+void QueryProcessor::UpdateSchema(QueryConnection& connection) {
+  InternalStatementScope scope(connection);
+  auto& collections = connection.collections;
+  for (auto iter = collections.begin(); iter != collections.end();) {
+    auto vtable = m_collectionVTables.find(iter->first);
+    if (vtable == m_collectionVTables.end() ||
+        vtable->second.schemaVersion != iter->second) {
+      std::string stmt = "DROP TABLE IF EXISTS temp.";
+      stmt.append(iter->first).append(";");
+      ExecuteSchemaStatement(connection.db.get(), stmt, false);
+      iter = collections.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+
+  for (auto& vtable : m_collectionVTables) {
+    if (collections.find(vtable.first) == collections.end()) {
+      ExecuteSchemaStatement(connection.db.get(),
+                             vtable.second.createStatement, false);
+      collections[vtable.first] = vtable.second.schemaVersion;
+    }
+  }
+
+  connection.schemaVersion = m_schemaVersion.load(std::memory_order_relaxed);
+}
+
+void QueryProcessor::UpdateIdleConnections() {
+  // The connections that are in use catch up when they are taken next
+  m_dbConnectionPool->ForEachIdle([this](QueryConnection* connection) {
+    std::lock_guard<std::mutex> lock(m_schemaMutex);
+    UpdateSchema(*connection);
+  });
+}
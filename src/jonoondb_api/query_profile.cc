@@ -0,0 +1,90 @@
+#include "query_profile.h"
+#include <iomanip>
+#include <sstream>
+
+using namespace jonoondb_api;
+
+static thread_local QueryProfile* s_currentProfile = nullptr;
+
+static double ToMilliseconds(std::chrono::nanoseconds time) {
+  return std::chrono::duration<double, std::milli>(time).count();
+}
+
+QueryProfile* QueryProfile::Current() {
+  return s_currentProfile;
+}
+
+void QueryProfile::Merge(const QueryProfile& other) {
+  scans.insert(scans.end(), other.scans.begin(), other.scans.end());
+  prepareTime += other.prepareTime;
+  filterTime += other.filterTime;
+  fetchTime += other.fetchTime;
+  executionTime += other.executionTime;
+  rowsReturned += other.rowsReturned;
+  bitmapsANDed += other.bitmapsANDed;
+  bitmapsORed += other.bitmapsORed;
+  indexerValues += other.indexerValues;
+  documentValues += other.documentValues;
+  documentsFetched += other.documentsFetched;
+  fetchBatches += other.fetchBatches;
+  blobsRead += other.blobsRead;
+  bytesRead += other.bytesRead;
+  bytesDecompressed += other.bytesDecompressed;
+  fileCacheHits += other.fileCacheHits;
+  fileCacheMisses += other.fileCacheMisses;
+}
+
+std::string QueryProfile::ToString() const {
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3);
+  ss << "Plan: " << plan;
+  if (workerThreads > 0) {
+    ss << " (" << workerThreads << " worker threads)";
+  }
+  ss << "\n";
+  for (auto& row : sqlitePlan) {
+    ss << "  " << row << "\n";
+  }
+
+  for (auto& scan : scans) {
+    ss << "  " << scan.collectionName << ": " << scan.plan;
+    if (!scan.constraints.empty()) {
+      ss << " on";
+      for (std::size_t i = 0; i < scan.constraints.size(); i++) {
+        ss << (i == 0 ? " " : ", ") << scan.constraints[i];
+      }
+    }
+    ss << ", " << ToMilliseconds(scan.filterTime) << " ms, "
+       << scan.rowsScanned << " rows scanned\n";
+  }
+
+  ss << "Stages:\n";
+  ss << "  prepare: " << ToMilliseconds(prepareTime) << " ms\n";
+  ss << "  filter: " << ToMilliseconds(filterTime) << " ms, " << scans.size()
+     << " scans\n";
+  ss << "  fetch: " << ToMilliseconds(fetchTime) << " ms, "
+     << documentsFetched << " documents in " << fetchBatches << " batches\n";
+  ss << "  execution: " << ToMilliseconds(executionTime) << " ms, "
+     << rowsReturned << " rows returned\n";
+
+  ss << "Counters:\n";
+  ss << "  column values from indexes: " << indexerValues << "\n";
+  ss << "  column values from documents: " << documentValues << "\n";
+  ss << "  bitmaps ANDed: " << bitmapsANDed << "\n";
+  ss << "  bitmaps ORed: " << bitmapsORed << "\n";
+  ss << "  blobs read: " << blobsRead << ", " << bytesRead << " bytes\n";
+  ss << "  bytes decompressed: " << bytesDecompressed << "\n";
+  ss << "  data file cache hits: " << fileCacheHits
+     << ", misses: " << fileCacheMisses << "\n";
+
+  return ss.str();
+}
+
+QueryProfileScope::QueryProfileScope(QueryProfile* profile)
+    : m_previous(s_currentProfile) {
+  s_currentProfile = profile;
+}
+
+QueryProfileScope::~QueryProfileScope() {
+  s_currentProfile = m_previous;
+}
@@ -1,22 +1,25 @@
 #include "resultset_impl.h"
+#include <cstring>
 #include <sstream>
 #include "guard_funcs.h"
 #include "jonoondb_exceptions.h"
+#include "query_connection.h"
+#include "query_profile.h"
 
 using namespace jonoondb_api;
 
-ResultSetImpl::ResultSetImpl(ObjectPoolGuard<sqlite3> db,
+ResultSetImpl::ResultSetImpl(ObjectPoolGuard<QueryConnection> db,
                              const std::string& selectStmt)
     : m_db(std::move(db)), m_stmt(nullptr, GuardFuncs::SQLite3Finalize) {
   sqlite3_stmt* stmt = nullptr;
-  int code = sqlite3_prepare_v2(m_db, selectStmt.c_str(), selectStmt.size(),
-                                &stmt, nullptr);
+  int code = sqlite3_prepare_v2(m_db->db.get(), selectStmt.c_str(),
+                                selectStmt.size(), &stmt, nullptr);
   m_stmt.reset(stmt);
   if (code != SQLITE_OK) {
     // We can safely use sqlite3_errmsg because each ResultSetImpl
     // has a dedicated sqlite3 connection, so it will only be used
     // by one thread at any given time.
-    const char* errMsg = sqlite3_errmsg(m_db);
+    const char* errMsg = sqlite3_errmsg(m_db->db.get());
     if (errMsg != nullptr) {
       std::string sqliteErrorMsg = errMsg;
       throw SQLException(sqliteErrorMsg, __FILE__, __func__, __LINE__);
@@ -25,6 +28,17 @@ ResultSetImpl::ResultSetImpl(ObjectPoolGuard<sqlite3> db,
     throw SQLException(sqlite3_errstr(code), __FILE__, __func__, __LINE__);
   }
 
+  ReadColumns();
+}
+
+ResultSetImpl::ResultSetImpl(ObjectPoolGuard<QueryConnection> db,
+                             sqlite3_stmt* stmt,
+                             std::function<void(sqlite3_stmt*)> releaseFunc)
+    : m_db(std::move(db)), m_stmt(stmt, std::move(releaseFunc)) {
+  ReadColumns();
+}
+
+void ResultSetImpl::ReadColumns() {
   int colCount = sqlite3_column_count(m_stmt.get());
   for (int i = 0; i < colCount; i++) {
     const char* colName = sqlite3_column_name(m_stmt.get(), i);
@@ -43,40 +57,69 @@ ResultSetImpl::ResultSetImpl(ObjectPoolGuard<sqlite3> db,
   }
 }
 
+ResultSetImpl::~ResultSetImpl() = default;
+
 // Todo: Use more efficient move sematics (e.g. pimpl idom)
 ResultSetImpl::ResultSetImpl(ResultSetImpl&& other)
     : m_stmt(nullptr, GuardFuncs::SQLite3Finalize) {
+  this->m_profile = std::move(other.m_profile);
   this->m_db = std::move(other.m_db);
   this->m_stmt = std::move(other.m_stmt);
   this->m_columnMapStringStore = std::move(other.m_columnMapStringStore);
   this->m_columnMap = std::move(other.m_columnMap);
+  this->m_columnSqlType = std::move(other.m_columnSqlType);
   this->m_tmpStrStorage = std::move(other.m_tmpStrStorage);
+  this->m_resultSetConsumed = other.m_resultSetConsumed;
+  this->m_rowPending = other.m_rowPending;
 }
 
 ResultSetImpl& ResultSetImpl::operator=(ResultSetImpl&& other) {
   if (this != &other) {
-    this->m_db = std::move(other.m_db);
+    // The old statement has to be released while we still own its
+    // connection
     this->m_stmt = std::move(other.m_stmt);
+    this->m_db = std::move(other.m_db);
+    this->m_profile = std::move(other.m_profile);
     this->m_columnMapStringStore = std::move(other.m_columnMapStringStore);
     this->m_columnMap = std::move(other.m_columnMap);
+    this->m_columnSqlType = std::move(other.m_columnSqlType);
     this->m_tmpStrStorage = std::move(other.m_tmpStrStorage);
+    this->m_resultSetConsumed = other.m_resultSetConsumed;
+    this->m_rowPending = other.m_rowPending;
   }
 
   return *this;
 }
 
 bool ResultSetImpl::Next() {
+  if (!m_profile) {
+    return Step();
+  }
+
+  QueryProfileScope scope(m_profile.get());
+  StageTimer timer(&m_profile->executionTime);
+  return Step();
+}
+
+bool ResultSetImpl::Step() {
+  if (m_rowPending) {
+    m_rowPending = false;
+    return true;
+  }
   if (m_resultSetConsumed) {
     return false;
   }
   int code = sqlite3_step(m_stmt.get());
   if (code == SQLITE_ROW) {
+    if (m_profile) {
+      m_profile->rowsReturned++;
+    }
     return true;
   } else if (code == SQLITE_DONE) {
     m_resultSetConsumed = true;
     return false;
   } else {
-    const char* errMsg = sqlite3_errmsg(m_db);
+    const char* errMsg = sqlite3_errmsg(m_db->db.get());
     if (errMsg != nullptr) {
       std::string sqliteErrorMsg = errMsg;
       throw SQLException(sqliteErrorMsg, __FILE__, __func__, __LINE__);
@@ -170,3 +213,139 @@ bool ResultSetImpl::IsNull(std::int32_t columnIndex) {
 
   return false;
 }
+
+std::uint64_t ResultSetImpl::FetchBatch(ColumnBatchBuffers* columns,
+                                        std::size_t columnCount,
+                                        std::uint64_t maxRows) {
+  for (std::size_t i = 0; i < columnCount; i++) {
+    auto& column = columns[i];
+    if (column.columnIndex < 0 ||
+        column.columnIndex >= m_columnMapStringStore.size()) {
+      std::ostringstream ss;
+      ss << "Column index " << column.columnIndex
+         << " is out of range, the resultset has "
+         << m_columnMapStringStore.size() << " column(s).";
+      throw IndexOutOfBoundException(ss.str(), __FILE__, __func__, __LINE__);
+    }
+
+    bool hasBuffers = column.validity != nullptr;
+    switch (column.type) {
+      case SqlType::INTEGER:
+        hasBuffers = hasBuffers && column.int64Values != nullptr;
+        break;
+      case SqlType::DOUBLE:
+        hasBuffers = hasBuffers && column.doubleValues != nullptr;
+        break;
+      case SqlType::STRING:
+      case SqlType::BLOB:
+        hasBuffers = hasBuffers && column.offsets != nullptr &&
+                     (column.data != nullptr || column.dataCapacity == 0);
+        break;
+      default: {
+        std::ostringstream ss;
+        ss << "Column " << column.columnIndex << " has type "
+           << static_cast<std::int32_t>(column.type)
+           << ", batches can only be read as INTEGER, DOUBLE, STRING or BLOB.";
+        throw InvalidArgumentException(ss.str(), __FILE__, __func__, __LINE__);
+      }
+    }
+    if (!hasBuffers) {
+      std::ostringstream ss;
+      ss << "Buffers for column " << column.columnIndex << " are missing.";
+      throw InvalidArgumentException(ss.str(), __FILE__, __func__, __LINE__);
+    }
+
+    std::memset(column.validity, 0, (maxRows + 7) / 8);
+    if (column.offsets != nullptr) {
+      column.offsets[0] = 0;
+    }
+  }
+
+  QueryProfileScope scope(m_profile.get());
+  StageTimer timer(m_profile ? &m_profile->executionTime : nullptr);
+  auto stmt = m_stmt.get();
+  std::uint64_t row = 0;
+  while (row < maxRows) {
+    if (!m_rowPending && !Step()) {
+      break;
+    }
+    m_rowPending = false;
+
+    if (!FitsInBatch(columns, columnCount, row)) {
+      m_rowPending = true;
+      if (row == 0) {
+        throw InvalidArgumentException(
+            "The data capacity of the column buffers is too small for a "
+            "single row.",
+            __FILE__, __func__, __LINE__);
+      }
+      break;
+    }
+
+    for (std::size_t i = 0; i < columnCount; i++) {
+      auto& column = columns[i];
+      auto colIndex = column.columnIndex;
+      bool isNull = sqlite3_column_type(stmt, colIndex) == SQLITE_NULL;
+      if (!isNull) {
+        column.validity[row / 8] |= static_cast<std::uint8_t>(1 << (row % 8));
+      }
+
+      switch (column.type) {
+        case SqlType::INTEGER:
+          column.int64Values[row] = sqlite3_column_int64(stmt, colIndex);
+          break;
+        case SqlType::DOUBLE:
+          column.doubleValues[row] = sqlite3_column_double(stmt, colIndex);
+          break;
+        default: {
+          // FitsInBatch already converted the value, so these don't allocate
+          const void* val = column.type == SqlType::STRING
+                                ? sqlite3_column_text(stmt, colIndex)
+                                : sqlite3_column_blob(stmt, colIndex);
+          auto size = sqlite3_column_bytes(stmt, colIndex);
+          if (size > 0) {
+            std::memcpy(column.data + column.offsets[row], val, size);
+          }
+          column.offsets[row + 1] = column.offsets[row] + size;
+          break;
+        }
+      }
+    }
+    row++;
+  }
+
+  return row;
+}
+
+bool ResultSetImpl::FitsInBatch(const ColumnBatchBuffers* columns,
+                                std::size_t columnCount, std::uint64_t row) {
+  auto stmt = m_stmt.get();
+  for (std::size_t i = 0; i < columnCount; i++) {
+    auto& column = columns[i];
+    if ((column.type != SqlType::STRING && column.type != SqlType::BLOB) ||
+        sqlite3_column_type(stmt, column.columnIndex) == SQLITE_NULL) {
+      continue;
+    }
+
+    // The value has to be converted before its size is known
+    if (column.type == SqlType::STRING) {
+      sqlite3_column_text(stmt, column.columnIndex);
+    } else {
+      sqlite3_column_blob(stmt, column.columnIndex);
+    }
+    std::uint64_t size = sqlite3_column_bytes(stmt, column.columnIndex);
+    if (column.offsets[row] + size > column.dataCapacity) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void ResultSetImpl::SetProfile(std::unique_ptr<QueryProfile> profile) {
+  m_profile = std::move(profile);
+}
+
+const QueryProfile* ResultSetImpl::GetProfile() const {
+  return m_profile.get();
+}
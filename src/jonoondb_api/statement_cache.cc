@@ -0,0 +1,65 @@
+#include "statement_cache.h"
+#include "guard_funcs.h"
+#include "sqlite3.h"
+
+using namespace jonoondb_api;
+
+StatementCache::StatementCache(std::size_t capacity) : m_capacity(capacity) {}
+
+StatementCache::~StatementCache() {
+  for (auto& item : m_idleStatements) {
+    GuardFuncs::SQLite3Finalize(item.second);
+  }
+}
+
+int StatementCache::Acquire(sqlite3* db, const std::string& sql,
+                            sqlite3_stmt*& stmt) {
+  auto iter = m_statementMap.find(sql);
+  if (iter != m_statementMap.end()) {
+    stmt = iter->second->second;
+    m_idleStatements.erase(iter->second);
+    m_statementMap.erase(iter);
+    return SQLITE_OK;
+  }
+
+  sqlite3_stmt* newStmt = nullptr;
+  int code =
+      sqlite3_prepare_v2(db, sql.c_str(), sql.size(), &newStmt, nullptr);
+  if (code != SQLITE_OK) {
+    sqlite3_finalize(newStmt);
+    return code;
+  }
+
+  stmt = newStmt;
+  return SQLITE_OK;
+}
+
+void StatementCache::Release(const std::string& sql, sqlite3_stmt* stmt) {
+  if (stmt == nullptr) {
+    return;
+  }
+
+  // The result code of reset repeats the error of the last step, which was
+  // already reported to the caller
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+  m_idleStatements.emplace_front(sql, stmt);
+  m_statementMap.emplace(sql, m_idleStatements.begin());
+
+  if (m_idleStatements.size() > m_capacity) {
+    auto victim = std::prev(m_idleStatements.end());
+    auto range = m_statementMap.equal_range(victim->first);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+      if (iter->second == victim) {
+        m_statementMap.erase(iter);
+        break;
+      }
+    }
+    GuardFuncs::SQLite3Finalize(victim->second);
+    m_idleStatements.erase(victim);
+  }
+}
+
+std::size_t StatementCache::GetIdleCount() const {
+  return m_idleStatements.size();
+}
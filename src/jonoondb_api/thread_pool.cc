@@ -0,0 +1,67 @@
+#include "thread_pool.h"
+
+using namespace jonoondb_api;
+
+ThreadPool::ThreadPool(std::size_t threadCount) {
+  try {
+    for (std::size_t i = 0; i < threadCount; i++) {
+      m_threads.emplace_back(&ThreadPool::WorkerFunc, this);
+    }
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_shutdown = true;
+    }
+    m_taskQueued.notify_all();
+    for (auto& thread : m_threads) {
+      thread.join();
+    }
+    throw;
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_shutdown = true;
+  }
+  m_taskQueued.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+std::size_t ThreadPool::GetThreadCount() const {
+  return m_threads.size();
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  if (m_threads.empty()) {
+    task();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.push_back(std::move(task));
+  }
+  m_taskQueued.notify_one();
+}
+
+void ThreadPool::WorkerFunc() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_taskQueued.wait(lock, [&] { return m_shutdown || !m_tasks.empty(); });
+      if (m_tasks.empty()) {
+        // We only stop once everything queued before the shutdown has run
+        break;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+
+    task();
+  }
+}
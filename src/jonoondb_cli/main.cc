@@ -1,9 +1,6 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/predicate.hpp>
-#include <boost/endian/conversion.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/interprocess/file_mapping.hpp>
-#include <boost/interprocess/mapped_region.hpp>
 #include <boost/program_options/cmdline.hpp>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/parsers.hpp>
@@ -12,15 +9,15 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
-#include "jonoondb_api/buffer_impl.h"
+#include "jonoondb_api/bulk_import_impl.h"
 #include "jonoondb_api/database_impl.h"
 #include "jonoondb_api/file.h"
 #include "jonoondb_api/index_info_impl.h"
 #include "jonoondb_api/options_impl.h"
+#include "jonoondb_api/query_profile.h"
 #include "jonoondb_api/resultset_impl.h"
 #include "jonoondb_api/write_options_impl.h"
 #include "jonoondb_utils/stopwatch.h"
-#include "jonoondb_utils/varint.h"
 #include "linenoise/linenoise.h"
 
 namespace po = boost::program_options;
@@ -143,6 +140,7 @@ int StartJonoonDBCLI(string dbName, string dbPath) {
     std::string cmd;
     boost::char_separator<char> sep(" ");
     bool isTimerOn = true;
+    bool isProfileOn = false;
     const string historyFilePath = ".jdb_cmd_history";
     LoadHistory(historyFilePath);
 
@@ -158,12 +156,15 @@ int StartJonoonDBCLI(string dbName, string dbPath) {
             boost::starts_with(cmd, "EXPLAIN SELECT ")) {
           // select command or explain select command
           Stopwatch sw(true);
-          auto rs = db.ExecuteSelect(cmd);
+          auto rs = db.ExecuteSelect(cmd, isProfileOn);
           PrintResultSet(rs);
           if (isTimerOn) {
             sw.Stop();
             PrintTime(sw);
           }
+          if (isProfileOn) {
+            cout << rs.GetProfile()->ToString();
+          }
           continue;
         }
 
@@ -185,6 +186,9 @@ int StartJonoonDBCLI(string dbName, string dbPath) {
           cout << "                                                  DATA_FILE are treated as big endian otherwise\n";
           cout << "                                                  they are treated as little endian.\n";
 
+          cout << ".profile on|off                                   Turn query profiling on or off. When on, the\n";
+          cout << "                                                  plan, time and rows of each stage and storage\n";
+          cout << "                                                  counters are printed after each query.\n";
           cout << ".timer on|off                                     Turn timer on or off.\n";
           cout << ".exit                                             Exit this program.\n";
           // clang-format on
@@ -248,6 +252,14 @@ int StartJonoonDBCLI(string dbName, string dbPath) {
                 }
                 indexes.push_back(IndexInfoImpl(idxTokens[0], IndexType::VECTOR,
                                                 idxTokens[2], isAscending));
+              } else if (idxTokens[1] == "BLOOM_FILTER") {
+                bool isAscending = false;
+                if (boost::iequals("ASC", idxTokens[3])) {
+                  isAscending = true;
+                }
+                indexes.push_back(IndexInfoImpl(idxTokens[0],
+                                                IndexType::BLOOM_FILTER,
+                                                idxTokens[2], isAscending));
               } else {
                 ostringstream ss;
                 ss << "Unknown index type \"" << idxTokens[1]
@@ -284,69 +296,21 @@ int StartJonoonDBCLI(string dbName, string dbPath) {
             }
           }
 
-          auto fileMapping = boost::interprocess::file_mapping(
-              tokens[2].c_str(), boost::interprocess::read_only);
-          auto mappedRegion = boost::interprocess::mapped_region(
-              fileMapping, boost::interprocess::read_only);
-          auto fileSize = mappedRegion.get_size();
-          char* currentPostion =
-              reinterpret_cast<char*>(mappedRegion.get_address());
-          std::vector<BufferImpl> documents;
-          std::size_t bytesRead = 0;
-          std::int64_t bytesReadForCurrRegion = 0;
-          std::uint32_t size = 0;
-          std::size_t pageSize =
-              boost::interprocess::mapped_region::get_page_size();
-          bool swapEndianess = false;
-          if ((Varint::OnLittleEndianMachine() && bigEndSize) ||
-              (!Varint::OnLittleEndianMachine() && !bigEndSize)) {
-            swapEndianess = true;
-          }
-
-          WriteOptionsImpl wo(true, true);
-          while (bytesRead < fileSize) {
-            memcpy(&size, currentPostion, sizeof(std::uint32_t));
-            if (swapEndianess) {
-              boost::endian::endian_reverse_inplace(size);
-            }
-
-            currentPostion += sizeof(std::uint32_t);
-            documents.push_back(
-                BufferImpl(currentPostion, size, size, nullptr));
-            currentPostion += size;
-            bytesReadForCurrRegion += sizeof(std::uint32_t) + size;
-            bytesRead += sizeof(std::uint32_t) + size;
-            if (bytesReadForCurrRegion > (1024 * 1024 * 1024)) {
-              // Insert accumulated docs
-              vector<const BufferImpl*> docs;
-              for (auto& item : documents) {
-                docs.push_back(&item);
-              }
-              gsl::span<const BufferImpl*> docSpan(docs.data(), docs.size());
-              db.MultiInsert(tokens[1], docSpan, wo);
-              documents.clear();
-
-              // Remap to not use too much memory
-              auto quotient = bytesRead / pageSize;
-              auto remainder = bytesRead % pageSize;
-              auto offset = pageSize * quotient;
-
-              mappedRegion = boost::interprocess::mapped_region(
-                  fileMapping, boost::interprocess::read_only, offset);
-              currentPostion =
-                  reinterpret_cast<char*>(mappedRegion.get_address());
-              currentPostion += remainder;
-              bytesReadForCurrRegion = 0;
-            }
-          }
-
-          if (documents.size() > 0) {
-            vector<const BufferImpl*> docs;
-            for (auto& item : documents) {
-              docs.push_back(&item);
-            }
-            gsl::span<const BufferImpl*> docSpan(docs.data(), docs.size());
-            db.MultiInsert(tokens[1], docSpan, wo);
+          BulkImportOptionsImpl options;
+          options.wo = WriteOptionsImpl(true, true);
+          options.bigEndianSizes = bigEndSize;
+          BulkImportResultImpl result;
+          db.BulkImport(tokens[1], tokens[2], options, result);
+          if (result.elapsedNanoseconds > 0) {
+            auto seconds = result.elapsedNanoseconds / 1e9;
+            ostringstream ss;
+            ss << "Imported " << result.documentCount << " documents, "
+               << std::fixed << std::setprecision(0)
+               << result.documentCount / seconds << " documents/sec, "
+               << std::setprecision(1)
+               << result.byteCount / (1024.0 * 1024.0) / seconds
+               << " MB/sec.";
+            cout << ss.str() << endl;
           }
 
           if (isTimerOn) {
@@ -369,6 +333,22 @@ int StartJonoonDBCLI(string dbName, string dbPath) {
             cout << "ERROR: Not a boolean value: \"" << tokens[1]
                  << "\". Assuming \"no\"." << endl;
           }
+        } else if (tokens[0] == ".profile") {
+          // profile command
+          // make sure we have enough params
+          if (tokens.size() < 2) {
+            cout << "Not enough parameters. USAGE: .profile on|off" << endl;
+            continue;
+          }
+
+          if (boost::iequals(tokens[1], "on")) {
+            isProfileOn = true;
+          } else if (boost::iequals(tokens[1], "off")) {
+            isProfileOn = false;
+          } else {
+            cout << "ERROR: Not a boolean value: \"" << tokens[1]
+                 << "\". Assuming \"no\"." << endl;
+          }
         } else if (tokens[0] == ".exit") {
           SaveHistory(historyFilePath);
           return 0;
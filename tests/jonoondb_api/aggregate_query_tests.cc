@@ -0,0 +1,162 @@
+#include <string>
+#include "gtest/gtest.h"
+#include "jonoondb_api/aggregate_query.h"
+
+using namespace std;
+using namespace jonoondb_api;
+
+TEST(AggregateQuery, Aggregates) {
+  AggregateQuery query;
+  ASSERT_TRUE(AggregateQuery::TryParse(
+      "SELECT COUNT(*), SUM(id) AS sum_id, min(rating), MAX([user.id]), "
+      "AVG(rating) avg_rating FROM tweet WHERE text = 'a, b' AND id > 5;",
+      query));
+  ASSERT_EQ(query.GetCollectionName(), "tweet");
+  ASSERT_EQ(query.GetPartialColumnCount(), 6);
+  ASSERT_EQ(query.GetPartialStatement(),
+            "SELECT COUNT(*), SUM(id), MIN(rating), MAX([user.id]), "
+            "TOTAL(rating), COUNT(rating) FROM tweet "
+            "WHERE (text = 'a, b' AND id > 5) AND rowid >= ?1 AND rowid < ?2;");
+  ASSERT_EQ(query.GetMergeStatement("p"),
+            "SELECT COALESCE(SUM(c0), 0) AS \"COUNT(*)\", "
+            "SUM(c1) AS \"sum_id\", MIN(c2) AS \"min(rating)\", "
+            "MAX(c3) AS \"MAX([user.id])\", "
+            "TOTAL(c4) / SUM(c5) AS \"avg_rating\" FROM p;");
+}
+
+TEST(AggregateQuery, GroupBy) {
+  AggregateQuery query;
+  ASSERT_TRUE(AggregateQuery::TryParse(
+      "SELECT COUNT(*) AS cnt, [user.name], id % 4 FROM tweet "
+      "GROUP BY [user.name], id % 4",
+      query));
+  ASSERT_EQ(query.GetPartialColumnCount(), 3);
+  ASSERT_EQ(query.GetPartialStatement(),
+            "SELECT [user.name], id % 4, COUNT(*) FROM tweet "
+            "WHERE rowid >= ?1 AND rowid < ?2 GROUP BY [user.name], id % 4;");
+  ASSERT_EQ(query.GetMergeStatement("p"),
+            "SELECT COALESCE(SUM(c2), 0) AS \"cnt\", c0 AS \"user.name\", "
+            "c1 AS \"id % 4\" FROM p GROUP BY c0, c1;");
+}
+
+TEST(AggregateQuery, Distinct) {
+  AggregateQuery query;
+  ASSERT_TRUE(AggregateQuery::TryParse(
+      "SELECT DISTINCT [user.name] AS name, id % 4 FROM tweet WHERE id > 5",
+      query));
+  ASSERT_EQ(query.GetPartialColumnCount(), 2);
+  ASSERT_EQ(query.GetPartialStatement(),
+            "SELECT [user.name], id % 4 FROM tweet WHERE (id > 5) AND "
+            "rowid >= ?1 AND rowid < ?2 GROUP BY [user.name], id % 4;");
+  ASSERT_EQ(query.GetMergeStatement("p"),
+            "SELECT c0 AS \"name\", c1 AS \"id % 4\" FROM p "
+            "GROUP BY c0, c1;");
+  ASSERT_FALSE(query.IsColumnAggregate());
+
+  ASSERT_TRUE(AggregateQuery::TryParse(
+      "SELECT DISTINCT [user.name] FROM tweet", query));
+  ASSERT_TRUE(query.IsColumnAggregate());
+  ASSERT_EQ(query.GetGroupByColumn(), "user.name");
+  ASSERT_EQ(query.GetColumnAggregateItems().size(), 1);
+  ASSERT_TRUE(query.GetColumnAggregateItems()[0].type ==
+              AggregateQuery::AggregateType::NONE);
+
+  const char* queries[] = {
+      "SELECT DISTINCT id, COUNT(*) FROM tweet",
+      "SELECT DISTINCT id FROM tweet GROUP BY id",
+      "SELECT DISTINCT 1 FROM tweet", "SELECT DISTINCT FROM tweet"};
+  for (auto sql : queries) {
+    ASSERT_FALSE(AggregateQuery::TryParse(sql, query)) << sql;
+  }
+}
+
+TEST(AggregateQuery, ColumnAggregates) {
+  AggregateQuery query;
+  ASSERT_TRUE(AggregateQuery::TryParse(
+      "SELECT COUNT(*) AS cnt, SUM(id), max([user.id]) FROM tweet "
+      "WHERE [user.name] = 'it''s' AND id >= -5 AND rating < 1.5 AND "
+      "text IS NOT NULL",
+      query));
+  ASSERT_TRUE(query.IsColumnAggregate());
+  auto& items = query.GetColumnAggregateItems();
+  ASSERT_EQ(items.size(), 3);
+  ASSERT_TRUE(items[0].type == AggregateQuery::AggregateType::COUNT);
+  ASSERT_EQ(items[0].columnName, "");
+  ASSERT_TRUE(items[1].type == AggregateQuery::AggregateType::SUM);
+  ASSERT_EQ(items[1].columnName, "id");
+  ASSERT_TRUE(items[2].type == AggregateQuery::AggregateType::MAX);
+  ASSERT_EQ(items[2].columnName, "user.id");
+
+  auto& conditions = query.GetConditions();
+  ASSERT_EQ(conditions.size(), 4);
+  ASSERT_EQ(conditions[0].columnName, "user.name");
+  ASSERT_TRUE(conditions[0].op == IndexConstraintOperator::EQUAL);
+  ASSERT_TRUE(conditions[0].operandType == OperandType::STRING);
+  ASSERT_EQ(conditions[0].strVal, "it's");
+  ASSERT_TRUE(conditions[1].op == IndexConstraintOperator::GREATER_THAN_EQUAL);
+  ASSERT_TRUE(conditions[1].operandType == OperandType::INTEGER);
+  ASSERT_EQ(conditions[1].intVal, -5);
+  ASSERT_TRUE(conditions[2].op == IndexConstraintOperator::LESS_THAN);
+  ASSERT_TRUE(conditions[2].operandType == OperandType::DOUBLE);
+  ASSERT_DOUBLE_EQ(conditions[2].doubleVal, 1.5);
+  ASSERT_EQ(conditions[3].columnName, "text");
+  ASSERT_TRUE(conditions[3].op == IndexConstraintOperator::IS_NOT_NULL);
+  ASSERT_EQ(query.GetResultStatement("r"),
+            "SELECT c0 AS \"cnt\", c1 AS \"SUM(id)\", "
+            "c2 AS \"max([user.id])\" FROM r;");
+
+  ASSERT_TRUE(AggregateQuery::TryParse(
+      "SELECT [user.name], COUNT(*) FROM tweet GROUP BY [user.name]", query));
+  ASSERT_TRUE(query.IsColumnAggregate());
+  ASSERT_EQ(query.GetGroupByColumn(), "user.name");
+  ASSERT_TRUE(query.GetColumnAggregateItems()[0].type ==
+              AggregateQuery::AggregateType::NONE);
+  ASSERT_EQ(query.GetColumnAggregateItems()[0].columnName, "user.name");
+
+  // Still split across threads but not answerable from the indexes
+  const char* queries[] = {
+      "SELECT [user.name], id, COUNT(*) FROM tweet GROUP BY [user.name], id",
+      "SELECT id % 2, COUNT(*) FROM tweet GROUP BY id % 2",
+      "SELECT SUM(id + 1) FROM tweet",
+      "SELECT SUM(tweet.id) FROM tweet",
+      "SELECT SUM(*) FROM tweet",
+      "SELECT COUNT(*) FROM tweet WHERE id = 1 OR id = 2",
+      "SELECT COUNT(*) FROM tweet WHERE (id = 1)",
+      "SELECT COUNT(*) FROM tweet WHERE id <> 1",
+      "SELECT COUNT(*) FROM tweet WHERE id != 1",
+      "SELECT COUNT(*) FROM tweet WHERE 1 = id",
+      "SELECT COUNT(*) FROM tweet WHERE id = 0x10",
+      "SELECT COUNT(*) FROM tweet WHERE id = rating",
+      "SELECT COUNT(*) FROM tweet WHERE id BETWEEN 1 AND 2",
+      "SELECT COUNT(*) FROM tweet WHERE id < = 1",
+      "SELECT COUNT(*) FROM tweet WHERE id = 99999999999999999999"};
+  for (auto sql : queries) {
+    ASSERT_TRUE(AggregateQuery::TryParse(sql, query)) << sql;
+    ASSERT_FALSE(query.IsColumnAggregate()) << sql;
+  }
+}
+
+TEST(AggregateQuery, UnsupportedQueries) {
+  AggregateQuery query;
+  const char* queries[] = {
+      "SELECT id FROM tweet",
+      "SELECT id, SUM(rating) FROM tweet",
+      "SELECT COUNT(DISTINCT id) FROM tweet",
+      "SELECT SUM(id) + 1 FROM tweet",
+      "SELECT SUM(id) + SUM(rating) FROM tweet",
+      "SELECT MAX(id, rating) FROM tweet",
+      "SELECT SUM(id) FROM tweet t",
+      "SELECT SUM(id) FROM tweet, user",
+      "SELECT SUM(id) FROM tweet JOIN user ON id = uid",
+      "SELECT SUM(id) FROM tweet WHERE id IN (SELECT id FROM tweet)",
+      "SELECT id, COUNT(*) FROM tweet GROUP BY id HAVING COUNT(*) > 1",
+      "SELECT id, COUNT(*) FROM tweet GROUP BY id ORDER BY id",
+      "SELECT COUNT(*) FROM tweet LIMIT 1",
+      "SELECT id, COUNT(*) FROM tweet GROUP BY 1",
+      "SELECT COUNT(*) FROM tweet -- comment",
+      "SELECT COUNT(*) FROM tweet; SELECT 1",
+      "DELETE FROM tweet"};
+  for (auto sql : queries) {
+    ASSERT_FALSE(AggregateQuery::TryParse(sql, query)) << sql;
+  }
+}
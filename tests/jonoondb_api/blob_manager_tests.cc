@@ -19,7 +19,7 @@ TEST(BlobManager, Constructor) {
   auto fileSize = 1024 * 1024;
   auto fnm =
       std::make_unique<FileNameManager>(dbPath, dbName, collectionName, true);
-  BlobManager bm(move(fnm), fileSize, true);
+  BlobManager bm(move(fnm), fileSize, true, 1);
 
   // make sure the file is there and it is the same size
   ASSERT_TRUE(boost::filesystem::exists(pathObj));
@@ -34,7 +34,7 @@ TEST(BlobManager, Put) {
   auto fileSize = 1024 * 1024;
   auto fnm =
       std::make_unique<FileNameManager>(dbPath, dbName, collectionName, true);
-  BlobManager bm(move(fnm), fileSize, true);
+  BlobManager bm(move(fnm), fileSize, true, 1);
   std::string data = "This is the string!";
   BufferImpl buffer(data.c_str(), data.size(), data.size());
   BlobMetadata metadata;
@@ -50,7 +50,7 @@ TEST(BlobManager, Putx2) {
   auto fileSize = 1024 * 1024;
   auto fnm =
       std::make_unique<FileNameManager>(dbPath, dbName, collectionName, true);
-  BlobManager bm(move(fnm), fileSize, true);
+  BlobManager bm(move(fnm), fileSize, true, 1);
   std::string data = "This is the string!";
   BufferImpl buffer(data.c_str(), data.size(), data.size());
   BlobMetadata metadata;
@@ -69,7 +69,7 @@ void ExecuteGetTest(const std::string& dbName, bool enableCompression) {
   auto fileSize = 1024 * 1024;
   auto fnm =
       std::make_unique<FileNameManager>(dbPath, dbName, collectionName, true);
-  BlobManager bm(move(fnm), fileSize, true);
+  BlobManager bm(move(fnm), fileSize, true, 1);
   std::string data = "This is the string!";
   BufferImpl buffer(data.c_str(), data.size(), data.size());
   BlobMetadata metadata;
@@ -107,7 +107,7 @@ void ExecuteMultiputTest(const std::string& dbName, bool enableCompression) {
   auto fileSize = 1024 * 1024;
   auto fnm =
       std::make_unique<FileNameManager>(dbPath, dbName, collectionName, true);
-  BlobManager bm(move(fnm), fileSize, true);
+  BlobManager bm(move(fnm), fileSize, true, 1);
 
   const int SIZE = 10;
   std::vector<BlobMetadata> metadataArray(SIZE);
@@ -155,7 +155,7 @@ void ExecuteMultiput_SwitchFileTest(const std::string& dbName,
   auto fileSize = 128;
   auto fnm =
       std::make_unique<FileNameManager>(dbPath, dbName, collectionName, true);
-  BlobManager bm(move(fnm), fileSize, true);
+  BlobManager bm(move(fnm), fileSize, true, 1);
 
   const int SIZE = 20;
   std::vector<BlobMetadata> metadataArray(SIZE);
@@ -203,4 +203,156 @@ TEST(BlobManager, Multiput_SwitchFile) {
 TEST(BlobManager, Multiput_SwitchFile_Compressed) {
   std::string dbName = "BlobManager_Multiput_SwitchFile";
   ExecuteMultiput_SwitchFileTest(dbName, true);
-}
\ No newline at end of file
+}
+void ExecuteMultiGetTest(const std::string& dbName, bool enableCompression) {
+  std::string dbPath = g_TestRootDirectory;
+  std::string collectionName = "Collection";
+  // Small file size to make sure the blobs are spread over multiple files
+  auto fileSize = 128;
+  auto fnm =
+      std::make_unique<FileNameManager>(dbPath, dbName, collectionName, true);
+  BlobManager bm(move(fnm), fileSize, true, 1);
+
+  const int SIZE = 20;
+  std::vector<BlobMetadata> metadataArray(SIZE);
+  std::vector<BufferImpl> bufferArray;
+  std::vector<const BufferImpl*> bufferPtrArray;
+  std::string data;
+
+  for (size_t i = 0; i < SIZE; i++) {
+    data = "This is the string " + std::to_string(i);
+    BufferImpl buf(data.c_str(), data.size(), data.size());
+    bufferArray.push_back(buf);
+  }
+
+  for (auto& buf : bufferArray) {
+    bufferPtrArray.push_back(&buf);
+  }
+
+  bm.MultiPut(bufferPtrArray, metadataArray, enableCompression);
+
+  // Ask for the blobs in reverse order, MultiGet has to return them in the
+  // requested order even though it reads them in file order
+  std::vector<BlobMetadata> reversedMetadata(metadataArray.rbegin(),
+                                             metadataArray.rend());
+  std::vector<BufferImpl> outBuffers;
+  bm.MultiGet(reversedMetadata, outBuffers);
+  ASSERT_EQ(outBuffers.size(), SIZE);
+  for (size_t i = 0; i < SIZE; i++) {
+    data = "This is the string " + std::to_string(SIZE - 1 - i);
+    ASSERT_EQ(data.size(), outBuffers[i].GetLength());
+    ASSERT_EQ(
+        memcmp(data.data(), outBuffers[i].GetData(), outBuffers[i].GetLength()),
+        0);
+  }
+}
+
+TEST(BlobManager, MultiGet) {
+  std::string dbName = "BlobManager_MultiGet";
+  ExecuteMultiGetTest(dbName, false);
+}
+
+TEST(BlobManager, MultiGet_Compressed) {
+  std::string dbName = "BlobManager_MultiGet_Compressed";
+  ExecuteMultiGetTest(dbName, true);
+}
+
+TEST(BlobManager, WriteLanes) {
+  std::string dbName = "BlobManager_WriteLanes";
+  std::string dbPath = g_TestRootDirectory;
+  std::string collectionName = "Collection";
+  auto fileSize = 1024 * 1024;
+  auto fnm =
+      std::make_unique<FileNameManager>(dbPath, dbName, collectionName, true);
+  BlobManager bm(move(fnm), fileSize, true, 2);
+
+  std::vector<std::string> data;
+  std::vector<BufferImpl> bufferArray;
+  for (size_t i = 0; i < 4; i++) {
+    data.push_back("This is the string " + std::to_string(i));
+    bufferArray.emplace_back(data[i].c_str(), data[i].size(), data[i].size());
+  }
+  std::vector<std::vector<const BufferImpl*>> blobs;
+  for (auto& buf : bufferArray) {
+    blobs.push_back({&buf});
+  }
+  std::vector<std::vector<BlobMetadata>> metadata(
+      4, std::vector<BlobMetadata>(1));
+
+  // A pending batch holds its lane, so the next one goes to another file
+  BlobManager::PendingBatch batch0, batch1;
+  bm.MultiPut(blobs[0], metadata[0], false, batch0);
+  bm.MultiPut(blobs[1], metadata[1], true, batch1);
+  ASSERT_NE(metadata[0][0].fileKey, metadata[1][0].fileKey);
+  bm.Commit(batch0, 0);
+  bm.Commit(batch1, 1);
+
+  // The blobs of a batch that is not committed are overwritten
+  {
+    BlobManager::PendingBatch batch2;
+    bm.MultiPut(blobs[2], metadata[2], false, batch2);
+  }
+  BlobManager::PendingBatch batch3;
+  bm.MultiPut(blobs[3], metadata[3], false, batch3);
+  bm.Commit(batch3, 2);
+  ASSERT_EQ(metadata[3][0].fileKey, metadata[2][0].fileKey);
+  ASSERT_EQ(metadata[3][0].offset, metadata[2][0].offset);
+
+  BufferImpl outBuffer;
+  for (size_t i : {0, 1, 3}) {
+    bm.Get(metadata[i][0], outBuffer);
+    ASSERT_EQ(data[i].size(), outBuffer.GetLength());
+    ASSERT_EQ(
+        memcmp(data[i].data(), outBuffer.GetData(), outBuffer.GetLength()), 0);
+  }
+}
+
+TEST(BlobManager, DeferredSync) {
+  std::string dbName = "BlobManager_DeferredSync";
+  std::string dbPath = g_TestRootDirectory;
+  std::string collectionName = "Collection";
+  auto fileSize = 1024 * 1024;
+  auto fnm =
+      std::make_unique<FileNameManager>(dbPath, dbName, collectionName, true);
+  BlobManager bm(move(fnm), fileSize, true, 1);
+  auto getPersistedLength = [&](std::int32_t fileKey) {
+    // A new reader every time so nothing cached is returned. All the blobs
+    // go to the first file, so that is the current one.
+    FileNameManager reader(dbPath, dbName, collectionName, false);
+    FileInfo fileInfo;
+    reader.GetCurrentDataFileInfo(false, fileInfo);
+    EXPECT_EQ(fileKey, fileInfo.fileKey);
+    return fileInfo.dataLength;
+  };
+
+  std::string data = "This is the string!";
+  BufferImpl buffer(data.c_str(), data.size(), data.size());
+  std::vector<const BufferImpl*> blobs = {&buffer};
+  std::vector<BlobMetadata> metadata(1);
+  BlobManager::PendingBatch batch0(true);
+  bm.MultiPut(blobs, metadata, false, batch0);
+  auto fileKey = metadata[0].fileKey;
+  auto initialLength = getPersistedLength(fileKey);
+  bm.Commit(batch0, 0);
+
+  // A deferred batch can be read but its length is not persisted
+  BufferImpl outBuffer;
+  bm.Get(metadata[0], outBuffer);
+  ASSERT_EQ(data.size(), outBuffer.GetLength());
+  ASSERT_EQ(initialLength, getPersistedLength(fileKey));
+  bm.SyncDeferred();
+  auto length = getPersistedLength(fileKey);
+  ASSERT_EQ(0, metadata[0].offset);
+  ASSERT_GT(length, 0);
+
+  // Committing a batch that is not deferred syncs the deferred ones first
+  BlobManager::PendingBatch batch1(true);
+  bm.MultiPut(blobs, metadata, false, batch1);
+  bm.Commit(batch1, 1);
+  ASSERT_EQ(length, getPersistedLength(fileKey));
+  BlobManager::PendingBatch batch2;
+  bm.MultiPut(blobs, metadata, false, batch2);
+  bm.Commit(batch2, 2);
+  // All three blobs have the same size
+  ASSERT_EQ(3 * length, getPersistedLength(fileKey));
+}
@@ -0,0 +1,142 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include "bloom_filter_indexer.h"
+#include "buffer_impl.h"
+#include "constraint.h"
+#include "enums.h"
+#include "file.h"
+#include "flatbuffers/flatbuffers.h"
+#include "flatbuffers_document.h"
+#include "flatbuffers_document_schema.h"
+#include "gtest/gtest.h"
+#include "index_info_impl.h"
+#include "jonoondb_exceptions.h"
+#include "mama_jennies_bitmap.h"
+#include "test_utils.h"
+#include "tweet_generated.h"
+
+using namespace std;
+using namespace flatbuffers;
+using namespace jonoondb_api;
+using namespace jonoondb_test;
+
+static BufferImpl GetBloomTweetObject(int64_t id) {
+  FlatBufferBuilder fbb;
+  auto name = fbb.CreateString("user" + to_string(id % 10));
+  auto user = CreateUser(fbb, name, id % 10);
+  auto text = fbb.CreateString("request-" + to_string(id));
+  fbb.Finish(CreateTweet(fbb, id, text, user, id * 0.5));
+  auto size = fbb.GetSize();
+  return BufferImpl(reinterpret_cast<char*>(fbb.GetBufferPointer()), size,
+                    size);
+}
+
+static unique_ptr<BloomFilterIndexer> CreateBloomIndexer(
+    const FlatbuffersDocumentSchema& schema, const string& columnName) {
+  IndexInfoImpl indexInfo("BloomIndex", IndexType::BLOOM_FILTER, columnName,
+                          true);
+  BloomFilterIndexer* indexer;
+  BloomFilterIndexer::Construct(indexInfo, schema.GetFieldType(columnName),
+                                schema.CreateFieldAccessor(columnName),
+                                indexer);
+  return unique_ptr<BloomFilterIndexer>(indexer);
+}
+
+static size_t GetCount(const MamaJenniesBitmap& bitmap) {
+  size_t count = 0;
+  for (auto iter = bitmap.begin(); iter != bitmap.end(); ++iter) {
+    count++;
+  }
+  return count;
+}
+
+static bool Contains(const MamaJenniesBitmap& bitmap, size_t id) {
+  for (auto iter = bitmap.begin(); iter != bitmap.end(); ++iter) {
+    if (*iter == id) {
+      return true;
+    }
+  }
+  return false;
+}
+
+TEST(BloomFilterIndexer, NeedleLookupReturnsOnlyItsBlock) {
+  auto schemaData = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  FlatbuffersDocumentSchema schema(schemaData);
+  auto idIndexer = CreateBloomIndexer(schema, "id");
+  auto textIndexer = CreateBloomIndexer(schema, "text");
+  auto ratingIndexer = CreateBloomIndexer(schema, "rating");
+
+  const size_t blockSize = BloomFilterIndexer::BLOCK_SIZE;
+  const int64_t docCount = blockSize * 4 + 100;
+  for (int64_t id = 0; id < docCount; id++) {
+    auto data = GetBloomTweetObject(id);
+    FlatbuffersDocument doc(&schema, &data);
+    idIndexer->Insert(id, doc);
+    textIndexer->Insert(id, doc);
+    ratingIndexer->Insert(id, doc);
+  }
+
+  string idColumn = "id";
+  Constraint idConstraint(idColumn, IndexConstraintOperator::EQUAL);
+  idConstraint.operandType = OperandType::INTEGER;
+  idConstraint.operand.int64Val = blockSize + 12;
+  auto bm = idIndexer->Filter(idConstraint);
+  ASSERT_TRUE(Contains(*bm, blockSize + 12));
+  ASSERT_EQ(GetCount(*bm), blockSize);
+
+  // The last block is partially filled
+  idConstraint.operand.int64Val = docCount - 1;
+  bm = idIndexer->Filter(idConstraint);
+  ASSERT_TRUE(Contains(*bm, docCount - 1));
+  ASSERT_EQ(GetCount(*bm), 100);
+
+  // Values that were never inserted should not match any block
+  idConstraint.operand.int64Val = docCount * 10;
+  ASSERT_TRUE(idIndexer->Filter(idConstraint)->Empty());
+
+  // A double operand with a fractional part never equals an integer
+  idConstraint.operandType = OperandType::DOUBLE;
+  idConstraint.operand.doubleVal = 12.5;
+  ASSERT_TRUE(idIndexer->Filter(idConstraint)->Empty());
+  idConstraint.operand.doubleVal = 12.0;
+  ASSERT_TRUE(Contains(*idIndexer->Filter(idConstraint), 12));
+
+  string textColumn = "text";
+  Constraint textConstraint(textColumn, IndexConstraintOperator::EQUAL);
+  textConstraint.operandType = OperandType::STRING;
+  textConstraint.strVal = "request-" + to_string(3 * blockSize + 7);
+  bm = textIndexer->Filter(textConstraint);
+  ASSERT_TRUE(Contains(*bm, 3 * blockSize + 7));
+  ASSERT_EQ(GetCount(*bm), blockSize);
+
+  string ratingColumn = "rating";
+  Constraint ratingConstraint(ratingColumn, IndexConstraintOperator::EQUAL);
+  ratingConstraint.operandType = OperandType::INTEGER;
+  ratingConstraint.operand.int64Val = 50;
+  bm = ratingIndexer->Filter(ratingConstraint);
+  ASSERT_TRUE(Contains(*bm, 100));
+  ASSERT_EQ(GetCount(*bm), blockSize);
+}
+
+TEST(BloomFilterIndexer, UnsupportedOperators) {
+  auto schemaData = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  FlatbuffersDocumentSchema schema(schemaData);
+  auto indexer = CreateBloomIndexer(schema, "id");
+  string idColumn = "id";
+  Constraint lower(idColumn, IndexConstraintOperator::GREATER_THAN);
+  lower.operandType = OperandType::INTEGER;
+  lower.operand.int64Val = 1;
+  Constraint upper(idColumn, IndexConstraintOperator::LESS_THAN);
+  upper.operandType = OperandType::INTEGER;
+  upper.operand.int64Val = 10;
+  ASSERT_THROW(indexer->Filter(lower), JonoonDBException);
+  ASSERT_THROW(indexer->FilterRange(lower, upper), JonoonDBException);
+
+  IndexInfoImpl indexInfo("BloomIndex", IndexType::VECTOR, "id", true);
+  BloomFilterIndexer* obj;
+  ASSERT_THROW(
+      BloomFilterIndexer::Construct(indexInfo, FieldType::INT64,
+                                    schema.CreateFieldAccessor("id"), obj),
+      InvalidArgumentException);
+}
@@ -0,0 +1,140 @@
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "jonoondb_api/chunked_vector.h"
+#include "jonoondb_api/segmented_bitmap_map.h"
+
+using namespace std;
+using namespace jonoondb_api;
+
+TEST(ChunkedVector, AppendAndIndex) {
+  ChunkedVector<string> vec;
+  ASSERT_TRUE(vec.empty());
+  ASSERT_TRUE(vec.begin() == vec.end());
+
+  // Enough elements to span several chunks
+  const size_t count = 5000;
+  for (size_t i = 0; i < count; i++) {
+    vec.push_back(to_string(i));
+  }
+  ASSERT_EQ(vec.size(), count);
+
+  size_t index = 0;
+  for (auto& item : vec) {
+    ASSERT_EQ(item, to_string(index));
+    ASSERT_EQ(vec[index], item);
+    index++;
+  }
+  ASSERT_EQ(index, count);
+}
+
+TEST(ChunkedVector, AppendRange) {
+  ChunkedVector<int> vec;
+  vector<int> values;
+  for (int i = 0; i < 1000; i++) {
+    values.push_back(i * 2);
+  }
+  vec.append(values.begin(), values.begin() + 10);
+  vec.append(values.begin() + 10, values.end());
+
+  ASSERT_EQ(vec.size(), values.size());
+  for (size_t i = 0; i < values.size(); i++) {
+    ASSERT_EQ(vec[i], values[i]);
+  }
+}
+
+TEST(ChunkedVector, ReadersRunWhileWriterAppends) {
+  ChunkedVector<uint64_t> vec;
+  const uint64_t count = 200000;
+  atomic<bool> done(false);
+  vector<thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+      while (!done.load()) {
+        // Every element below the loaded size is fully written
+        uint64_t index = 0;
+        for (auto item : vec) {
+          ASSERT_EQ(item, index);
+          index++;
+        }
+        if (index > 0) {
+          ASSERT_EQ(vec[index - 1], index - 1);
+        }
+      }
+    });
+  }
+
+  for (uint64_t i = 0; i < count; i++) {
+    vec.push_back(i);
+  }
+  done = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+  ASSERT_EQ(vec.size(), count);
+}
+
+static vector<uint64_t> GetIDs(
+    const SegmentedBitmapMap<int64_t>::Segments& segments, int64_t key) {
+  vector<shared_ptr<MamaJenniesBitmap>> bitmaps;
+  for (auto& segment : segments) {
+    auto iter = segment->find(key);
+    if (iter != segment->end()) {
+      bitmaps.push_back(iter->second);
+    }
+  }
+
+  auto bitmap = MamaJenniesBitmap::LogicalOR(bitmaps);
+  vector<uint64_t> ids;
+  for (auto id : *bitmap) {
+    ids.push_back(id);
+  }
+  return ids;
+}
+
+TEST(SegmentedBitmapMap, AddsAreVisibleAfterPublish) {
+  SegmentedBitmapMap<int64_t> map;
+  map.Add(1, 0);
+  map.Add(2, 1);
+  ASSERT_EQ(map.GetSegments()->size(), 0);
+
+  map.Publish();
+  auto segments = map.GetSegments();
+  ASSERT_EQ(GetIDs(*segments, 1), vector<uint64_t>({0}));
+
+  // Published segments are not changed by later adds
+  map.Add(1, 2);
+  ASSERT_EQ(GetIDs(*segments, 1), vector<uint64_t>({0}));
+  map.Publish();
+  ASSERT_EQ(GetIDs(*map.GetSegments(), 1), vector<uint64_t>({0, 2}));
+}
+
+TEST(SegmentedBitmapMap, SegmentsAreMerged) {
+  SegmentedBitmapMap<int64_t> map;
+  const uint64_t count =
+      SegmentedBitmapMap<int64_t>::SegmentDocumentCount * 37 + 5;
+  for (uint64_t id = 0; id < count; id++) {
+    map.Add(id % 3, id);
+    map.Publish();
+  }
+
+  // Segments are merged like a binary counter, 37 full segments leave one
+  // segment per set bit plus the active one
+  auto segments = map.GetSegments();
+  ASSERT_EQ(segments->size(), 4);
+
+  auto merged = SegmentedBitmapMap<int64_t>::Merge(*segments);
+  ASSERT_EQ(merged.size(), 3);
+  for (auto& item : merged) {
+    uint64_t expected = item.first;
+    for (auto id : *item.second) {
+      ASSERT_EQ(id, expected);
+      expected += 3;
+    }
+    ASSERT_GE(expected, count);
+    ASSERT_EQ(GetIDs(*segments, item.first).size(), item.second->GetCount());
+  }
+}
@@ -291,6 +291,31 @@ TEST_P(DatabaseDeleteTestSuite, DeleteAndReinsertDocument) {
   ASSERT_EQ(cnt, m_docCnt + 1);
 }
 
+TEST_P(DatabaseDeleteTestSuite, PreparedDelete) {
+  // given: a prepared delete statement
+  auto ps = m_db->Prepare("DELETE FROM " + GetParam().collectionName +
+                          " WHERE field1 = ?");
+  ASSERT_EQ(ps.GetParameterCount(), 1);
+
+  // when: it is executed repeatedly with different bindings
+  for (int i = 0; i < 3; i++) {
+    ps.BindInteger(1, i);
+    ASSERT_EQ(ps.ExecuteDelete(), 1);
+  }
+  // then: deleting the same documents again deletes nothing
+  ps.BindInteger(1, 1);
+  ASSERT_EQ(ps.ExecuteDelete(), 0);
+
+  if (GetParam().reopenDB) {
+    CloseAndReopenDB();
+  }
+
+  ResultSet rs = m_db->ExecuteSelect("SELECT COUNT(*) FROM " +
+                                     GetParam().collectionName);
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(rs.GetInteger(0), m_docCnt - 3);
+}
+
 TEST_F(DatabaseDeleteTestSuite, DeleteDocumentInEmptyCollection) {
   // given: document is deleted in empty collection
   auto deletedCnt = m_db->Delete("DELETE FROM " + COLLECTION_WITH_NO_DOCS +
@@ -340,3 +365,19 @@ TEST_F(DatabaseDeleteTestSuite, ApiMisuseTestForDeleteApi) {
   ASSERT_THROW(m_db->Delete("CREATE TABLE tab (c1 INT, c2 INT)"),
                ApiMisuseException);
 }
+
+TEST_F(DatabaseDeleteTestSuite, ApiMisuseTestForPrepare) {
+  // when: trying to prepare statements other than select and delete then
+  // ApiMisuseException should be thrown
+  ASSERT_THROW(m_db->Prepare("DROP table " + COLLECTION_WITH_DOCS),
+               ApiMisuseException);
+  ASSERT_THROW(m_db->Prepare("INSERT INTO " + COLLECTION_WITH_DOCS +
+                             " VALUES (1, 2, 3)"),
+               ApiMisuseException);
+  ASSERT_THROW(m_db->Prepare("BEGIN"), ApiMisuseException);
+  ASSERT_ANY_THROW(m_db->Prepare("DELETE FROM Collection"));
+
+  // when: executing a delete statement as a select
+  auto ps = m_db->Prepare("DELETE FROM " + COLLECTION_WITH_DOCS);
+  ASSERT_THROW(ps.ExecuteSelect(), ApiMisuseException);
+}
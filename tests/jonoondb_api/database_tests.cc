@@ -1,6 +1,11 @@
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <fstream>
+#include <future>
+#include <map>
 #include <string>
+#include <thread>
 #include "buffer_impl.h"
 #include "database.h"
 #include "enums.h"
@@ -1390,6 +1395,654 @@ TEST(Database, ExecuteSelect_Aggregation) {
   }
 }
 
+TEST(Database, ExecuteSelect_ParallelAggregation) {
+  string dbPath = g_TestRootDirectory;
+  string filePath = GetSchemaFilePath("tweet.bfbs");
+  string schema = File::Read(filePath);
+  auto options = TestUtils::GetDefaultDBOptions();
+  options.SetMaxQueryThreads(4);
+  Database db(dbPath, "ExecuteSelect_ParallelAggregation", options);
+  std::vector<IndexInfo> indexes{
+      IndexInfo("IndexName1", IndexType::VECTOR, "id", true)};
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema, indexes);
+
+  // Enough documents for the query to be split across threads
+  const int docCount = 40000;
+  std::vector<Buffer> documents;
+  std::string text = "hello";
+  std::string binData = "some_data";
+  std::vector<std::string> names = {"a", "b", "c"};
+  std::vector<std::int64_t> groupCounts(names.size(), 0);
+  std::vector<std::int64_t> groupSums(names.size(), 0);
+  std::int64_t expectedCount = 0, expectedSum = 0;
+  for (int i = 0; i < docCount; i++) {
+    documents.push_back(TestUtils::GetTweetObject(i, i * 2, &names[i % 3],
+                                                  &text, (double)i, &binData));
+    if (i >= 100) {
+      expectedCount++;
+      expectedSum += i;
+    }
+    groupCounts[i % 3]++;
+    groupSums[i % 3] += i;
+  }
+  db.MultiInsert("tweet", documents);
+
+  auto rs = db.ExecuteSelect(
+      "SELECT COUNT(*) AS cnt, SUM(id) AS sum_id, MIN(rating) AS min_rating, "
+      "MAX([user.id]) AS max_user_id, AVG(id) AS avg_id "
+      "FROM tweet WHERE id >= 100;");
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(expectedCount, rs.GetInteger(rs.GetColumnIndex("cnt")));
+  ASSERT_EQ(expectedSum, rs.GetInteger(rs.GetColumnIndex("sum_id")));
+  ASSERT_DOUBLE_EQ(100.0, rs.GetDouble(rs.GetColumnIndex("min_rating")));
+  ASSERT_EQ((docCount - 1) * 2,
+            rs.GetInteger(rs.GetColumnIndex("max_user_id")));
+  ASSERT_DOUBLE_EQ((double)expectedSum / expectedCount,
+                   rs.GetDouble(rs.GetColumnIndex("avg_id")));
+  ASSERT_FALSE(rs.Next());
+
+  rs = db.ExecuteSelect(
+      "SELECT [user.name], COUNT(*) AS cnt, SUM(id) AS sum_id FROM tweet "
+      "GROUP BY [user.name];");
+  std::size_t rowCnt = 0;
+  while (rs.Next()) {
+    ASSERT_STREQ(names[rowCnt].c_str(),
+                 rs.GetString(rs.GetColumnIndex("user.name")).str());
+    ASSERT_EQ(groupCounts[rowCnt], rs.GetInteger(rs.GetColumnIndex("cnt")));
+    ASSERT_EQ(groupSums[rowCnt], rs.GetInteger(rs.GetColumnIndex("sum_id")));
+    rowCnt++;
+  }
+  ASSERT_EQ(names.size(), rowCnt);
+
+  // The partial query has no aliases, queries that refer to one run in
+  // SQLite instead
+  for (auto& select :
+       {"SELECT [user.name] AS n, COUNT(*) AS cnt FROM tweet GROUP BY n;",
+        "SELECT [user.name] AS n, COUNT(*) AS cnt FROM tweet "
+        "WHERE n IS NOT NULL GROUP BY [user.name];"}) {
+    rs = db.ExecuteSelect(select);
+    rowCnt = 0;
+    while (rs.Next()) {
+      ASSERT_STREQ(names[rowCnt].c_str(), rs.GetString(0).str());
+      ASSERT_EQ(groupCounts[rowCnt], rs.GetInteger(1));
+      rowCnt++;
+    }
+    ASSERT_EQ(names.size(), rowCnt);
+  }
+
+  // The query is filtered once, every range only takes its slice of the ids.
+  // Every filter ANDs the bitmaps of the two indexes. The index aggregate
+  // that is tried first filters once before it gives up on the unindexed
+  // rating, the ranges filter once more instead of once per range.
+  db.CreateIndex("tweet", IndexInfo("IndexName2",
+                                    IndexType::INVERTED_COMPRESSED_BITMAP,
+                                    "user.name", true));
+  rs = db.ExecuteSelectProfiled(
+      "SELECT COUNT(*), SUM(rating) FROM tweet "
+      "WHERE [user.name] = 'a' AND id >= 100;");
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(13300, rs.GetInteger(0));
+  ASSERT_DOUBLE_EQ(266671650.0, rs.GetDouble(1));
+  ASSERT_FALSE(rs.Next());
+  std::string profile = rs.GetProfile().str();
+  std::size_t sliceCount = 0;
+  for (auto pos = profile.find("tweet: RANGE SLICE"); pos != std::string::npos;
+       pos = profile.find("tweet: RANGE SLICE", pos + 1)) {
+    sliceCount++;
+  }
+  ASSERT_EQ(4, sliceCount) << profile;
+  ASSERT_NE(profile.find("bitmaps ANDed: 4\n"), std::string::npos) << profile;
+
+  // No matching documents, every range returns an empty partial aggregate
+  rs = db.ExecuteSelect(
+      "SELECT COUNT(*) AS cnt, SUM(id) AS sum_id FROM tweet "
+      "WHERE rating < 0;");
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(0, rs.GetInteger(rs.GetColumnIndex("cnt")));
+  ASSERT_TRUE(rs.IsNull(rs.GetColumnIndex("sum_id")));
+  ASSERT_FALSE(rs.Next());
+
+  // The partial rows are dropped once the resultset is done with them
+  rs = db.ExecuteSelect(
+      "SELECT COUNT(*) FROM temp.sqlite_master "
+      "WHERE name = 'jonoondb_partial_aggregate';");
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(0, rs.GetInteger(0));
+}
+
+TEST(Database, ExecuteSelect_IndexAggregates) {
+  string dbPath = g_TestRootDirectory;
+  string filePath = GetSchemaFilePath("tweet.bfbs");
+  string schema = File::Read(filePath);
+  Database db(dbPath, "ExecuteSelect_IndexAggregates",
+              TestUtils::GetDefaultDBOptions());
+  std::vector<IndexInfo> indexes{
+      IndexInfo("IndexName1", IndexType::VECTOR, "id", true),
+      IndexInfo("IndexName2", IndexType::VECTOR, "rating", true),
+      IndexInfo("IndexName3", IndexType::INVERTED_COMPRESSED_BITMAP,
+                "user.name", true)};
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema, indexes);
+
+  std::vector<Buffer> documents;
+  std::string text = "hello";
+  std::string binData = "some_data";
+  std::vector<std::string> names = {"a", "b", "c"};
+  for (int i = 0; i < 1000; i++) {
+    documents.push_back(TestUtils::GetTweetObject(
+        i, i, &names[i % 3], &text, i / 2.0, &binData));
+  }
+  db.MultiInsert("tweet", documents);
+
+  // The indexes answer the queries, appending a condition on a literal makes
+  // SQLite evaluate them instead and both have to agree
+  auto verify = [&db](const std::string& select, const std::string& where) {
+    auto rs = db.ExecuteSelect(select + " WHERE " + where + ";");
+    auto expectedRs =
+        db.ExecuteSelect(select + " WHERE " + where + " AND 1 = 1;");
+    ASSERT_TRUE(rs.Next());
+    ASSERT_TRUE(expectedRs.Next());
+    ASSERT_EQ(expectedRs.GetColumnCount(), rs.GetColumnCount());
+    for (std::int32_t i = 0; i < rs.GetColumnCount(); i++) {
+      ASSERT_STREQ(expectedRs.GetColumnLabel(i).str(),
+                   rs.GetColumnLabel(i).str());
+      ASSERT_EQ(expectedRs.IsNull(i), rs.IsNull(i)) << where;
+      if (!rs.IsNull(i)) {
+        ASSERT_EQ(expectedRs.GetInteger(i), rs.GetInteger(i)) << where;
+        ASSERT_DOUBLE_EQ(expectedRs.GetDouble(i), rs.GetDouble(i)) << where;
+      }
+    }
+    ASSERT_FALSE(rs.Next());
+  };
+
+  std::string select =
+      "SELECT COUNT(*), COUNT(id) AS cnt, SUM(id), TOTAL(rating), "
+      "AVG(rating) AS avg_rating, MIN(id), MAX(rating), SUM(rating) "
+      "FROM tweet";
+  std::vector<std::string> conditions = {
+      "id >= 0", "[user.name] = 'b'", "id >= 100 AND id < 600",
+      "rating > 10.5 AND [user.name] = 'c' AND id <= 900", "id > 5000",
+      "id = -1"};
+  for (auto& where : conditions) {
+    verify(select, where);
+  }
+
+  auto rs = db.ExecuteSelect("SELECT COUNT(*) AS cnt FROM tweet;");
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(1000, rs.GetInteger(rs.GetColumnIndex("cnt")));
+
+  // Deleted documents are not counted
+  ASSERT_EQ(100, db.Delete("DELETE FROM tweet WHERE id < 100;"));
+  rs = db.ExecuteSelect("SELECT COUNT(*) AS cnt FROM tweet;");
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(900, rs.GetInteger(rs.GetColumnIndex("cnt")));
+  for (auto& where : conditions) {
+    verify(select, where);
+  }
+}
+
+TEST(Database, ExecuteSelect_IndexGroupBy) {
+  string dbPath = g_TestRootDirectory;
+  string filePath = GetSchemaFilePath("tweet.bfbs");
+  string schema = File::Read(filePath);
+  Database db(dbPath, "ExecuteSelect_IndexGroupBy",
+              TestUtils::GetDefaultDBOptions());
+  std::vector<IndexInfo> indexes{
+      IndexInfo("IndexName1", IndexType::VECTOR, "id", true),
+      IndexInfo("IndexName2", IndexType::INVERTED_COMPRESSED_BITMAP,
+                "user.name", true),
+      IndexInfo("IndexName3", IndexType::INVERTED_COMPRESSED_BITMAP,
+                "user.id", true)};
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema, indexes);
+
+  std::vector<Buffer> documents;
+  std::string text = "hello";
+  std::string binData = "some_data";
+  std::vector<std::string> names = {"b", "a", "c"};
+  for (int i = 0; i < 1000; i++) {
+    // Every fourth document has a null name
+    auto name = i % 4 == 3 ? nullptr : &names[i % 3];
+    documents.push_back(TestUtils::GetTweetObject(i, i % 5, name, &text,
+                                                  i / 2.0, &binData));
+  }
+  db.MultiInsert("tweet", documents);
+
+  auto getRows = [&db](const std::string& sql) {
+    std::vector<std::string> rows;
+    auto rs = db.ExecuteSelect(sql);
+    while (rs.Next()) {
+      std::string row;
+      for (std::int32_t i = 0; i < rs.GetColumnCount(); i++) {
+        row.append(rs.GetColumnLabel(i).str()).append("=");
+        row.append(rs.IsNull(i) ? "NULL" : rs.GetString(i).str()).append(";");
+      }
+      rows.push_back(row);
+    }
+    return rows;
+  };
+
+  // The indexes answer the queries, appending a condition on a literal makes
+  // SQLite evaluate them instead and both have to agree
+  auto verify = [&getRows](const std::string& select,
+                           const std::string& where,
+                           const std::string& groupBy) {
+    auto rows = getRows(select + " WHERE " + where + groupBy + ";");
+    auto expectedRows =
+        getRows(select + " WHERE " + where + " AND 1 = 1" + groupBy + ";");
+    // The order of DISTINCT rows is not defined
+    std::sort(rows.begin(), rows.end());
+    std::sort(expectedRows.begin(), expectedRows.end());
+    ASSERT_EQ(expectedRows, rows) << select << where << groupBy;
+  };
+
+  std::vector<std::string> conditions = {"id >= 0", "id >= 100 AND id < 600",
+                                         "[user.id] = 3", "id > 5000"};
+  for (int pass = 0; pass < 2; pass++) {
+    for (auto& where : conditions) {
+      verify("SELECT [user.name], COUNT(*) AS cnt, SUM(id), MAX(id) "
+             "FROM tweet", where, " GROUP BY [user.name]");
+      verify("SELECT COUNT(*) AS cnt, [user.id] AS user_id FROM tweet", where,
+             " GROUP BY [user.id]");
+      verify("SELECT DISTINCT [user.name] FROM tweet", where, "");
+      verify("SELECT DISTINCT [user.id] AS user_id FROM tweet", where, "");
+    }
+
+    // Groups are sorted with the NULL group first, same as SQLite
+    auto rows = getRows(
+        "SELECT [user.name], COUNT(*) FROM tweet GROUP BY [user.name];");
+    ASSERT_EQ(4, rows.size());
+    ASSERT_EQ(0, rows[0].find("user.name=NULL;"));
+    ASSERT_EQ(0, rows[1].find("user.name=a;"));
+    ASSERT_EQ(0, rows[3].find("user.name=c;"));
+
+    // Groups only made of deleted documents disappear
+    db.Delete("DELETE FROM tweet WHERE [user.id] = 4;");
+  }
+
+  auto rows = getRows("SELECT DISTINCT [user.id] FROM tweet;");
+  ASSERT_EQ(4, rows.size());
+}
+
+TEST(Database, PreparedStatement_Select) {
+  string filePath = GetSchemaFilePath("tweet.bfbs");
+  string schema = File::Read(filePath);
+  Database db(g_TestRootDirectory, "PreparedStatement_Select",
+              TestUtils::GetDefaultDBOptions());
+  std::vector<IndexInfo> indexes{
+      IndexInfo("IndexName1", IndexType::VECTOR, "id", true)};
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema, indexes);
+
+  std::vector<Buffer> documents;
+  std::string text = "hello";
+  std::string binData = "some_data";
+  std::vector<std::string> names = {"a", "b"};
+  for (int i = 0; i < 100; i++) {
+    documents.push_back(TestUtils::GetTweetObject(i, i % 5, &names[i % 2],
+                                                  &text, i / 2.0, &binData));
+  }
+  db.MultiInsert("tweet", documents);
+
+  auto ps = db.Prepare(
+      "SELECT COUNT(*) FROM tweet "
+      "WHERE id >= ?1 AND id < ?2 AND [user.name] = ?3 AND binData = ?4");
+  ASSERT_EQ(ps.GetParameterCount(), 4);
+  auto getCount = [&ps] {
+    auto rs = ps.ExecuteSelect();
+    EXPECT_TRUE(rs.Next());
+    return rs.GetInteger(0);
+  };
+
+  // Unbound parameters are NULL
+  ASSERT_EQ(getCount(), 0);
+
+  // Bindings are kept between executions until they are bound again
+  ps.BindInteger(1, 10);
+  ps.BindDouble(2, 20.5);
+  ps.BindString(3, "a");
+  ps.BindBlob(4, Buffer(binData.c_str(), binData.size(), binData.size()));
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(getCount(), 6);
+  }
+  ps.BindString(3, "b");
+  ASSERT_EQ(getCount(), 5);
+  ps.BindInteger(2, 100);
+  ASSERT_EQ(getCount(), 45);
+  ps.BindNull(3);
+  ASSERT_EQ(getCount(), 0);
+  ps.BindString(3, "a");
+  ps.ClearBindings();
+  ASSERT_EQ(getCount(), 0);
+
+  // Resultsets of earlier executions are not affected by new bindings
+  auto idPs = db.Prepare("SELECT id FROM tweet WHERE id = ?");
+  idPs.BindInteger(1, 7);
+  auto rs1 = idPs.ExecuteSelect();
+  idPs.BindInteger(1, 8);
+  auto rs2 = idPs.ExecuteSelect();
+  ASSERT_TRUE(rs2.Next());
+  ASSERT_EQ(rs2.GetInteger(0), 8);
+  ASSERT_TRUE(rs1.Next());
+  ASSERT_EQ(rs1.GetInteger(0), 7);
+  ASSERT_FALSE(rs1.Next());
+  ASSERT_FALSE(rs2.Next());
+
+  ASSERT_THROW(ps.BindInteger(0, 1), IndexOutOfBoundException);
+  ASSERT_THROW(ps.BindInteger(5, 1), IndexOutOfBoundException);
+  ASSERT_THROW(ps.ExecuteDelete(), ApiMisuseException);
+  ASSERT_THROW(db.Prepare("SELECT * FROM missing_collection"), SQLException);
+  ASSERT_THROW(db.Prepare(" "), InvalidArgumentException);
+}
+
+TEST(Database, ExecuteSelect_StringsAcrossBatches) {
+  string filePath = GetSchemaFilePath("tweet.bfbs");
+  string schema = File::Read(filePath);
+  Database db(g_TestRootDirectory, "ExecuteSelect_StringsAcrossBatches",
+              TestUtils::GetDefaultDBOptions());
+  // user.name is read from the indexer, text and binData from the documents
+  std::vector<IndexInfo> indexes{
+      IndexInfo("IndexName1", IndexType::VECTOR, "user.name", true)};
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema, indexes);
+
+  const int docCount = 1000;
+  std::vector<Buffer> documents;
+  for (int i = 0; i < docCount; i++) {
+    // The largest values are in the middle so they have to survive the
+    // batches read after them
+    auto val = std::to_string(100000 + (i * 7919) % docCount);
+    documents.push_back(
+        TestUtils::GetTweetObject(i, i, &val, &val, i, &val));
+  }
+  db.MultiInsert("tweet", documents);
+
+  auto rs = db.ExecuteSelect(
+      "SELECT MIN(text), MAX(text), MIN([user.name]), MAX([user.name]), "
+      "MIN(binData), MAX(binData), COUNT(DISTINCT text) FROM tweet;");
+  ASSERT_TRUE(rs.Next());
+  for (int i = 0; i < 6; i += 2) {
+    ASSERT_EQ(rs.GetString(i).str(), string("100000"));
+    ASSERT_EQ(rs.GetString(i + 1).str(), string("100999"));
+  }
+  ASSERT_EQ(rs.GetInteger(6), docCount);
+
+  rs = db.ExecuteSelect(
+      "SELECT text, [user.name] FROM tweet ORDER BY text DESC;");
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(rs.GetString(0).str(), string("100999"));
+  ASSERT_EQ(rs.GetString(1).str(), string("100999"));
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(rs.GetString(0).str(), string("100998"));
+  ASSERT_EQ(rs.GetString(1).str(), string("100998"));
+}
+
+// Reads every column type across several batches, with nulls in all of the
+// string and blob columns. VECTOR indexes make the string and blob columns
+// come from the batches gathered from the indexers.
+void Execute_SelectAllColumnTypes_Test(const string& dbName,
+                                       bool vectorIndexed) {
+  string filePath = GetSchemaFilePath("tweet.bfbs");
+  string schema = File::Read(filePath);
+  Database db(g_TestRootDirectory, dbName, TestUtils::GetDefaultDBOptions());
+  std::vector<IndexInfo> indexes;
+  if (vectorIndexed) {
+    for (auto column : {"id", "text", "user.id", "user.name", "rating",
+                        "binData"}) {
+      indexes.push_back(IndexInfo(string("Index_") + column, IndexType::VECTOR,
+                                  column, true));
+    }
+  }
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema, indexes);
+
+  const int docCount = 250;
+  std::vector<Buffer> documents;
+  for (int i = 0; i < docCount; i++) {
+    string name = "user" + to_string(i);
+    string text = "tweet" + to_string(i);
+    string binData = "bin" + to_string(i);
+    documents.push_back(TestUtils::GetTweetObject(
+        i, i * 2, i % 5 == 0 ? nullptr : &name, i % 7 == 0 ? nullptr : &text,
+        i * 0.5, i % 3 == 0 ? nullptr : &binData));
+  }
+  db.MultiInsert("tweet", documents);
+
+  for (int lowerID : {0, 90}) {
+    auto rs = db.ExecuteSelect(
+        "SELECT id, text, [user.id], [user.name], rating, binData FROM tweet "
+        "WHERE id >= " +
+        to_string(lowerID) + ";");
+    int i = lowerID;
+    while (rs.Next()) {
+      ASSERT_EQ(rs.GetInteger(0), i);
+      if (i % 7 == 0) {
+        ASSERT_TRUE(rs.IsNull(1));
+      } else {
+        ASSERT_EQ(rs.GetString(1).str(), "tweet" + to_string(i));
+      }
+      ASSERT_EQ(rs.GetInteger(2), i * 2);
+      if (i % 5 == 0) {
+        ASSERT_TRUE(rs.IsNull(3));
+      } else {
+        ASSERT_EQ(rs.GetString(3).str(), "user" + to_string(i));
+      }
+      ASSERT_DOUBLE_EQ(rs.GetDouble(4), i * 0.5);
+      if (i % 3 == 0) {
+        ASSERT_TRUE(rs.IsNull(5));
+      } else {
+        auto& blob = rs.GetBlob(5);
+        ASSERT_EQ(string(blob.GetData(), blob.GetLength()),
+                  "bin" + to_string(i));
+      }
+      i++;
+    }
+    ASSERT_EQ(i, docCount);
+  }
+
+  if (vectorIndexed) {
+    auto rs = db.ExecuteSelectProfiled(
+        "SELECT text, [user.name], binData FROM tweet;");
+    while (rs.Next()) {
+    }
+    string profile = rs.GetProfile().str();
+    ASSERT_NE(profile.find("column values from indexes: 750\n"),
+              string::npos)
+        << profile;
+    ASSERT_NE(profile.find("column values from documents: 0\n"),
+              string::npos)
+        << profile;
+  }
+}
+
+TEST(Database, ExecuteSelect_AllColumnTypes) {
+  Execute_SelectAllColumnTypes_Test("ExecuteSelect_AllColumnTypes", false);
+}
+
+TEST(Database, ExecuteSelect_AllColumnTypes_VectorIndexed) {
+  Execute_SelectAllColumnTypes_Test(
+      "ExecuteSelect_AllColumnTypes_VectorIndexed", true);
+}
+
+TEST(Database, ExecuteSelect_ConcurrentQueries) {
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  Database db(g_TestRootDirectory, "ExecuteSelect_ConcurrentQueries",
+              TestUtils::GetDefaultDBOptions());
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema,
+                      std::vector<IndexInfo>());
+  std::vector<Buffer> documents;
+  std::string text = "hello";
+  for (int i = 0; i < 100; i++) {
+    std::string name = "user_" + std::to_string(i % 10);
+    documents.push_back(
+        TestUtils::GetTweetObject(i, i, &name, &text, (double)i, &text));
+  }
+  db.MultiInsert("tweet", documents);
+
+  // A collection created while a connection is in use is declared on it
+  // once it goes back to the pool
+  auto rs = db.ExecuteSelect("SELECT id FROM tweet;");
+  ASSERT_TRUE(rs.Next());
+  db.CreateCollection("tweet2", SchemaType::FLAT_BUFFERS, schema,
+                      std::vector<IndexInfo>());
+  db.MultiInsert("tweet2", documents);
+  rs = db.ExecuteSelect("SELECT COUNT(*) FROM tweet2;");
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(rs.GetInteger(0), 100);
+
+  std::atomic<int> wrongResults(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&db, &wrongResults, i] {
+      auto ps = db.Prepare("SELECT COUNT(*) FROM tweet2 WHERE id < ?;");
+      for (int j = 0; j < 200; j++) {
+        auto rs = db.ExecuteSelect(
+            "SELECT COUNT(*) FROM tweet WHERE [user.name] = 'user_" +
+            std::to_string((i + j) % 10) + "';");
+        if (!rs.Next() || rs.GetInteger(0) != 10) {
+          wrongResults++;
+        }
+        ps.BindInteger(1, j % 100);
+        rs = ps.ExecuteSelect();
+        if (!rs.Next() || rs.GetInteger(0) != j % 100) {
+          wrongResults++;
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(wrongResults, 0);
+}
+
+TEST(Database, ExecuteSelect_OnlyQueries) {
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  Database db(g_TestRootDirectory, "ExecuteSelect_OnlyQueries",
+              TestUtils::GetDefaultDBOptions());
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema,
+                      std::vector<IndexInfo>());
+  std::vector<Buffer> documents;
+  std::string text = "hello";
+  for (int i = 0; i < 10; i++) {
+    documents.push_back(
+        TestUtils::GetTweetObject(i, i, &text, &text, (double)i, &text));
+  }
+  db.MultiInsert("tweet", documents);
+
+  // The collections are declared in the temp schema of the read
+  // connections, which SQLite lets us write to
+  ASSERT_THROW(db.ExecuteSelect("DROP TABLE temp.tweet;"), SQLException);
+  ASSERT_THROW(db.ExecuteSelect("DELETE FROM tweet;"), SQLException);
+  ASSERT_THROW(db.ExecuteSelect("CREATE TABLE temp.t (a);"), SQLException);
+  ASSERT_THROW(db.ExecuteSelect("BEGIN;"), SQLException);
+
+  auto rs = db.ExecuteSelect("SELECT COUNT(*) FROM tweet;");
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(10, rs.GetInteger(0));
+}
+
+TEST(Database, ExecuteSelect_Profile) {
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  Database db(g_TestRootDirectory, "ExecuteSelect_Profile",
+              TestUtils::GetDefaultDBOptions());
+  std::vector<IndexInfo> indexes{
+      IndexInfo("IndexName1", IndexType::VECTOR, "id", true)};
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema, indexes);
+  std::vector<Buffer> documents;
+  std::string text = "hello";
+  for (int i = 0; i < 100; i++) {
+    documents.push_back(
+        TestUtils::GetTweetObject(i, i, &text, &text, (double)i, &text));
+  }
+  db.MultiInsert("tweet", documents);
+
+  auto contains = [](const std::string& profile, const std::string& text) {
+    return profile.find(text) != std::string::npos;
+  };
+
+  // id is served by its indexer, no document has to be read
+  auto rs = db.ExecuteSelectProfiled("SELECT id FROM tweet WHERE id >= 10;");
+  int rowCount = 0;
+  while (rs.Next()) {
+    rowCount++;
+  }
+  ASSERT_EQ(rowCount, 90);
+  std::string profile = rs.GetProfile().str();
+  ASSERT_TRUE(contains(profile, "Plan: SQLITE\n")) << profile;
+  ASSERT_TRUE(contains(profile, "tweet: INDEX FILTER on id >=")) << profile;
+  ASSERT_TRUE(contains(profile, "90 rows scanned")) << profile;
+  ASSERT_TRUE(contains(profile, "90 rows returned")) << profile;
+  ASSERT_TRUE(contains(profile, "column values from indexes: 90\n"))
+      << profile;
+  ASSERT_TRUE(contains(profile, "column values from documents: 0\n"))
+      << profile;
+  ASSERT_TRUE(contains(profile, "blobs read: 0,")) << profile;
+
+  // text has to be read from the documents
+  rs = db.ExecuteSelectProfiled("SELECT COUNT(text) FROM tweet;");
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(rs.GetInteger(0), 100);
+  ASSERT_FALSE(rs.Next());
+  profile = rs.GetProfile().str();
+  ASSERT_TRUE(contains(profile, "tweet: FULL SCAN")) << profile;
+  ASSERT_TRUE(contains(profile, "100 rows scanned")) << profile;
+  ASSERT_TRUE(contains(profile, "100 documents in")) << profile;
+  ASSERT_TRUE(contains(profile, "1 rows returned")) << profile;
+  ASSERT_TRUE(contains(profile, "column values from documents: 100\n"))
+      << profile;
+  ASSERT_TRUE(contains(profile, "blobs read: 100,")) << profile;
+
+  // Queries are only profiled on request
+  rs = db.ExecuteSelect("SELECT id FROM tweet;");
+  ASSERT_THROW(rs.GetProfile(), ApiMisuseException);
+}
+
+TEST(Database, EngineStats) {
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  Database db(g_TestRootDirectory, "EngineStats",
+              TestUtils::GetDefaultDBOptions());
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema,
+                      std::vector<IndexInfo>());
+  auto getStat = [&db](const std::string& name) {
+    for (auto& stat : db.GetEngineStats()) {
+      if (name == stat.name) {
+        return stat;
+      }
+    }
+    return jonoondb_engine_stat{};
+  };
+  auto inserted = getStat("documents_inserted").count;
+  auto batches = getStat("insert_batch").count;
+  auto fetched = getStat("documents_fetched").count;
+
+  std::vector<Buffer> documents;
+  std::string text = "hello";
+  for (int i = 0; i < 10; i++) {
+    documents.push_back(
+        TestUtils::GetTweetObject(i, i, &text, &text, (double)i, &text));
+  }
+  db.MultiInsert("tweet", documents);
+  auto rs = db.ExecuteSelect("SELECT text FROM tweet;");
+  while (rs.Next()) {
+  }
+
+  ASSERT_EQ(getStat("documents_inserted").count - inserted, 10);
+  ASSERT_EQ(getStat("insert_batch").count - batches, 1);
+  ASSERT_EQ(getStat("documents_fetched").count - fetched, 10);
+  ASSERT_EQ(getStat("insert_batch").isLatency, 1);
+
+  // The same stats are exposed to SQL
+  rs = db.ExecuteSelect(
+      "SELECT type, count FROM jonoondb_stats "
+      "WHERE name = 'documents_inserted';");
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(rs.GetString(0).str(), string("counter"));
+  ASSERT_GE(rs.GetInteger(1), inserted + 10);
+  ASSERT_FALSE(rs.Next());
+  rs = db.ExecuteSelect(
+      "SELECT COUNT(*) FROM jonoondb_stats "
+      "WHERE type = 'latency' AND p50_ns <= p99_ns;");
+  ASSERT_TRUE(rs.Next());
+  ASSERT_EQ(rs.GetInteger(0), 4);
+}
+
 TEST(Database, ExecuteSelect_NullStrFields) {
   Database db(g_TestRootDirectory, "ExecuteSelect_NullStrFields",
               TestUtils::GetDefaultDBOptions());
@@ -1762,3 +2415,675 @@ TEST(Database, Insert_Invalid) {
 
   ASSERT_THROW(db.Insert(collectionName, documentData), JonoonDBException);
 }
+
+TEST(Database, CreateIndex_MissingCollection) {
+  string dbName = "Database_CreateIndex_MissingCollection";
+  Database db(g_TestRootDirectory, dbName, TestUtils::GetDefaultDBOptions());
+  IndexInfo index("IndexName1", IndexType::VECTOR, "id", true);
+  ASSERT_THROW(db.CreateIndex("tweet", index), CollectionNotFoundException);
+}
+
+static int64_t GetTweetCount(Database& db, const string& whereClause) {
+  auto rs = db.ExecuteSelect("SELECT COUNT(*) FROM tweet WHERE " + whereClause);
+  int64_t count = -1;
+  while (rs.Next()) {
+    count = rs.GetInteger(0);
+  }
+
+  return count;
+}
+
+// Checks that the filter on user.name is answered by the new index and that
+// the index has the documents inserted before and while it was built
+static void AssertUserIndexUsed(Database& db, IndexType indexType,
+                                int docCount) {
+  auto rs = db.ExecuteSelectProfiled(
+      "SELECT id FROM tweet WHERE [user.name] = 'user_0';");
+  std::vector<int64_t> ids;
+  while (rs.Next()) {
+    ids.push_back(rs.GetInteger(0));
+  }
+
+  std::vector<int64_t> expectedIDs;
+  for (int64_t id = 0; id < docCount; id += 10) {
+    expectedIDs.push_back(id);
+  }
+  for (int64_t id = docCount; id < docCount + 1000; id++) {
+    expectedIDs.push_back(id);
+  }
+  std::sort(ids.begin(), ids.end());
+  ASSERT_EQ(expectedIDs, ids);
+
+  // A full scan would visit every document
+  std::string profile = rs.GetProfile().str();
+  ASSERT_NE(profile.find("tweet: INDEX FILTER on user.name ="),
+            std::string::npos)
+      << profile;
+  if (indexType != IndexType::BLOOM_FILTER) {
+    std::string rowsScanned = to_string(expectedIDs.size()) + " rows scanned";
+    ASSERT_NE(profile.find(rowsScanned), std::string::npos) << profile;
+    return;
+  }
+
+  // user_0 is in every block of a bloom filter, only blocks without the
+  // value are skipped
+  rs = db.ExecuteSelectProfiled(
+      "SELECT id FROM tweet WHERE [user.name] = 'user_10';");
+  ASSERT_FALSE(rs.Next());
+  profile = rs.GetProfile().str();
+  ASSERT_NE(profile.find("tweet: INDEX FILTER on user.name ="),
+            std::string::npos)
+      << profile;
+  ASSERT_EQ(profile.find(to_string(docCount + 1000) + " rows scanned"),
+            std::string::npos)
+      << profile;
+}
+
+void Execute_CreateIndex_PopulatedCollection_Test(const string& dbName,
+                                                  IndexType indexType) {
+  string collectionName = "tweet";
+  string dbPath = g_TestRootDirectory;
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  const int docCount = 25000;
+  {
+    Database db(dbPath, dbName, TestUtils::GetDefaultDBOptions());
+    db.CreateCollection(collectionName, SchemaType::FLAT_BUFFERS, schema,
+                        vector<IndexInfo>());
+
+    std::vector<Buffer> documents;
+    std::string text = "hello";
+    std::string binData = "some_data";
+    for (size_t i = 0; i < docCount; i++) {
+      std::string name = "user_" + to_string(i % 10);
+      documents.push_back(
+          TestUtils::GetTweetObject(i, i, &name, &text, (double)i, &binData));
+    }
+    db.MultiInsert(collectionName, documents);
+
+    // Keep inserting while the index is being built
+    std::thread writer([&] {
+      std::string name = "user_0";
+      for (size_t i = docCount; i < docCount + 1000; i++) {
+        db.Insert(collectionName, TestUtils::GetTweetObject(
+                                      i, i, &name, &text, (double)i, &binData));
+      }
+    });
+    db.CreateIndex(collectionName,
+                   IndexInfo("IndexName1", indexType, "user.name", true));
+    writer.join();
+
+    AssertUserIndexUsed(db, indexType, docCount);
+    ASSERT_EQ(docCount / 10 + 1000,
+              GetTweetCount(db, "[user.name] = 'user_0'"));
+    ASSERT_EQ(docCount / 10, GetTweetCount(db, "[user.name] = 'user_9'"));
+    IndexInfo duplicateIndex("IndexName1", indexType, "id", true);
+    ASSERT_THROW(db.CreateIndex(collectionName, duplicateIndex),
+                 IndexAlreadyExistException);
+  }
+
+  // The index should be persisted and rebuilt when the db is reopened
+  Database db(dbPath, dbName, TestUtils::GetDefaultDBOptions());
+  AssertUserIndexUsed(db, indexType, docCount);
+  IndexInfo index("IndexName1", indexType, "user.name", true);
+  ASSERT_THROW(db.CreateIndex(collectionName, index),
+               IndexAlreadyExistException);
+}
+
+TEST(Database, CreateIndex_PopulatedCollection_EWAHIndexed) {
+  Execute_CreateIndex_PopulatedCollection_Test(
+      "CreateIndex_PopulatedCollection_EWAHIndexed",
+      IndexType::INVERTED_COMPRESSED_BITMAP);
+}
+
+TEST(Database, CreateIndex_PopulatedCollection_VectorIndexed) {
+  Execute_CreateIndex_PopulatedCollection_Test(
+      "CreateIndex_PopulatedCollection_VectorIndexed", IndexType::VECTOR);
+}
+
+TEST(Database, CreateIndex_PopulatedCollection_BloomFilterIndexed) {
+  Execute_CreateIndex_PopulatedCollection_Test(
+      "CreateIndex_PopulatedCollection_BloomFilterIndexed",
+      IndexType::BLOOM_FILTER);
+}
+
+TEST(Database, ExecuteSelect_WhileInserting) {
+  string dbName = "ExecuteSelect_WhileInserting";
+  string collectionName = "tweet";
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  Database db(g_TestRootDirectory, dbName, TestUtils::GetDefaultDBOptions());
+  std::vector<IndexInfo> indexes{
+      IndexInfo("IndexName1", IndexType::INVERTED_COMPRESSED_BITMAP,
+                "user.name", true),
+      IndexInfo("IndexName2", IndexType::VECTOR, "id", true)};
+  db.CreateCollection(collectionName, SchemaType::FLAT_BUFFERS, schema,
+                      indexes);
+
+  // Every batch has one document of each user
+  const int batchSize = 10;
+  const int batchCount = 300;
+  std::thread writer([&] {
+    std::string text = "hello";
+    std::string binData = "some_data";
+    for (int batch = 0; batch < batchCount; batch++) {
+      std::vector<Buffer> documents;
+      for (int i = 0; i < batchSize; i++) {
+        std::string name = "user_" + to_string(i);
+        auto id = batch * batchSize + i;
+        documents.push_back(TestUtils::GetTweetObject(id, id, &name, &text,
+                                                      (double)id, &binData));
+      }
+      db.MultiInsert(collectionName, documents);
+    }
+  });
+
+  // Queries only ever see whole batches and never lose documents
+  int64_t lastCount = 0, lastUserCount = 0;
+  while (lastCount < batchSize * batchCount) {
+    auto count = GetTweetCount(db, "id >= 0");
+    ASSERT_EQ(count % batchSize, 0);
+    ASSERT_GE(count, lastCount);
+    auto userCount = GetTweetCount(db, "[user.name] = 'user_3'");
+    ASSERT_GE(userCount, lastUserCount);
+    ASSERT_GE(userCount, count / batchSize);
+    lastCount = count;
+    lastUserCount = userCount;
+
+    // The documents a cursor returns and their values come from one snapshot
+    auto rs = db.ExecuteSelect(
+        "SELECT COUNT(*), SUM([user.name] = 'user_3') FROM tweet "
+        "WHERE id >= 0");
+    ASSERT_TRUE(rs.Next());
+    ASSERT_EQ(rs.GetInteger(0) % batchSize, 0);
+    ASSERT_EQ(rs.GetInteger(0) / batchSize,
+              rs.IsNull(1) ? 0 : rs.GetInteger(1));
+  }
+  writer.join();
+
+  ASSERT_EQ(batchCount, GetTweetCount(db, "[user.name] = 'user_3'"));
+}
+
+TEST(Database, MultiInsert_WriteLanes) {
+  string dbName = "MultiInsert_WriteLanes";
+  string collectionName = "tweet";
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  auto options = TestUtils::GetDefaultDBOptions();
+  options.SetWriteLanes(4);
+  // Small data files so the lanes switch files in the middle of batches
+  options.SetMaxDataFileSize(16 * 1024);
+
+  const int batchSize = 10;
+  const int batchCount = 50;
+  const int writerCount = 4;
+  auto insertBatches = [&](Database& db, int firstBatch, int count) {
+    std::string text = "hello";
+    std::string binData = "some_data";
+    for (int batch = firstBatch; batch < firstBatch + count; batch++) {
+      std::vector<Buffer> documents;
+      for (int i = 0; i < batchSize; i++) {
+        std::string name = "user_" + to_string(i);
+        auto id = batch * batchSize + i;
+        documents.push_back(TestUtils::GetTweetObject(id, id, &name, &text,
+                                                      (double)id, &binData));
+      }
+      db.MultiInsert(collectionName, documents);
+    }
+  };
+
+  int64_t docCount = batchSize * batchCount * writerCount;
+  {
+    Database db(g_TestRootDirectory, dbName, options);
+    std::vector<IndexInfo> indexes{
+        IndexInfo("IndexName1", IndexType::INVERTED_COMPRESSED_BITMAP,
+                  "user.name", true),
+        IndexInfo("IndexName2", IndexType::VECTOR, "id", true)};
+    db.CreateCollection(collectionName, SchemaType::FLAT_BUFFERS, schema,
+                        indexes);
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < writerCount; w++) {
+      writers.emplace_back(insertBatches, std::ref(db), w * batchCount,
+                           batchCount);
+    }
+    for (auto& writer : writers) {
+      writer.join();
+    }
+
+    ASSERT_EQ(docCount, GetTweetCount(db, "id >= 0"));
+    ASSERT_EQ(docCount / batchSize,
+              GetTweetCount(db, "[user.name] = 'user_3'"));
+    ASSERT_EQ(docCount / 7 + 1,
+              db.Delete("DELETE FROM tweet WHERE id % 7 = 0;"));
+  }
+
+  // Deletes are stored by document id. They only remove the same documents
+  // after a reopen if the documents get the ids they had before.
+  auto deletedRange = " AND id < " + to_string(docCount);
+  int64_t liveCount = docCount - (docCount / 7 + 1);
+  for (size_t writeLanes : {1, 4}) {
+    options.SetWriteLanes(writeLanes);
+    Database db(g_TestRootDirectory, dbName, options);
+    ASSERT_EQ(liveCount, GetTweetCount(db, "id >= 0"));
+    ASSERT_EQ(0, GetTweetCount(db, "id % 7 = 0" + deletedRange));
+    ASSERT_EQ(GetTweetCount(db, "[user.name] = 'user_3' AND id % 7 <> 0"),
+              GetTweetCount(db, "[user.name] = 'user_3'"));
+
+    insertBatches(db, docCount / batchSize, 1);
+    docCount += batchSize;
+    liveCount += batchSize;
+    ASSERT_EQ(liveCount, GetTweetCount(db, "id >= 0"));
+  }
+}
+
+TEST(Database, Reopen_WriteLanes) {
+  string dbName = "Reopen_WriteLanes";
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  auto options = TestUtils::GetDefaultDBOptions();
+  options.SetWriteLanes(2);
+  auto getDocuments = [](Database& db) {
+    std::map<int64_t, int64_t> documents;
+    auto rs = db.ExecuteSelect("SELECT rowid, id FROM tweet;");
+    while (rs.Next()) {
+      documents[rs.GetInteger(0)] = rs.GetInteger(1);
+    }
+    return documents;
+  };
+
+  // The writers commit to both lanes, so the documents are not in id order
+  // in the data files
+  std::map<int64_t, int64_t> documents;
+  {
+    Database db(g_TestRootDirectory, dbName, options);
+    db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema,
+                        std::vector<IndexInfo>());
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 2; w++) {
+      writers.emplace_back([&db, w] {
+        std::string text = "hello";
+        for (int batch = 0; batch < 50; batch++) {
+          std::vector<Buffer> batchDocuments;
+          for (int i = 0; i < 10; i++) {
+            auto id = (w * 50 + batch) * 10 + i;
+            batchDocuments.push_back(TestUtils::GetTweetObject(
+                id, id, &text, &text, (double)id, &text));
+          }
+          db.MultiInsert("tweet", batchDocuments);
+        }
+      });
+    }
+    for (auto& writer : writers) {
+      writer.join();
+    }
+    documents = getDocuments(db);
+    ASSERT_EQ(1000, documents.size());
+  }
+
+  // Every document gets its id back, whatever the number of lanes
+  for (size_t writeLanes : {1, 2}) {
+    options.SetWriteLanes(writeLanes);
+    Database db(g_TestRootDirectory, dbName, options);
+    ASSERT_EQ(documents, getDocuments(db));
+  }
+}
+
+TEST(Database, Reopen_NewerDataFileVersion) {
+  string dbName = "Reopen_NewerDataFileVersion";
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  {
+    Database db(g_TestRootDirectory, dbName,
+                TestUtils::GetDefaultDBOptions());
+    db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema,
+                        std::vector<IndexInfo>());
+    std::string text = "hello";
+    db.Insert("tweet",
+              TestUtils::GetTweetObject(1, 1, &text, &text, 1.0, &text));
+  }
+
+  // The version is in the upper 4 bits of the first byte of every blob
+  {
+    std::fstream file(g_TestRootDirectory + "/" + dbName + "_tweet.0",
+                      std::ios::in | std::ios::out | std::ios::binary);
+    char verAndFlags;
+    ASSERT_TRUE(file.read(&verAndFlags, 1).good());
+    verAndFlags = static_cast<char>((verAndFlags & 0x0F) | 0xF0);
+    file.seekp(0);
+    ASSERT_TRUE(file.write(&verAndFlags, 1).good());
+  }
+
+  ASSERT_THROW(Database(g_TestRootDirectory, dbName,
+                        TestUtils::GetDefaultDBOptions()),
+               JonoonDBException);
+}
+
+TEST(Database, MultiInsert_ParallelCompression) {
+  string dbName = "MultiInsert_ParallelCompression";
+  string collectionName = "tweet";
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  auto options = TestUtils::GetDefaultDBOptions();
+  options.SetMaxInsertThreads(4);
+  WriteOptions wo(true, true);
+
+  // Enough documents for several chunks that are prepared by the workers
+  const int docCount = 5000;
+  std::vector<Buffer> documents;
+  std::string binData = "some_data";
+  for (int i = 0; i < docCount; i++) {
+    std::string name = "user_" + to_string(i % 10);
+    std::string text = "request_" + to_string(i);
+    documents.push_back(
+        TestUtils::GetTweetObject(i, i, &name, &text, (double)i, &binData));
+  }
+
+  {
+    Database db(g_TestRootDirectory, dbName, options);
+    std::vector<IndexInfo> indexes{
+        IndexInfo("IndexName1", IndexType::VECTOR, "id", true)};
+    db.CreateCollection(collectionName, SchemaType::FLAT_BUFFERS, schema,
+                        indexes);
+
+    // An invalid document in a later chunk fails the whole batch
+    auto valid = documents[4500];
+    std::string invalid(valid.GetData(), valid.GetLength());
+    invalid[0] = invalid[1] = invalid[2] = invalid[3] = '\xFF';
+    documents[4500] = Buffer(invalid.data(), invalid.size());
+    ASSERT_THROW(db.MultiInsert(collectionName, documents, wo),
+                 JonoonDBException);
+    ASSERT_EQ(0, GetTweetCount(db, "id >= 0"));
+
+    documents[4500] = valid;
+    db.MultiInsert(collectionName, documents, wo);
+    ASSERT_EQ(docCount, GetTweetCount(db, "id >= 0"));
+  }
+
+  // The documents are stored in insert order
+  Database db(g_TestRootDirectory, dbName, options);
+  auto rs = db.ExecuteSelect("SELECT id, text FROM tweet;");
+  int expectedID = 0;
+  while (rs.Next()) {
+    ASSERT_EQ(expectedID, rs.GetInteger(0));
+    ASSERT_STREQ(("request_" + to_string(expectedID)).c_str(),
+                 rs.GetString(1).str());
+    expectedID++;
+  }
+  ASSERT_EQ(docCount, expectedID);
+}
+
+TEST(Database, InsertAsync) {
+  string dbName = "InsertAsync";
+  string collectionName = "tweet";
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  auto options = TestUtils::GetDefaultDBOptions();
+  // Small enough for the writers to wait for the queue
+  options.SetInsertQueueCapacity(100);
+  const int threadCount = 4;
+  const int requestCount = 50;
+  const int requestSize = 20;
+  std::string binData = "some_data";
+  std::vector<std::vector<std::future<std::uint64_t>>> futures(threadCount);
+
+  {
+    Database db(g_TestRootDirectory, dbName, options);
+    std::vector<IndexInfo> indexes{
+        IndexInfo("IndexName1", IndexType::VECTOR, "id", true)};
+    db.CreateCollection(collectionName, SchemaType::FLAT_BUFFERS, schema,
+                        indexes);
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threadCount; t++) {
+      writers.emplace_back([&, t] {
+        for (int r = 0; r < requestCount; r++) {
+          // The tweet ids tell us which request inserted a document
+          std::vector<Buffer> documents;
+          for (int i = 0; i < requestSize; i++) {
+            auto id = (t * requestCount + r) * requestSize + i;
+            std::string name = "user_" + to_string(t);
+            std::string text = "request_" + to_string(id);
+            documents.push_back(TestUtils::GetTweetObject(
+                id, id, &name, &text, (double)id, &binData));
+          }
+          if (r % 10 == 0) {
+            // A request with a bad document fails on its own
+            std::string invalid(documents[0].GetData(),
+                                documents[0].GetLength());
+            invalid[0] = invalid[1] = invalid[2] = invalid[3] = '\xFF';
+            documents.push_back(Buffer(invalid.data(), invalid.size()));
+          }
+          futures[t].push_back(
+              db.MultiInsertAsync(collectionName, documents));
+        }
+      });
+    }
+    for (auto& writer : writers) {
+      writer.join();
+    }
+
+    auto id = -1;
+    std::string name = "user_single";
+    std::string text = "request_single";
+    auto future = db.InsertAsync(
+        collectionName,
+        TestUtils::GetTweetObject(id, id, &name, &text, 0.0, &binData));
+    auto documentID = future.get();
+    auto rs = db.ExecuteSelect("SELECT id FROM tweet WHERE rowid = " +
+                               to_string(documentID) + ";");
+    ASSERT_TRUE(rs.Next());
+    ASSERT_EQ(-1, rs.GetInteger(0));
+
+    ASSERT_THROW(db.InsertAsync("missing", Buffer("missing", 7)),
+                 CollectionNotFoundException);
+    // The queued inserts are finished before the database is closed
+  }
+
+  Database db(g_TestRootDirectory, dbName, options);
+  std::map<std::int64_t, std::int64_t> tweetIDs;
+  auto rs = db.ExecuteSelect("SELECT rowid, id FROM tweet;");
+  while (rs.Next()) {
+    tweetIDs[rs.GetInteger(0)] = rs.GetInteger(1);
+  }
+  ASSERT_EQ(threadCount * requestCount * requestSize * 9 / 10 + 1,
+            tweetIDs.size());
+
+  for (int t = 0; t < threadCount; t++) {
+    for (int r = 0; r < requestCount; r++) {
+      auto& future = futures[t][r];
+      if (r % 10 == 0) {
+        ASSERT_THROW(future.get(), JonoonDBException);
+        continue;
+      }
+
+      // The documents of a request have consecutive ids
+      auto documentID = static_cast<std::int64_t>(future.get());
+      for (int i = 0; i < requestSize; i++) {
+        auto id = (t * requestCount + r) * requestSize + i;
+        ASSERT_EQ(id, tweetIDs[documentID + i]);
+      }
+    }
+  }
+}
+
+// Writes the documents with a 4 byte size in front of each of them
+static void WriteImportFile(const string& filePath,
+                            const std::vector<Buffer>& documents,
+                            bool bigEndianSizes) {
+  std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+  for (auto& document : documents) {
+    auto size = static_cast<std::uint32_t>(document.GetLength());
+    char sizeBytes[4];
+    for (int i = 0; i < 4; i++) {
+      auto shift = bigEndianSizes ? (3 - i) * 8 : i * 8;
+      sizeBytes[i] = static_cast<char>((size >> shift) & 0xFF);
+    }
+    file.write(sizeBytes, sizeof(sizeBytes));
+    file.write(document.GetData(), document.GetLength());
+  }
+}
+
+TEST(Database, BulkImport) {
+  string dbName = "BulkImport";
+  string collectionName = "tweet";
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  string filePath = g_TestRootDirectory + "/BulkImport.data";
+  auto options = TestUtils::GetDefaultDBOptions();
+  options.SetMaxInsertThreads(4);
+  const int docCount = 25000;
+  std::vector<Buffer> documents;
+  std::uint64_t byteCount = 0;
+  std::string binData = "some_data";
+  for (int i = 0; i < docCount; i++) {
+    std::string name = "user_" + to_string(i % 10);
+    std::string text = "request_" + to_string(i);
+    documents.push_back(
+        TestUtils::GetTweetObject(i, i, &name, &text, (double)i, &binData));
+    byteCount += 4 + documents.back().GetLength();
+  }
+
+  {
+    Database db(g_TestRootDirectory, dbName, options);
+    std::vector<IndexInfo> indexes{
+        IndexInfo("IndexName1", IndexType::VECTOR, "id", true),
+        IndexInfo("IndexName2", IndexType::INVERTED_COMPRESSED_BITMAP,
+                  "user.name", true)};
+    db.CreateCollection(collectionName, SchemaType::FLAT_BUFFERS, schema,
+                        indexes);
+
+    // Small batches so the next batch is prepared while one is indexed
+    BulkImportOptions importOptions;
+    importOptions.compress = true;
+    importOptions.batchSize = 1000;
+    WriteImportFile(filePath, documents, false);
+    auto result = db.BulkImport(collectionName, filePath, importOptions);
+    ASSERT_EQ(docCount, result.documentCount);
+    ASSERT_EQ(byteCount, result.byteCount);
+    ASSERT_GT(result.GetDocumentsPerSecond(), 0);
+    ASSERT_EQ(docCount, GetTweetCount(db, "id >= 0"));
+    ASSERT_EQ(docCount / 10, GetTweetCount(db, "[user.name] = 'user_3'"));
+
+    importOptions.bigEndianSizes = true;
+    importOptions.syncEachBatch = true;
+    WriteImportFile(filePath, documents, true);
+    result = db.BulkImport(collectionName, filePath, importOptions);
+    ASSERT_EQ(docCount, result.documentCount);
+    ASSERT_EQ(2 * docCount, GetTweetCount(db, "id >= 0"));
+
+    // The complete batches before a truncated document are imported
+    documents.resize(3000);
+    WriteImportFile(filePath, documents, false);
+    std::ofstream(filePath, std::ios::binary | std::ios::app).write("\x01", 1);
+    importOptions = BulkImportOptions();
+    importOptions.batchSize = 1000;
+    ASSERT_THROW(db.BulkImport(collectionName, filePath, importOptions),
+                 JonoonDBException);
+    ASSERT_EQ(2 * docCount + 3000, GetTweetCount(db, "id >= 0"));
+
+    ASSERT_THROW(db.BulkImport(collectionName, filePath + ".missing"),
+                 FileIOException);
+    ASSERT_THROW(db.BulkImport("missing", filePath),
+                 CollectionNotFoundException);
+  }
+
+  // The imported documents are persisted in file order
+  Database db(g_TestRootDirectory, dbName, options);
+  ASSERT_EQ(2 * docCount + 3000, GetTweetCount(db, "id >= 0"));
+  auto rs = db.ExecuteSelect("SELECT rowid, id FROM tweet;");
+  std::int64_t rowCount = 0;
+  while (rs.Next()) {
+    ASSERT_EQ(rowCount, rs.GetInteger(0));
+    ASSERT_EQ(rowCount % docCount, rs.GetInteger(1));
+    rowCount++;
+  }
+}
+
+TEST(Database, ExecuteSelect_BloomFilterIndexed) {
+  string dbName = "ExecuteSelect_BloomFilterIndexed";
+  string collectionName = "tweet";
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  Database db(g_TestRootDirectory, dbName, TestUtils::GetDefaultDBOptions());
+  std::vector<IndexInfo> indexes{
+      IndexInfo("IndexName1", IndexType::BLOOM_FILTER, "id", true),
+      IndexInfo("IndexName2", IndexType::BLOOM_FILTER, "text", true),
+      IndexInfo("IndexName3", IndexType::BLOOM_FILTER, "rating", true),
+      IndexInfo("IndexName4", IndexType::INVERTED_COMPRESSED_BITMAP,
+                "user.name", true)};
+  db.CreateCollection(collectionName, SchemaType::FLAT_BUFFERS, schema,
+                      indexes);
+
+  const int docCount = 20000;
+  std::vector<Buffer> documents;
+  std::string binData = "some_data";
+  for (size_t i = 0; i < docCount; i++) {
+    std::string name = "user_" + to_string(i % 10);
+    std::string text = "request_" + to_string(i);
+    documents.push_back(
+        TestUtils::GetTweetObject(i, i, &name, &text, (double)i, &binData));
+  }
+  db.MultiInsert(collectionName, documents);
+
+  // Blocks that may contain the value are rechecked so the results are exact
+  ASSERT_EQ(1, GetTweetCount(db, "id = 12345"));
+  ASSERT_EQ(0, GetTweetCount(db, "id = 12345.5"));
+  ASSERT_EQ(0, GetTweetCount(db, "id = 1000000"));
+  ASSERT_EQ(1, GetTweetCount(db, "text = 'request_19999'"));
+  ASSERT_EQ(0, GetTweetCount(db, "text = 'request_20000'"));
+  ASSERT_EQ(1, GetTweetCount(db, "rating = 777"));
+  ASSERT_EQ(1, GetTweetCount(db, "id = 12345 AND [user.name] = 'user_5'"));
+  ASSERT_EQ(0, GetTweetCount(db, "id = 12345 AND [user.name] = 'user_4'"));
+  ASSERT_EQ(2, GetTweetCount(db, "id = 10 OR id = 19990"));
+
+  // Non equality operators are evaluated without the bloom filter
+  ASSERT_EQ(99, GetTweetCount(db, "id > 19900"));
+  ASSERT_EQ(10, GetTweetCount(db, "id >= 100 AND id < 110"));
+}
+
+void Execute_SelectNullPushdown_Test(const string& dbName,
+                                     IndexType indexType) {
+  Database db(g_TestRootDirectory, dbName, TestUtils::GetDefaultDBOptions());
+  string schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  std::vector<IndexInfo> indexes{
+      IndexInfo("IndexName1", indexType, "text", true),
+      IndexInfo("IndexName2", indexType, "user.name", true),
+      IndexInfo("IndexName3", indexType, "binData", true),
+      IndexInfo("IndexName4", indexType, "rating", true)};
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema, indexes);
+
+  // Every third document has null strings and blob
+  std::vector<Buffer> documents;
+  for (size_t i = 0; i < 99; i++) {
+    std::string name = "user_" + std::to_string(i);
+    std::string text = "hello_" + std::to_string(i);
+    std::string binData = "data_" + std::to_string(i);
+    if (i % 3 == 0) {
+      documents.push_back(TestUtils::GetTweetObject(i, i, nullptr, nullptr,
+                                                    (double)i, nullptr));
+    } else {
+      documents.push_back(TestUtils::GetTweetObject(i, i, &name, &text,
+                                                    (double)i, &binData));
+    }
+  }
+  db.MultiInsert("tweet", documents);
+
+  ASSERT_EQ(33, GetTweetCount(db, "text IS NULL"));
+  ASSERT_EQ(66, GetTweetCount(db, "text IS NOT NULL"));
+  ASSERT_EQ(33, GetTweetCount(db, "[user.name] IS NULL"));
+  ASSERT_EQ(66, GetTweetCount(db, "[user.name] IS NOT NULL"));
+  ASSERT_EQ(33, GetTweetCount(db, "binData IS NULL"));
+  ASSERT_EQ(66, GetTweetCount(db, "binData IS NOT NULL"));
+  ASSERT_EQ(0, GetTweetCount(db, "rating IS NULL"));
+  ASSERT_EQ(99, GetTweetCount(db, "rating IS NOT NULL"));
+  ASSERT_EQ(11, GetTweetCount(db, "text IS NULL AND rating < 33"));
+  ASSERT_EQ(22, GetTweetCount(db, "text IS NOT NULL AND rating < 33"));
+
+  // Range scans never return nulls
+  ASSERT_EQ(66, GetTweetCount(db, "text > ''"));
+  ASSERT_EQ(66, GetTweetCount(db, "binData > X'00'"));
+  ASSERT_EQ(66, GetTweetCount(db, "[user.name] >= 'user_' AND "
+                                  "[user.name] < 'user_a'"));
+}
+
+TEST(Database, ExecuteSelect_NullPushdown_EWAHIndexed) {
+  Execute_SelectNullPushdown_Test("ExecuteSelect_NullPushdown_EWAHIndexed",
+                                  IndexType::INVERTED_COMPRESSED_BITMAP);
+}
+
+TEST(Database, ExecuteSelect_NullPushdown_VectorIndexed) {
+  Execute_SelectNullPushdown_Test("ExecuteSelect_NullPushdown_VectorIndexed",
+                                  IndexType::VECTOR);
+}
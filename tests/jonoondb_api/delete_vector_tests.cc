@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
 #include "gtest/gtest.h"
 #include "jonoondb_api/delete_vector.h"
 #include "jonoondb_exceptions.h"
@@ -18,12 +23,12 @@ TEST(DeleteVector, DatabaseFileIsMissing) {
 TEST(DeleteVector, EmptyCheckOnDeleteVectorOnDocInsert) {
   DeleteVector delVector(g_TestRootDirectory, GetUniqueDBName(), "Collection",
                          true, 0);
-  ASSERT_TRUE(delVector.GetDeleteVectorBitmap().Empty());
+  ASSERT_TRUE(delVector.GetDeleteVectorBitmap()->Empty());
 
   // when documents are inserted
   delVector.OnDocumentsInserted(1);
   // then: the delete vector should not be empty
-  ASSERT_FALSE(delVector.GetDeleteVectorBitmap().Empty());
+  ASSERT_FALSE(delVector.GetDeleteVectorBitmap()->Empty());
 }
 
 TEST(DeleteVector, EmptyCheckOnDeleteVectorOnDocDelete) {
@@ -33,7 +38,7 @@ TEST(DeleteVector, EmptyCheckOnDeleteVectorOnDocDelete) {
   // when documents are deleted
   delVector.OnDocumentDeleted(0);
   // then: the delete vector should not be empty
-  ASSERT_FALSE(delVector.GetDeleteVectorBitmap().Empty());
+  ASSERT_FALSE(delVector.GetDeleteVectorBitmap()->Empty());
 }
 
 static void AssertEqual(const vector<int>& expectedValues,
@@ -51,7 +56,7 @@ TEST(DeleteVector, CheckBitmapOnEmptyDeleteVector) {
   DeleteVector delVector(g_TestRootDirectory, GetUniqueDBName(), "Collection",
                          true, 0);
   vector<int> expectedValues;
-  AssertEqual(expectedValues, delVector.GetDeleteVectorBitmap());
+  AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
 }
 
 TEST(DeleteVector, CheckBitmapOnNonEmptyDeleteVector) {
@@ -60,7 +65,21 @@ TEST(DeleteVector, CheckBitmapOnNonEmptyDeleteVector) {
   delVector.OnDocumentsInserted(5);
   delVector.OnDocumentDeleted(2);
   vector<int> expectedValues{0, 1, 3, 4};
-  AssertEqual(expectedValues, delVector.GetDeleteVectorBitmap());
+  AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
+}
+
+TEST(DeleteVector, BitmapIsASnapshot) {
+  DeleteVector delVector(g_TestRootDirectory, GetUniqueDBName(), "Collection",
+                         true, 0);
+  delVector.OnDocumentsInserted(3);
+  delVector.OnDocumentDeleted(1);
+  auto snapshot = delVector.GetDeleteVectorBitmap();
+
+  // Later inserts and deletes don't change a bitmap that is in use
+  delVector.OnDocumentsInserted(5);
+  delVector.OnDocumentDeleted(0);
+  AssertEqual({0, 2}, *snapshot);
+  AssertEqual({2, 3, 4}, *delVector.GetDeleteVectorBitmap());
 }
 
 TEST(DeleteVector, CheckBitmapWhenDocumentsAreInserted) {
@@ -71,7 +90,7 @@ TEST(DeleteVector, CheckBitmapWhenDocumentsAreInserted) {
   for (uint64_t i = 0; i < 5; ++i) {
     delVector.OnDocumentsInserted(i + 1);
     expectedValues.push_back(i);
-    AssertEqual(expectedValues, delVector.GetDeleteVectorBitmap());
+    AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
   }
 }
 
@@ -88,7 +107,7 @@ TEST(DeleteVector, FullDelete) {
     }
     // then: the delete vector bitmap should have no docIds marked as present
     vector<int> expectedValues;
-    AssertEqual(expectedValues, delVector.GetDeleteVectorBitmap());
+    AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
   }
 
   {
@@ -96,7 +115,7 @@ TEST(DeleteVector, FullDelete) {
     DeleteVector delVector(g_TestRootDirectory, dbName, "Collection", false, 5);
     // then: the last state of delete vector should be maintained
     vector<int> expectedValues;
-    AssertEqual(expectedValues, delVector.GetDeleteVectorBitmap());
+    AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
   }
 }
 
@@ -118,13 +137,160 @@ TEST(DeleteVector, ZigZagDelete) {
     }
     // then: the delete vector bitmap should have only the ids that were not
     // deleted
-    AssertEqual(expectedValues, delVector.GetDeleteVectorBitmap());
+    AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
   }
 
   {
     // when: the deleteVector/db is reopened
     DeleteVector delVector(g_TestRootDirectory, dbName, "Collection", false, 5);
     // then: the last state of delete vector should be maintained
-    AssertEqual(expectedValues, delVector.GetDeleteVectorBitmap());
+    AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
+  }
+}
+
+TEST(DeleteVector, BatchDelete) {
+  string dbName = GetUniqueDBName();
+  vector<int> expectedValues{2, 4};
+
+  {
+    DeleteVector delVector(g_TestRootDirectory, dbName, "Collection", true, 0);
+    delVector.OnDocumentsInserted(5);
+    delVector.OnDocumentsDeleted({1, 3});
+
+    // when: a batch has ids that are already deleted or repeated
+    delVector.OnDocumentsDeleted({3, 0, 0, 1});
+    // then: they are deleted once
+    AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
+  }
+
+  {
+    // when: the deleteVector/db is reopened
+    DeleteVector delVector(g_TestRootDirectory, dbName, "Collection", false, 5);
+    // then: all the batches should be persisted
+    AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
+  }
+}
+
+TEST(DeleteVector, ConcurrentBatchDeletes) {
+  string dbName = GetUniqueDBName();
+  const uint64_t docCount = 10000;
+  vector<int> expectedValues;
+  for (uint64_t i = 0; i < docCount; i++) {
+    if (i % 3 == 0) {
+      expectedValues.push_back(i);
+    }
+  }
+
+  {
+    // given: threads deleting overlapping sets of ids at the same time
+    DeleteVector delVector(g_TestRootDirectory, dbName, "Collection", true, 0);
+    delVector.OnDocumentsInserted(docCount);
+    vector<thread> threads;
+    for (uint64_t t = 0; t < 4; t++) {
+      threads.emplace_back([&delVector, t, docCount] {
+        for (uint64_t start = t * 10; start < docCount; start += 500) {
+          vector<uint64_t> docIds;
+          for (uint64_t i = start; i < min(start + 500, docCount); i++) {
+            if (i % 3 != 0) {
+              docIds.push_back(i);
+            }
+          }
+          delVector.OnDocumentsDeleted(docIds);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    // then: every id should be deleted exactly once
+    AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
+  }
+
+  {
+    DeleteVector delVector(g_TestRootDirectory, dbName, "Collection", false,
+                           docCount);
+    AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
+  }
+}
+
+TEST(DeleteVector, LogCompaction) {
+  string dbName = GetUniqueDBName();
+  const int64_t docCount = 20000;
+  vector<int> expectedValues{7};
+
+  {
+    // given: enough deletes to compact the log more than once, done out of
+    // order in several batches
+    DeleteVector delVector(g_TestRootDirectory, dbName, "Collection", true, 0);
+    delVector.OnDocumentsInserted(docCount);
+    for (int64_t batch = 0; batch < 4; batch++) {
+      vector<uint64_t> docIds;
+      for (int64_t i = docCount - 4 + batch; i >= 0; i -= 4) {
+        if (i != 7) {
+          docIds.push_back(i);
+        }
+      }
+      delVector.OnDocumentsDeleted(docIds);
+    }
+    AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
+  }
+
+  {
+    // when: the deleteVector/db is reopened
+    DeleteVector delVector(g_TestRootDirectory, dbName, "Collection", false,
+                           docCount);
+    // then: the deletes from both the snapshot and the log should be loaded
+    AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
+  }
+}
+
+TEST(DeleteVector, InterleavedInsertsAndDeletes) {
+  string dbName = GetUniqueDBName();
+  DeleteVector delVector(g_TestRootDirectory, dbName, "Collection", true, 0);
+  set<uint64_t> liveIds;
+  uint64_t nextDocId = 0;
+
+  // Batches of different sizes so runs start and end inside of words as well
+  // as on word boundaries
+  for (uint64_t batchSize : {1, 63, 64, 130, 7, 256, 3, 500}) {
+    delVector.OnDocumentsInserted(nextDocId + batchSize);
+    for (uint64_t i = nextDocId; i < nextDocId + batchSize; i++) {
+      liveIds.insert(i);
+    }
+    nextDocId += batchSize;
+
+    // Delete every 5th live document in one batch
+    vector<uint64_t> docIds;
+    uint64_t cnt = 0;
+    for (auto it = liveIds.begin(); it != liveIds.end();) {
+      if (cnt++ % 5 == 0) {
+        docIds.push_back(*it);
+        it = liveIds.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    delVector.OnDocumentsDeleted(docIds);
+
+    vector<int> expectedValues(liveIds.begin(), liveIds.end());
+    AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
   }
-}
\ No newline at end of file
+
+  // when: documents are deleted while a query holds the bitmap
+  auto snapshot = delVector.GetDeleteVectorBitmap();
+  delVector.OnDocumentDeleted(*liveIds.begin());
+  // then: the bitmap held by the query should still have the document
+  vector<int> expectedValues(liveIds.begin(), liveIds.end());
+  AssertEqual(expectedValues, *snapshot);
+  liveIds.erase(liveIds.begin());
+  expectedValues.assign(liveIds.begin(), liveIds.end());
+  AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
+
+  // when: more documents are inserted after the delete
+  delVector.OnDocumentsInserted(nextDocId + 10);
+  for (uint64_t i = nextDocId; i < nextDocId + 10; i++) {
+    expectedValues.push_back(static_cast<int>(i));
+  }
+  // then: the bitmap should be extended from where it ended
+  AssertEqual(expectedValues, *delVector.GetDeleteVectorBitmap());
+}
@@ -0,0 +1,146 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "blob_manager.h"
+#include "buffer_impl.h"
+#include "delete_vector.h"
+#include "document_collection.h"
+#include "document_schema.h"
+#include "enums.h"
+#include "field_accessor.h"
+#include "file.h"
+#include "filename_manager.h"
+#include "flatbuffers/flatbuffers.h"
+#include "gtest/gtest.h"
+#include "id_seq.h"
+#include "index_info_impl.h"
+#include "test_utils.h"
+#include "thread_pool.h"
+#include "tweet_generated.h"
+#include "write_options_impl.h"
+
+using namespace std;
+using namespace jonoondb_api;
+using namespace jonoondb_test;
+
+namespace {
+// Returns the vectors of the sequence one after the other
+vector<vector<uint64_t>> ReadAll(IDSequence& seq) {
+  vector<vector<uint64_t>> vectors;
+  while (seq.Next()) {
+    auto& current = seq.Current();
+    vectors.emplace_back(current.begin(), current.end());
+  }
+  // Current is empty once the sequence is consumed
+  EXPECT_EQ(seq.Current().size(), 0);
+  return vectors;
+}
+
+BufferImpl GetTweetObject(int64_t id) {
+  flatbuffers::FlatBufferBuilder fbb;
+  auto text = fbb.CreateString("tweet" + to_string(id));
+  fbb.Finish(CreateTweet(fbb, id, text, 0, id * 0.5));
+  auto size = fbb.GetSize();
+  return BufferImpl(reinterpret_cast<char*>(fbb.GetBufferPointer()), size,
+                    size);
+}
+
+// The tweets have the ids 0 to documentCount - 1 and a rating of id * 0.5
+shared_ptr<DocumentCollection> CreateTweetCollection(
+    const string& dbName, int documentCount,
+    const vector<IndexInfoImpl*>& indexes = vector<IndexInfoImpl*>()) {
+  auto fnm = make_unique<FileNameManager>(g_TestRootDirectory, dbName,
+                                          "tweet", true);
+  auto bm = make_unique<BlobManager>(move(fnm), 1024 * 1024, true, 1);
+  auto collection = make_shared<DocumentCollection>(
+      g_TestRootDirectory, dbName, "tweet", SchemaType::FLAT_BUFFERS,
+      File::Read(GetSchemaFilePath("tweet.bfbs")), indexes, move(bm),
+      vector<FileInfo>(), make_shared<ThreadPool>(1));
+
+  vector<BufferImpl> tweets;
+  for (int i = 0; i < documentCount; i++) {
+    tweets.push_back(GetTweetObject(i));
+  }
+  vector<const BufferImpl*> documents;
+  for (auto& tweet : tweets) {
+    documents.push_back(&tweet);
+  }
+  gsl::span<const BufferImpl*> span = documents;
+  collection->MultiInsert(span, WriteOptionsImpl());
+  return collection;
+}
+
+// Reads id and rating a batch at a time the way jonoondb_column_vec does
+void CheckFieldVectors(DocumentCollection& collection) {
+  auto idAccessor = collection.GetDocumentSchema()->CreateFieldAccessor("id");
+  auto ratingAccessor =
+      collection.GetDocumentSchema()->CreateFieldAccessor("rating");
+  vector<int64_t> ids;
+  vector<double> ratings;
+  vector<uint64_t> docIDs;
+  auto seq = collection.Scan(4, collection.GetDocumentCount());
+  while (seq->Next()) {
+    auto& current = seq->Current();
+    ids.resize(current.size());
+    ratings.resize(current.size());
+    collection.GetDocumentFieldsAsIntegerVector(current, *idAccessor, ids);
+    collection.GetDocumentFieldsAsDoubleVector(current, *ratingAccessor,
+                                               ratings);
+    for (size_t i = 0; i < current.size(); i++) {
+      ASSERT_EQ(ids[i], current[i]);
+      ASSERT_DOUBLE_EQ(ratings[i], current[i] * 0.5);
+    }
+    docIDs.insert(docIDs.end(), current.begin(), current.end());
+  }
+
+  vector<uint64_t> expected = {1, 2, 5, 6, 7, 8};
+  ASSERT_EQ(docIDs, expected);
+}
+}  // namespace
+
+TEST(DocumentCollection, Scan) {
+  auto collection = CreateTweetCollection("DocumentCollection_Scan", 10);
+  ASSERT_EQ(collection->GetDocumentCount(), 10);
+
+  auto seq = collection->Scan(4, 10);
+  vector<vector<uint64_t>> expected = {{0, 1, 2, 3}, {4, 5, 6, 7}, {8, 9}};
+  ASSERT_EQ(ReadAll(*seq), expected);
+
+  // Documents above the watermark are not returned
+  seq = collection->Scan(4, 6);
+  expected = {{0, 1, 2, 3}, {4, 5}};
+  ASSERT_EQ(ReadAll(*seq), expected);
+}
+
+TEST(DocumentCollection, ScanWithDeletes) {
+  auto collection =
+      CreateTweetCollection("DocumentCollection_ScanWithDeletes", 10);
+  collection->AddToDeleteVector({0, 3, 4, 9});
+
+  auto seq = collection->Scan(4, 10);
+  vector<vector<uint64_t>> expected = {{1, 2, 5, 6}, {7, 8}};
+  ASSERT_EQ(ReadAll(*seq), expected);
+
+  // Documents above the watermark are not returned
+  seq = collection->Scan(4, 6);
+  expected = {{1, 2, 5}};
+  ASSERT_EQ(ReadAll(*seq), expected);
+}
+
+TEST(DocumentCollection, GetDocumentFieldsAsVectors) {
+  auto collection = CreateTweetCollection(
+      "DocumentCollection_GetDocumentFieldsAsVectors", 10);
+  collection->AddToDeleteVector({0, 3, 4, 9});
+  CheckFieldVectors(*collection);
+}
+
+TEST(DocumentCollection, GetDocumentFieldsAsVectors_FromIndexers) {
+  IndexInfoImpl index1("IndexName1", IndexType::VECTOR, "id", true);
+  IndexInfoImpl index2("IndexName2", IndexType::VECTOR, "rating", true);
+  auto collection = CreateTweetCollection(
+      "DocumentCollection_GetDocumentFieldsAsVectors_FromIndexers", 10,
+      {&index1, &index2});
+  collection->AddToDeleteVector({0, 3, 4, 9});
+  CheckFieldVectors(*collection);
+}
@@ -0,0 +1,63 @@
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "jonoondb_api/engine_stats.h"
+
+using namespace std;
+using namespace jonoondb_api;
+
+static EngineStat GetStat(const string& name) {
+  for (auto& stat : EngineStats::GetStats()) {
+    if (name == stat.name) {
+      return stat;
+    }
+  }
+  ADD_FAILURE() << "Stat " << name << " not found.";
+  return EngineStat();
+}
+
+TEST(EngineStats, CountersAreSummedAcrossThreads) {
+  auto before = GetStat("delete_log_compactions").count;
+  vector<thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([] {
+      for (int j = 0; j < 1000; j++) {
+        EngineStats::Add(EngineCounter::DELETE_LOG_COMPACTIONS);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  auto stat = GetStat("delete_log_compactions");
+  ASSERT_FALSE(stat.isLatency);
+  ASSERT_EQ(stat.count - before, 8000);
+  ASSERT_EQ(stat.totalNanoseconds, 0);
+}
+
+TEST(EngineStats, LatencyHistogram) {
+  auto before = GetStat("connection_pool_wait");
+  // 99 fast samples and one slow one
+  for (int i = 0; i < 99; i++) {
+    EngineStats::Record(EngineLatency::CONNECTION_POOL_WAIT,
+                        chrono::nanoseconds(100));
+  }
+  EngineStats::Record(EngineLatency::CONNECTION_POOL_WAIT,
+                      chrono::nanoseconds(1000000));
+
+  auto stat = GetStat("connection_pool_wait");
+  ASSERT_TRUE(stat.isLatency);
+  ASSERT_EQ(stat.count - before.count, 100);
+  ASSERT_EQ(stat.totalNanoseconds - before.totalNanoseconds,
+            99 * 100 + 1000000);
+  ASSERT_GE(stat.maxNanoseconds, 1000000);
+  if (before.count == 0) {
+    // 100ns falls in [64, 128)
+    ASSERT_EQ(stat.p50Nanoseconds, 127);
+    ASSERT_EQ(stat.p99Nanoseconds, 127);
+  }
+}
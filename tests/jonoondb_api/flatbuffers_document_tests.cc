@@ -1,12 +1,16 @@
+#include <cstring>
 #include <string>
 #include "all_field_type_generated.h"
 #include "buffer_impl.h"
 #include "enums.h"
+#include "field_accessor.h"
 #include "file.h"
 #include "flatbuffers/flatbuffers.h"
 #include "flatbuffers_document.h"
 #include "flatbuffers_document_schema.h"
 #include "gtest/gtest.h"
+#include "jonoondb_exceptions.h"
+#include "null_helpers.h"
 #include "test_utils.h"
 
 using namespace std;
@@ -83,4 +87,158 @@ TEST(FlatbuffersDocument, GetterTest) {
   auto allFieldTypeObj = flatbuffers::GetRoot<AllFieldType>(buf2.GetData());
   // 3: Compare the values of FlatBufferDocument object and FlatBufferObject
   CompareObjects(fbDoc, *allFieldTypeObj);
-}
\ No newline at end of file
+}
+TEST(FlatbuffersFieldAccessor, GetterTest) {
+  auto schema = File::Read(GetSchemaFilePath("all_field_type.bfbs"));
+  FlatBufferBuilder fbb;
+  auto str = fbb.CreateString("joker");
+  std::vector<int8_t> bytes = {1, 2, 3};
+  auto blob = fbb.CreateVector(bytes);
+  StructType structVal(-5, 6);
+  auto nestedobject = CreateNestedAllFieldType(
+      fbb, 1, 2, true, 4, 5, 6, 7, 8.0f, 9, 10.0, str, 0, 0, 0, &structVal);
+  auto str2 = fbb.CreateString("ali");
+  auto allfieldtype =
+      CreateAllFieldType(fbb, -1, 2, false, -4, 5, -6, 7, 8.5f, -9, 10.5, str2,
+                         nestedobject, blob);
+  fbb.Finish(allfieldtype);
+  BufferImpl documentData(reinterpret_cast<char*>(fbb.GetBufferPointer()),
+                          fbb.GetSize(), fbb.GetSize());
+
+  FlatbuffersDocumentSchema docSchema(schema);
+  FlatbuffersDocument fbDoc(&docSchema, &documentData);
+  auto subDoc = fbDoc.AllocateSubDocument();
+  ASSERT_TRUE(fbDoc.TryGetDocumentValue("nestedField", *subDoc));
+
+  for (auto& fieldName : {"field1", "field2", "field3", "field4", "field5",
+                          "field6", "field7", "field9"}) {
+    auto accessor = docSchema.CreateFieldAccessor(fieldName);
+    ASSERT_EQ(accessor->GetIntegerValue(fbDoc),
+              fbDoc.GetIntegerValueAsInt64(fieldName));
+    auto nestedName = std::string("nestedField.") + fieldName;
+    accessor = docSchema.CreateFieldAccessor(nestedName);
+    ASSERT_EQ(accessor->GetFieldName(), nestedName);
+    ASSERT_EQ(accessor->GetIntegerValue(fbDoc),
+              subDoc->GetIntegerValueAsInt64(fieldName));
+  }
+
+  ASSERT_EQ(docSchema.CreateFieldAccessor("field8")->GetFloatValue(fbDoc), 8.5);
+  ASSERT_EQ(docSchema.CreateFieldAccessor("field10")->GetFloatValue(fbDoc),
+            10.5);
+  ASSERT_EQ(docSchema.CreateFieldAccessor("nestedField.field10")
+                ->GetFloatValue(fbDoc),
+            10.0);
+  ASSERT_EQ(docSchema.CreateFieldAccessor("field11")->GetStringValue(fbDoc),
+            "ali");
+  ASSERT_EQ(docSchema.CreateFieldAccessor("nestedField.field11")
+                ->GetStringValue(fbDoc),
+            "joker");
+
+  // Struct nested inside a nested table
+  ASSERT_EQ(docSchema.CreateFieldAccessor("nestedField.field15.field1")
+                ->GetIntegerValue(fbDoc),
+            -5);
+  ASSERT_EQ(docSchema.CreateFieldAccessor("nestedField.field15.field2")
+                ->GetIntegerValue(fbDoc),
+            6);
+
+  std::size_t size;
+  auto blobVal =
+      docSchema.CreateFieldAccessor("field12")->GetBlobValue(fbDoc, size);
+  ASSERT_EQ(size, bytes.size());
+  ASSERT_EQ(memcmp(blobVal, bytes.data(), size), 0);
+
+  auto docVal =
+      docSchema.CreateFieldAccessor("_document")->GetBlobValue(fbDoc, size);
+  ASSERT_EQ(docVal, documentData.GetData());
+  ASSERT_EQ(size, documentData.GetLength());
+}
+
+TEST(FlatbuffersFieldAccessor, NullFields) {
+  auto schema = File::Read(GetSchemaFilePath("all_field_type.bfbs"));
+  FlatBufferBuilder fbb;
+  // Only set a scalar, string, nested table, struct and blob are all absent
+  fbb.Finish(CreateAllFieldType(fbb, 1));
+  BufferImpl documentData(reinterpret_cast<char*>(fbb.GetBufferPointer()),
+                          fbb.GetSize(), fbb.GetSize());
+
+  FlatbuffersDocumentSchema docSchema(schema);
+  FlatbuffersDocument fbDoc(&docSchema, &documentData);
+
+  ASSERT_EQ(docSchema.CreateFieldAccessor("field1")->GetIntegerValue(fbDoc), 1);
+  // Absent scalars get their default value
+  ASSERT_EQ(docSchema.CreateFieldAccessor("field9")->GetIntegerValue(fbDoc), 0);
+  ASSERT_TRUE(NullHelpers::IsNull(
+      docSchema.CreateFieldAccessor("field11")->GetStringValue(fbDoc)));
+  ASSERT_TRUE(NullHelpers::IsNull(
+      docSchema.CreateFieldAccessor("nestedField.field11")
+          ->GetStringValue(fbDoc)));
+  ASSERT_TRUE(NullHelpers::IsNull(
+      docSchema.CreateFieldAccessor("nestedField.field9")
+          ->GetIntegerValue(fbDoc)));
+  ASSERT_TRUE(NullHelpers::IsNull(
+      docSchema.CreateFieldAccessor("nestedField.field10")
+          ->GetFloatValue(fbDoc)));
+  ASSERT_TRUE(NullHelpers::IsNull(
+      docSchema.CreateFieldAccessor("nestedField.field15.field1")
+          ->GetIntegerValue(fbDoc)));
+
+  std::size_t size;
+  ASSERT_EQ(docSchema.CreateFieldAccessor("field12")->GetBlobValue(fbDoc, size),
+            nullptr);
+  ASSERT_EQ(size, 0);
+  ASSERT_EQ(docSchema.CreateFieldAccessor("nestedField.field11")
+                ->GetStringValue(fbDoc, size),
+            nullptr);
+
+  ASSERT_FALSE(docSchema.CreateFieldAccessor("field9")->IsNull(fbDoc));
+  ASSERT_TRUE(docSchema.CreateFieldAccessor("field11")->IsNull(fbDoc));
+  ASSERT_TRUE(docSchema.CreateFieldAccessor("field12")->IsNull(fbDoc));
+  ASSERT_TRUE(
+      docSchema.CreateFieldAccessor("nestedField.field9")->IsNull(fbDoc));
+  ASSERT_TRUE(docSchema.CreateFieldAccessor("nestedField.field15.field1")
+                  ->IsNull(fbDoc));
+  ASSERT_FALSE(docSchema.CreateFieldAccessor("_document")->IsNull(fbDoc));
+}
+
+TEST(FlatbuffersFieldAccessor, SentinelValuesAreNotNull) {
+  auto schema = File::Read(GetSchemaFilePath("all_field_type.bfbs"));
+  FlatBufferBuilder fbb;
+  auto str = fbb.CreateString(JONOONDB_NULL_STR);
+  AllFieldTypeBuilder builder(fbb);
+  builder.add_field9(JONOONDB_NULL_INT64);
+  builder.add_field10(JONOONDB_NULL_DOUBLE);
+  builder.add_field11(str);
+  fbb.Finish(builder.Finish());
+  BufferImpl documentData(reinterpret_cast<char*>(fbb.GetBufferPointer()),
+                          fbb.GetSize(), fbb.GetSize());
+
+  FlatbuffersDocumentSchema docSchema(schema);
+  FlatbuffersDocument fbDoc(&docSchema, &documentData);
+  for (auto& fieldName : {"field9", "field10", "field11"}) {
+    ASSERT_FALSE(docSchema.CreateFieldAccessor(fieldName)->IsNull(fbDoc));
+  }
+  ASSERT_EQ(docSchema.CreateFieldAccessor("field9")->GetIntegerValue(fbDoc),
+            JONOONDB_NULL_INT64);
+}
+
+TEST(FlatbuffersFieldAccessor, InvalidFields) {
+  auto schema = File::Read(GetSchemaFilePath("all_field_type.bfbs"));
+  FlatbuffersDocumentSchema docSchema(schema);
+  ASSERT_THROW(docSchema.CreateFieldAccessor("missingField"),
+               JonoonDBException);
+  ASSERT_THROW(docSchema.CreateFieldAccessor("field1.field2"),
+               JonoonDBException);
+
+  auto documentData = GetAllFieldTypeObject();
+  FlatbuffersDocument fbDoc(&docSchema, &documentData);
+  std::size_t size;
+  ASSERT_THROW(
+      docSchema.CreateFieldAccessor("nestedField")->GetIntegerValue(fbDoc),
+      JonoonDBException);
+  ASSERT_THROW(docSchema.CreateFieldAccessor("field1")->GetStringValue(fbDoc),
+               JonoonDBException);
+  ASSERT_THROW(
+      docSchema.CreateFieldAccessor("field11")->GetBlobValue(fbDoc, size),
+      JonoonDBException);
+}
@@ -0,0 +1,53 @@
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "gtest/gtest.h"
+#include "id_seq.h"
+#include "mama_jennies_bitmap.h"
+
+using namespace std;
+using namespace jonoondb_api;
+
+namespace {
+// Returns the vectors of the sequence one after the other
+vector<vector<uint64_t>> ReadAll(IDSequence& seq) {
+  vector<vector<uint64_t>> vectors;
+  while (seq.Next()) {
+    auto& current = seq.Current();
+    vectors.emplace_back(current.begin(), current.end());
+  }
+  // Current is empty once the sequence is consumed
+  EXPECT_EQ(seq.Current().size(), 0);
+  return vectors;
+}
+}  // namespace
+
+TEST(IDSequence, EmptyRange) {
+  IDSequence seq(0, 4);
+  ASSERT_TRUE(ReadAll(seq).empty());
+}
+
+TEST(IDSequence, RangeMultipleOfVecSize) {
+  IDSequence seq(8, 4);
+  vector<vector<uint64_t>> expected = {{0, 1, 2, 3}, {4, 5, 6, 7}};
+  ASSERT_EQ(ReadAll(seq), expected);
+}
+
+TEST(IDSequence, RangePartialLastVector) {
+  IDSequence seq(10, 4);
+  vector<vector<uint64_t>> expected = {{0, 1, 2, 3}, {4, 5, 6, 7}, {8, 9}};
+  ASSERT_EQ(ReadAll(seq), expected);
+}
+
+TEST(IDSequence, Bitmap) {
+  auto bitmap = make_shared<MamaJenniesBitmap>();
+  bitmap->Add(1);
+  bitmap->Add(5);
+  bitmap->Add(6);
+  IDSequence seq(bitmap, 2);
+  vector<vector<uint64_t>> expected = {{1, 5}, {6}};
+  ASSERT_EQ(ReadAll(seq), expected);
+
+  IDSequence emptySeq(make_shared<MamaJenniesBitmap>(), 2);
+  ASSERT_TRUE(ReadAll(emptySeq).empty());
+}
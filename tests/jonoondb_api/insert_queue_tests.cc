@@ -0,0 +1,74 @@
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <string>
+#include <vector>
+#include "buffer_impl.h"
+#include "database_impl.h"
+#include "enums.h"
+#include "file.h"
+#include "gtest/gtest.h"
+#include "index_info_impl.h"
+#include "jonoondb_api_test_utils.h"
+#include "jonoondb_exceptions.h"
+#include "options_impl.h"
+#include "test_utils.h"
+#include "write_options_impl.h"
+
+using namespace std;
+using namespace jonoondb_api;
+using namespace jonoondb_test;
+using namespace jonoondb_api_test;
+
+namespace {
+void Push(DatabaseImpl& db, vector<const BufferImpl*>& documents,
+          InsertQueue::Callback callback) {
+  gsl::span<const BufferImpl*> span = documents;
+  db.MultiInsertAsync("tweet", span, WriteOptionsImpl(), move(callback));
+}
+}  // namespace
+
+TEST(InsertQueue, QueueFull) {
+  string dbName = "InsertQueue_QueueFull";
+  OptionsImpl options(true, 1024 * 1024, 1024LL * 1024LL * 1024LL);
+  options.SetInsertQueueCapacity(10);
+  options.SetBlockWhenInsertQueueFull(false);
+  DatabaseImpl db(g_TestRootDirectory, dbName, options);
+  vector<IndexInfoImpl*> indexes;
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS,
+                      File::Read(GetSchemaFilePath("tweet.bfbs")), indexes);
+
+  auto tweet = TestUtils::GetTweetObject();
+  vector<const BufferImpl*> one = {&tweet};
+  vector<const BufferImpl*> many(20, &tweet);
+
+  // The callback of the first request holds the writer until we release it
+  promise<void> entered;
+  promise<void> release;
+  auto released = release.get_future().share();
+  Push(db, one, [&](uint64_t, exception_ptr) {
+    entered.set_value();
+    released.wait();
+  });
+  entered.get_future().wait();
+
+  // A request bigger than the capacity is queued when the queue is empty,
+  // the queue is full until it is inserted
+  promise<uint64_t> manyDone;
+  Push(db, many, [&](uint64_t firstDocumentID, exception_ptr error) {
+    EXPECT_FALSE(error);
+    manyDone.set_value(firstDocumentID);
+  });
+  ASSERT_THROW(Push(db, one, [](uint64_t, exception_ptr) {}),
+               InsertQueueFullException);
+
+  // The space is free again once the result is reported
+  release.set_value();
+  ASSERT_EQ(manyDone.get_future().get(), 1);
+  promise<uint64_t> oneDone;
+  Push(db, one, [&](uint64_t firstDocumentID, exception_ptr error) {
+    EXPECT_FALSE(error);
+    oneDone.set_value(firstDocumentID);
+  });
+  ASSERT_EQ(oneDone.get_future().get(), 21);
+}
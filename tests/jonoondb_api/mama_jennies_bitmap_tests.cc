@@ -0,0 +1,70 @@
+#include <cstdint>
+#include <vector>
+#include "gtest/gtest.h"
+#include "jonoondb_api/jonoondb_exceptions.h"
+#include "jonoondb_api/mama_jennies_bitmap.h"
+
+using namespace std;
+using namespace jonoondb_api;
+
+namespace {
+vector<uint64_t> GetIDs(const MamaJenniesBitmap& bitmap) {
+  vector<uint64_t> ids;
+  for (auto id : bitmap) {
+    ids.push_back(id);
+  }
+  return ids;
+}
+
+// Checks that every slice has the ids of the bitmap in its range
+void CheckSplit(const MamaJenniesBitmap& bitmap,
+                const vector<uint64_t>& ends) {
+  vector<MamaJenniesBitmap> slices;
+  bitmap.Split(ends, slices);
+  ASSERT_EQ(slices.size(), ends.size());
+  auto ids = GetIDs(bitmap);
+  uint64_t start = 0;
+  for (size_t i = 0; i < ends.size(); i++) {
+    vector<uint64_t> expected;
+    for (auto id : ids) {
+      if (id >= start && id < ends[i]) {
+        expected.push_back(id);
+      }
+    }
+    ASSERT_EQ(GetIDs(slices[i]), expected) << "slice " << i;
+    ASSERT_EQ(slices[i].GetSizeInBits(), ends[i]);
+    start = ends[i];
+  }
+}
+}  // namespace
+
+TEST(MamaJenniesBitmap, Split) {
+  // Literal words, a run of ones that spans several slices, a run of zeroes
+  // and a partial last word
+  MamaJenniesBitmap bitmap;
+  for (uint64_t id = 0; id < 200; id += 3) {
+    bitmap.Add(id);
+  }
+  bitmap.AddRange(256, 1000);
+  for (uint64_t id = 2000; id < 2100; id += 7) {
+    bitmap.Add(id);
+  }
+
+  CheckSplit(bitmap, {2100});
+  CheckSplit(bitmap, {64, 512, 704, 2100});
+  CheckSplit(bitmap, {128, 1024, 2048, 2100});
+  // The last end can be within a word or a run
+  CheckSplit(bitmap, {64, 512, 900});
+  CheckSplit(bitmap, {64, 2050});
+  // Empty slices and slices past the end of the bitmap
+  CheckSplit(bitmap, {0, 64, 64, 3072, 5000});
+  CheckSplit(MamaJenniesBitmap(), {64, 128});
+}
+
+TEST(MamaJenniesBitmap, Split_InvalidEnds) {
+  MamaJenniesBitmap bitmap;
+  bitmap.AddRange(0, 1000);
+  vector<MamaJenniesBitmap> slices;
+  ASSERT_THROW(bitmap.Split({100, 1000}, slices), InvalidArgumentException);
+  ASSERT_THROW(bitmap.Split({128, 64}, slices), InvalidArgumentException);
+}
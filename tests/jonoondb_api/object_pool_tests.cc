@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include <algorithm>
+#include <atomic>
 #include <functional>
+#include <thread>
+#include <vector>
 #include "object_pool.h"
 
 using namespace jonoondb_api;
@@ -10,7 +13,9 @@ class ObjectPoolTestObject {
   int Data;
 
   ObjectPoolTestObject* AllocateObjectPoolTestObject() {
-    return new ObjectPoolTestObject();
+    auto obj = new ObjectPoolTestObject();
+    obj->Data = 0;
+    return obj;
   }
 
   ObjectPoolTestObject* AllocateNullObjectPoolTestObject() {
@@ -117,6 +122,35 @@ TEST(ObjectPool, Take_BeyondCapacity) {
   }
 }
 
+TEST(ObjectPool, TryTake) {
+  ObjectPoolTestObject obj;
+  ObjectPool<ObjectPoolTestObject> pool(
+      5, 10,
+      std::bind(&ObjectPoolTestObject::AllocateObjectPoolTestObject, obj),
+      std::bind(&ObjectPoolTestObject::DeallocateObjectPoolTestObject, obj,
+                std::placeholders::_1));
+  std::vector<ObjectPoolTestObject*> objects;
+  for (size_t i = 0; i < 10; i++) {
+    auto val = pool.TryTake();
+    ASSERT_NE(val, nullptr);
+    objects.push_back(val);
+  }
+
+  // Every object is in use, TryTake doesn't create more of them
+  ASSERT_EQ(pool.TryTake(), nullptr);
+  pool.Return(objects[3]);
+  ASSERT_EQ(pool.TryTake(), objects[3]);
+
+  // Take still creates one
+  auto extra = pool.Take();
+  ASSERT_NE(extra, nullptr);
+  ASSERT_EQ(pool.TryTake(), nullptr);
+  pool.Return(extra);
+  for (auto val : objects) {
+    pool.Return(val);
+  }
+}
+
 TEST(ObjectPool, Return) {
   ObjectPoolTestObject obj;
   ObjectPool<ObjectPoolTestObject> pool(
@@ -142,3 +176,61 @@ TEST(ObjectPool, Return) {
     ASSERT_NE(std::find(objects.begin(), objects.end(), val), objects.end());
   }
 }
+
+TEST(ObjectPool, Take_Concurrent) {
+  ObjectPoolTestObject obj;
+  ObjectPool<ObjectPoolTestObject> pool(
+      4, 8,
+      std::bind(&ObjectPoolTestObject::AllocateObjectPoolTestObject, obj),
+      std::bind(&ObjectPoolTestObject::DeallocateObjectPoolTestObject, obj,
+                std::placeholders::_1));
+
+  // An object is never handed to two threads at the same time
+  std::atomic<int> sharedCount(0);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 8; i++) {
+    threads.emplace_back([&] {
+      for (size_t j = 0; j < 10000; j++) {
+        auto val = pool.Take();
+        if (val->Data != 0) {
+          sharedCount++;
+        }
+        val->Data = 1;
+        std::this_thread::yield();
+        val->Data = 0;
+        pool.Return(val);
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(sharedCount, 0);
+}
+
+TEST(ObjectPool, ForEachIdle) {
+  ObjectPoolTestObject obj;
+  ObjectPool<ObjectPoolTestObject> pool(
+      5, 10,
+      std::bind(&ObjectPoolTestObject::AllocateObjectPoolTestObject, obj),
+      std::bind(&ObjectPoolTestObject::DeallocateObjectPoolTestObject, obj,
+                std::placeholders::_1));
+  auto inUse = pool.Take();
+  inUse->Data = 0;
+
+  int count = 0;
+  pool.ForEachIdle([&count](ObjectPoolTestObject* val) {
+    val->Data = 1;
+    count++;
+  });
+  ASSERT_EQ(count, 4);
+
+  // The visited objects are back in the pool
+  for (size_t i = 0; i < 4; i++) {
+    auto val = pool.Take();
+    ASSERT_EQ(val->Data, 1);
+    pool.Return(val);
+  }
+  pool.Return(inUse);
+}
@@ -7,6 +7,11 @@ TEST(Options, Ctor_Deafult) {
   Options opt;
   ASSERT_TRUE(opt.GetCreateDBIfMissing());
   ASSERT_EQ(opt.GetMemoryCleanupThreshold(), 1024LL * 1024LL * 1024LL * 4LL);
+  ASSERT_GE(opt.GetMaxQueryThreads(), 1);
+  ASSERT_GE(opt.GetMaxInsertThreads(), 1);
+  ASSERT_EQ(opt.GetWriteLanes(), 1);
+  ASSERT_EQ(opt.GetInsertQueueCapacity(), 100000);
+  ASSERT_TRUE(opt.GetBlockWhenInsertQueueFull());
 }
 
 TEST(Options, Ctor_Params) {
@@ -20,10 +25,20 @@ TEST(Options, Copy_Ctor) {
   Options opt1;
   opt1.SetMaxDataFileSize(12345);
   opt1.SetMemoryCleanupThreshold(1024);
+  opt1.SetMaxQueryThreads(3);
+  opt1.SetMaxInsertThreads(2);
+  opt1.SetWriteLanes(4);
+  opt1.SetInsertQueueCapacity(10);
+  opt1.SetBlockWhenInsertQueueFull(false);
   Options opt2(opt1);
   ASSERT_EQ(opt1.GetCreateDBIfMissing(), opt2.GetCreateDBIfMissing());
   ASSERT_EQ(opt1.GetMaxDataFileSize(), opt2.GetMaxDataFileSize());
   ASSERT_EQ(opt1.GetMemoryCleanupThreshold(), opt2.GetMemoryCleanupThreshold());
+  ASSERT_EQ(opt2.GetMaxQueryThreads(), 3);
+  ASSERT_EQ(opt2.GetMaxInsertThreads(), 2);
+  ASSERT_EQ(opt2.GetWriteLanes(), 4);
+  ASSERT_EQ(opt2.GetInsertQueueCapacity(), 10);
+  ASSERT_FALSE(opt2.GetBlockWhenInsertQueueFull());
 }
 
 TEST(Options, Copy_Assignment) {
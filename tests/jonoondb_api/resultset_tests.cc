@@ -80,3 +80,78 @@ TEST(Resultset, GetColumnType) {
               SqlType::DB_NULL);
   }
 }
+
+TEST(Resultset, FetchBatch) {
+  Database db(g_TestRootDirectory, "Resultset_FetchBatch",
+              TestUtils::GetDefaultDBOptions());
+  string filePath = GetSchemaFilePath("tweet.bfbs");
+  string schema = File::Read(filePath);
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema,
+                      std::vector<IndexInfo>());
+
+  const int docCount = 25;
+  std::vector<Buffer> documents;
+  std::vector<string> texts;
+  string name = "name";
+  string binData = "bin";
+  for (int i = 0; i < docCount; i++) {
+    texts.push_back("text_" + std::to_string(i));
+  }
+  for (int i = 0; i < docCount; i++) {
+    // Every third document has a null text
+    auto text = i % 3 == 0 ? nullptr : &texts[i];
+    documents.push_back(
+        TestUtils::GetTweetObject(i, i, &name, text, i / 2.0, &binData));
+  }
+  db.MultiInsert("tweet", documents);
+
+  auto rs = db.ExecuteSelect("SELECT id, rating, text FROM tweet ORDER BY id;");
+  // The texts are 6 or 7 bytes long, so the data capacity ends most batches
+  // before the row capacity does
+  std::vector<ColumnVector> columns{ColumnVector(0, SqlType::INTEGER, 10),
+                                    ColumnVector(1, SqlType::DOUBLE, 10),
+                                    ColumnVector(2, SqlType::STRING, 10, 40)};
+  auto getString = [](const ColumnVector& column, std::size_t row) {
+    auto val = column.GetString(row);
+    return string(val.str(), val.size());
+  };
+  int id = 0;
+  std::size_t rowCount;
+  while ((rowCount = rs.FetchBatch(columns)) > 0) {
+    ASSERT_LE(rowCount, 10);
+    for (std::size_t row = 0; row < rowCount; row++, id++) {
+      ASSERT_FALSE(columns[0].IsNull(row));
+      ASSERT_EQ(columns[0].GetInteger(row), id);
+      ASSERT_DOUBLE_EQ(columns[1].GetDouble(row), id / 2.0);
+      if (id % 3 == 0) {
+        ASSERT_TRUE(columns[2].IsNull(row));
+        ASSERT_EQ(columns[2].GetString(row).size(), 0);
+      } else {
+        ASSERT_FALSE(columns[2].IsNull(row));
+        ASSERT_EQ(getString(columns[2], row), texts[id]);
+      }
+    }
+
+    // Next continues where the batch stopped
+    if (id == 12) {
+      ASSERT_TRUE(rs.Next());
+      ASSERT_EQ(rs.GetInteger(0), id);
+      id++;
+    }
+  }
+  ASSERT_EQ(id, docCount);
+  ASSERT_EQ(rs.FetchBatch(columns), 0);
+
+  // Integers can be read as strings, the conversion follows SQLite
+  rs = db.ExecuteSelect("SELECT id FROM tweet WHERE id = 24;");
+  std::vector<ColumnVector> idColumn{ColumnVector(0, SqlType::STRING, 4, 2)};
+  ASSERT_EQ(rs.FetchBatch(idColumn), 1);
+  ASSERT_EQ(getString(idColumn[0], 0), "24");
+
+  // A row that doesn't fit in an empty batch is an error
+  rs = db.ExecuteSelect("SELECT text FROM tweet WHERE id = 23;");
+  std::vector<ColumnVector> smallColumn{ColumnVector(0, SqlType::STRING, 4, 2)};
+  ASSERT_THROW(rs.FetchBatch(smallColumn), InvalidArgumentException);
+  std::vector<ColumnVector> badColumn{ColumnVector(3, SqlType::INTEGER, 4)};
+  ASSERT_THROW(rs.FetchBatch(badColumn), IndexOutOfBoundException);
+}
@@ -0,0 +1,81 @@
+#include <memory>
+#include <string>
+#include "gtest/gtest.h"
+#include "jonoondb_api/guard_funcs.h"
+#include "jonoondb_api/statement_cache.h"
+#include "sqlite3.h"
+
+using namespace std;
+using namespace jonoondb_api;
+
+static unique_ptr<sqlite3, void (*)(sqlite3*)> OpenMemoryDB() {
+  sqlite3* db = nullptr;
+  int code = sqlite3_open(":memory:", &db);
+  unique_ptr<sqlite3, void (*)(sqlite3*)> dbPtr(db, GuardFuncs::SQLite3Close);
+  EXPECT_EQ(code, SQLITE_OK);
+  return dbPtr;
+}
+
+TEST(StatementCache, ReusesReleasedStatements) {
+  auto db = OpenMemoryDB();
+  string sql = "SELECT ?1 + 1;";
+  StatementCache cache(2);
+
+  sqlite3_stmt* stmt = nullptr;
+  ASSERT_EQ(cache.Acquire(db.get(), sql, stmt), SQLITE_OK);
+  ASSERT_EQ(sqlite3_bind_int64(stmt, 1, 41), SQLITE_OK);
+  ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+  ASSERT_EQ(sqlite3_column_int64(stmt, 0), 42);
+  cache.Release(sql, stmt);
+  ASSERT_EQ(cache.GetIdleCount(), 1);
+
+  // The cached statement comes back reset with its bindings cleared
+  sqlite3_stmt* cachedStmt = nullptr;
+  ASSERT_EQ(cache.Acquire(db.get(), sql, cachedStmt), SQLITE_OK);
+  ASSERT_EQ(cachedStmt, stmt);
+  ASSERT_EQ(cache.GetIdleCount(), 0);
+  ASSERT_EQ(sqlite3_step(cachedStmt), SQLITE_ROW);
+  ASSERT_EQ(sqlite3_column_type(cachedStmt, 0), SQLITE_NULL);
+
+  // Statements acquired while the SQL is in use are separate statements
+  sqlite3_stmt* otherStmt = nullptr;
+  ASSERT_EQ(cache.Acquire(db.get(), sql, otherStmt), SQLITE_OK);
+  ASSERT_NE(otherStmt, cachedStmt);
+  cache.Release(sql, cachedStmt);
+  cache.Release(sql, otherStmt);
+  ASSERT_EQ(cache.GetIdleCount(), 2);
+}
+
+TEST(StatementCache, EvictsLeastRecentlyUsed) {
+  auto db = OpenMemoryDB();
+  StatementCache cache(2);
+  string sqls[] = {"SELECT 1;", "SELECT 2;", "SELECT 3;"};
+  sqlite3_stmt* stmts[3];
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(cache.Acquire(db.get(), sqls[i], stmts[i]), SQLITE_OK);
+  }
+  for (int i = 0; i < 3; i++) {
+    cache.Release(sqls[i], stmts[i]);
+  }
+  ASSERT_EQ(cache.GetIdleCount(), 2);
+
+  // SELECT 1 was finalized, the other two are still cached
+  sqlite3_stmt* stmt = nullptr;
+  ASSERT_EQ(cache.Acquire(db.get(), sqls[2], stmt), SQLITE_OK);
+  ASSERT_EQ(stmt, stmts[2]);
+  cache.Release(sqls[2], stmt);
+  ASSERT_EQ(cache.Acquire(db.get(), sqls[1], stmt), SQLITE_OK);
+  ASSERT_EQ(stmt, stmts[1]);
+  cache.Release(sqls[1], stmt);
+  ASSERT_EQ(cache.GetIdleCount(), 2);
+}
+
+TEST(StatementCache, PrepareError) {
+  auto db = OpenMemoryDB();
+  StatementCache cache(2);
+  sqlite3_stmt* stmt = nullptr;
+  ASSERT_EQ(cache.Acquire(db.get(), "SELECT * FROM missing;", stmt),
+            SQLITE_ERROR);
+  ASSERT_EQ(stmt, nullptr);
+  ASSERT_EQ(cache.GetIdleCount(), 0);
+}
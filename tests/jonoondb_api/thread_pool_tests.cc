@@ -0,0 +1,44 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "jonoondb_api/thread_pool.h"
+
+using namespace std;
+using namespace jonoondb_api;
+
+TEST(ThreadPool, RunsAllTasks) {
+  atomic<int> count(0);
+  {
+    ThreadPool pool(4);
+    ASSERT_EQ(pool.GetThreadCount(), 4);
+    for (int i = 0; i < 1000; i++) {
+      pool.Submit([&] { count++; });
+    }
+    // The destructor runs the tasks that are still queued
+  }
+  ASSERT_EQ(count, 1000);
+}
+
+TEST(ThreadPool, TasksRunOnPoolThreads) {
+  ThreadPool pool(2);
+  atomic<bool> done(false);
+  thread::id taskThread;
+  pool.Submit([&] {
+    taskThread = this_thread::get_id();
+    done = true;
+  });
+  while (!done) {
+    this_thread::yield();
+  }
+  ASSERT_NE(taskThread, this_thread::get_id());
+}
+
+TEST(ThreadPool, NoThreads) {
+  // Without threads a task runs before Submit returns
+  ThreadPool pool(0);
+  ASSERT_EQ(pool.GetThreadCount(), 0);
+  thread::id taskThread;
+  pool.Submit([&] { taskThread = this_thread::get_id(); });
+  ASSERT_EQ(taskThread, this_thread::get_id());
+}
@@ -0,0 +1,111 @@
+#include <string>
+#include <vector>
+#include "buffer_impl.h"
+#include "database_impl.h"
+#include "enums.h"
+#include "file.h"
+#include "flatbuffers/flatbuffers.h"
+#include "gtest/gtest.h"
+#include "index_info_impl.h"
+#include "jonoondb_exceptions.h"
+#include "options_impl.h"
+#include "resultset_impl.h"
+#include "test_utils.h"
+#include "tweet_generated.h"
+#include "typed_collection.h"
+#include "write_options_impl.h"
+
+using namespace std;
+using namespace flatbuffers;
+using namespace jonoondb_api;
+using namespace jonoondb_test;
+
+namespace jonoondb_api {
+template <>
+struct TypedSchema<Tweet> {
+  static const char* GetRootTypeName() {
+    return "Tweet";
+  }
+};
+}  // namespace jonoondb_api
+
+// Tweets with an odd id don't have a user
+BufferImpl GetTypedTweetObject(int64_t id) {
+  FlatBufferBuilder fbb;
+  Offset<User> user = 0;
+  if (id % 2 == 0) {
+    auto name = fbb.CreateString("user" + to_string(id % 10));
+    user = CreateUser(fbb, name, id % 10);
+  }
+  auto text = fbb.CreateString("tweet" + to_string(id));
+  vector<int8_t> bytes = {1, 2, static_cast<int8_t>(id % 100)};
+  auto binData = fbb.CreateVector(bytes);
+  fbb.Finish(CreateTweet(fbb, id, text, user, id * 0.5, binData));
+  auto size = fbb.GetSize();
+  return BufferImpl(reinterpret_cast<char*>(fbb.GetBufferPointer()), size,
+                    size);
+}
+
+int64_t ExecuteCount(DatabaseImpl& db, const string& sql) {
+  auto rs = db.ExecuteSelect(sql);
+  EXPECT_TRUE(rs.Next());
+  return rs.GetInteger(0);
+}
+
+TEST(TypedCollection, InsertAndSelect) {
+  string dbName = "TypedCollection_InsertAndSelect";
+  OptionsImpl options(true, 1024 * 1024, 1024LL * 1024LL * 1024LL);
+  auto schema = File::Read(GetSchemaFilePath("tweet.bfbs"));
+  DatabaseImpl db(g_TestRootDirectory, dbName, options);
+  IndexInfoImpl index1("IndexName1", IndexType::INVERTED_COMPRESSED_BITMAP,
+                       "user.name", true);
+  IndexInfoImpl index2("IndexName2", IndexType::VECTOR, "rating", true);
+  IndexInfoImpl index3("IndexName3", IndexType::VECTOR, "user.id", true);
+  vector<IndexInfoImpl*> indexes = {&index1, &index2, &index3};
+  db.CreateCollection("tweet", SchemaType::FLAT_BUFFERS, schema, indexes);
+
+  TypedCollection<Tweet> tweets(db, "tweet");
+  ASSERT_EQ(tweets.GetName(), "tweet");
+  vector<BufferImpl> documents;
+  for (int64_t id = 0; id < 1000; id++) {
+    documents.push_back(GetTypedTweetObject(id));
+  }
+  vector<const BufferImpl*> docPtrs;
+  for (auto& doc : documents) {
+    docPtrs.push_back(&doc);
+  }
+  gsl::span<const BufferImpl*> span = docPtrs;
+  tweets.MultiInsert(span, WriteOptionsImpl());
+  tweets.Insert(GetTypedTweetObject(1000), WriteOptionsImpl());
+  ASSERT_EQ(TypedCollection<Tweet>::GetRoot(documents[10])->id(), 10);
+
+  // Corrupt documents are rejected by the generated verifier
+  string garbage = "this is not a tweet";
+  BufferImpl invalid(garbage.c_str(), garbage.size(), garbage.size());
+  ASSERT_THROW(tweets.Insert(invalid, WriteOptionsImpl()), JonoonDBException);
+
+  ASSERT_EQ(ExecuteCount(db, "SELECT COUNT(*) FROM tweet"), 1001);
+  ASSERT_EQ(ExecuteCount(db, "SELECT COUNT(*) FROM tweet WHERE "
+                             "[user.name] = 'user2'"),
+            100);
+  ASSERT_EQ(ExecuteCount(db, "SELECT COUNT(*) FROM tweet WHERE "
+                             "rating >= 250.0"),
+            501);
+  ASSERT_EQ(ExecuteCount(db, "SELECT SUM([user.id]) FROM tweet"),
+            100 * (2 + 4 + 6 + 8));
+}
+
+TEST(TypedCollection, SchemaWithOtherRootTypeThrows) {
+  string dbName = "TypedCollection_SchemaWithOtherRootTypeThrows";
+  OptionsImpl options(true, 1024 * 1024, 1024LL * 1024LL * 1024LL);
+  DatabaseImpl db(g_TestRootDirectory, dbName, options);
+  auto schema = File::Read(GetSchemaFilePath("all_field_type.bfbs"));
+  vector<IndexInfoImpl*> indexes;
+  db.CreateCollection("all_field_type", SchemaType::FLAT_BUFFERS, schema,
+                      indexes);
+
+  ASSERT_FALSE(TypedCollection<Tweet>::HasRootType(schema));
+  ASSERT_THROW(TypedCollection<Tweet>(db, "all_field_type"),
+               InvalidSchemaException);
+  ASSERT_FALSE(TypedCollection<Tweet>::HasRootType("not a schema"));
+}
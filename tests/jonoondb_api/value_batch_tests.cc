@@ -0,0 +1,103 @@
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "buffer_impl.h"
+#include "enums.h"
+#include "file.h"
+#include "flatbuffers/flatbuffers.h"
+#include "flatbuffers_document.h"
+#include "flatbuffers_document_schema.h"
+#include "gtest/gtest.h"
+#include "index_info_impl.h"
+#include "jonoondb_api/value_batch.h"
+#include "test_utils.h"
+#include "tweet_generated.h"
+#include "vector_string_indexer.h"
+
+using namespace std;
+using namespace flatbuffers;
+using namespace jonoondb_api;
+using namespace jonoondb_test;
+
+TEST(ValueBatch, AddValuesAndNulls) {
+  ValueBatch batch;
+  vector<string> vals = {"joker", "", "batman"};
+
+  // Enough batches to make the arena grow and then get reused
+  for (int round = 0; round < 3; round++) {
+    batch.Clear();
+    for (int i = 0; i < 100; i++) {
+      if (i % 4 == 3) {
+        batch.AddNull();
+      } else {
+        auto& val = vals[i % 4];
+        batch.Add(val.data(), val.size());
+      }
+    }
+
+    ASSERT_EQ(batch.GetCount(), 100);
+    auto values = batch.GetValues();
+    auto sizes = batch.GetSizes();
+    for (int i = 0; i < 100; i++) {
+      if (i % 4 == 3) {
+        ASSERT_TRUE(batch.IsNull(i));
+        ASSERT_EQ(values[i], nullptr);
+      } else {
+        auto& val = vals[i % 4];
+        ASSERT_FALSE(batch.IsNull(i));
+        ASSERT_NE(values[i], nullptr);
+        ASSERT_EQ(string(values[i], sizes[i]), val);
+      }
+    }
+  }
+}
+
+TEST(ValueBatch, OnlyEmptyValues) {
+  ValueBatch batch;
+  batch.Add("", 0);
+  batch.Add(nullptr, 0);
+
+  ASSERT_EQ(batch.GetCount(), 2);
+  auto values = batch.GetValues();
+  // An empty value is not null
+  ASSERT_NE(values[0], nullptr);
+  ASSERT_EQ(batch.GetSizes()[0], 0);
+  ASSERT_EQ(values[1], nullptr);
+}
+
+TEST(ValueBatch, VectorStringIndexerBatch) {
+  FlatbuffersDocumentSchema schema(
+      File::Read(GetSchemaFilePath("tweet.bfbs")));
+  IndexInfoImpl indexInfo("VectorIndex", IndexType::VECTOR, "text", true);
+  VectorStringIndexer indexer(indexInfo, schema.GetFieldType("text"),
+                              schema.CreateFieldAccessor("text"));
+
+  for (int64_t id = 0; id < 10; id++) {
+    FlatBufferBuilder fbb;
+    // Every third tweet has no text
+    auto text = id % 3 == 0 ? 0 : fbb.CreateString("tweet" + to_string(id));
+    fbb.Finish(CreateTweet(fbb, id, text));
+    BufferImpl buffer(reinterpret_cast<char*>(fbb.GetBufferPointer()),
+                      fbb.GetSize(), fbb.GetSize());
+    FlatbuffersDocument document(&schema, &buffer);
+    indexer.Insert(id, document);
+  }
+
+  vector<uint64_t> ids = {9, 1, 3, 4};
+  ValueBatch batch;
+  ASSERT_TRUE(indexer.TryGetStringVector(
+      gsl::span<uint64_t>(ids.data(), ids.size()), batch));
+  ASSERT_EQ(batch.GetCount(), ids.size());
+  auto values = batch.GetValues();
+  auto sizes = batch.GetSizes();
+  ASSERT_EQ(values[0], nullptr);
+  ASSERT_EQ(string(values[1], sizes[1]), "tweet1");
+  ASSERT_EQ(values[2], nullptr);
+  ASSERT_EQ(string(values[3], sizes[3]), "tweet4");
+
+  // Ids beyond the indexed documents can't be served from the indexer
+  ids.push_back(10);
+  ASSERT_FALSE(indexer.TryGetStringVector(
+      gsl::span<uint64_t>(ids.data(), ids.size()), batch));
+}